@@ -1,5 +1,9 @@
 #pragma once
+#include <algorithm>
+#include <stdexcept>
 #include <type_traits>
+#include <vector>
+#include "Memory.h"
 #include "Rational.h"
 
 namespace LAR
@@ -10,4 +14,26 @@ namespace LAR
 	{
 		return min + static_cast<DataType>(rand()) / (static_cast<DataType>(RAND_MAX / (max - min)));
 	}
+
+	namespace Detail
+	{
+		// Throws unless permutation holds each of 0 .. size - 1 exactly once.
+		inline void CheckPermutation(const std::vector<size_t>& permutation, const size_t size)
+		{
+			if (permutation.size() != size)
+			{
+				throw std::invalid_argument("Permutation size must match the dimension it permutes.");
+			}
+			ScratchBuffer<char> seen(size);
+			std::fill(seen.Data(), seen.Data() + size, char(0));
+			for (const size_t index : permutation)
+			{
+				if (index >= size || seen[index])
+				{
+					throw std::invalid_argument("Permutation must contain every index exactly once.");
+				}
+				seen[index] = 1;
+			}
+		}
+	} // namespace Detail
 } // namespace LAR
\ No newline at end of file
@@ -0,0 +1,474 @@
+#pragma once
+#include "SparseMatrix.h"
+#include "SparseKernels.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include "LAR_export.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace LAR
+{
+	namespace Detail
+	{
+		// y += A x for one row-major B x B block. Fixed is B when known at compile time, so the loops
+		// unroll and the accumulators stay in registers; 0 takes the runtime size b.
+		template<size_t Fixed, typename DataType>
+		inline void BlockMultiplyAdd(const size_t b, const DataType* block, const DataType* x, DataType* y)
+		{
+			const size_t size = Fixed > 0 ? Fixed : b;
+			for (size_t r = 0; r < size; ++r)
+			{
+				DataType sum = y[r];
+				for (size_t c = 0; c < size; ++c)
+				{
+					sum += block[r * size + c] * x[c];
+				}
+				y[r] = sum;
+			}
+		}
+
+		// Y += A X for one B x B block and B rows of a row-major X with k columns.
+		template<size_t Fixed, typename DataType>
+		inline void BlockMultiplyAddRows(const size_t b, const DataType* block, const size_t k, const DataType* x, const size_t ldx,
+			DataType* y, const size_t ldy)
+		{
+			const size_t size = Fixed > 0 ? Fixed : b;
+			for (size_t r = 0; r < size; ++r)
+			{
+				DataType* out = y + r * ldy;
+				for (size_t c = 0; c < size; ++c)
+				{
+					const DataType a = block[r * size + c];
+					const DataType* in = x + c * ldx;
+					for (size_t j = 0; j < k; ++j)
+					{
+						out[j] += a * in[j];
+					}
+				}
+			}
+		}
+
+		// Calls kernel(std::integral_constant<size_t, B>()) with the block size when it is one of the
+		// unrolled sizes (the 2D/3D elasticity and shell element ones), with 0 otherwise.
+		template<typename Kernel>
+		void DispatchBlockSize(const size_t b, Kernel&& kernel)
+		{
+			switch (b)
+			{
+			case 2: kernel(std::integral_constant<size_t, 2>()); break;
+			case 3: kernel(std::integral_constant<size_t, 3>()); break;
+			case 4: kernel(std::integral_constant<size_t, 4>()); break;
+			case 6: kernel(std::integral_constant<size_t, 6>()); break;
+			default: kernel(std::integral_constant<size_t, 0>()); break;
+			}
+		}
+
+		// y = A x for BSR arrays, block rows balanced across threads by block count.
+		template<size_t Fixed, typename DataType>
+		void BsrSpMV(const size_t blockRows, const size_t b, const std::vector<size_t>& blockStart, const std::vector<size_t>& columns,
+			const std::vector<DataType>& values, const DataType* x, DataType* y)
+		{
+			const size_t area = b * b;
+			ForBalancedRows(blockStart, blockRows, values.size(), [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					DataType* out = y + i * b;
+					if constexpr (Fixed > 0)
+					{
+						// Local sums do not alias x or the values, so they stay in registers.
+						DataType sums[Fixed] = {};
+						for (size_t p = blockStart[i]; p < blockStart[i + 1]; ++p)
+						{
+							BlockMultiplyAdd<Fixed>(b, values.data() + p * area, x + columns[p] * b, sums);
+						}
+						std::copy(sums, sums + Fixed, out);
+					}
+					else
+					{
+						std::fill(out, out + b, DataType(0));
+						for (size_t p = blockStart[i]; p < blockStart[i + 1]; ++p)
+						{
+							BlockMultiplyAdd<Fixed>(b, values.data() + p * area, x + columns[p] * b, out);
+						}
+					}
+				}
+			});
+		}
+
+		// C = A B for BSR A and a row-major B with k columns.
+		template<size_t Fixed, typename DataType>
+		void BsrSpMM(const size_t blockRows, const size_t b, const std::vector<size_t>& blockStart, const std::vector<size_t>& columns,
+			const std::vector<DataType>& values, const size_t k, const DataType* x, const size_t ldx, DataType* y, const size_t ldy)
+		{
+			const size_t area = b * b;
+			ForBalancedRows(blockStart, blockRows, values.size() * k, [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					DataType* out = y + i * b * ldy;
+					for (size_t r = 0; r < b; ++r)
+					{
+						std::fill(out + r * ldy, out + r * ldy + k, DataType(0));
+					}
+					for (size_t p = blockStart[i]; p < blockStart[i + 1]; ++p)
+					{
+						BlockMultiplyAddRows<Fixed>(b, values.data() + p * area, k, x + columns[p] * b * ldx, ldx, out, ldy);
+					}
+				}
+			});
+		}
+	} // namespace Detail
+
+	// Block sparse row storage: the matrix is tiled into dense B x B blocks and only blocks holding a
+	// nonzero are kept, compressed by block row. FEM matrices with several unknowns per node store
+	// one index per block instead of one per entry, and every block is applied by an unrolled dense
+	// kernel. Blocks are row-major and contiguous, ordered by block column within each block row.
+	template<typename DataType>
+	class LAR_EXPORT BsrMatrix
+	{
+	public:
+		// An all-zero matrix of blockRows x blockCols blocks.
+		BsrMatrix(const size_t blockRows, const size_t blockCols, const size_t blockSize)
+			: mBlockRows(blockRows), mBlockCols(blockCols), mBlockSize(blockSize), mBlockStart(blockRows + 1, 0)
+		{
+			if (blockSize == 0)
+			{
+				throw std::invalid_argument("Block size must be positive.");
+			}
+		}
+
+		// Keeps every block of a dense matrix that holds a nonzero.
+		BsrMatrix(const Matrix<DataType>& dense, const size_t blockSize)
+			: BsrMatrix(BlockCount(dense.GetRows(), blockSize), BlockCount(dense.GetCols(), blockSize), blockSize)
+		{
+			const size_t b = mBlockSize;
+			for (size_t i = 0; i < mBlockRows; ++i)
+			{
+				for (size_t j = 0; j < mBlockCols; ++j)
+				{
+					bool nonZero = false;
+					for (size_t r = 0; r < b && !nonZero; ++r)
+					{
+						for (size_t c = 0; c < b && !nonZero; ++c)
+						{
+							nonZero = dense(i * b + r, j * b + c) != DataType(0);
+						}
+					}
+					if (!nonZero)
+					{
+						continue;
+					}
+					mColumns.push_back(j);
+					for (size_t r = 0; r < b; ++r)
+					{
+						for (size_t c = 0; c < b; ++c)
+						{
+							mValues.push_back(dense(i * b + r, j * b + c));
+						}
+					}
+				}
+				mBlockStart[i + 1] = mColumns.size();
+			}
+		}
+
+		// Keeps every block of a sparse matrix that holds a stored entry.
+		template<SparseFormat Format>
+		BsrMatrix(const SparseMatrix<DataType, Format>& sparse, const size_t blockSize)
+			: BsrMatrix(BlockCount(sparse.GetRows(), blockSize), BlockCount(sparse.GetCols(), blockSize), blockSize)
+		{
+			const SparseMatrix<DataType, SparseFormat::CSR> rows(sparse);
+			const std::vector<size_t>& start = rows.OuterStart();
+			const std::vector<size_t>& inner = rows.InnerIndices();
+			const size_t b = mBlockSize;
+			const size_t area = b * b;
+			std::vector<size_t> slot(mBlockCols, size_t(-1));
+			for (size_t i = 0; i < mBlockRows; ++i)
+			{
+				const size_t first = mColumns.size();
+				for (size_t p = start[i * b]; p < start[(i + 1) * b]; ++p)
+				{
+					const size_t j = inner[p] / b;
+					if (slot[j] == size_t(-1))
+					{
+						slot[j] = 0;
+						mColumns.push_back(j);
+					}
+				}
+				std::sort(mColumns.begin() + first, mColumns.end());
+				for (size_t q = first; q < mColumns.size(); ++q)
+				{
+					slot[mColumns[q]] = q;
+				}
+				mValues.resize(mColumns.size() * area, DataType(0));
+				for (size_t r = 0; r < b; ++r)
+				{
+					for (size_t p = start[i * b + r]; p < start[i * b + r + 1]; ++p)
+					{
+						mValues[slot[inner[p] / b] * area + r * b + inner[p] % b] = rows.Values()[p];
+					}
+				}
+				for (size_t q = first; q < mColumns.size(); ++q)
+				{
+					slot[mColumns[q]] = size_t(-1);
+				}
+				mBlockStart[i + 1] = mColumns.size();
+			}
+		}
+
+		size_t GetRows() const { return mBlockRows * mBlockSize; }
+		size_t GetCols() const { return mBlockCols * mBlockSize; }
+		size_t GetBlockRows() const { return mBlockRows; }
+		size_t GetBlockCols() const { return mBlockCols; }
+		size_t GetBlockSize() const { return mBlockSize; }
+		size_t GetBlocks() const { return mColumns.size(); }
+		// Stored entries, including the explicit zeros inside kept blocks.
+		size_t GetStoredEntries() const { return mValues.size(); }
+
+		const std::vector<size_t>& BlockStart() const { return mBlockStart; }
+		const std::vector<size_t>& BlockColumns() const { return mColumns; }
+		const std::vector<DataType>& Values() const { return mValues; }
+		// Values may be updated in place; the block pattern may not.
+		std::vector<DataType>& Values() { return mValues; }
+
+		// The stored block at (blockRow, blockCol), row-major, or nullptr when it is not stored.
+		const DataType* FindBlock(const size_t blockRow, const size_t blockCol) const
+		{
+			if (blockRow >= mBlockRows || blockCol >= mBlockCols)
+			{
+				throw std::out_of_range("Block index out of range.");
+			}
+			const auto first = mColumns.begin() + mBlockStart[blockRow];
+			const auto last = mColumns.begin() + mBlockStart[blockRow + 1];
+			const auto found = std::lower_bound(first, last, blockCol);
+			return found != last && *found == blockCol ? mValues.data() + (found - mColumns.begin()) * mBlockSize * mBlockSize : nullptr;
+		}
+
+		DataType* FindBlock(const size_t blockRow, const size_t blockCol)
+		{
+			return const_cast<DataType*>(static_cast<const BsrMatrix&>(*this).FindBlock(blockRow, blockCol));
+		}
+
+		// Zeros the values and keeps the pattern, for reassembly into the same structure.
+		void SetZero()
+		{
+			std::fill(mValues.begin(), mValues.end(), DataType(0));
+		}
+
+		// Adds a row-major B x B block to a stored block; the pattern does not grow.
+		void AddToBlock(const size_t blockRow, const size_t blockCol, const DataType* block)
+		{
+			DataType* target = FindBlock(blockRow, blockCol);
+			if (target == nullptr)
+			{
+				throw std::invalid_argument("Block is not part of the sparsity pattern.");
+			}
+			for (size_t e = 0; e < mBlockSize * mBlockSize; ++e)
+			{
+				target[e] += block[e];
+			}
+		}
+
+		// Element (row, col), zero outside the stored blocks.
+		DataType operator()(const size_t row, const size_t col) const
+		{
+			if (row >= GetRows() || col >= GetCols())
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			const DataType* block = FindBlock(row / mBlockSize, col / mBlockSize);
+			return block == nullptr ? DataType(0) : block[(row % mBlockSize) * mBlockSize + col % mBlockSize];
+		}
+
+		Matrix<DataType> ToDense() const
+		{
+			const size_t b = mBlockSize;
+			Matrix<DataType> result(GetRows(), GetCols());
+			std::fill(result.mData, result.mData + GetRows() * GetCols(), DataType(0));
+			for (size_t i = 0; i < mBlockRows; ++i)
+			{
+				for (size_t p = mBlockStart[i]; p < mBlockStart[i + 1]; ++p)
+				{
+					for (size_t r = 0; r < b; ++r)
+					{
+						std::copy(mValues.data() + (p * b + r) * b, mValues.data() + (p * b + r + 1) * b,
+							result.mData + (i * b + r) * GetCols() + mColumns[p] * b);
+					}
+				}
+			}
+			return result;
+		}
+
+		// CSR copy holding the nonzeros of the stored blocks.
+		SparseMatrix<DataType> ToSparse() const
+		{
+			const size_t b = mBlockSize;
+			std::vector<size_t> start(GetRows() + 1, 0);
+			std::vector<size_t> inner;
+			std::vector<DataType> values;
+			for (size_t i = 0; i < mBlockRows; ++i)
+			{
+				for (size_t r = 0; r < b; ++r)
+				{
+					for (size_t p = mBlockStart[i]; p < mBlockStart[i + 1]; ++p)
+					{
+						for (size_t c = 0; c < b; ++c)
+						{
+							const DataType value = mValues[(p * b + r) * b + c];
+							if (value != DataType(0))
+							{
+								inner.push_back(mColumns[p] * b + c);
+								values.push_back(value);
+							}
+						}
+					}
+					start[i * b + r + 1] = inner.size();
+				}
+			}
+			return SparseMatrix<DataType>(GetRows(), GetCols(), std::move(start), std::move(inner), std::move(values));
+		}
+
+		// y = A x on raw arrays, the operator hook used by the Krylov solvers.
+		void Apply(const DataType* x, DataType* y) const
+		{
+			Detail::DispatchBlockSize(mBlockSize, [&](const auto fixed)
+			{
+				Detail::BsrSpMV<decltype(fixed)::value>(mBlockRows, mBlockSize, mBlockStart, mColumns, mValues, x, y);
+			});
+		}
+
+		template<bool RowVector>
+		Vector<DataType> operator*(const Vector<DataType, RowVector>& vector) const
+		{
+			if (GetCols() != vector.GetSize())
+			{
+				throw std::invalid_argument("Number of columns in matrix must match size of vector.");
+			}
+			Vector<DataType> result(GetRows());
+			Apply(vector.Data(), result.Data());
+			return result;
+		}
+
+		Matrix<DataType> operator*(const Matrix<DataType>& dense) const
+		{
+			if (GetCols() != dense.GetRows())
+			{
+				throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+			}
+			const size_t k = dense.GetCols();
+			Matrix<DataType> result(GetRows(), k);
+			Detail::DispatchBlockSize(mBlockSize, [&](const auto fixed)
+			{
+				Detail::BsrSpMM<decltype(fixed)::value>(mBlockRows, mBlockSize, mBlockStart, mColumns, mValues, k, dense.mData, k,
+					result.mData, k);
+			});
+			return result;
+		}
+
+	private:
+		template<typename OtherType>
+		friend class BsrAssembler;
+
+		static size_t BlockCount(const size_t size, const size_t blockSize)
+		{
+			if (blockSize == 0 || size % blockSize != 0)
+			{
+				throw std::invalid_argument("Matrix dimensions must be multiples of the block size.");
+			}
+			return size / blockSize;
+		}
+
+		size_t mBlockRows;
+		size_t mBlockCols;
+		size_t mBlockSize;
+		std::vector<size_t> mBlockStart;
+		std::vector<size_t> mColumns;
+		// B * B values per block, blocks in mColumns order.
+		std::vector<DataType> mValues;
+	};
+
+	// Collects element blocks in any order, as a FEM assembly loop produces them, and compresses
+	// them into a BsrMatrix; blocks added at the same position are summed. Reassembly into a known
+	// pattern can skip this and use BsrMatrix::SetZero and AddToBlock.
+	template<typename DataType>
+	class LAR_EXPORT BsrAssembler
+	{
+	public:
+		BsrAssembler(const size_t blockRows, const size_t blockCols, const size_t blockSize)
+			: mBlockRows(blockRows), mBlockCols(blockCols), mBlockSize(blockSize)
+		{
+			if (blockSize == 0)
+			{
+				throw std::invalid_argument("Block size must be positive.");
+			}
+		}
+
+		// Adds a row-major B x B block at block position (blockRow, blockCol).
+		void AddBlock(const size_t blockRow, const size_t blockCol, const DataType* block)
+		{
+			if (blockRow >= mBlockRows || blockCol >= mBlockCols)
+			{
+				throw std::invalid_argument("Block index out of range.");
+			}
+			mPositions.push_back({ blockRow, blockCol });
+			mValues.insert(mValues.end(), block, block + mBlockSize * mBlockSize);
+		}
+
+		void AddBlock(const size_t blockRow, const size_t blockCol, const Matrix<DataType>& block)
+		{
+			if (block.GetRows() != mBlockSize || block.GetCols() != mBlockSize)
+			{
+				throw std::invalid_argument("Block must be block size x block size.");
+			}
+			AddBlock(blockRow, blockCol, block.mData);
+		}
+
+		size_t GetPendingBlocks() const { return mPositions.size(); }
+
+		BsrMatrix<DataType> Assemble() const
+		{
+			const size_t area = mBlockSize * mBlockSize;
+			std::vector<size_t> order(mPositions.size());
+			std::iota(order.begin(), order.end(), size_t(0));
+			// Stable, so repeated blocks are summed in the order they were added.
+			std::stable_sort(order.begin(), order.end(), [this](const size_t x, const size_t y)
+			{
+				return mPositions[x] < mPositions[y];
+			});
+			BsrMatrix<DataType> result(mBlockRows, mBlockCols, mBlockSize);
+			for (const size_t e : order)
+			{
+				const auto& [row, col] = mPositions[e];
+				const DataType* block = mValues.data() + e * area;
+				if (!result.mColumns.empty() && result.mBlockStart[row + 1] > 0 && result.mColumns.back() == col)
+				{
+					DataType* target = result.mValues.data() + result.mValues.size() - area;
+					for (size_t v = 0; v < area; ++v)
+					{
+						target[v] += block[v];
+					}
+					continue;
+				}
+				result.mColumns.push_back(col);
+				result.mValues.insert(result.mValues.end(), block, block + area);
+				++result.mBlockStart[row + 1];
+			}
+			for (size_t i = 0; i < mBlockRows; ++i)
+			{
+				result.mBlockStart[i + 1] += result.mBlockStart[i];
+			}
+			return result;
+		}
+
+	private:
+		size_t mBlockRows;
+		size_t mBlockCols;
+		size_t mBlockSize;
+		std::vector<std::pair<size_t, size_t>> mPositions;
+		std::vector<DataType> mValues;
+	};
+} // namespace LAR
@@ -0,0 +1,873 @@
+#pragma once
+#include "Matrix.h"
+#include "Vector.h"
+#include "Gemm.h"
+#include "Hessenberg.h"
+#include "Memory.h"
+#include "QR.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace LAR
+{
+	struct EigenOptions
+	{
+		// Keep the quasi-triangular Schur factor T and the orthogonal Schur vectors Z with A = Z T Z^T.
+		bool ComputeSchurForm = false;
+		// Right eigenvectors; implies the Schur form.
+		bool ComputeEigenvectors = false;
+		// Columns per panel in the blocked Hessenberg reduction.
+		size_t BlockSize = 32;
+	};
+
+	namespace Detail
+	{
+		// Active blocks at least this large try aggressive early deflation before each QR sweep.
+		constexpr size_t EarlyDeflationMinimum = 75;
+		// Early deflation that frees more than this percentage of its window skips the next sweep.
+		constexpr size_t EarlyDeflationNibble = 14;
+		// Iterations allowed per eigenvalue before the Hessenberg QR gives up.
+		constexpr size_t HessenbergQRIterations = 60;
+
+		// Shifts taken from early deflation for an active block of the given size (LAPACK's iparmq
+		// table). They are spent two at a time, one double-shift sweep per pair.
+		inline size_t SweepShiftCount(const size_t active)
+		{
+			if (active < 30) return 2;
+			if (active < 60) return 4;
+			if (active < 150) return 10;
+			if (active < 590) return std::max<size_t>(10, active / static_cast<size_t>(std::round(std::log2(double(active)))) / 2 * 2);
+			if (active < 3000) return 64;
+			if (active < 6000) return 128;
+			return 256;
+		}
+
+		template<typename DataType>
+		bool HessenbergQR(DataType* h, const size_t ldh, const size_t n, const bool wantT, DataType* z, const size_t ldz,
+			const size_t zRows, DataType* wr, DataType* wi);
+
+		// Splits the 2 x 2 block at rows k, k+1 of the Schur form. Real pairs are rotated to upper
+		// triangular form; complex pairs are left as they are and reported as wr +- i wi.
+		template<typename DataType>
+		void SplitBlock(DataType* h, const size_t ldh, const size_t k, const size_t rowBegin,
+			const size_t colEnd, DataType* z, const size_t ldz, const size_t zRows, DataType* wr, DataType* wi)
+		{
+			auto H = [h, ldh](const size_t i, const size_t j) -> DataType& { return h[i * ldh + j]; };
+			const DataType x = H(k + 1, k + 1);
+			const DataType y = H(k, k);
+			const DataType w = H(k + 1, k) * H(k, k + 1);
+			DataType p = DataType(0.5) * (y - x);
+			const DataType q = p * p + w;
+			DataType root = std::sqrt(std::abs(q));
+			if (q < DataType(0))
+			{
+				wr[k] = wr[k + 1] = x + p;
+				wi[k] = root;
+				wi[k + 1] = -root;
+				return;
+			}
+			root = p + std::copysign(root, p);
+			const DataType sub = H(k + 1, k);
+			const DataType scale = std::abs(sub) + std::abs(root);
+			if (scale != DataType(0))
+			{
+				p = sub / scale;
+				DataType c = root / scale;
+				const DataType r = std::hypot(p, c);
+				p /= r;
+				c /= r;
+				for (size_t j = k; j <= colEnd; ++j)
+				{
+					const DataType top = H(k, j);
+					H(k, j) = c * top + p * H(k + 1, j);
+					H(k + 1, j) = c * H(k + 1, j) - p * top;
+				}
+				for (size_t i = rowBegin; i <= k + 1; ++i)
+				{
+					const DataType left = H(i, k);
+					H(i, k) = c * left + p * H(i, k + 1);
+					H(i, k + 1) = c * H(i, k + 1) - p * left;
+				}
+				if (z != nullptr)
+				{
+					for (size_t i = 0; i < zRows; ++i)
+					{
+						DataType* row = z + i * ldz;
+						const DataType left = row[k];
+						row[k] = c * left + p * row[k + 1];
+						row[k + 1] = c * row[k + 1] - p * left;
+					}
+				}
+			}
+			H(k + 1, k) = DataType(0);
+			wr[k] = H(k, k);
+			wr[k + 1] = H(k + 1, k + 1);
+			wi[k] = wi[k + 1] = DataType(0);
+		}
+
+		// Swaps the adjacent diagonal blocks of sizes p and q (1 or 2) starting at row j of the
+		// quasi-triangular n x n matrix t (Bai-Demmel direct swap): X solves A11 X - X A22 = -A12, so
+		// [X; I] spans the invariant subspace of A22 and its QR factor moves A22 to the front. The
+		// transformation is applied to all of t and accumulated into the n columns of u.
+		template<typename DataType>
+		void SwapSchurBlocks(DataType* t, const size_t n, const size_t j, const size_t p, const size_t q, DataType* u)
+		{
+			auto T = [t, n](const size_t i, const size_t k) -> DataType& { return t[i * n + k]; };
+			const size_t size = p + q;
+			const size_t unknowns = p * q;
+			DataType system[4][5] = {};
+			DataType scale = 0;
+			for (size_t c = 0; c < q; ++c)
+			{
+				for (size_t r = 0; r < p; ++r)
+				{
+					const size_t row = r + c * p;
+					for (size_t s = 0; s < p; ++s)
+					{
+						system[row][s + c * p] += T(j + r, j + s);
+					}
+					for (size_t s = 0; s < q; ++s)
+					{
+						system[row][r + s * p] -= T(j + p + s, j + p + c);
+					}
+					system[row][unknowns] = -T(j + r, j + p + c);
+				}
+			}
+			for (size_t r = 0; r < unknowns; ++r)
+			{
+				for (size_t c = 0; c < unknowns; ++c)
+				{
+					scale = std::max(scale, std::abs(system[r][c]));
+				}
+			}
+			const DataType tiny = std::max(std::numeric_limits<DataType>::epsilon() * scale, std::numeric_limits<DataType>::min());
+			for (size_t c = 0; c < unknowns; ++c)
+			{
+				size_t pivot = c;
+				for (size_t r = c + 1; r < unknowns; ++r)
+				{
+					if (std::abs(system[r][c]) > std::abs(system[pivot][c]))
+					{
+						pivot = r;
+					}
+				}
+				std::swap(system[c], system[pivot]);
+				if (std::abs(system[c][c]) < tiny)
+				{
+					system[c][c] = tiny;
+				}
+				for (size_t r = c + 1; r < unknowns; ++r)
+				{
+					const DataType factor = system[r][c] / system[c][c];
+					for (size_t k = c; k <= unknowns; ++k)
+					{
+						system[r][k] -= factor * system[c][k];
+					}
+				}
+			}
+			DataType x[4];
+			for (size_t r = unknowns; r-- > 0;)
+			{
+				DataType sum = system[r][unknowns];
+				for (size_t k = r + 1; k < unknowns; ++k)
+				{
+					sum -= system[r][k] * x[k];
+				}
+				x[r] = sum / system[r][r];
+			}
+
+			// QR of [X; I] by q reflectors, each applied to t from both sides and to u.
+			DataType w[4][2];
+			for (size_t r = 0; r < size; ++r)
+			{
+				for (size_t c = 0; c < q; ++c)
+				{
+					w[r][c] = r < p ? x[r + c * p] : (r - p == c ? DataType(1) : DataType(0));
+				}
+			}
+			std::vector<DataType> work(n);
+			for (size_t c = 0; c < q; ++c)
+			{
+				DataType v[4];
+				DataType column[4];
+				for (size_t r = c; r < size; ++r)
+				{
+					column[r - c] = w[r][c];
+				}
+				const DataType tau = HouseholderVector(column[0], column + 1, size - c - 1, size_t(1));
+				v[0] = DataType(1);
+				for (size_t r = 1; r < size - c; ++r)
+				{
+					v[r] = column[r];
+				}
+				for (size_t k = c + 1; k < q; ++k)
+				{
+					DataType dot = 0;
+					for (size_t r = 0; r < size - c; ++r)
+					{
+						dot += v[r] * w[c + r][k];
+					}
+					for (size_t r = 0; r < size - c; ++r)
+					{
+						w[c + r][k] -= tau * dot * v[r];
+					}
+				}
+				const size_t first = j + c;
+				ApplyHouseholder(v, tau, size - c, n - j, t + first * n + j, n, work.data());
+				ApplyHouseholderRight(v, tau, j + size, size - c, t + first, n);
+				ApplyHouseholderRight(v, tau, n, size - c, u + first, n);
+			}
+			for (size_t r = j + q; r < j + size; ++r)
+			{
+				for (size_t c = j; c < j + q; ++c)
+				{
+					T(r, c) = DataType(0);
+				}
+			}
+		}
+
+		// Size of the Schur block ending at row k of the quasi-triangular matrix t.
+		template<typename DataType>
+		size_t SchurBlockEndingAt(const DataType* t, const size_t n, const size_t k)
+		{
+			return k > 0 && t[k * n + k - 1] != DataType(0) ? 2 : 1;
+		}
+
+		// Aggressive early deflation (Braman-Byers-Mathias) on the trailing window of the active block
+		// [low, high]: the window is reduced to Schur form, and trailing eigenvalues whose spike entries
+		// are negligible deflate at once, typically long before their subdiagonals would converge.
+		// Undeflatable eigenvalues are swapped to the top of the window so the search can continue
+		// past them. Returns the number of deflated eigenvalues, 0 if H was left untouched.
+		template<typename DataType>
+		size_t EarlyDeflation(DataType* h, const size_t ldh, const size_t n, const size_t low, const size_t high,
+			const size_t window, const bool wantT, DataType* z, const size_t ldz, const size_t zRows,
+			std::vector<std::complex<DataType>>& shifts)
+		{
+			auto H = [h, ldh](const size_t i, const size_t j) -> DataType& { return h[i * ldh + j]; };
+			const size_t top = high + 1 - window;
+			const size_t rowBegin = wantT ? 0 : low;
+			const size_t colEnd = wantT ? n - 1 : high;
+
+			Matrix<DataType> t(window, window);
+			Matrix<DataType> u(window, window);
+			for (size_t i = 0; i < window; ++i)
+			{
+				for (size_t j = 0; j < window; ++j)
+				{
+					t.mData[i * window + j] = H(top + i, top + j);
+					u.mData[i * window + j] = i == j ? DataType(1) : DataType(0);
+				}
+			}
+			std::vector<DataType> wr(window), wi(window);
+			shifts.clear();
+			if (!HessenbergQR(t.mData, window, window, true, u.mData, window, window, wr.data(), wi.data()))
+			{
+				return 0;
+			}
+
+			const DataType eps = std::numeric_limits<DataType>::epsilon();
+			const DataType safeMinimum = std::numeric_limits<DataType>::min() * (DataType(n) / eps);
+			const DataType spike = H(top, top - 1);
+			// Walk up from the bottom: deflatable blocks stay where they are, the others are moved to
+			// the front of the undecided range, as LAPACK's laqr3 does.
+			size_t kept = window;
+			size_t front = 0;
+			while (front < kept)
+			{
+				const size_t block = SchurBlockEndingAt(t.mData, window, kept - 1);
+				const size_t start = kept - block;
+				DataType magnitude = std::abs(t.mData[(kept - 1) * window + kept - 1]);
+				DataType weight = std::abs(spike * u.mData[kept - 1]);
+				if (block == 2)
+				{
+					magnitude += std::sqrt(std::abs(t.mData[(kept - 1) * window + kept - 2])) *
+						std::sqrt(std::abs(t.mData[(kept - 2) * window + kept - 1]));
+					weight = std::max(weight, std::abs(spike * u.mData[kept - 2]));
+				}
+				if (magnitude == DataType(0))
+				{
+					magnitude = std::abs(spike);
+				}
+				if (weight <= std::max(safeMinimum, eps * magnitude))
+				{
+					kept = start;
+					continue;
+				}
+				size_t position = start;
+				while (position > front)
+				{
+					const size_t above = SchurBlockEndingAt(t.mData, window, position - 1);
+					SwapSchurBlocks(t.mData, window, position - above, above, block, u.mData);
+					position -= above;
+				}
+				front += block;
+			}
+
+			// The undeflated eigenvalues, bottom first, paired so that conjugates stay together.
+			DataType pendingReal = 0;
+			bool pending = false;
+			for (size_t end = kept; end > 0;)
+			{
+				const size_t block = SchurBlockEndingAt(t.mData, window, end - 1);
+				end -= block;
+				if (block == 2)
+				{
+					const DataType* b = t.mData + end * window + end;
+					const DataType half = (b[0] - b[window + 1]) / 2;
+					const DataType discriminant = half * half + b[1] * b[window];
+					const DataType mean = (b[0] + b[window + 1]) / 2;
+					const DataType root = std::sqrt(std::abs(discriminant));
+					shifts.emplace_back(discriminant < DataType(0) ? std::complex<DataType>(mean, root) : std::complex<DataType>(mean + root));
+					shifts.emplace_back(discriminant < DataType(0) ? std::complex<DataType>(mean, -root) : std::complex<DataType>(mean - root));
+				}
+				else if (pending)
+				{
+					shifts.emplace_back(pendingReal);
+					shifts.emplace_back(t.mData[end * window + end]);
+					pending = false;
+				}
+				else
+				{
+					pendingReal = t.mData[end * window + end];
+					pending = true;
+				}
+			}
+			if (kept == window)
+			{
+				return 0;
+			}
+
+			// Commit the window: H_w = U^T H_w U, with the spike as the new column top - 1.
+			for (size_t i = 0; i < window; ++i)
+			{
+				std::copy(t.mData + i * window, t.mData + (i + 1) * window, h + (top + i) * ldh + top);
+				H(top + i, top - 1) = i < kept ? spike * u.mData[i] : DataType(0);
+			}
+			if (top > rowBegin)
+			{
+				const size_t rows = top - rowBegin;
+				Matrix<DataType> block(rows, window);
+				for (size_t i = 0; i < rows; ++i)
+				{
+					std::copy(h + (rowBegin + i) * ldh + top, h + (rowBegin + i) * ldh + top + window, block.mData + i * window);
+					std::fill(h + (rowBegin + i) * ldh + top, h + (rowBegin + i) * ldh + top + window, DataType(0));
+				}
+				GemmAccumulate(rows, window, window, DataType(1), block.mData, window, Op::NoTrans, u.mData, window, Op::NoTrans,
+					h + rowBegin * ldh + top, ldh);
+			}
+			if (colEnd > high)
+			{
+				const size_t cols = colEnd - high;
+				Matrix<DataType> block(window, cols);
+				for (size_t i = 0; i < window; ++i)
+				{
+					std::copy(h + (top + i) * ldh + high + 1, h + (top + i) * ldh + colEnd + 1, block.mData + i * cols);
+					std::fill(h + (top + i) * ldh + high + 1, h + (top + i) * ldh + colEnd + 1, DataType(0));
+				}
+				GemmAccumulate(window, cols, window, DataType(1), u.mData, window, Op::Trans, block.mData, cols, Op::NoTrans,
+					h + top * ldh + high + 1, ldh);
+			}
+			if (z != nullptr)
+			{
+				Matrix<DataType> block(zRows, window);
+				for (size_t i = 0; i < zRows; ++i)
+				{
+					std::copy(z + i * ldz + top, z + i * ldz + top + window, block.mData + i * window);
+					std::fill(z + i * ldz + top, z + i * ldz + top + window, DataType(0));
+				}
+				GemmAccumulate(zRows, window, window, DataType(1), block.mData, window, Op::NoTrans, u.mData, window, Op::NoTrans,
+					z + top, ldz);
+			}
+
+			// The spike makes rows top..top+kept-1 full again; one reflector folds it into H(top, top-1)
+			// and a Householder sweep restores Hessenberg form on the undeflated part.
+			std::vector<DataType> v(kept);
+			std::vector<DataType> work(n);
+			for (size_t c = top - 1; c + 2 < top + kept; ++c)
+			{
+				const size_t count = top + kept - c - 1;
+				const DataType tau = HouseholderVector(H(c + 1, c), h + (c + 2) * ldh + c, count - 1, ldh);
+				v[0] = DataType(1);
+				for (size_t r = 1; r < count; ++r)
+				{
+					v[r] = H(c + 1 + r, c);
+					H(c + 1 + r, c) = DataType(0);
+				}
+				ApplyHouseholder(v.data(), tau, count, colEnd - c, h + (c + 1) * ldh + c + 1, ldh, work.data());
+				ApplyHouseholderRight(v.data(), tau, top + kept - rowBegin, count, h + rowBegin * ldh + c + 1, ldh);
+				if (z != nullptr)
+				{
+					ApplyHouseholderRight(v.data(), tau, zRows, count, z + c + 1, ldz);
+				}
+			}
+			return window - kept;
+		}
+
+		// One Francis double-shift sweep over the active block [low, high]: the bulge is started from
+		// the first column of (H - s1)(H - s2), where s1 + s2 = x + y and s1 s2 = x y - w, and chased
+		// down with 3 x 3 reflectors.
+		template<typename DataType>
+		void FrancisSweep(DataType* h, const size_t ldh, const size_t n, const size_t low, const size_t high,
+			DataType x, DataType y, const DataType w, const bool wantT, DataType* z, const size_t ldz, const size_t zRows)
+		{
+			auto H = [h, ldh](const size_t i, const size_t j) -> DataType& { return h[i * ldh + j]; };
+			const DataType eps = std::numeric_limits<DataType>::epsilon();
+			const size_t rowBegin = wantT ? 0 : low;
+			const size_t colEnd = wantT ? n - 1 : high;
+
+			// Look for two consecutive small subdiagonals so the sweep can start above the bottom.
+			size_t m = high - 2;
+			DataType p, q, r;
+			while (true)
+			{
+				const DataType diagonal = H(m, m);
+				const DataType rx = x - diagonal;
+				const DataType sy = y - diagonal;
+				p = (rx * sy - w) / H(m + 1, m) + H(m, m + 1);
+				q = H(m + 1, m + 1) - diagonal - rx - sy;
+				r = H(m + 2, m + 1);
+				const DataType s = std::abs(p) + std::abs(q) + std::abs(r);
+				p /= s;
+				q /= s;
+				r /= s;
+				if (m == low)
+				{
+					break;
+				}
+				const DataType u = std::abs(H(m, m - 1)) * (std::abs(q) + std::abs(r));
+				const DataType v = std::abs(p) * (std::abs(H(m - 1, m - 1)) + std::abs(diagonal) + std::abs(H(m + 1, m + 1)));
+				if (u <= eps * v)
+				{
+					break;
+				}
+				--m;
+			}
+			for (size_t i = m; i + 1 < high; ++i)
+			{
+				H(i + 2, i) = DataType(0);
+				if (i != m)
+				{
+					H(i + 2, i - 1) = DataType(0);
+				}
+			}
+
+			// Chase the bulge with 3 x 3 reflectors.
+			for (size_t k = m; k < high; ++k)
+			{
+				const bool full = k + 1 != high;
+				if (k != m)
+				{
+					p = H(k, k - 1);
+					q = H(k + 1, k - 1);
+					r = full ? H(k + 2, k - 1) : DataType(0);
+					x = std::abs(p) + std::abs(q) + std::abs(r);
+					if (x != DataType(0))
+					{
+						p /= x;
+						q /= x;
+						r /= x;
+					}
+				}
+				const DataType s = std::copysign(std::sqrt(p * p + q * q + r * r), p);
+				if (s == DataType(0))
+				{
+					continue;
+				}
+				if (k == m)
+				{
+					if (low != m)
+					{
+						H(k, k - 1) = -H(k, k - 1);
+					}
+				}
+				else
+				{
+					H(k, k - 1) = -s * x;
+					H(k + 1, k - 1) = DataType(0);
+					if (full)
+					{
+						H(k + 2, k - 1) = DataType(0);
+					}
+				}
+				p += s;
+				x = p / s;
+				y = q / s;
+				const DataType zeta = r / s;
+				q /= p;
+				r /= p;
+				for (size_t j = k; j <= colEnd; ++j)
+				{
+					DataType sum = H(k, j) + q * H(k + 1, j);
+					if (full)
+					{
+						sum += r * H(k + 2, j);
+						H(k + 2, j) -= sum * zeta;
+					}
+					H(k + 1, j) -= sum * y;
+					H(k, j) -= sum * x;
+				}
+				const size_t rowEnd = std::min(high, k + 3);
+				for (size_t i = rowBegin; i <= rowEnd; ++i)
+				{
+					DataType sum = x * H(i, k) + y * H(i, k + 1);
+					if (full)
+					{
+						sum += zeta * H(i, k + 2);
+						H(i, k + 2) -= sum * r;
+					}
+					H(i, k + 1) -= sum * q;
+					H(i, k) -= sum;
+				}
+				if (z != nullptr)
+				{
+					for (size_t i = 0; i < zRows; ++i)
+					{
+						DataType* row = z + i * ldz;
+						DataType sum = x * row[k] + y * row[k + 1];
+						if (full)
+						{
+							sum += zeta * row[k + 2];
+							row[k + 2] -= sum * r;
+						}
+						row[k + 1] -= sum * q;
+						row[k] -= sum;
+					}
+				}
+			}
+		}
+
+		// Francis double-shift QR on the upper Hessenberg n x n matrix h (row stride ldh), following
+		// EISPACK's hqr2 with exceptional shifts every tenth iteration. Large active blocks use
+		// aggressive early deflation, and the eigenvalues it could not deflate become the shifts of a
+		// run of double-shift sweeps. Each sweep chases its bulge to the bottom before the next starts,
+		// with level-2 updates; this is not LAPACK's multishift laqr5, which chases a chain of small
+		// bulges together and applies the accumulated reflectors with Gemm. wr/wi receive
+		// the eigenvalues, complex pairs as wr +- i wi with the positive imaginary part first. With
+		// wantT the full matrix is driven to real Schur form, otherwise only the active block is
+		// updated. Transformations are accumulated into the first zRows rows of z when it is given.
+		// Returns false if an eigenvalue failed to converge.
+		template<typename DataType>
+		bool HessenbergQR(DataType* h, const size_t ldh, const size_t n, const bool wantT, DataType* z, const size_t ldz,
+			const size_t zRows, DataType* wr, DataType* wi)
+		{
+			auto H = [h, ldh](const size_t i, const size_t j) -> DataType& { return h[i * ldh + j]; };
+			const DataType eps = std::numeric_limits<DataType>::epsilon();
+			DataType norm = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				for (size_t j = i > 0 ? i - 1 : 0; j < n; ++j)
+				{
+					norm += std::abs(H(i, j));
+				}
+			}
+
+			std::vector<std::complex<DataType>> shifts;
+			size_t remaining = n;
+			size_t iterations = 0;
+			while (remaining > 0)
+			{
+				size_t high = remaining - 1;
+				size_t low = high;
+				for (; low > 0; --low)
+				{
+					DataType scale = std::abs(H(low - 1, low - 1)) + std::abs(H(low, low));
+					if (scale == DataType(0))
+					{
+						scale = norm;
+					}
+					if (std::abs(H(low, low - 1)) <= eps * scale)
+					{
+						H(low, low - 1) = DataType(0);
+						break;
+					}
+				}
+
+				if (low == high)
+				{
+					wr[high] = H(high, high);
+					wi[high] = DataType(0);
+					remaining -= 1;
+					iterations = 0;
+					continue;
+				}
+				if (low + 1 == high)
+				{
+					SplitBlock(h, ldh, low, wantT ? 0 : low, wantT ? n - 1 : high, z, ldz, zRows, wr, wi);
+					remaining -= 2;
+					iterations = 0;
+					continue;
+				}
+				if (++iterations > HessenbergQRIterations)
+				{
+					return false;
+				}
+
+				const size_t active = high - low + 1;
+				if (active >= EarlyDeflationMinimum && iterations % 10 != 0)
+				{
+					const size_t shiftCount = SweepShiftCount(active);
+					const size_t window = std::min(active - 1, active > 500 ? 3 * shiftCount / 2 : shiftCount);
+					const size_t deflated = EarlyDeflation(h, ldh, n, low, high, window, wantT, z, ldz, zRows, shifts);
+					if (deflated > 0)
+					{
+						iterations = 0;
+					}
+					// Enough progress: look for further deflations before spending a sweep.
+					if (deflated > 0 && (deflated * 100 > EarlyDeflationNibble * window || high - deflated < low + EarlyDeflationMinimum))
+					{
+						continue;
+					}
+					high -= deflated;
+					const size_t pairs = std::min(shifts.size(), shiftCount) / 2;
+					for (size_t k = 0; k < pairs; ++k)
+					{
+						const std::complex<DataType> first = shifts[2 * k];
+						const std::complex<DataType> second = shifts[2 * k + 1];
+						const DataType x = (first.real() + second.real()) / 2;
+						const DataType difference = (first.real() - second.real()) / 2;
+						// Conjugate pair a +- ib: w = -b^2. Two real shifts: w = ((s1 - s2) / 2)^2.
+						const DataType w = first.imag() != DataType(0) ? -first.imag() * first.imag() : difference * difference;
+						FrancisSweep(h, ldh, n, low, high, x, x, w, wantT, z, ldz, zRows);
+					}
+					if (pairs > 0)
+					{
+						continue;
+					}
+				}
+
+				// Shifts are the eigenvalues of the trailing 2 x 2 block, or ad hoc values to break cycles.
+				DataType x = H(high, high);
+				DataType y = H(high - 1, high - 1);
+				DataType w = H(high, high - 1) * H(high - 1, high);
+				if (iterations % 10 == 0)
+				{
+					const DataType s = std::abs(H(high, high - 1)) + std::abs(H(high - 1, high - 2));
+					x = y = H(high, high) + DataType(0.75) * s;
+					w = DataType(-0.4375) * s * s;
+				}
+				FrancisSweep(h, ldh, n, low, high, x, y, w, wantT, z, ldz, zRows);
+			}
+			return true;
+		}
+
+		// Right eigenvectors of the quasi-triangular Schur factor t by back substitution, packed as LAPACK
+		// does: a real eigenvalue owns one column, a complex pair wr(k) + i wi(k), wi(k) > 0, stores the
+		// real and imaginary parts of its vector in columns k and k+1.
+		template<typename DataType>
+		void QuasiTriangularEigenvectors(const DataType* t, const size_t n, const DataType* wr, const DataType* wi, DataType* x)
+		{
+			using Complex = std::complex<DataType>;
+			auto T = [t, n](const size_t i, const size_t j) { return t[i * n + j]; };
+			DataType norm = 0;
+			for (size_t i = 0; i < n * n; ++i)
+			{
+				norm = std::max(norm, std::abs(t[i]));
+			}
+			const DataType small = std::max(std::numeric_limits<DataType>::epsilon() * norm, std::numeric_limits<DataType>::min());
+			const DataType big = std::sqrt(std::numeric_limits<DataType>::max());
+			std::fill(x, x + n * n, DataType(0));
+			std::vector<Complex> vector(n);
+
+			for (size_t k = n; k-- > 0;)
+			{
+				const bool pair = wi[k] != DataType(0);
+				// A complex pair is handled once, from its second row.
+				const size_t head = pair ? k - 1 : k;
+				const Complex lambda = pair ? Complex(wr[head], wi[head]) : Complex(wr[k]);
+				std::fill(vector.begin(), vector.end(), Complex(0));
+				if (pair)
+				{
+					vector[head] = T(head, k);
+					vector[k] = lambda - T(head, head);
+				}
+				else
+				{
+					vector[k] = 1;
+				}
+				auto residual = [&](const size_t i)
+				{
+					Complex sum = 0;
+					for (size_t j = i + 1; j <= k; ++j)
+					{
+						sum += T(i, j) * vector[j];
+					}
+					return sum;
+				};
+				for (size_t i = head; i-- > 0;)
+				{
+					if (i > 0 && T(i, i - 1) != DataType(0))
+					{
+						// 2 x 2 block (i-1, i), solved by Cramer's rule.
+						const Complex r0 = -residual(i - 1);
+						const Complex r1 = -residual(i);
+						const Complex a00 = T(i - 1, i - 1) - lambda;
+						const Complex a11 = T(i, i) - lambda;
+						const DataType a01 = T(i - 1, i);
+						const DataType a10 = T(i, i - 1);
+						Complex det = a00 * a11 - a01 * a10;
+						if (std::abs(det) < small)
+						{
+							det = small;
+						}
+						vector[i - 1] = (r0 * a11 - a01 * r1) / det;
+						vector[i] = (a00 * r1 - a10 * r0) / det;
+						--i;
+					}
+					else
+					{
+						Complex denominator = T(i, i) - lambda;
+						if (std::abs(denominator) < small)
+						{
+							denominator = small;
+						}
+						vector[i] = -residual(i) / denominator;
+					}
+					const DataType magnitude = std::abs(vector[i]);
+					if (magnitude > big)
+					{
+						for (size_t j = i; j <= k; ++j)
+						{
+							vector[j] /= magnitude;
+						}
+					}
+				}
+				if (pair)
+				{
+					for (size_t i = 0; i <= k; ++i)
+					{
+						x[i * n + head] = vector[i].real();
+						x[i * n + k] = vector[i].imag();
+					}
+					k = head;
+				}
+				else
+				{
+					for (size_t i = 0; i <= k; ++i)
+					{
+						x[i * n + k] = vector[i].real();
+					}
+				}
+			}
+		}
+	} // namespace Detail
+
+	// Eigenvalues of a general square matrix: blocked Hessenberg reduction followed by Francis
+	// double-shift QR with aggressive early deflation, optionally keeping the real Schur form A = Z T Z^T and the right eigenvectors.
+	// The reduction, Schur form and Schur vectors all live in the two matrices this object owns.
+	template<typename DataType>
+	class LAR_EXPORT Eigen
+	{
+		static_assert(std::is_floating_point<DataType>::value, "Eigen requires a floating-point element type.");
+
+	public:
+		explicit Eigen(const Matrix<DataType>& a, const EigenOptions& options = EigenOptions())
+			: mSchur(a), mSchurVectors(0, 0), mEigenvectors(0, 0), mReal(a.GetRows()), mImaginary(a.GetRows())
+		{
+			if (!a.IsSquare())
+			{
+				throw std::invalid_argument("Matrix must be square to compute its eigenvalues.");
+			}
+			const size_t n = a.GetRows();
+			const size_t blockSize = std::max<size_t>(1, options.BlockSize);
+			const bool wantT = options.ComputeSchurForm || options.ComputeEigenvectors;
+			DataType* h = mSchur.mData;
+
+			std::vector<DataType> tau(n);
+			Detail::ReduceHessenberg(h, n, blockSize, tau.data());
+			if (wantT)
+			{
+				mSchurVectors = Matrix<DataType>(n, n);
+				for (size_t i = 0; i < n; ++i)
+				{
+					for (size_t j = 0; j < n; ++j)
+					{
+						mSchurVectors.mData[i * n + j] = i == j ? DataType(1) : DataType(0);
+					}
+				}
+				Detail::ApplyHessenbergQ(h, n, tau.data(), blockSize, mSchurVectors.mData, n, n);
+			}
+			for (size_t i = 2; i < n; ++i)
+			{
+				std::fill(h + i * n, h + i * n + i - 1, DataType(0));
+			}
+
+			if (!Detail::HessenbergQR(h, n, n, wantT, wantT ? mSchurVectors.mData : nullptr, n, n, mReal.Data(), mImaginary.Data()))
+			{
+				throw std::runtime_error("Hessenberg QR iteration did not converge.");
+			}
+			if (!wantT)
+			{
+				mSchur = Matrix<DataType>(0, 0);
+				return;
+			}
+			if (options.ComputeEigenvectors)
+			{
+				Matrix<DataType> x(n, n);
+				Detail::QuasiTriangularEigenvectors(h, n, mReal.Data(), mImaginary.Data(), x.mData);
+				mEigenvectors = Matrix<DataType>(n, n);
+				std::fill(mEigenvectors.mData, mEigenvectors.mData + n * n, DataType(0));
+				Detail::ParallelGemmAccumulate(n, n, n, DataType(1), mSchurVectors.mData, n, Op::NoTrans, x.mData, n, Op::NoTrans,
+					mEigenvectors.mData, n);
+				NormalizeEigenvectors();
+			}
+		}
+
+		// Real and imaginary parts of the eigenvalues, in the order they appear on the diagonal of T.
+		// Complex conjugate pairs are adjacent, positive imaginary part first.
+		const Vector<DataType>& RealParts() const { return mReal; }
+		const Vector<DataType>& ImaginaryParts() const { return mImaginary; }
+
+		std::vector<std::complex<DataType>> Eigenvalues() const
+		{
+			std::vector<std::complex<DataType>> values(mReal.GetSize());
+			for (size_t i = 0; i < values.size(); ++i)
+			{
+				values[i] = std::complex<DataType>(mReal[i], mImaginary[i]);
+			}
+			return values;
+		}
+
+		// Quasi upper triangular T with 1 x 1 and 2 x 2 diagonal blocks; empty unless requested.
+		const Matrix<DataType>& Schur() const { return mSchur; }
+		const Matrix<DataType>& SchurVectors() const { return mSchurVectors; }
+
+		// Unit-norm right eigenvectors. For a complex pair at (k, k+1) the vector of RealParts()[k] +
+		// i ImaginaryParts()[k] is column k + i column k+1, and its conjugate belongs to k+1.
+		const Matrix<DataType>& Eigenvectors() const { return mEigenvectors; }
+
+	private:
+		void NormalizeEigenvectors()
+		{
+			const size_t n = mEigenvectors.GetRows();
+			DataType* v = mEigenvectors.mData;
+			for (size_t k = 0; k < n; ++k)
+			{
+				const size_t width = mImaginary[k] != DataType(0) ? 2 : 1;
+				const DataType norm = std::hypot(Detail::Norm2(v + k, n, n), width == 2 ? Detail::Norm2(v + k + 1, n, n) : DataType(0));
+				if (norm != DataType(0))
+				{
+					for (size_t i = 0; i < n; ++i)
+					{
+						for (size_t c = k; c < k + width; ++c)
+						{
+							v[i * n + c] /= norm;
+						}
+					}
+				}
+				k += width - 1;
+			}
+		}
+
+		Matrix<DataType> mSchur;
+		Matrix<DataType> mSchurVectors;
+		Matrix<DataType> mEigenvectors;
+		Vector<DataType> mReal;
+		Vector<DataType> mImaginary;
+	};
+} // namespace LAR
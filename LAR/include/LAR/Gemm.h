@@ -0,0 +1,262 @@
+#pragma once
+#include "MatrixBase.h"
+#include "Memory.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace LAR
+{
+	enum class Op
+	{
+		NoTrans,
+		Trans
+	};
+
+	namespace Detail
+	{
+		// Register tile computed by the micro-kernel and cache blocks for the packed panels.
+		constexpr size_t GemmMR = 4;
+		constexpr size_t GemmNR = 8;
+		constexpr size_t GemmMC = 128;
+		constexpr size_t GemmKC = 256;
+		constexpr size_t GemmNC = 2048;
+
+		// Below this many multiply-adds packing costs more than it saves.
+		constexpr size_t GemmSmallWork = 48 * 48 * 48;
+
+		// Element (i, k) of op(M), where M is stored row-major with the given column count.
+		template<typename DataType>
+		inline const DataType& OpAt(const DataType* data, const size_t cols, const Op op, const size_t i, const size_t k)
+		{
+			return op == Op::NoTrans ? data[i * cols + k] : data[k * cols + i];
+		}
+
+		// Copies op(A)[i0:i0+mc, k0:k0+kc] into MR-row panels, k-major within a panel, zero-padded.
+		template<typename DataType>
+		void PackA(const DataType* a, const size_t lda, const Op op, const size_t i0, const size_t k0,
+			const size_t mc, const size_t kc, DataType* packed)
+		{
+			for (size_t ir = 0; ir < mc; ir += GemmMR)
+			{
+				const size_t mr = std::min(GemmMR, mc - ir);
+				DataType* panel = packed + ir * kc;
+				if (op == Op::NoTrans)
+				{
+					for (size_t r = 0; r < GemmMR; ++r)
+					{
+						const DataType* row = r < mr ? a + (i0 + ir + r) * lda + k0 : nullptr;
+						for (size_t k = 0; k < kc; ++k)
+						{
+							panel[k * GemmMR + r] = row != nullptr ? row[k] : DataType(0);
+						}
+					}
+				}
+				else
+				{
+					for (size_t k = 0; k < kc; ++k)
+					{
+						const DataType* row = a + (k0 + k) * lda + i0 + ir;
+						for (size_t r = 0; r < GemmMR; ++r)
+						{
+							panel[k * GemmMR + r] = r < mr ? row[r] : DataType(0);
+						}
+					}
+				}
+			}
+		}
+
+		// Copies op(B)[k0:k0+kc, j0:j0+nc] into NR-column panels, k-major within a panel, zero-padded.
+		template<typename DataType>
+		void PackB(const DataType* b, const size_t ldb, const Op op, const size_t k0, const size_t j0,
+			const size_t kc, const size_t nc, DataType* packed)
+		{
+			for (size_t jr = 0; jr < nc; jr += GemmNR)
+			{
+				const size_t nr = std::min(GemmNR, nc - jr);
+				DataType* panel = packed + jr * kc;
+				if (op == Op::NoTrans)
+				{
+					for (size_t k = 0; k < kc; ++k)
+					{
+						const DataType* row = b + (k0 + k) * ldb + j0 + jr;
+						for (size_t c = 0; c < GemmNR; ++c)
+						{
+							panel[k * GemmNR + c] = c < nr ? row[c] : DataType(0);
+						}
+					}
+				}
+				else
+				{
+					for (size_t c = 0; c < GemmNR; ++c)
+					{
+						const DataType* row = c < nr ? b + (j0 + jr + c) * ldb + k0 : nullptr;
+						for (size_t k = 0; k < kc; ++k)
+						{
+							panel[k * GemmNR + c] = row != nullptr ? row[k] : DataType(0);
+						}
+					}
+				}
+			}
+		}
+
+		// C[mr x nr] += alpha * Apanel * Bpanel. The fixed-size accumulator keeps the tile in
+		// registers for arithmetic types and lets the inner loop vectorize across NR.
+		template<typename DataType>
+		void GemmMicroKernel(const size_t kc, const DataType alpha, const DataType* aPanel, const DataType* bPanel,
+			DataType* c, const size_t ldc, const size_t mr, const size_t nr)
+		{
+			DataType acc[GemmMR][GemmNR] = {};
+			for (size_t k = 0; k < kc; ++k)
+			{
+				const DataType* ak = aPanel + k * GemmMR;
+				const DataType* bk = bPanel + k * GemmNR;
+				for (size_t r = 0; r < GemmMR; ++r)
+				{
+					const DataType ar = ak[r];
+					for (size_t col = 0; col < GemmNR; ++col)
+					{
+						acc[r][col] += ar * bk[col];
+					}
+				}
+			}
+			for (size_t r = 0; r < mr; ++r)
+			{
+				for (size_t col = 0; col < nr; ++col)
+				{
+					c[r * ldc + col] += alpha * acc[r][col];
+				}
+			}
+		}
+
+		template<typename DataType>
+		void ScaleInPlace(DataType* c, const size_t count, const DataType beta)
+		{
+			if (beta == DataType(0))
+			{
+				std::fill(c, c + count, DataType(0));
+			}
+			else if (beta != DataType(1))
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					c[i] *= beta;
+				}
+			}
+		}
+
+		// C += alpha * op(A) * op(B) for raw row-major storage; beta has already been applied to C.
+		template<typename DataType>
+		void GemmAccumulate(const size_t m, const size_t n, const size_t k, const DataType alpha,
+			const DataType* a, const size_t lda, const Op opA,
+			const DataType* b, const size_t ldb, const Op opB,
+			DataType* c, const size_t ldc)
+		{
+			if (m * n * k <= GemmSmallWork)
+			{
+				for (size_t i = 0; i < m; ++i)
+				{
+					DataType* cRow = c + i * ldc;
+					for (size_t p = 0; p < k; ++p)
+					{
+						const DataType aip = alpha * OpAt(a, lda, opA, i, p);
+						if (opB == Op::NoTrans)
+						{
+							const DataType* bRow = b + p * ldb;
+							for (size_t j = 0; j < n; ++j)
+							{
+								cRow[j] += aip * bRow[j];
+							}
+						}
+						else
+						{
+							for (size_t j = 0; j < n; ++j)
+							{
+								cRow[j] += aip * b[j * ldb + p];
+							}
+						}
+					}
+				}
+				return;
+			}
+
+			const size_t kcMax = std::min(GemmKC, k);
+			const size_t mcMax = (std::min(GemmMC, m) + GemmMR - 1) / GemmMR * GemmMR;
+			const size_t ncMax = (std::min(GemmNC, n) + GemmNR - 1) / GemmNR * GemmNR;
+			ScratchBuffer<DataType> packedA(mcMax * kcMax);
+			ScratchBuffer<DataType> packedB(ncMax * kcMax);
+
+			for (size_t jc = 0; jc < n; jc += GemmNC)
+			{
+				const size_t nc = std::min(GemmNC, n - jc);
+				for (size_t pc = 0; pc < k; pc += GemmKC)
+				{
+					const size_t kc = std::min(GemmKC, k - pc);
+					PackB(b, ldb, opB, pc, jc, kc, nc, packedB.Data());
+					for (size_t ic = 0; ic < m; ic += GemmMC)
+					{
+						const size_t mc = std::min(GemmMC, m - ic);
+						PackA(a, lda, opA, ic, pc, mc, kc, packedA.Data());
+						for (size_t jr = 0; jr < nc; jr += GemmNR)
+						{
+							const size_t nr = std::min(GemmNR, nc - jr);
+							for (size_t ir = 0; ir < mc; ir += GemmMR)
+							{
+								const size_t mr = std::min(GemmMR, mc - ir);
+								GemmMicroKernel(kc, alpha, packedA.Data() + ir * kc, packedB.Data() + jr * kc,
+									c + (ic + ir) * ldc + jc + jr, ldc, mr, nr);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		// GemmAccumulate with the rows of C split across threads; each thread packs its own panels.
+		template<typename DataType>
+		void ParallelGemmAccumulate(const size_t m, const size_t n, const size_t k, const DataType alpha,
+			const DataType* a, const size_t lda, const Op opA,
+			const DataType* b, const size_t ldb, const Op opB,
+			DataType* c, const size_t ldc)
+		{
+			const size_t minRows = m * n * k >= 8 * GemmSmallWork ? GemmMC : m;
+			ParallelFor(0, m, minRows, [&](const size_t begin, const size_t end)
+			{
+				const DataType* aBlock = opA == Op::NoTrans ? a + begin * lda : a + begin;
+				GemmAccumulate(end - begin, n, k, alpha, aBlock, lda, opA, b, ldb, opB, c + begin * ldc, ldc);
+			});
+		}
+	} // namespace Detail
+
+	// C = alpha * op(A) * op(B) + beta * C, accumulating into C in place. Transposed operands are read
+	// directly by the packing routines, so no transpose is ever materialized. With beta == 0 the
+	// previous contents of C are ignored.
+	template<typename DataType>
+	void Gemm(const DataType alpha, const Op opA, const Matrix<DataType>& a, const Op opB, const Matrix<DataType>& b,
+		const DataType beta, Matrix<DataType>& c)
+	{
+		const size_t m = opA == Op::NoTrans ? a.mNumRows : a.mNumCols;
+		const size_t k = opA == Op::NoTrans ? a.mNumCols : a.mNumRows;
+		const size_t kb = opB == Op::NoTrans ? b.mNumRows : b.mNumCols;
+		const size_t n = opB == Op::NoTrans ? b.mNumCols : b.mNumRows;
+		if (k != kb)
+		{
+			throw std::invalid_argument("Inner dimensions of op(A) and op(B) must match.");
+		}
+		if (c.mNumRows != m || c.mNumCols != n)
+		{
+			throw std::invalid_argument("Output matrix must be sized rows(op(A)) x cols(op(B)).");
+		}
+		if (c.mData != nullptr && (c.mData == a.mData || c.mData == b.mData))
+		{
+			throw std::invalid_argument("Output matrix must not alias an input of Gemm.");
+		}
+
+		Detail::ScaleInPlace(c.mData, m * n, beta);
+		if (alpha == DataType(0) || k == 0)
+		{
+			return;
+		}
+		Detail::GemmAccumulate(m, n, k, alpha, a.mData, a.mNumCols, opA, b.mData, b.mNumCols, opB, c.mData, n);
+	}
+} // namespace LAR
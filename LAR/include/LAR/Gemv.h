@@ -0,0 +1,95 @@
+#pragma once
+#include "Gemm.h"
+#include "Parallel.h"
+#include "Reduction.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace LAR
+{
+	namespace Detail
+	{
+		// Matrices with fewer elements than this are not worth spawning threads for.
+		constexpr size_t GemvParallelWork = 1 << 20;
+
+		// Each lane of the partial-sum array is an independent accumulator, so the loop vectorizes
+		// without reassociating a single sum.
+		template<typename DataType>
+		DataType RowDot(const DataType* row, const DataType* x, const size_t n)
+		{
+			return ReduceLanes<DataType>(0, n, [row, x](const size_t j) { return row[j] * x[j]; });
+		}
+
+		// y = alpha * A * x + beta * y for row-major A (m x n): one contiguous dot product per row,
+		// rows split across threads for large matrices.
+		template<typename DataType>
+		void GemvRows(const size_t m, const size_t n, const DataType alpha, const DataType* a, const size_t lda,
+			const DataType* x, const DataType beta, DataType* y)
+		{
+			auto rows = [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					const DataType dot = alpha * RowDot(a + i * lda, x, n);
+					y[i] = beta == DataType(0) ? dot : dot + beta * y[i];
+				}
+			};
+			const size_t minRows = std::max<size_t>(1, GemvParallelWork / std::max<size_t>(1, n));
+			ParallelFor(0, m, m * n >= GemvParallelWork ? minRows : m, rows);
+		}
+
+		// y = alpha * A^T * x + beta * y for row-major A (m x n) without forming the transpose: each row
+		// of A is streamed once as an axpy into y. Threads own disjoint column slices of y, so no
+		// reduction between them is needed.
+		template<typename DataType>
+		void GemvColumns(const size_t m, const size_t n, const DataType alpha, const DataType* a, const size_t lda,
+			const DataType* x, const DataType beta, DataType* y)
+		{
+			auto columns = [&](const size_t begin, const size_t end)
+			{
+				ScaleInPlace(y + begin, end - begin, beta);
+				for (size_t i = 0; i < m; ++i)
+				{
+					const DataType scale = alpha * x[i];
+					const DataType* row = a + i * lda;
+					for (size_t j = begin; j < end; ++j)
+					{
+						y[j] += scale * row[j];
+					}
+				}
+			};
+			const size_t minCols = std::max<size_t>(64, GemvParallelWork / std::max<size_t>(1, m));
+			ParallelFor(0, n, m * n >= GemvParallelWork ? minCols : n, columns);
+		}
+	} // namespace Detail
+
+	// y = alpha * op(A) * x + beta * y. Row-major A is read row-wise for both op values; with beta == 0
+	// the previous contents of y are ignored.
+	template<typename DataType, bool RowVectorX, bool RowVectorY>
+	void Gemv(const DataType alpha, const Op op, const Matrix<DataType>& a, const Vector<DataType, RowVectorX>& x,
+		const DataType beta, Vector<DataType, RowVectorY>& y)
+	{
+		const size_t rows = op == Op::NoTrans ? a.mNumRows : a.mNumCols;
+		const size_t cols = op == Op::NoTrans ? a.mNumCols : a.mNumRows;
+		if (x.GetSize() != cols)
+		{
+			throw std::invalid_argument("Size of vector must match the number of columns of op(A).");
+		}
+		if (y.GetSize() != rows)
+		{
+			throw std::invalid_argument("Output vector must have one entry per row of op(A).");
+		}
+		if (y.mData != nullptr && y.mData == x.mData)
+		{
+			throw std::invalid_argument("Output vector must not alias the input of Gemv.");
+		}
+		if (op == Op::NoTrans)
+		{
+			Detail::GemvRows(a.mNumRows, a.mNumCols, alpha, a.mData, a.mNumCols, x.mData, beta, y.mData);
+		}
+		else
+		{
+			Detail::GemvColumns(a.mNumRows, a.mNumCols, alpha, a.mData, a.mNumCols, x.mData, beta, y.mData);
+		}
+	}
+} // namespace LAR
@@ -0,0 +1,409 @@
+#pragma once
+#include "SparseMatrix.h"
+#include "SparseOrdering.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace LAR
+{
+	namespace Detail
+	{
+		// Coarsening stops at this many vertices, or when a level shrinks the graph by less than 5%.
+		constexpr size_t PartitionCoarsestSize = 64;
+		// A side may exceed its target weight by this fraction (or by one coarse vertex, if heavier).
+		constexpr double PartitionImbalance = 0.03;
+		// Greedy refinement passes per level; a pass that moves nothing ends the level early.
+		constexpr size_t PartitionRefinePasses = 8;
+		// Growing starts tried on the coarsest graph; the smallest refined cut is kept.
+		constexpr size_t PartitionInitialTries = 4;
+
+		// Graph with vertex and edge weights, the weights counting the fine vertices and edges that a
+		// coarse vertex or edge stands for.
+		struct WeightedGraph
+		{
+			size_t Size = 0;
+			std::vector<size_t> Start;
+			std::vector<size_t> Adjacent;
+			std::vector<size_t> EdgeWeight;
+			std::vector<size_t> VertexWeight;
+		};
+
+		inline WeightedGraph UnitWeights(const AdjacencyGraph& graph)
+		{
+			WeightedGraph result;
+			result.Size = graph.Size;
+			result.Start = graph.Start;
+			result.Adjacent = graph.Adjacent;
+			result.EdgeWeight.assign(graph.Adjacent.size(), 1);
+			result.VertexWeight.assign(graph.Size, 1);
+			return result;
+		}
+
+		// Heavy-edge matching in a shuffled vertex order; matched pairs become one coarse vertex and
+		// parallel edges are merged with their weights summed. map gets the coarse vertex of each vertex.
+		inline WeightedGraph Coarsen(const WeightedGraph& graph, std::vector<size_t>& map, std::minstd_rand& random)
+		{
+			constexpr size_t None = size_t(-1);
+			const size_t n = graph.Size;
+			std::vector<size_t> visit(n);
+			std::iota(visit.begin(), visit.end(), size_t(0));
+			std::shuffle(visit.begin(), visit.end(), random);
+			std::vector<size_t> match(n, None);
+			for (const size_t v : visit)
+			{
+				if (match[v] != None)
+				{
+					continue;
+				}
+				size_t best = v;
+				size_t bestWeight = 0;
+				for (size_t p = graph.Start[v]; p < graph.Start[v + 1]; ++p)
+				{
+					const size_t u = graph.Adjacent[p];
+					if (match[u] == None && u != v && graph.EdgeWeight[p] > bestWeight)
+					{
+						best = u;
+						bestWeight = graph.EdgeWeight[p];
+					}
+				}
+				match[v] = best;
+				match[best] = v;
+			}
+
+			map.assign(n, None);
+			WeightedGraph coarse;
+			std::vector<size_t> first;
+			for (size_t v = 0; v < n; ++v)
+			{
+				if (map[v] == None)
+				{
+					map[v] = map[match[v]] = coarse.Size++;
+					first.push_back(v);
+					coarse.VertexWeight.push_back(graph.VertexWeight[v] + (match[v] != v ? graph.VertexWeight[match[v]] : 0));
+				}
+			}
+			coarse.Start.assign(1, 0);
+			// position[d]: slot of coarse neighbour d in the row being built, valid when >= rowStart.
+			std::vector<size_t> position(coarse.Size, None);
+			for (size_t c = 0; c < coarse.Size; ++c)
+			{
+				const size_t rowStart = coarse.Adjacent.size();
+				const size_t v = first[c];
+				for (const size_t w : { v, match[v] })
+				{
+					for (size_t p = graph.Start[w]; p < graph.Start[w + 1]; ++p)
+					{
+						const size_t d = map[graph.Adjacent[p]];
+						if (d == c)
+						{
+							continue;
+						}
+						if (position[d] == None || position[d] < rowStart)
+						{
+							position[d] = coarse.Adjacent.size();
+							coarse.Adjacent.push_back(d);
+							coarse.EdgeWeight.push_back(graph.EdgeWeight[p]);
+						}
+						else
+						{
+							coarse.EdgeWeight[position[d]] += graph.EdgeWeight[p];
+						}
+					}
+					if (match[v] == v)
+					{
+						break;
+					}
+				}
+				coarse.Start.push_back(coarse.Adjacent.size());
+			}
+			return coarse;
+		}
+
+		// Weight of the edges between the two sides.
+		inline size_t CutWeight(const WeightedGraph& graph, const std::vector<char>& side)
+		{
+			size_t cut = 0;
+			for (size_t v = 0; v < graph.Size; ++v)
+			{
+				for (size_t p = graph.Start[v]; p < graph.Start[v + 1]; ++p)
+				{
+					cut += side[v] != side[graph.Adjacent[p]] ? graph.EdgeWeight[p] : 0;
+				}
+			}
+			return cut / 2;
+		}
+
+		// Greedy boundary refinement in the spirit of Fiduccia-Mattheyses: vertices whose move lowers the
+		// cut (or keeps it and evens the sides) change side, best gain first, while the destination
+		// stays within its limit; an overweight side first sheds its cheapest boundary vertices.
+		inline void RefineBisection(const WeightedGraph& graph, const size_t target0, std::vector<char>& side)
+		{
+			const size_t n = graph.Size;
+			const size_t total = std::accumulate(graph.VertexWeight.begin(), graph.VertexWeight.end(), size_t(0));
+			const size_t heaviest = n > 0 ? *std::max_element(graph.VertexWeight.begin(), graph.VertexWeight.end()) : 0;
+			const size_t target[2] = { target0, total - target0 };
+			size_t limit[2];
+			size_t weight[2] = { 0, 0 };
+			for (size_t s = 0; s < 2; ++s)
+			{
+				limit[s] = std::max(target[s] + size_t(PartitionImbalance * double(target[s])), target[s] + heaviest);
+			}
+			for (size_t v = 0; v < n; ++v)
+			{
+				weight[size_t(side[v])] += graph.VertexWeight[v];
+			}
+			// External minus internal edge weight of v.
+			const auto gain = [&](const size_t v)
+			{
+				long long result = 0;
+				for (size_t p = graph.Start[v]; p < graph.Start[v + 1]; ++p)
+				{
+					const long long w = (long long)graph.EdgeWeight[p];
+					result += side[graph.Adjacent[p]] != side[v] ? w : -w;
+				}
+				return result;
+			};
+
+			std::vector<std::pair<long long, size_t>> candidates;
+			for (size_t pass = 0; pass < PartitionRefinePasses; ++pass)
+			{
+				candidates.clear();
+				for (size_t v = 0; v < n; ++v)
+				{
+					bool boundary = false;
+					for (size_t p = graph.Start[v]; p < graph.Start[v + 1] && !boundary; ++p)
+					{
+						boundary = side[graph.Adjacent[p]] != side[v];
+					}
+					const size_t from = size_t(side[v]);
+					if (boundary || weight[from] > limit[from])
+					{
+						candidates.emplace_back(gain(v), v);
+					}
+				}
+				std::stable_sort(candidates.begin(), candidates.end(), [](const auto& x, const auto& y) { return x.first > y.first; });
+				size_t moved = 0;
+				for (const auto& candidate : candidates)
+				{
+					const size_t v = candidate.second;
+					const size_t from = size_t(side[v]);
+					const size_t to = 1 - from;
+					const size_t w = graph.VertexWeight[v];
+					if (weight[to] + w > limit[to])
+					{
+						continue;
+					}
+					const long long current = gain(v);
+					const bool overweight = weight[from] > limit[from];
+					const bool evens = weight[from] > target[from] && weight[to] + w <= target[to] + w / 2;
+					if (current > 0 || (current == 0 && evens) || overweight)
+					{
+						side[v] = char(to);
+						weight[from] -= w;
+						weight[to] += w;
+						++moved;
+					}
+				}
+				if (moved == 0)
+				{
+					break;
+				}
+			}
+		}
+
+		// Initial bisection of a small graph: side 0 grows breadth-first from a start vertex (other
+		// components joining as needed) until it reaches target0, then the split is refined.
+		inline std::vector<char> GrowBisection(const WeightedGraph& graph, const size_t target0, const size_t start)
+		{
+			const size_t n = graph.Size;
+			std::vector<char> side(n, 1);
+			std::vector<char> queued(n, 0);
+			std::vector<size_t> queue;
+			size_t weight = 0;
+			for (size_t seed = 0; seed < n && weight < target0; ++seed)
+			{
+				const size_t root = (start + seed) % n;
+				if (queued[root])
+				{
+					continue;
+				}
+				queue.assign(1, root);
+				queued[root] = 1;
+				for (size_t head = 0; head < queue.size() && weight < target0; ++head)
+				{
+					const size_t v = queue[head];
+					side[v] = 0;
+					weight += graph.VertexWeight[v];
+					for (size_t p = graph.Start[v]; p < graph.Start[v + 1]; ++p)
+					{
+						const size_t u = graph.Adjacent[p];
+						if (!queued[u])
+						{
+							queued[u] = 1;
+							queue.push_back(u);
+						}
+					}
+				}
+			}
+			RefineBisection(graph, target0, side);
+			return side;
+		}
+
+		// Multilevel bisection (coarsen, bisect the coarsest graph, project back refining each level)
+		// with side 0 aiming at target0 of the vertex weight.
+		inline std::vector<char> MultilevelBisection(const WeightedGraph& graph, const size_t target0, std::minstd_rand& random)
+		{
+			std::vector<WeightedGraph> levels;
+			std::vector<std::vector<size_t>> maps;
+			const WeightedGraph* current = &graph;
+			while (current->Size > PartitionCoarsestSize)
+			{
+				std::vector<size_t> map;
+				WeightedGraph coarse = Coarsen(*current, map, random);
+				if (coarse.Size * 20 > current->Size * 19)
+				{
+					break;
+				}
+				maps.push_back(std::move(map));
+				levels.push_back(std::move(coarse));
+				current = &levels.back();
+			}
+
+			std::vector<char> side;
+			size_t bestCut = size_t(-1);
+			for (size_t attempt = 0; attempt < PartitionInitialTries && current->Size > 0; ++attempt)
+			{
+				std::vector<char> trial = GrowBisection(*current, target0, attempt * current->Size / PartitionInitialTries);
+				const size_t cut = CutWeight(*current, trial);
+				if (cut < bestCut)
+				{
+					bestCut = cut;
+					side.swap(trial);
+				}
+			}
+			for (size_t level = levels.size(); level-- > 0;)
+			{
+				const WeightedGraph& fine = level == 0 ? graph : levels[level - 1];
+				std::vector<char> projected(fine.Size);
+				for (size_t v = 0; v < fine.Size; ++v)
+				{
+					projected[v] = side[maps[level][v]];
+				}
+				side.swap(projected);
+				RefineBisection(fine, target0, side);
+			}
+			return side;
+		}
+
+		// Induced subgraph on the vertices with side[v] == which; local gets their subgraph indices.
+		inline WeightedGraph Subgraph(const WeightedGraph& graph, const std::vector<char>& side, const char which,
+			std::vector<size_t>& local)
+		{
+			WeightedGraph sub;
+			for (size_t v = 0; v < graph.Size; ++v)
+			{
+				local[v] = side[v] == which ? sub.Size++ : size_t(-1);
+			}
+			sub.Start.assign(1, 0);
+			for (size_t v = 0; v < graph.Size; ++v)
+			{
+				if (side[v] != which)
+				{
+					continue;
+				}
+				sub.VertexWeight.push_back(graph.VertexWeight[v]);
+				for (size_t p = graph.Start[v]; p < graph.Start[v + 1]; ++p)
+				{
+					if (side[graph.Adjacent[p]] == which)
+					{
+						sub.Adjacent.push_back(local[graph.Adjacent[p]]);
+						sub.EdgeWeight.push_back(graph.EdgeWeight[p]);
+					}
+				}
+				sub.Start.push_back(sub.Adjacent.size());
+			}
+			return sub;
+		}
+
+		// k-way partition by recursive multilevel bisection; parts [firstPart, firstPart + parts) are
+		// assigned to the vertices listed in global.
+		inline void RecursivePartition(const WeightedGraph& graph, const std::vector<size_t>& global, const size_t firstPart,
+			const size_t parts, std::vector<size_t>& partition, std::minstd_rand& random)
+		{
+			if (parts <= 1 || graph.Size == 0)
+			{
+				for (const size_t v : global)
+				{
+					partition[v] = firstPart;
+				}
+				return;
+			}
+			const size_t total = std::accumulate(graph.VertexWeight.begin(), graph.VertexWeight.end(), size_t(0));
+			const size_t leftParts = parts / 2;
+			const std::vector<char> side = MultilevelBisection(graph, total * leftParts / parts, random);
+			std::vector<size_t> local(graph.Size);
+			for (const char which : { char(0), char(1) })
+			{
+				const WeightedGraph sub = Subgraph(graph, side, which, local);
+				std::vector<size_t> subGlobal;
+				subGlobal.reserve(sub.Size);
+				for (size_t v = 0; v < graph.Size; ++v)
+				{
+					if (side[v] == which)
+					{
+						subGlobal.push_back(global[v]);
+					}
+				}
+				RecursivePartition(sub, subGlobal, which == 0 ? firstPart : firstPart + leftParts, which == 0 ? leftParts : parts - leftParts,
+					partition, random);
+			}
+		}
+	} // namespace Detail
+
+	// Multilevel k-way partition of the pattern of A + A^T: parts of near-equal size (within a few
+	// percent) with few edges between them, as used to distribute rows or to order a matrix part by
+	// part. Returns the part of each row. Deterministic for a given matrix.
+	template<typename DataType, SparseFormat Format>
+	std::vector<size_t> GraphPartition(const SparseMatrix<DataType, Format>& a, const size_t parts)
+	{
+		if (parts == 0)
+		{
+			throw std::invalid_argument("Number of parts must be positive.");
+		}
+		const Detail::WeightedGraph graph = Detail::UnitWeights(Detail::SymmetricAdjacency(a));
+		std::vector<size_t> global(graph.Size);
+		std::iota(global.begin(), global.end(), size_t(0));
+		std::vector<size_t> partition(graph.Size, 0);
+		std::minstd_rand random(graph.Size);
+		Detail::RecursivePartition(graph, global, 0, parts, partition, random);
+		return partition;
+	}
+
+	// Permutation (p[new] = old) listing the rows part by part, keeping their order inside a part;
+	// apply it with Permute(a, p, p).
+	inline std::vector<size_t> PartitionOrdering(const std::vector<size_t>& partition, const size_t parts)
+	{
+		std::vector<size_t> start(parts + 1, 0);
+		for (const size_t part : partition)
+		{
+			if (part >= parts)
+			{
+				throw std::invalid_argument("Part index out of range.");
+			}
+			++start[part + 1];
+		}
+		for (size_t part = 0; part < parts; ++part)
+		{
+			start[part + 1] += start[part];
+		}
+		std::vector<size_t> order(partition.size());
+		for (size_t v = 0; v < partition.size(); ++v)
+		{
+			order[start[partition[v]]++] = v;
+		}
+		return order;
+	}
+} // namespace LAR
@@ -0,0 +1,214 @@
+#pragma once
+#include "Gemm.h"
+#include "Gemv.h"
+#include "Memory.h"
+#include "Parallel.h"
+#include "QR.h"
+#include <algorithm>
+#include <vector>
+
+namespace LAR
+{
+	namespace Detail
+	{
+		// Copies reflectors j0..j0+k-1 of a Hessenberg (or tridiagonal) reduction into an explicit
+		// (n - j0 - 1) x k buffer with unit diagonal. Reflector i acts on rows i+1..n-1 and is stored
+		// below the subdiagonal of column i.
+		template<typename DataType>
+		void ExtractHessenbergReflectors(const DataType* a, const size_t n, const size_t j0, const size_t k, DataType* v)
+		{
+			const size_t rows = n - j0 - 1;
+			for (size_t r = 0; r < rows; ++r)
+			{
+				for (size_t c = 0; c < k; ++c)
+				{
+					v[r * k + c] = r > c ? a[(j0 + 1 + r) * n + j0 + c] : (r == c ? DataType(1) : DataType(0));
+				}
+			}
+		}
+
+		// c = c (I - tau v v^T) for the rows x cols block c; the right-hand counterpart of ApplyHouseholder.
+		template<typename DataType>
+		void ApplyHouseholderRight(const DataType* v, const DataType tau, const size_t rows, const size_t cols,
+			DataType* c, const size_t ldc)
+		{
+			if (tau == DataType(0))
+			{
+				return;
+			}
+			for (size_t r = 0; r < rows; ++r)
+			{
+				DataType* row = c + r * ldc;
+				DataType dot = 0;
+				for (size_t j = 0; j < cols; ++j)
+				{
+					dot += row[j] * v[j];
+				}
+				dot *= tau;
+				for (size_t j = 0; j < cols; ++j)
+				{
+					row[j] -= dot * v[j];
+				}
+			}
+		}
+
+		// Reduces the n x n matrix a (row stride n) to upper Hessenberg form Q^T A Q = H with
+		// Q = H_0 H_1 ... H_{n-2} (LAPACK's gehrd with lahr2 panels). Each panel accumulates
+		// Y = A V T alongside its reflectors so the trailing matrix sees one right update Y V^T and one
+		// block reflector from the left, both Gemm calls. The reflectors are left below the subdiagonal.
+		template<typename DataType>
+		void ReduceHessenberg(DataType* a, const size_t n, const size_t blockSize, DataType* tau)
+		{
+			if (n < 2)
+			{
+				return;
+			}
+			const size_t reflectors = n - 1;
+			ScratchBuffer<DataType> panelY(n * blockSize);
+			ScratchBuffer<DataType> factor(blockSize * blockSize);
+			ScratchBuffer<DataType> column(n);
+			ScratchBuffer<DataType> coefficients(blockSize);
+			ScratchBuffer<DataType> y(n);
+
+			for (size_t j0 = 0; j0 < reflectors; j0 += blockSize)
+			{
+				const size_t nb = std::min(blockSize, reflectors - j0);
+				DataType* t = factor.Data();
+				DataType* panel = panelY.Data();
+				std::fill(t, t + nb * nb, DataType(0));
+				// V(r, c) for global row r and panel reflector c.
+				auto reflector = [&](const size_t r, const size_t c)
+				{
+					const size_t head = j0 + c + 1;
+					return r < head ? DataType(0) : (r == head ? DataType(1) : a[r * n + j0 + c]);
+				};
+
+				for (size_t l = 0; l < nb; ++l)
+				{
+					const size_t i = j0 + l;
+					if (l > 0)
+					{
+						// Right update from the panel so far: A(:, i) -= Y V(i, :)^T.
+						for (size_t r = 0; r < n; ++r)
+						{
+							DataType sum = 0;
+							for (size_t c = 0; c < l; ++c)
+							{
+								sum += panel[r * nb + c] * reflector(i, c);
+							}
+							a[r * n + i] -= sum;
+						}
+						// Left update: A(j0+1:n, i) = (I - V T V^T)^T A(j0+1:n, i).
+						DataType* w = coefficients.Data();
+						for (size_t c = 0; c < l; ++c)
+						{
+							DataType sum = 0;
+							for (size_t r = j0 + c + 1; r < n; ++r)
+							{
+								sum += reflector(r, c) * a[r * n + i];
+							}
+							w[c] = sum;
+						}
+						for (size_t c = l; c-- > 0;)
+						{
+							DataType sum = 0;
+							for (size_t d = 0; d <= c; ++d)
+							{
+								sum += t[d * nb + c] * w[d];
+							}
+							w[c] = sum;
+						}
+						for (size_t r = j0 + 1; r < n; ++r)
+						{
+							DataType sum = 0;
+							for (size_t c = 0; c < l; ++c)
+							{
+								sum += reflector(r, c) * w[c];
+							}
+							a[r * n + i] -= sum;
+						}
+					}
+
+					tau[i] = HouseholderVector(a[(i + 1) * n + i], a + (i + 2) * n + i, n - i - 2, n);
+					const size_t rows = n - i - 1;
+					DataType* u = column.Data();
+					u[0] = DataType(1);
+					for (size_t r = 1; r < rows; ++r)
+					{
+						u[r] = a[(i + 1 + r) * n + i];
+					}
+
+					// Y(:, l) = tau (A(:, i+1:n) u - Y (V^T u)); A's columns right of i are untouched by this panel.
+					GemvRows(n, rows, DataType(1), a + i + 1, n, u, DataType(0), y.Data());
+					DataType* g = coefficients.Data();
+					for (size_t c = 0; c < l; ++c)
+					{
+						DataType sum = 0;
+						for (size_t r = 0; r < rows; ++r)
+						{
+							sum += reflector(i + 1 + r, c) * u[r];
+						}
+						g[c] = sum;
+					}
+					for (size_t r = 0; r < n; ++r)
+					{
+						DataType sum = y[r];
+						for (size_t c = 0; c < l; ++c)
+						{
+							sum -= panel[r * nb + c] * g[c];
+						}
+						panel[r * nb + l] = tau[i] * sum;
+					}
+					// T(0:l, l) = -tau T(0:l, 0:l) V^T u, as in larft.
+					for (size_t c = 0; c < l; ++c)
+					{
+						DataType sum = 0;
+						for (size_t d = c; d < l; ++d)
+						{
+							sum += t[c * nb + d] * g[d];
+						}
+						t[c * nb + l] = -tau[i] * sum;
+					}
+					t[l * nb + l] = tau[i];
+				}
+
+				// Trailing columns: A(:, j0+nb:n) -= Y V(j0+nb:n, :)^T, then the block reflector from the left.
+				const size_t first = j0 + nb;
+				if (first < n)
+				{
+					const size_t rows = n - j0 - 1;
+					ScratchBuffer<DataType> v(rows * nb);
+					ExtractHessenbergReflectors(a, n, j0, nb, v.Data());
+					ParallelGemmAccumulate(n, n - first, nb, DataType(-1), panel, nb, Op::NoTrans,
+						v.Data() + (nb - 1) * nb, nb, Op::Trans, a + first, n);
+					ApplyBlockReflector(v.Data(), nb, rows, nb, t, Op::Trans, a + (j0 + 1) * n + first, n, n - first);
+				}
+			}
+		}
+
+		// z = Q z for the Q of ReduceHessenberg or Tridiagonalize, applied as compact WY blocks from
+		// last to first. z has n rows.
+		template<typename DataType>
+		void ApplyHessenbergQ(const DataType* a, const size_t n, const DataType* tau, const size_t blockSize,
+			DataType* z, const size_t ldz, const size_t cols)
+		{
+			if (n < 2 || cols == 0)
+			{
+				return;
+			}
+			const size_t reflectors = n - 1;
+			const size_t blocks = (reflectors + blockSize - 1) / blockSize;
+			for (size_t block = blocks; block-- > 0;)
+			{
+				const size_t j0 = block * blockSize;
+				const size_t jb = std::min(blockSize, reflectors - j0);
+				const size_t rows = n - j0 - 1;
+				ScratchBuffer<DataType> v(rows * jb);
+				ExtractHessenbergReflectors(a, n, j0, jb, v.Data());
+				std::vector<DataType> t(jb * jb);
+				BlockReflectorFactor(v.Data(), jb, rows, jb, tau + j0, t.data());
+				ApplyBlockReflector(v.Data(), jb, rows, jb, t.data(), Op::NoTrans, z + (j0 + 1) * ldz, ldz, cols);
+			}
+		}
+	} // namespace Detail
+} // namespace LAR
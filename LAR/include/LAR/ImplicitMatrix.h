@@ -0,0 +1,567 @@
+#pragma once
+#include "Matrix.h"
+#include "Vector.h"
+#include "Algorithms.h"
+#include "LAR_export.h"
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace LAR
+{
+	// Structured matrices held implicitly: O(1) or O(n) state instead of an n x n buffer. Products and
+	// sums with Matrix and Vector go to kernels that use the structure (a copy, row or column scaling,
+	// a gather); ToDense materializes the full matrix when one is really needed.
+
+	// The n x n identity.
+	template<typename DataType>
+	class LAR_EXPORT IdentityMatrix
+	{
+	public:
+		explicit IdentityMatrix(const size_t size)
+			: mSize(size)
+		{
+		}
+
+		size_t GetSize() const { return mSize; }
+		size_t GetRows() const { return mSize; }
+		size_t GetCols() const { return mSize; }
+
+		DataType operator()(const size_t row, const size_t col) const
+		{
+			if (row >= mSize || col >= mSize)
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			return row == col ? DataType(1) : DataType(0);
+		}
+
+		Matrix<DataType> ToDense() const
+		{
+			return Matrix<DataType>::Identity(mSize);
+		}
+
+		void Apply(const DataType* x, DataType* y) const
+		{
+			std::copy(x, x + mSize, y);
+		}
+
+	private:
+		size_t mSize;
+	};
+
+	// rows x cols matrix with every entry equal to one value (Matrix::Fill without the buffer).
+	template<typename DataType>
+	class LAR_EXPORT ConstantMatrix
+	{
+	public:
+		ConstantMatrix(const size_t rows, const size_t cols, const DataType value)
+			: mNumRows(rows), mNumCols(cols), mValue(value)
+		{
+		}
+
+		size_t GetRows() const { return mNumRows; }
+		size_t GetCols() const { return mNumCols; }
+		DataType GetValue() const { return mValue; }
+
+		DataType operator()(const size_t row, const size_t col) const
+		{
+			if (row >= mNumRows || col >= mNumCols)
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			return mValue;
+		}
+
+		Matrix<DataType> ToDense() const
+		{
+			return Matrix<DataType>::Fill(mNumRows, mNumCols, mValue);
+		}
+
+		// Every entry of y is value * sum(x).
+		void Apply(const DataType* x, DataType* y) const
+		{
+			DataType sum = DataType(0);
+			for (size_t j = 0; j < mNumCols; ++j)
+			{
+				sum += x[j];
+			}
+			std::fill(y, y + mNumRows, mValue * sum);
+		}
+
+	private:
+		size_t mNumRows;
+		size_t mNumCols;
+		DataType mValue;
+	};
+
+	// Diagonal matrix stored as its diagonal.
+	template<typename DataType>
+	class LAR_EXPORT DiagonalMatrix
+	{
+	public:
+		// An all-zero n x n diagonal matrix.
+		explicit DiagonalMatrix(const size_t size)
+			: mDiagonal(size, DataType(0))
+		{
+		}
+
+		template<bool RowVector>
+		explicit DiagonalMatrix(const Vector<DataType, RowVector>& diagonal)
+			: mDiagonal(diagonal.begin(), diagonal.end())
+		{
+		}
+
+		DiagonalMatrix(const std::initializer_list<DataType>& diagonal)
+			: mDiagonal(diagonal)
+		{
+		}
+
+		size_t GetSize() const { return mDiagonal.size(); }
+		size_t GetRows() const { return mDiagonal.size(); }
+		size_t GetCols() const { return mDiagonal.size(); }
+		const std::vector<DataType>& Diagonal() const { return mDiagonal; }
+
+		DataType operator()(const size_t row, const size_t col) const
+		{
+			if (row >= GetSize() || col >= GetSize())
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			return row == col ? mDiagonal[row] : DataType(0);
+		}
+
+		// Diagonal entry i.
+		DataType& operator[](const size_t index) { return mDiagonal[index]; }
+		DataType operator[](const size_t index) const { return mDiagonal[index]; }
+
+		Matrix<DataType> ToDense() const
+		{
+			const size_t n = GetSize();
+			Matrix<DataType> result(n, n);
+			std::fill(result.mData, result.mData + n * n, DataType(0));
+			for (size_t i = 0; i < n; ++i)
+			{
+				result.mData[i * n + i] = mDiagonal[i];
+			}
+			return result;
+		}
+
+		void Apply(const DataType* x, DataType* y) const
+		{
+			for (size_t i = 0; i < mDiagonal.size(); ++i)
+			{
+				y[i] = mDiagonal[i] * x[i];
+			}
+		}
+
+		DiagonalMatrix Inverse() const
+		{
+			DiagonalMatrix result(*this);
+			for (DataType& value : result.mDiagonal)
+			{
+				if (value == DataType(0))
+				{
+					throw std::runtime_error("Matrix is singular.");
+				}
+				value = DataType(1) / value;
+			}
+			return result;
+		}
+
+		DiagonalMatrix operator*(const DiagonalMatrix& other) const
+		{
+			if (GetSize() != other.GetSize())
+			{
+				throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+			}
+			DiagonalMatrix result(*this);
+			for (size_t i = 0; i < GetSize(); ++i)
+			{
+				result.mDiagonal[i] *= other.mDiagonal[i];
+			}
+			return result;
+		}
+
+	private:
+		std::vector<DataType> mDiagonal;
+	};
+
+	// Permutation matrix P with P(i, permutation[i]) = 1, so P A has row i equal to row
+	// permutation[i] of A, as Matrix::PermuteRows leaves it. SwapRows records a row swap in O(1);
+	// the accumulated permutation is applied to a matrix in one pass.
+	template<typename DataType>
+	class LAR_EXPORT PermutationMatrix
+	{
+	public:
+		// The n x n identity permutation.
+		explicit PermutationMatrix(const size_t size)
+			: mPermutation(size)
+		{
+			for (size_t i = 0; i < size; ++i)
+			{
+				mPermutation[i] = i;
+			}
+		}
+
+		explicit PermutationMatrix(std::vector<size_t> permutation)
+			: mPermutation(std::move(permutation))
+		{
+			Detail::CheckPermutation(mPermutation, mPermutation.size());
+		}
+
+		size_t GetSize() const { return mPermutation.size(); }
+		size_t GetRows() const { return mPermutation.size(); }
+		size_t GetCols() const { return mPermutation.size(); }
+		const std::vector<size_t>& Permutation() const { return mPermutation; }
+
+		DataType operator()(const size_t row, const size_t col) const
+		{
+			if (row >= GetSize() || col >= GetSize())
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			return mPermutation[row] == col ? DataType(1) : DataType(0);
+		}
+
+		// Swaps rows row1 and row2 of P; P A then equals A after the same sequence of SwapRows.
+		void SwapRows(const size_t row1, const size_t row2)
+		{
+			if (row1 >= GetSize() || row2 >= GetSize())
+			{
+				throw std::invalid_argument("Rows must be within the bounds of the matrix.");
+			}
+			std::swap(mPermutation[row1], mPermutation[row2]);
+		}
+
+		// P^-1 = P^T.
+		PermutationMatrix Transpose() const
+		{
+			std::vector<size_t> inverse(GetSize());
+			for (size_t i = 0; i < GetSize(); ++i)
+			{
+				inverse[mPermutation[i]] = i;
+			}
+			return PermutationMatrix(std::move(inverse), 0);
+		}
+
+		PermutationMatrix Inverse() const
+		{
+			return Transpose();
+		}
+
+		Matrix<DataType> ToDense() const
+		{
+			const size_t n = GetSize();
+			Matrix<DataType> result(n, n);
+			std::fill(result.mData, result.mData + n * n, DataType(0));
+			for (size_t i = 0; i < n; ++i)
+			{
+				result.mData[i * n + mPermutation[i]] = DataType(1);
+			}
+			return result;
+		}
+
+		// y = P x, a gather.
+		void Apply(const DataType* x, DataType* y) const
+		{
+			for (size_t i = 0; i < GetSize(); ++i)
+			{
+				y[i] = x[mPermutation[i]];
+			}
+		}
+
+		// (P Q)(i, :) = Q(permutation[i], :), so the product permutes by Q's entries in P's order.
+		PermutationMatrix operator*(const PermutationMatrix& other) const
+		{
+			if (GetSize() != other.GetSize())
+			{
+				throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+			}
+			std::vector<size_t> product(GetSize());
+			for (size_t i = 0; i < GetSize(); ++i)
+			{
+				product[i] = other.mPermutation[mPermutation[i]];
+			}
+			return PermutationMatrix(std::move(product), 0);
+		}
+
+	private:
+		// Adopts a permutation already known to be valid.
+		PermutationMatrix(std::vector<size_t> permutation, int)
+			: mPermutation(std::move(permutation))
+		{
+		}
+
+		std::vector<size_t> mPermutation;
+	};
+
+	namespace Detail
+	{
+		inline void CheckProductShape(const size_t leftCols, const size_t rightRows)
+		{
+			if (leftCols != rightRows)
+			{
+				throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+			}
+		}
+
+		template<typename Structured, typename DataType>
+		void CheckSumShape(const Structured& s, const Matrix<DataType>& a)
+		{
+			if (s.GetRows() != a.GetRows() || s.GetCols() != a.GetCols())
+			{
+				throw std::invalid_argument("Matrices must be the same size to add them.");
+			}
+		}
+
+		// a += sign * s, touching only the entries s can make nonzero.
+		template<typename DataType>
+		void AddInPlace(Matrix<DataType>& a, const IdentityMatrix<DataType>& s, const DataType sign)
+		{
+			for (size_t i = 0; i < s.GetSize(); ++i)
+			{
+				a.mData[i * a.GetCols() + i] += sign;
+			}
+		}
+
+		template<typename DataType>
+		void AddInPlace(Matrix<DataType>& a, const DiagonalMatrix<DataType>& s, const DataType sign)
+		{
+			for (size_t i = 0; i < s.GetSize(); ++i)
+			{
+				a.mData[i * a.GetCols() + i] += sign * s[i];
+			}
+		}
+
+		template<typename DataType>
+		void AddInPlace(Matrix<DataType>& a, const ConstantMatrix<DataType>& s, const DataType sign)
+		{
+			const DataType value = sign * s.GetValue();
+			for (size_t e = 0; e < a.GetRows() * a.GetCols(); ++e)
+			{
+				a.mData[e] += value;
+			}
+		}
+
+		template<typename DataType>
+		void AddInPlace(Matrix<DataType>& a, const PermutationMatrix<DataType>& s, const DataType sign)
+		{
+			for (size_t i = 0; i < s.GetSize(); ++i)
+			{
+				a.mData[i * a.GetCols() + s.Permutation()[i]] += sign;
+			}
+		}
+	} // namespace Detail
+
+#pragma region Identity
+	template<typename DataType>
+	Matrix<DataType> operator*(const IdentityMatrix<DataType>& identity, const Matrix<DataType>& a)
+	{
+		Detail::CheckProductShape(identity.GetCols(), a.GetRows());
+		return a;
+	}
+
+	template<typename DataType>
+	Matrix<DataType> operator*(const Matrix<DataType>& a, const IdentityMatrix<DataType>& identity)
+	{
+		Detail::CheckProductShape(a.GetCols(), identity.GetRows());
+		return a;
+	}
+#pragma endregion Identity
+
+#pragma region Constant
+	// Every row of c B is value times the column sums of B: O(rows(B) cols(B)) plus writing the result.
+	template<typename DataType>
+	Matrix<DataType> operator*(const ConstantMatrix<DataType>& c, const Matrix<DataType>& b)
+	{
+		Detail::CheckProductShape(c.GetCols(), b.GetRows());
+		const size_t k = b.GetCols();
+		std::vector<DataType> sums(k, DataType(0));
+		for (size_t i = 0; i < b.GetRows(); ++i)
+		{
+			for (size_t j = 0; j < k; ++j)
+			{
+				sums[j] += b.mData[i * k + j];
+			}
+		}
+		Matrix<DataType> result(c.GetRows(), k);
+		for (size_t i = 0; i < c.GetRows(); ++i)
+		{
+			for (size_t j = 0; j < k; ++j)
+			{
+				result.mData[i * k + j] = c.GetValue() * sums[j];
+			}
+		}
+		return result;
+	}
+
+	// Row i of A c is value times the sum of row i of A, repeated.
+	template<typename DataType>
+	Matrix<DataType> operator*(const Matrix<DataType>& a, const ConstantMatrix<DataType>& c)
+	{
+		Detail::CheckProductShape(a.GetCols(), c.GetRows());
+		const size_t k = c.GetCols();
+		Matrix<DataType> result(a.GetRows(), k);
+		for (size_t i = 0; i < a.GetRows(); ++i)
+		{
+			DataType sum = DataType(0);
+			for (size_t j = 0; j < a.GetCols(); ++j)
+			{
+				sum += a.mData[i * a.GetCols() + j];
+			}
+			std::fill(result.mData + i * k, result.mData + (i + 1) * k, c.GetValue() * sum);
+		}
+		return result;
+	}
+#pragma endregion Constant
+
+#pragma region Diagonal
+	// Scales row i of A by d_i.
+	template<typename DataType>
+	Matrix<DataType> operator*(const DiagonalMatrix<DataType>& d, const Matrix<DataType>& a)
+	{
+		Detail::CheckProductShape(d.GetCols(), a.GetRows());
+		const size_t k = a.GetCols();
+		Matrix<DataType> result(a.GetRows(), k);
+		for (size_t i = 0; i < a.GetRows(); ++i)
+		{
+			const DataType scale = d[i];
+			for (size_t j = 0; j < k; ++j)
+			{
+				result.mData[i * k + j] = scale * a.mData[i * k + j];
+			}
+		}
+		return result;
+	}
+
+	// Scales column j of A by d_j.
+	template<typename DataType>
+	Matrix<DataType> operator*(const Matrix<DataType>& a, const DiagonalMatrix<DataType>& d)
+	{
+		Detail::CheckProductShape(a.GetCols(), d.GetRows());
+		const size_t k = a.GetCols();
+		Matrix<DataType> result(a.GetRows(), k);
+		for (size_t i = 0; i < a.GetRows(); ++i)
+		{
+			for (size_t j = 0; j < k; ++j)
+			{
+				result.mData[i * k + j] = a.mData[i * k + j] * d[j];
+			}
+		}
+		return result;
+	}
+#pragma endregion Diagonal
+
+#pragma region Permutation
+	// P A gathers rows: row i is row permutation[i] of A.
+	template<typename DataType>
+	Matrix<DataType> operator*(const PermutationMatrix<DataType>& p, const Matrix<DataType>& a)
+	{
+		Detail::CheckProductShape(p.GetCols(), a.GetRows());
+		const size_t k = a.GetCols();
+		Matrix<DataType> result(a.GetRows(), k);
+		for (size_t i = 0; i < a.GetRows(); ++i)
+		{
+			const DataType* row = a.mData + p.Permutation()[i] * k;
+			std::copy(row, row + k, result.mData + i * k);
+		}
+		return result;
+	}
+
+	// A P scatters columns: column permutation[i] of the result is column i of A.
+	template<typename DataType>
+	Matrix<DataType> operator*(const Matrix<DataType>& a, const PermutationMatrix<DataType>& p)
+	{
+		Detail::CheckProductShape(a.GetCols(), p.GetRows());
+		const size_t k = a.GetCols();
+		Matrix<DataType> result(a.GetRows(), k);
+		for (size_t r = 0; r < a.GetRows(); ++r)
+		{
+			for (size_t i = 0; i < k; ++i)
+			{
+				result.mData[r * k + p.Permutation()[i]] = a.mData[r * k + i];
+			}
+		}
+		return result;
+	}
+#pragma endregion Permutation
+
+#pragma region Common
+	// Products with vectors, and sums and differences with Matrix, for every structured type.
+	template<typename DataType, bool RowVector>
+	Vector<DataType> operator*(const IdentityMatrix<DataType>& s, const Vector<DataType, RowVector>& x)
+	{
+		Detail::CheckProductShape(s.GetCols(), x.GetSize());
+		Vector<DataType> y(s.GetRows());
+		s.Apply(x.Data(), y.Data());
+		return y;
+	}
+
+	template<typename DataType, bool RowVector>
+	Vector<DataType> operator*(const ConstantMatrix<DataType>& s, const Vector<DataType, RowVector>& x)
+	{
+		Detail::CheckProductShape(s.GetCols(), x.GetSize());
+		Vector<DataType> y(s.GetRows());
+		s.Apply(x.Data(), y.Data());
+		return y;
+	}
+
+	template<typename DataType, bool RowVector>
+	Vector<DataType> operator*(const DiagonalMatrix<DataType>& s, const Vector<DataType, RowVector>& x)
+	{
+		Detail::CheckProductShape(s.GetCols(), x.GetSize());
+		Vector<DataType> y(s.GetRows());
+		s.Apply(x.Data(), y.Data());
+		return y;
+	}
+
+	template<typename DataType, bool RowVector>
+	Vector<DataType> operator*(const PermutationMatrix<DataType>& s, const Vector<DataType, RowVector>& x)
+	{
+		Detail::CheckProductShape(s.GetCols(), x.GetSize());
+		Vector<DataType> y(s.GetRows());
+		s.Apply(x.Data(), y.Data());
+		return y;
+	}
+
+	template<typename DataType, template<typename> class Structured,
+		typename = decltype(Detail::AddInPlace(std::declval<Matrix<DataType>&>(), std::declval<const Structured<DataType>&>(), DataType()))>
+	Matrix<DataType> operator+(const Matrix<DataType>& a, const Structured<DataType>& s)
+	{
+		Detail::CheckSumShape(s, a);
+		Matrix<DataType> result(a);
+		Detail::AddInPlace(result, s, DataType(1));
+		return result;
+	}
+
+	template<typename DataType, template<typename> class Structured,
+		typename = decltype(Detail::AddInPlace(std::declval<Matrix<DataType>&>(), std::declval<const Structured<DataType>&>(), DataType()))>
+	Matrix<DataType> operator+(const Structured<DataType>& s, const Matrix<DataType>& a)
+	{
+		return a + s;
+	}
+
+	template<typename DataType, template<typename> class Structured,
+		typename = decltype(Detail::AddInPlace(std::declval<Matrix<DataType>&>(), std::declval<const Structured<DataType>&>(), DataType()))>
+	Matrix<DataType> operator-(const Matrix<DataType>& a, const Structured<DataType>& s)
+	{
+		Detail::CheckSumShape(s, a);
+		Matrix<DataType> result(a);
+		Detail::AddInPlace(result, s, DataType(-1));
+		return result;
+	}
+
+	template<typename DataType, template<typename> class Structured,
+		typename = decltype(Detail::AddInPlace(std::declval<Matrix<DataType>&>(), std::declval<const Structured<DataType>&>(), DataType()))>
+	Matrix<DataType> operator-(const Structured<DataType>& s, const Matrix<DataType>& a)
+	{
+		Detail::CheckSumShape(s, a);
+		Matrix<DataType> result = -a;
+		Detail::AddInPlace(result, s, DataType(1));
+		return result;
+	}
+#pragma endregion Common
+} // namespace LAR
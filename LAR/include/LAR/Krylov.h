@@ -0,0 +1,649 @@
+#pragma once
+#include "Matrix.h"
+#include "Vector.h"
+#include "Gemv.h"
+#include "Reduction.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace LAR
+{
+	// Anything usable as A (or as a preconditioner M^-1) in the Krylov solvers below:
+	//  - a square Matrix<DataType>, applied with Gemv;
+	//  - an object with a const member Apply(const DataType* x, DataType* y) computing y = A x, such
+	//    as SparseMatrix or the preconditioners;
+	//  - a callable with the same signature, e.g. a lambda wrapping a matrix-free stencil.
+	// The operator is only ever applied to vectors with as many entries as the right-hand side.
+
+	// M^-1 = I; the default preconditioner.
+	template<typename DataType>
+	struct IdentityPreconditioner
+	{
+		size_t Size;
+
+		void Apply(const DataType* x, DataType* y) const
+		{
+			std::copy(x, x + Size, y);
+		}
+	};
+
+	enum class KrylovStatus
+	{
+		Converged,
+		// MaxIterations reached first.
+		IterationLimit,
+		// A scalar the recurrence divides by vanished (indefinite A in CG, rho = 0 in BiCGSTAB, ...).
+		Breakdown,
+		// The Monitor callback asked to stop.
+		Stopped
+	};
+
+	struct KrylovOptions
+	{
+		size_t MaxIterations = 1000;
+		// Converged once the residual norm drops to max(RelativeTolerance * ||b||, AbsoluteTolerance).
+		double RelativeTolerance = 1e-8;
+		double AbsoluteTolerance = 0;
+		// Krylov dimension between GMRES restarts.
+		size_t Restart = 30;
+		// Keep the residual norm of every iteration in KrylovResult::History.
+		bool RecordHistory = false;
+		// Called after every iteration with (iteration, residual norm); returning false stops the solve.
+		std::function<bool(size_t, double)> Monitor;
+	};
+
+	template<typename DataType>
+	struct KrylovResult
+	{
+		KrylovStatus Status = KrylovStatus::IterationLimit;
+		size_t Iterations = 0;
+		// The solver's own residual estimate: ||b - A x|| for CG, GMRES and BiCGSTAB, the
+		// M^-1-norm of the residual for preconditioned MINRES.
+		DataType ResidualNorm = 0;
+		std::vector<DataType> History;
+
+		bool Converged() const { return Status == KrylovStatus::Converged; }
+	};
+
+	namespace Detail
+	{
+		template<typename Operator, typename DataType, typename = void>
+		struct HasApplyMember : std::false_type
+		{
+		};
+
+		template<typename Operator, typename DataType>
+		struct HasApplyMember<Operator, DataType,
+			std::void_t<decltype(std::declval<const Operator&>().Apply(std::declval<const DataType*>(), std::declval<DataType*>()))>>
+			: std::true_type
+		{
+		};
+
+		// y = A x for any operator of the concept above.
+		template<typename DataType, typename Operator>
+		void ApplyOperator(const Operator& a, const DataType* x, DataType* y, const size_t n)
+		{
+			if constexpr (std::is_same<Operator, Matrix<DataType>>::value)
+			{
+				GemvRows(n, n, DataType(1), a.mData, n, x, DataType(0), y);
+			}
+			else if constexpr (HasApplyMember<Operator, DataType>::value)
+			{
+				a.Apply(x, y);
+			}
+			else
+			{
+				a(x, y);
+			}
+		}
+
+		template<typename Operator, typename = void>
+		struct HasShape : std::false_type
+		{
+		};
+
+		template<typename Operator>
+		struct HasShape<Operator, std::void_t<decltype(std::declval<const Operator&>().GetRows() + std::declval<const Operator&>().GetCols())>>
+			: std::true_type
+		{
+		};
+
+		// Operators that know their shape (Matrix, SparseMatrix) are checked against the right-hand side.
+		template<typename DataType, typename Operator>
+		void CheckOperatorSize(const Operator& a, const size_t n)
+		{
+			if constexpr (HasShape<Operator>::value)
+			{
+				if (a.GetRows() != n || a.GetCols() != n)
+				{
+					throw std::invalid_argument("Operator must be square and match the right-hand side.");
+				}
+			}
+		}
+
+		template<typename DataType>
+		DataType Norm(const DataType* x, const size_t n)
+		{
+			return std::sqrt(Dot<DataType>(x, x, n));
+		}
+
+		// y += alpha x
+		template<typename DataType>
+		void Axpy(const size_t n, const DataType alpha, const DataType* x, DataType* y)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				y[i] += alpha * x[i];
+			}
+		}
+
+		// r = b - A x
+		template<typename DataType, typename Operator>
+		void Residual(const Operator& a, const DataType* b, const DataType* x, DataType* r, const size_t n)
+		{
+			ApplyOperator(a, x, r, n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				r[i] = b[i] - r[i];
+			}
+		}
+
+		// Bookkeeping shared by every solver: tolerance, history, monitor and iteration limit.
+		template<typename DataType>
+		class KrylovMonitor
+		{
+		public:
+			KrylovMonitor(const KrylovOptions& options, const DataType normB, KrylovResult<DataType>& result)
+				: mOptions(options), mResult(result),
+				mTolerance(std::max(DataType(options.RelativeTolerance) * normB, DataType(options.AbsoluteTolerance)))
+			{
+				mResult = KrylovResult<DataType>();
+			}
+
+			bool Satisfied(const DataType residual) const { return residual <= mTolerance; }
+
+			// Records iteration `iteration` (0 is the initial residual) and returns true when the solve must end.
+			bool Finished(const size_t iteration, const DataType residual)
+			{
+				mResult.Iterations = iteration;
+				mResult.ResidualNorm = residual;
+				if (mOptions.RecordHistory)
+				{
+					mResult.History.push_back(residual);
+				}
+				if (Satisfied(residual))
+				{
+					mResult.Status = KrylovStatus::Converged;
+					return true;
+				}
+				if (iteration > 0 && mOptions.Monitor && !mOptions.Monitor(iteration, double(residual)))
+				{
+					mResult.Status = KrylovStatus::Stopped;
+					return true;
+				}
+				if (iteration >= mOptions.MaxIterations)
+				{
+					mResult.Status = KrylovStatus::IterationLimit;
+					return true;
+				}
+				return false;
+			}
+
+			void Breakdown() { mResult.Status = KrylovStatus::Breakdown; }
+
+		private:
+			const KrylovOptions& mOptions;
+			KrylovResult<DataType>& mResult;
+			DataType mTolerance;
+		};
+	} // namespace Detail
+
+	// Shared state of the solvers: options and a workspace that grows to the largest system solved
+	// and is then reused, so repeated solves (time stepping, Newton) allocate nothing.
+	template<typename DataType>
+	class LAR_EXPORT KrylovSolverBase
+	{
+		static_assert(std::is_floating_point<DataType>::value, "Krylov solvers require a floating-point element type.");
+
+	public:
+		explicit KrylovSolverBase(const KrylovOptions& options)
+			: mOptions(options)
+		{
+		}
+
+		KrylovOptions& Options() { return mOptions; }
+		const KrylovOptions& Options() const { return mOptions; }
+
+	protected:
+		DataType* Workspace(const size_t size)
+		{
+			if (mWork.size() < size)
+			{
+				mWork.resize(size);
+			}
+			return mWork.data();
+		}
+
+		static void CheckSizes(const Vector<DataType>& b, const Vector<DataType>& x)
+		{
+			if (b.GetSize() != x.GetSize())
+			{
+				throw std::invalid_argument("Solution and right-hand side must have the same size.");
+			}
+		}
+
+		KrylovOptions mOptions;
+		std::vector<DataType> mWork;
+	};
+
+	// Preconditioned conjugate gradients for symmetric positive definite A and M. x holds the initial
+	// guess on entry and the solution on exit.
+	template<typename DataType>
+	class LAR_EXPORT ConjugateGradient : public KrylovSolverBase<DataType>
+	{
+	public:
+		explicit ConjugateGradient(const KrylovOptions& options = KrylovOptions())
+			: KrylovSolverBase<DataType>(options)
+		{
+		}
+
+		template<typename Operator>
+		KrylovResult<DataType> Solve(const Operator& a, const Vector<DataType>& b, Vector<DataType>& x)
+		{
+			return Solve(a, b, x, IdentityPreconditioner<DataType>{ b.GetSize() });
+		}
+
+		template<typename Operator, typename Preconditioner>
+		KrylovResult<DataType> Solve(const Operator& a, const Vector<DataType>& b, Vector<DataType>& x, const Preconditioner& m)
+		{
+			this->CheckSizes(b, x);
+			const size_t n = b.GetSize();
+			Detail::CheckOperatorSize<DataType>(a, n);
+			DataType* r = this->Workspace(4 * n);
+			DataType* z = r + n;
+			DataType* p = z + n;
+			DataType* q = p + n;
+
+			KrylovResult<DataType> result;
+			Detail::KrylovMonitor<DataType> monitor(this->mOptions, Detail::Norm(b.Data(), n), result);
+			Detail::Residual(a, b.Data(), x.Data(), r, n);
+			if (monitor.Finished(0, Detail::Norm(r, n)))
+			{
+				return result;
+			}
+			Detail::ApplyOperator(m, r, z, n);
+			std::copy(z, z + n, p);
+			DataType rho = Dot<DataType>(r, z, n);
+			for (size_t iteration = 1;; ++iteration)
+			{
+				Detail::ApplyOperator(a, p, q, n);
+				const DataType curvature = Dot<DataType>(p, q, n);
+				if (!(curvature > DataType(0)))
+				{
+					monitor.Breakdown();
+					return result;
+				}
+				const DataType alpha = rho / curvature;
+				Detail::Axpy(n, alpha, p, x.Data());
+				Detail::Axpy(n, -alpha, q, r);
+				if (monitor.Finished(iteration, Detail::Norm(r, n)))
+				{
+					return result;
+				}
+				Detail::ApplyOperator(m, r, z, n);
+				const DataType rhoNext = Dot<DataType>(r, z, n);
+				const DataType beta = rhoNext / rho;
+				rho = rhoNext;
+				for (size_t i = 0; i < n; ++i)
+				{
+					p[i] = z[i] + beta * p[i];
+				}
+			}
+		}
+	};
+
+	// MINRES (Paige and Saunders) for symmetric, possibly indefinite A with a symmetric positive
+	// definite preconditioner. The reported residual is the M^-1-norm, which is ||b - A x|| without
+	// preconditioning.
+	template<typename DataType>
+	class LAR_EXPORT MINRES : public KrylovSolverBase<DataType>
+	{
+	public:
+		explicit MINRES(const KrylovOptions& options = KrylovOptions())
+			: KrylovSolverBase<DataType>(options)
+		{
+		}
+
+		template<typename Operator>
+		KrylovResult<DataType> Solve(const Operator& a, const Vector<DataType>& b, Vector<DataType>& x)
+		{
+			return Solve(a, b, x, IdentityPreconditioner<DataType>{ b.GetSize() });
+		}
+
+		template<typename Operator, typename Preconditioner>
+		KrylovResult<DataType> Solve(const Operator& a, const Vector<DataType>& b, Vector<DataType>& x, const Preconditioner& m)
+		{
+			this->CheckSizes(b, x);
+			const size_t n = b.GetSize();
+			Detail::CheckOperatorSize<DataType>(a, n);
+			DataType* r1 = this->Workspace(7 * n);
+			DataType* r2 = r1 + n;
+			DataType* y = r2 + n;
+			DataType* v = y + n;
+			DataType* w = v + n;
+			DataType* w1 = w + n;
+			DataType* w2 = w1 + n;
+
+			KrylovResult<DataType> result;
+			Detail::Residual(a, b.Data(), x.Data(), r1, n);
+			Detail::ApplyOperator(m, r1, y, n);
+			const DataType beta1Squared = Dot<DataType>(r1, y, n);
+			if (beta1Squared < DataType(0))
+			{
+				throw std::invalid_argument("MINRES needs a positive definite preconditioner.");
+			}
+			// Tolerances are relative to ||b|| in the same M^-1-norm as the residual estimate.
+			Detail::ApplyOperator(m, b.Data(), v, n);
+			Detail::KrylovMonitor<DataType> monitor(this->mOptions, std::sqrt(std::max(DataType(0), Dot<DataType>(b.Data(), v, n))), result);
+			DataType beta = std::sqrt(beta1Squared);
+			if (monitor.Finished(0, beta))
+			{
+				return result;
+			}
+			std::copy(r1, r1 + n, r2);
+			std::fill(w, w + n, DataType(0));
+			std::fill(w2, w2 + n, DataType(0));
+			DataType oldBeta = 0, dbar = 0, epsilon = 0, phibar = beta;
+			DataType cs = -1, sn = 0;
+			for (size_t iteration = 1;; ++iteration)
+			{
+				// Lanczos step: v = y / beta, y = A v - (beta / oldBeta) r1 - (alpha / beta) r2.
+				const DataType scale = DataType(1) / beta;
+				for (size_t i = 0; i < n; ++i)
+				{
+					v[i] = scale * y[i];
+				}
+				Detail::ApplyOperator(a, v, y, n);
+				if (iteration > 1)
+				{
+					Detail::Axpy(n, -beta / oldBeta, r1, y);
+				}
+				const DataType alpha = Dot<DataType>(v, y, n);
+				Detail::Axpy(n, -alpha / beta, r2, y);
+				std::swap(r1, r2);
+				std::copy(y, y + n, r2);
+				Detail::ApplyOperator(m, r2, y, n);
+				oldBeta = beta;
+				const DataType betaSquared = Dot<DataType>(r2, y, n);
+				if (betaSquared < DataType(0))
+				{
+					monitor.Breakdown();
+					return result;
+				}
+				beta = std::sqrt(betaSquared);
+
+				// Apply the previous rotation, then compute and apply the new one.
+				const DataType oldEpsilon = epsilon;
+				const DataType delta = cs * dbar + sn * alpha;
+				const DataType gbar = sn * dbar - cs * alpha;
+				epsilon = sn * beta;
+				dbar = -cs * beta;
+				const DataType gamma = std::max(std::hypot(gbar, beta), std::numeric_limits<DataType>::min());
+				cs = gbar / gamma;
+				sn = beta / gamma;
+				const DataType phi = cs * phibar;
+				phibar *= sn;
+
+				// w = (v - oldEpsilon w1 - delta w2) / gamma, with (w1, w2) the two previous directions.
+				std::swap(w1, w2);
+				std::swap(w2, w);
+				const DataType inverse = DataType(1) / gamma;
+				for (size_t i = 0; i < n; ++i)
+				{
+					w[i] = (v[i] - oldEpsilon * w1[i] - delta * w2[i]) * inverse;
+				}
+				Detail::Axpy(n, phi, w, x.Data());
+				if (monitor.Finished(iteration, phibar))
+				{
+					return result;
+				}
+				if (beta == DataType(0))
+				{
+					// Invariant subspace found: x is the exact least-squares solution.
+					monitor.Breakdown();
+					return result;
+				}
+			}
+		}
+	};
+
+	// Restarted GMRES(Restart) for general A, right-preconditioned so the residual estimate is the
+	// true ||b - A x||. Arnoldi uses modified Gram-Schmidt and the least-squares problem is kept
+	// triangular with Givens rotations.
+	template<typename DataType>
+	class LAR_EXPORT GMRES : public KrylovSolverBase<DataType>
+	{
+	public:
+		explicit GMRES(const KrylovOptions& options = KrylovOptions())
+			: KrylovSolverBase<DataType>(options)
+		{
+		}
+
+		template<typename Operator>
+		KrylovResult<DataType> Solve(const Operator& a, const Vector<DataType>& b, Vector<DataType>& x)
+		{
+			return Solve(a, b, x, IdentityPreconditioner<DataType>{ b.GetSize() });
+		}
+
+		template<typename Operator, typename Preconditioner>
+		KrylovResult<DataType> Solve(const Operator& a, const Vector<DataType>& b, Vector<DataType>& x, const Preconditioner& m)
+		{
+			this->CheckSizes(b, x);
+			const size_t n = b.GetSize();
+			Detail::CheckOperatorSize<DataType>(a, n);
+			const size_t restart = std::max<size_t>(1, std::min(this->mOptions.Restart, std::max<size_t>(1, n)));
+			// Basis V (restart + 1 rows of n), z, the Hessenberg matrix and the rotation and rhs vectors.
+			DataType* basis = this->Workspace((restart + 2) * n + (restart + 1) * restart + 3 * (restart + 1));
+			DataType* z = basis + (restart + 1) * n;
+			DataType* h = z + n;
+			DataType* cs = h + (restart + 1) * restart;
+			DataType* sn = cs + restart + 1;
+			DataType* g = sn + restart + 1;
+
+			KrylovResult<DataType> result;
+			Detail::KrylovMonitor<DataType> monitor(this->mOptions, Detail::Norm(b.Data(), n), result);
+			size_t iteration = 0;
+			while (true)
+			{
+				DataType* v0 = basis;
+				Detail::Residual(a, b.Data(), x.Data(), v0, n);
+				DataType beta = Detail::Norm(v0, n);
+				// After a restart the estimate for this iteration is already recorded; only the true
+				// residual confirming convergence is reported again.
+				if (iteration == 0 ? monitor.Finished(0, beta) : monitor.Satisfied(beta) && monitor.Finished(iteration, beta))
+				{
+					return result;
+				}
+				for (size_t i = 0; i < n; ++i)
+				{
+					v0[i] /= beta;
+				}
+				std::fill(g, g + restart + 1, DataType(0));
+				g[0] = beta;
+
+				size_t j = 0;
+				bool done = false;
+				bool breakdown = false;
+				while (j < restart && !done)
+				{
+					DataType* vNext = basis + (j + 1) * n;
+					Detail::ApplyOperator(m, basis + j * n, z, n);
+					Detail::ApplyOperator(a, z, vNext, n);
+					// Column j of H, row-major (restart + 1) x restart.
+					for (size_t i = 0; i <= j; ++i)
+					{
+						const DataType hij = Dot<DataType>(basis + i * n, vNext, n);
+						h[i * restart + j] = hij;
+						Detail::Axpy(n, -hij, basis + i * n, vNext);
+					}
+					const DataType hNext = Detail::Norm(vNext, n);
+					h[(j + 1) * restart + j] = hNext;
+					if (hNext != DataType(0))
+					{
+						for (size_t i = 0; i < n; ++i)
+						{
+							vNext[i] /= hNext;
+						}
+					}
+					for (size_t i = 0; i < j; ++i)
+					{
+						const DataType upper = h[i * restart + j];
+						const DataType lower = h[(i + 1) * restart + j];
+						h[i * restart + j] = cs[i] * upper + sn[i] * lower;
+						h[(i + 1) * restart + j] = -sn[i] * upper + cs[i] * lower;
+					}
+					const DataType diagonal = h[j * restart + j];
+					const DataType radius = std::hypot(diagonal, hNext);
+					if (radius == DataType(0))
+					{
+						// H(0:j+1, 0:j+1) is singular; the j directions already built still reduce the residual.
+						breakdown = true;
+						break;
+					}
+					cs[j] = diagonal / radius;
+					sn[j] = hNext / radius;
+					h[j * restart + j] = radius;
+					h[(j + 1) * restart + j] = DataType(0);
+					g[j + 1] = -sn[j] * g[j];
+					g[j] = cs[j] * g[j];
+					++j;
+					++iteration;
+					const DataType estimate = std::abs(g[j]);
+					done = monitor.Finished(iteration, estimate) || hNext == DataType(0);
+				}
+
+				// x += M^-1 V y with H(0:j, 0:j) y = g(0:j).
+				for (size_t i = j; i-- > 0;)
+				{
+					DataType sum = g[i];
+					for (size_t k = i + 1; k < j; ++k)
+					{
+						sum -= h[i * restart + k] * g[k];
+					}
+					g[i] = sum / h[i * restart + i];
+				}
+				std::fill(z, z + n, DataType(0));
+				for (size_t i = 0; i < j; ++i)
+				{
+					Detail::Axpy(n, g[i], basis + i * n, z);
+				}
+				DataType* update = basis;
+				Detail::ApplyOperator(m, z, update, n);
+				Detail::Axpy(n, DataType(1), update, x.Data());
+				if (breakdown)
+				{
+					monitor.Breakdown();
+					return result;
+				}
+				if (result.Status != KrylovStatus::IterationLimit || iteration >= this->mOptions.MaxIterations)
+				{
+					return result;
+				}
+			}
+		}
+	};
+
+	// BiCGSTAB (van der Vorst) for general A, right-preconditioned. Two operator and two
+	// preconditioner applications per iteration, with short recurrences and fixed memory.
+	template<typename DataType>
+	class LAR_EXPORT BiCGSTAB : public KrylovSolverBase<DataType>
+	{
+	public:
+		explicit BiCGSTAB(const KrylovOptions& options = KrylovOptions())
+			: KrylovSolverBase<DataType>(options)
+		{
+		}
+
+		template<typename Operator>
+		KrylovResult<DataType> Solve(const Operator& a, const Vector<DataType>& b, Vector<DataType>& x)
+		{
+			return Solve(a, b, x, IdentityPreconditioner<DataType>{ b.GetSize() });
+		}
+
+		template<typename Operator, typename Preconditioner>
+		KrylovResult<DataType> Solve(const Operator& a, const Vector<DataType>& b, Vector<DataType>& x, const Preconditioner& m)
+		{
+			this->CheckSizes(b, x);
+			const size_t n = b.GetSize();
+			Detail::CheckOperatorSize<DataType>(a, n);
+			DataType* r = this->Workspace(7 * n);
+			DataType* shadow = r + n;
+			DataType* p = shadow + n;
+			DataType* v = p + n;
+			DataType* pHat = v + n;
+			DataType* sHat = pHat + n;
+			DataType* t = sHat + n;
+
+			KrylovResult<DataType> result;
+			Detail::KrylovMonitor<DataType> monitor(this->mOptions, Detail::Norm(b.Data(), n), result);
+			Detail::Residual(a, b.Data(), x.Data(), r, n);
+			if (monitor.Finished(0, Detail::Norm(r, n)))
+			{
+				return result;
+			}
+			std::copy(r, r + n, shadow);
+			std::fill(p, p + n, DataType(0));
+			std::fill(v, v + n, DataType(0));
+			DataType rho = 1, alpha = 1, omega = 1;
+			for (size_t iteration = 1;; ++iteration)
+			{
+				const DataType rhoNext = Dot<DataType>(shadow, r, n);
+				if (rhoNext == DataType(0) || omega == DataType(0))
+				{
+					monitor.Breakdown();
+					return result;
+				}
+				const DataType beta = (rhoNext / rho) * (alpha / omega);
+				rho = rhoNext;
+				for (size_t i = 0; i < n; ++i)
+				{
+					p[i] = r[i] + beta * (p[i] - omega * v[i]);
+				}
+				Detail::ApplyOperator(m, p, pHat, n);
+				Detail::ApplyOperator(a, pHat, v, n);
+				const DataType projection = Dot<DataType>(shadow, v, n);
+				if (projection == DataType(0))
+				{
+					monitor.Breakdown();
+					return result;
+				}
+				alpha = rho / projection;
+				// r becomes s = r - alpha v.
+				Detail::Axpy(n, -alpha, v, r);
+				Detail::Axpy(n, alpha, pHat, x.Data());
+				const DataType normS = Detail::Norm(r, n);
+				if (monitor.Satisfied(normS))
+				{
+					monitor.Finished(iteration, normS);
+					return result;
+				}
+				Detail::ApplyOperator(m, r, sHat, n);
+				Detail::ApplyOperator(a, sHat, t, n);
+				const DataType tt = Dot<DataType>(t, t, n);
+				omega = tt == DataType(0) ? DataType(0) : Dot<DataType>(t, r, n) / tt;
+				Detail::Axpy(n, omega, sHat, x.Data());
+				Detail::Axpy(n, -omega, t, r);
+				if (monitor.Finished(iteration, Detail::Norm(r, n)))
+				{
+					return result;
+				}
+			}
+		}
+	};
+} // namespace LAR
@@ -1,4 +1,21 @@
 #pragma once
 #include "Rational.h"
 #include "Vector.h"
-#include "Matrix.h"
\ No newline at end of file
+#include "Matrix.h"
+#include "QR.h"
+#include "SymmetricEigen.h"
+#include "Eigen.h"
+#include "SVD.h"
+#include "RandomizedSVD.h"
+#include "Krylov.h"
+#include "SparseMatrix.h"
+#include "Preconditioners.h"
+#include "SellMatrix.h"
+#include "SparseOrdering.h"
+#include "SparseDirect.h"
+#include "SparseElimination.h"
+#include "BsrMatrix.h"
+#include "SparseVector.h"
+#include "GraphPartition.h"
+#include "PackedMatrix.h"
+#include "ImplicitMatrix.h"
@@ -6,6 +6,10 @@
 #  define LAR_EXPORT
 #  define LAR_NO_EXPORT
 #else
+#  if !defined(LAR_EXPORT) && defined(__GNUC__)
+/* The library is built with hidden visibility; exported names opt back in */
+#    define LAR_EXPORT __attribute__((visibility("default")))
+#  endif
 #  ifndef LAR_EXPORT
 #    ifdef LAR_EXPORTS
 /* We are building this library */
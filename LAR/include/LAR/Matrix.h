@@ -2,6 +2,9 @@
 #include "MatrixBase.h"
 #include "LAR_export.h"
 #include "Algorithms.h"
+#include "Operations.h"
+#include "Reduction.h"
+#include <algorithm>
 #include <vector>
 
 namespace LAR
@@ -106,17 +109,7 @@ namespace LAR
 				throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
 			}
 			Matrix<decltype(DataType()* OtherDataType())> result(this->mNumRows, other.mNumCols);
-			for (size_t i = 0; i < this->mNumRows; ++i)
-			{
-				for (size_t j = 0; j < other.mNumCols; ++j)
-				{
-					result(i, j) = 0;
-					for (size_t k = 0; k < this->mNumCols; ++k)
-					{
-						result(i, j) += (*this)(i, k) * other(k, j);
-					}
-				}
-			}
+			Multiply(*this, other, result);
 			return result;
 		}
 
@@ -127,15 +120,8 @@ namespace LAR
 			{
 				throw std::invalid_argument("Number of columns in matrix must match size of vector.");
 			}
-			Vector<decltype(DataType()* OtherDataType()), true> result(this->mNumRows);
-			for (size_t i = 0; i < this->mNumRows; ++i)
-			{
-				result[i] = 0;
-				for (size_t j = 0; j < this->mNumCols; ++j)
-				{
-					result[i] += (*this)(i, j) * vector[j];
-				}
-			}
+			Vector<decltype(DataType()* OtherDataType())> result(this->mNumRows);
+			Multiply(*this, vector, result);
 			return result;
 		}
 
@@ -215,6 +201,7 @@ namespace LAR
 		static Matrix Identity(const size_t size)
 		{
 			Matrix result(size, size);
+			std::fill(result.mData, result.mData + size * size, DataType(0));
 			for (size_t i = 0; i < size; ++i)
 			{
 				result.mData[i * size + i] = 1;
@@ -272,18 +259,15 @@ namespace LAR
 			return result;
 		}
 
-		DataType Trace() const
+		DataType Trace(const ReductionMode mode = GetReductionMode()) const
 		{
 			if (!IsSquare())
 			{
 				throw std::invalid_argument("Matrix must be square to find the trace.");
 			}
-			DataType sum = 0;
-			for (size_t i = 0; i < mNumRows; ++i)
-			{
-				sum += mData[i * mNumCols + i];
-			}
-			return sum;
+			const DataType* data = this->mData;
+			const size_t stride = this->mNumCols + 1;
+			return Detail::Reduce<DataType>(this->mNumRows, mode, [data, stride](const size_t i) { return data[i * stride]; });
 		}
 
 		void SwapRows(const size_t row1, const size_t row2)
@@ -310,6 +294,49 @@ namespace LAR
 			}
 		}
 
+		// Row i becomes the old row permutation[i], the net effect of a sequence of SwapRows calls.
+		// Each cycle of the permutation is followed with one row of scratch, so every row moves once.
+		void PermuteRows(const std::vector<size_t>& permutation)
+		{
+			Detail::CheckPermutation(permutation, mNumRows);
+			ScratchBuffer<char> placed(mNumRows);
+			ScratchBuffer<DataType> carried(mNumCols);
+			std::fill(placed.Data(), placed.Data() + mNumRows, char(0));
+			for (size_t start = 0; start < mNumRows; ++start)
+			{
+				if (placed[start] || permutation[start] == start)
+				{
+					continue;
+				}
+				std::copy(mData + start * mNumCols, mData + (start + 1) * mNumCols, carried.Data());
+				size_t row = start;
+				while (permutation[row] != start)
+				{
+					std::copy(mData + permutation[row] * mNumCols, mData + (permutation[row] + 1) * mNumCols, mData + row * mNumCols);
+					placed[row] = 1;
+					row = permutation[row];
+				}
+				std::copy(carried.Data(), carried.Data() + mNumCols, mData + row * mNumCols);
+				placed[row] = 1;
+			}
+		}
+
+		// Column j becomes the old column permutation[j], as a sequence of SwapCols would leave it.
+		void PermuteCols(const std::vector<size_t>& permutation)
+		{
+			Detail::CheckPermutation(permutation, mNumCols);
+			ScratchBuffer<DataType> row(mNumCols);
+			for (size_t i = 0; i < mNumRows; ++i)
+			{
+				DataType* data = mData + i * mNumCols;
+				for (size_t j = 0; j < mNumCols; ++j)
+				{
+					row[j] = data[permutation[j]];
+				}
+				std::copy(row.Data(), row.Data() + mNumCols, data);
+			}
+		}
+
 		void ScaleRow(const size_t row, const DataType scalar)
 		{
 			if (row < 0 || row >= mNumRows)
@@ -358,9 +385,9 @@ namespace LAR
 			}
 		}
 
-		Matrix RowEchelonForm() const
+		Matrix& RowEchelonFormInPlace()
 		{
-			Matrix result(*this);
+			Matrix& result = *this;
 			size_t lead = 0;
 			for (size_t r = 0; r < result.mNumRows; ++r)
 			{
@@ -400,6 +427,13 @@ namespace LAR
 				}
 				++lead;
 			}
+			return *this;
+		}
+
+		Matrix RowEchelonForm() const
+		{
+			Matrix result(*this);
+			result.RowEchelonFormInPlace();
 			return result;
 		}
 	};
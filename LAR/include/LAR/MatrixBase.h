@@ -1,6 +1,8 @@
 #pragma once
 #include <iostream>
+#include <utility>
 #include "LAR_export.h"
+#include "Memory.h"
 
 namespace LAR
 {
@@ -16,7 +18,7 @@ namespace LAR
 	public:
 #pragma region Utility Functions
 		MatrixBase(const size_t rows, const size_t cols)
-			: mNumRows(rows), mNumCols(cols), mData(new DataType[rows * cols])
+			: mNumRows(rows), mNumCols(cols), mData(AllocateStorage(rows, cols, mScratch))
 		{
 		}
 		MatrixBase(const MatrixBase& other)
@@ -24,7 +26,7 @@ namespace LAR
 		{
 			if (mNumRows > 0 && mNumCols > 0)
 			{
-				mData = new DataType[mNumRows * mNumCols];
+				mData = AllocateStorage(mNumRows, mNumCols, mScratch);
 
 				for (size_t i = 0; i < mNumRows * mNumCols; ++i)
 				{
@@ -37,9 +39,27 @@ namespace LAR
 			}
 		}
 
+		MatrixBase(MatrixBase&& other) noexcept
+			: mNumRows(other.mNumRows), mNumCols(other.mNumCols), mScratch(other.mScratch), mData(other.mData)
+		{
+			other.mNumRows = 0;
+			other.mNumCols = 0;
+			other.mScratch = ScratchOwner();
+			other.mData = nullptr;
+		}
+
+	protected:
+		// Takes ownership of a buffer obtained from AllocateStorage, e.g. to reinterpret a vector's
+		// storage under the opposite orientation without copying.
+		MatrixBase(const size_t rows, const size_t cols, DataType* data, const ScratchOwner& scratch)
+			: mNumRows(rows), mNumCols(cols), mScratch(scratch), mData(data)
+		{
+		}
+
+	public:
 		virtual ~MatrixBase()
 		{
-			delete[] mData;
+			ReleaseStorage(mData, mNumRows, mNumCols, mScratch);
 		}
 
 		Derived& AsDerived() { return static_cast<Derived&>(*this); }
@@ -49,10 +69,16 @@ namespace LAR
 		{
 			if (this != &other)
 			{
-				delete[] mData;
+				if (mData == nullptr || mNumRows * mNumCols != other.mNumRows * other.mNumCols)
+				{
+					// The new buffer may only come from the arena if this matrix already belongs to the
+					// innermost scope; otherwise it could outlive the memory.
+					const bool innermost = mScratch && mScratch == ScratchArena::Current().CurrentOwner();
+					ReleaseStorage(mData, mNumRows, mNumCols, mScratch);
+					mData = innermost ? AllocateStorage(other.mNumRows, other.mNumCols, mScratch) : AllocateHeap(other.mNumRows, other.mNumCols, mScratch);
+				}
 				mNumRows = other.mNumRows;
 				mNumCols = other.mNumCols;
-				mData = new DataType[mNumRows * mNumCols];
 				for (size_t i = 0; i < mNumRows * mNumCols; ++i)
 				{
 					mData[i] = other.mData[i];
@@ -61,6 +87,24 @@ namespace LAR
 			return *this;
 		}
 
+		MatrixBase& operator=(MatrixBase&& other)
+		{
+			if (mScratch != other.mScratch)
+			{
+				// Buffers trade places only when both come from the same scope (or both from the heap);
+				// never hand an arena buffer to a matrix that may outlive the scope it came from.
+				return *this = static_cast<const MatrixBase&>(other);
+			}
+			if (this != &other)
+			{
+				std::swap(mNumRows, other.mNumRows);
+				std::swap(mNumCols, other.mNumCols);
+				std::swap(mScratch, other.mScratch);
+				std::swap(mData, other.mData);
+			}
+			return *this;
+		}
+
 		size_t GetRows() const
 		{
 			return mNumRows;
@@ -101,6 +145,52 @@ namespace LAR
 		}
 
 #pragma endregion Utility Functions
+
+#pragma region Storage
+		// Inside a ScratchScope that serves results the buffer comes from the thread's arena and is
+		// reclaimed with the scope. Otherwise it is a heap array, recycled through BufferPool when
+		// pooling is enabled.
+		static DataType* AllocateStorage(const size_t rows, const size_t cols, ScratchOwner& scratch)
+		{
+			ScratchArena& arena = ScratchArena::Current();
+			if (arena.ServesResults())
+			{
+				return arena.Construct<DataType>(rows * cols, scratch);
+			}
+			return AllocateHeap(rows, cols, scratch);
+		}
+
+		static DataType* AllocateHeap(const size_t rows, const size_t cols, ScratchOwner& scratch)
+		{
+			scratch = ScratchOwner();
+			if (IsBufferPoolEnabled())
+			{
+				return BufferPool<DataType>::Acquire(rows, cols);
+			}
+			return new DataType[rows * cols];
+		}
+
+		// Scratch buffers go back to the arena they came from, whichever thread releases them.
+		static void ReleaseStorage(DataType* data, const size_t rows, const size_t cols, const ScratchOwner& scratch)
+		{
+			if (data == nullptr)
+			{
+				return;
+			}
+			if (scratch)
+			{
+				ScratchArena::Destroy(data, rows * cols, scratch);
+			}
+			else if (IsBufferPoolEnabled())
+			{
+				BufferPool<DataType>::Release(data, rows, cols);
+			}
+			else
+			{
+				delete[] data;
+			}
+		}
+#pragma endregion Storage
 		
 		template<typename OtherDerived, typename OtherDataType>
 		bool CanMultiply(const MatrixBase<OtherDerived, OtherDataType>& other) const
@@ -144,6 +234,53 @@ namespace LAR
 			return result;
 		}
 
+		template<typename OtherDerived, typename OtherDataType>
+		Derived& operator+=(const MatrixBase<OtherDerived, OtherDataType>& other)
+		{
+			if (!SameSize(other))
+			{
+				throw std::invalid_argument("Matrices must be the same size to add them.");
+			}
+			for (size_t i = 0; i < mNumRows * mNumCols; ++i)
+			{
+				mData[i] += other.mData[i];
+			}
+			return AsDerived();
+		}
+
+		template<typename OtherDerived, typename OtherDataType>
+		Derived& operator-=(const MatrixBase<OtherDerived, OtherDataType>& other)
+		{
+			if (!SameSize(other))
+			{
+				throw std::invalid_argument("Matrices must be the same size to subtract them.");
+			}
+			for (size_t i = 0; i < mNumRows * mNumCols; ++i)
+			{
+				mData[i] -= other.mData[i];
+			}
+			return AsDerived();
+		}
+
+		Derived& operator*=(const DataType scalar)
+		{
+			for (size_t i = 0; i < mNumRows * mNumCols; ++i)
+			{
+				mData[i] *= scalar;
+			}
+			return AsDerived();
+		}
+
+		template<typename OtherDataType>
+		Derived& operator/=(const OtherDataType scalar)
+		{
+			for (size_t i = 0; i < mNumRows * mNumCols; ++i)
+			{
+				mData[i] /= scalar;
+			}
+			return AsDerived();
+		}
+
 		Derived operator*(const DataType scalar) const
 		{
 			Derived result(mNumRows, mNumCols);
@@ -188,13 +325,51 @@ namespace LAR
 			return result;
 		}
 
-		void TransposeInPlace() const
+		// Transposes without a second buffer: square matrices swap across the diagonal, others follow
+		// the permutation cycles of the row-major index map and rotate each cycle from its leader.
+		Derived& TransposeInPlace()
 		{
-			*this = Transpose();
+			const size_t count = mNumRows * mNumCols;
+			if (mNumRows == mNumCols)
+			{
+				for (size_t i = 0; i < mNumRows; ++i)
+				{
+					for (size_t j = i + 1; j < mNumCols; ++j)
+					{
+						std::swap(mData[i * mNumCols + j], mData[j * mNumCols + i]);
+					}
+				}
+			}
+			else if (count > 1)
+			{
+				// Element at index k moves to (k * rows) mod (count - 1); first and last stay put.
+				for (size_t start = 1; start < count - 1; ++start)
+				{
+					size_t next = (start * mNumRows) % (count - 1);
+					while (next > start)
+					{
+						next = (next * mNumRows) % (count - 1);
+					}
+					if (next < start)
+					{
+						continue;
+					}
+					DataType carried = mData[start];
+					size_t index = start;
+					do
+					{
+						index = (index * mNumRows) % (count - 1);
+						std::swap(carried, mData[index]);
+					} while (index != start);
+				}
+			}
+			std::swap(mNumRows, mNumCols);
+			return AsDerived();
 		}
 
 		size_t mNumRows;
 		size_t mNumCols;
+		ScratchOwner mScratch;
 		DataType* mData;
 	};
 
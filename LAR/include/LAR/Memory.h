@@ -0,0 +1,498 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace LAR
+{
+	struct ScratchStats
+	{
+		size_t BytesServed = 0;
+		size_t Allocations = 0;
+		size_t PeakBytes = 0;
+		size_t BytesReserved = 0;
+	};
+
+	class ScratchArena;
+
+	// Where a buffer came from: the arena and the live count of the scope that was innermost when it
+	// was allocated. Empty for heap storage. Two buffers with equal owners can trade places freely.
+	struct ScratchOwner
+	{
+		ScratchArena* Arena = nullptr;
+		std::atomic<size_t>* Live = nullptr;
+
+		explicit operator bool() const
+		{
+			return Arena != nullptr;
+		}
+		bool operator==(const ScratchOwner& other) const
+		{
+			return Arena == other.Arena && Live == other.Live;
+		}
+		bool operator!=(const ScratchOwner& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	// Per-thread bump allocator behind ScratchScope. Memory is only handed out while a scope is
+	// open and is reclaimed wholesale when that scope closes; the blocks themselves are kept so
+	// that the next scope on this thread does not touch the system allocator at all.
+	class ScratchArena
+	{
+	public:
+		static constexpr size_t Alignment = 64;
+		static constexpr size_t MinBlockSize = 64 * 1024;
+
+		struct Marker
+		{
+			size_t Block;
+			size_t Offset;
+			size_t InUse;
+		};
+
+		static ScratchArena& Current()
+		{
+			static thread_local ScratchArena arena;
+			return arena;
+		}
+
+		ScratchArena() = default;
+		ScratchArena(const ScratchArena&) = delete;
+		ScratchArena& operator=(const ScratchArena&) = delete;
+
+		~ScratchArena()
+		{
+			for (Block& block : mBlocks)
+			{
+				::operator delete(block.Data, std::align_val_t(Alignment));
+			}
+		}
+
+		bool IsActive() const
+		{
+			return !mScopes.empty();
+		}
+		bool ServesResults() const
+		{
+			return IsActive() && mServeResults;
+		}
+
+		// Owner record for a buffer allocated now: this arena and the innermost open scope, or the
+		// empty (heap) owner outside any scope.
+		ScratchOwner CurrentOwner()
+		{
+			return IsActive() ? ScratchOwner{ this, mScopes.back() } : ScratchOwner();
+		}
+
+		void* Allocate(const size_t bytes)
+		{
+			assert(IsActive() && "ScratchArena used outside of a ScratchScope");
+			const size_t size = (bytes + Alignment - 1) & ~(Alignment - 1);
+			while (mBlock < mBlocks.size() && mOffset + size > mBlocks[mBlock].Size)
+			{
+				mInUse += mBlocks[mBlock].Size - mOffset;
+				++mBlock;
+				mOffset = 0;
+			}
+			if (mBlock == mBlocks.size())
+			{
+				AddBlock(size);
+			}
+			void* result = mBlocks[mBlock].Data + mOffset;
+			mOffset += size;
+			mInUse += size;
+
+			mStats.BytesServed += bytes;
+			++mStats.Allocations;
+			if (mInUse > mStats.PeakBytes)
+			{
+				mStats.PeakBytes = mInUse;
+			}
+			return result;
+		}
+
+		// Constructs count objects in the innermost scope and records that scope in owner.
+		template<typename T>
+		T* Construct(const size_t count, ScratchOwner& owner)
+		{
+			T* data = static_cast<T*>(Allocate(count * sizeof(T)));
+			for (size_t i = 0; i < count; ++i)
+			{
+				new (data + i) T;
+			}
+			owner = CurrentOwner();
+			owner.Live->fetch_add(1, std::memory_order_relaxed);
+			return data;
+		}
+
+		// Ends the lifetime of a buffer from Construct. Only the owning scope's live count is touched,
+		// so this is safe from any thread while that scope is open; the memory returns with the scope.
+		template<typename T>
+		static void Destroy(T* data, const size_t count, const ScratchOwner& owner)
+		{
+			if (!std::is_trivially_destructible<T>::value)
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					data[i].~T();
+				}
+			}
+			owner.Live->fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		Marker Enter(std::atomic<size_t>& live, const bool serveResults, bool& previousServeResults)
+		{
+			previousServeResults = mServeResults;
+			mServeResults = serveResults;
+			mScopes.push_back(&live);
+			return Marker{ mBlock, mOffset, mInUse };
+		}
+
+		// A buffer still alive here would dangle once the memory is reused, in release builds as much
+		// as in debug ones, so this is a hard failure rather than an assert.
+		void Leave(const Marker& marker, const bool previousServeResults)
+		{
+			if (mScopes.back()->load(std::memory_order_relaxed) != 0)
+			{
+				std::fputs("LAR: a scratch-backed matrix or buffer outlived its ScratchScope.\n", stderr);
+				std::abort();
+			}
+			mScopes.pop_back();
+			mBlock = marker.Block;
+			mOffset = marker.Offset;
+			mInUse = marker.InUse;
+			mServeResults = previousServeResults;
+		}
+
+		// Releases retained blocks; only valid while no scope is open on this thread.
+		void Trim()
+		{
+			assert(!IsActive());
+			for (Block& block : mBlocks)
+			{
+				::operator delete(block.Data, std::align_val_t(Alignment));
+			}
+			mBlocks.clear();
+			mBlock = 0;
+			mOffset = 0;
+			mStats.BytesReserved = 0;
+		}
+
+		const ScratchStats& GetStats() const
+		{
+			return mStats;
+		}
+
+	private:
+		struct Block
+		{
+			unsigned char* Data;
+			size_t Size;
+		};
+
+		void AddBlock(const size_t minSize)
+		{
+			size_t size = mBlocks.empty() ? MinBlockSize : mBlocks.back().Size * 2;
+			while (size < minSize)
+			{
+				size *= 2;
+			}
+			unsigned char* data = static_cast<unsigned char*>(::operator new(size, std::align_val_t(Alignment)));
+			mBlocks.push_back(Block{ data, size });
+			mBlock = mBlocks.size() - 1;
+			mOffset = 0;
+			mStats.BytesReserved += size;
+		}
+
+		std::vector<Block> mBlocks;
+		// Live counts of the open scopes, innermost last.
+		std::vector<std::atomic<size_t>*> mScopes;
+		size_t mBlock = 0;
+		size_t mOffset = 0;
+		size_t mInUse = 0;
+		bool mServeResults = false;
+		ScratchStats mStats;
+	};
+
+	// Opens a scratch region on the calling thread. LAR-internal work buffers (ScratchBuffer) always
+	// draw from the arena while a scope is open; with serveResults set, every Matrix/Vector allocated
+	// on this thread does too. Such results must be destroyed before the scope closes - assign into a
+	// matrix created outside the scope to keep a value. A result that is still alive when the scope
+	// closes aborts the program.
+	class ScratchScope
+	{
+	public:
+		explicit ScratchScope(const bool serveResults = false)
+			: mArena(ScratchArena::Current()),
+			mStart(mArena.GetStats()),
+			mMarker(mArena.Enter(mLive, serveResults, mPreviousServeResults))
+		{
+		}
+
+		ScratchScope(const ScratchScope&) = delete;
+		ScratchScope& operator=(const ScratchScope&) = delete;
+
+		~ScratchScope()
+		{
+			mArena.Leave(mMarker, mPreviousServeResults);
+		}
+
+		// Statistics for this scope only; PeakBytes and BytesReserved are reported for the arena.
+		ScratchStats GetStats() const
+		{
+			const ScratchStats& now = mArena.GetStats();
+			ScratchStats stats;
+			stats.BytesServed = now.BytesServed - mStart.BytesServed;
+			stats.Allocations = now.Allocations - mStart.Allocations;
+			stats.PeakBytes = now.PeakBytes;
+			stats.BytesReserved = now.BytesReserved;
+			return stats;
+		}
+
+	private:
+		ScratchArena& mArena;
+		ScratchStats mStart;
+		std::atomic<size_t> mLive{ 0 };
+		bool mPreviousServeResults = false;
+		ScratchArena::Marker mMarker;
+	};
+
+	// Work buffer for algorithm temporaries: served from the thread's arena inside a ScratchScope,
+	// from the heap otherwise.
+	template<typename T>
+	class ScratchBuffer
+	{
+	public:
+		explicit ScratchBuffer(const size_t count)
+			: mCount(count)
+		{
+			ScratchArena& arena = ScratchArena::Current();
+			mData = arena.IsActive() ? arena.Construct<T>(count, mOwner) : new T[count];
+		}
+
+		ScratchBuffer(const ScratchBuffer&) = delete;
+		ScratchBuffer& operator=(const ScratchBuffer&) = delete;
+
+		~ScratchBuffer()
+		{
+			if (mOwner)
+			{
+				ScratchArena::Destroy(mData, mCount, mOwner);
+			}
+			else
+			{
+				delete[] mData;
+			}
+		}
+
+		T* Data() { return mData; }
+		const T* Data() const { return mData; }
+		size_t Size() const { return mCount; }
+
+		T& operator[](const size_t index) { return mData[index]; }
+		const T& operator[](const size_t index) const { return mData[index]; }
+
+	private:
+		size_t mCount;
+		ScratchOwner mOwner;
+		T* mData;
+	};
+
+	struct PoolStats
+	{
+		size_t ThreadHits = 0;
+		size_t GlobalHits = 0;
+		size_t Misses = 0;
+		size_t Recycled = 0;
+		size_t Freed = 0;
+	};
+
+	// Opt-in switch and limits shared by every BufferPool<T>.
+	struct BufferPoolSettings
+	{
+		static inline std::atomic<bool> Enabled{ false };
+		static inline std::atomic<size_t> ThreadCacheDepth{ 8 };
+		static inline std::atomic<size_t> GlobalDepth{ 64 };
+	};
+
+	inline void SetBufferPoolEnabled(const bool enabled)
+	{
+		BufferPoolSettings::Enabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	inline bool IsBufferPoolEnabled()
+	{
+		return BufferPoolSettings::Enabled.load(std::memory_order_relaxed);
+	}
+
+	// Recycles released matrix buffers by element count for one element type. Each thread keeps a
+	// small cache it can use without locking; overflow and the caches of exiting threads spill into
+	// a mutex-protected global list that other threads fall back to before calling new[].
+	template<typename T>
+	class BufferPool
+	{
+	public:
+		static T* Acquire(const size_t rows, const size_t cols)
+		{
+			ThreadCache& cache = LocalCache();
+			const size_t key = Key(rows, cols);
+			auto it = cache.Buffers.find(key);
+			if (it != cache.Buffers.end() && !it->second.empty())
+			{
+				T* data = it->second.back();
+				it->second.pop_back();
+				++cache.Stats.ThreadHits;
+				return data;
+			}
+
+			GlobalPool& global = Global();
+			{
+				std::lock_guard<std::mutex> lock(global.Mutex);
+				auto globalIt = global.Buffers.find(key);
+				if (globalIt != global.Buffers.end() && !globalIt->second.empty())
+				{
+					T* data = globalIt->second.back();
+					globalIt->second.pop_back();
+					++cache.Stats.GlobalHits;
+					return data;
+				}
+			}
+
+			++cache.Stats.Misses;
+			return new T[rows * cols];
+		}
+
+		static void Release(T* data, const size_t rows, const size_t cols)
+		{
+			ThreadCache& cache = LocalCache();
+			const size_t key = Key(rows, cols);
+			std::vector<T*>& local = cache.Buffers[key];
+			if (local.size() < BufferPoolSettings::ThreadCacheDepth.load(std::memory_order_relaxed))
+			{
+				local.push_back(data);
+				++cache.Stats.Recycled;
+				return;
+			}
+			if (PushGlobal(key, data))
+			{
+				++cache.Stats.Recycled;
+				return;
+			}
+			++cache.Stats.Freed;
+			delete[] data;
+		}
+
+		// Counters for the calling thread.
+		static PoolStats GetStats()
+		{
+			return LocalCache().Stats;
+		}
+
+		static void ResetStats()
+		{
+			LocalCache().Stats = PoolStats();
+		}
+
+		// Frees every buffer cached by the calling thread and in the global list.
+		static void Clear()
+		{
+			ThreadCache& cache = LocalCache();
+			for (auto& entry : cache.Buffers)
+			{
+				for (T* data : entry.second)
+				{
+					delete[] data;
+				}
+			}
+			cache.Buffers.clear();
+
+			GlobalPool& global = Global();
+			std::lock_guard<std::mutex> lock(global.Mutex);
+			global.FreeAll();
+		}
+
+	private:
+		struct GlobalPool
+		{
+			std::mutex Mutex;
+			std::unordered_map<size_t, std::vector<T*>> Buffers;
+
+			void FreeAll()
+			{
+				for (auto& entry : Buffers)
+				{
+					for (T* data : entry.second)
+					{
+						delete[] data;
+					}
+				}
+				Buffers.clear();
+			}
+
+			~GlobalPool()
+			{
+				FreeAll();
+			}
+		};
+
+		struct ThreadCache
+		{
+			std::unordered_map<size_t, std::vector<T*>> Buffers;
+			PoolStats Stats;
+
+			~ThreadCache()
+			{
+				for (auto& entry : Buffers)
+				{
+					for (T* data : entry.second)
+					{
+						if (!PushGlobal(entry.first, data))
+						{
+							delete[] data;
+						}
+					}
+				}
+			}
+		};
+
+		// Buffers are plain arrays, so any shape with the same element count can reuse one.
+		static size_t Key(const size_t rows, const size_t cols)
+		{
+			return rows * cols;
+		}
+
+		static bool PushGlobal(const size_t key, T* data)
+		{
+			GlobalPool& global = Global();
+			std::lock_guard<std::mutex> lock(global.Mutex);
+			std::vector<T*>& buffers = global.Buffers[key];
+			if (buffers.size() >= BufferPoolSettings::GlobalDepth.load(std::memory_order_relaxed))
+			{
+				return false;
+			}
+			buffers.push_back(data);
+			return true;
+		}
+
+		static GlobalPool& Global()
+		{
+			static GlobalPool pool;
+			return pool;
+		}
+
+		static ThreadCache& LocalCache()
+		{
+			static thread_local ThreadCache cache;
+			return cache;
+		}
+	};
+} // namespace LAR
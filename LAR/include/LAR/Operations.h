@@ -0,0 +1,145 @@
+#pragma once
+#include "MatrixBase.h"
+#include "Gemm.h"
+#include "Gemv.h"
+#include "Strassen.h"
+#include <stdexcept>
+#include <type_traits>
+
+// Output-parameter forms of the MatrixBase/Matrix operators. The destination must already have the
+// result's shape; nothing is allocated, so hot loops can reuse the same buffers on every iteration.
+namespace LAR
+{
+	template<typename DerivedA, typename DataTypeA, typename DerivedB, typename DataTypeB>
+	bool Aliases(const MatrixBase<DerivedA, DataTypeA>& a, const MatrixBase<DerivedB, DataTypeB>& b)
+	{
+		return a.mData != nullptr && static_cast<const void*>(a.mData) == static_cast<const void*>(b.mData);
+	}
+
+	template<typename DerivedA, typename DataTypeA, typename DerivedB, typename DataTypeB, typename DerivedOut, typename DataTypeOut>
+	void Add(const MatrixBase<DerivedA, DataTypeA>& a, const MatrixBase<DerivedB, DataTypeB>& b, MatrixBase<DerivedOut, DataTypeOut>& out)
+	{
+		if (!a.SameSize(b) || !a.SameSize(out))
+		{
+			throw std::invalid_argument("Matrices must be the same size to add them.");
+		}
+		for (size_t i = 0; i < a.mNumRows * a.mNumCols; ++i)
+		{
+			out.mData[i] = a.mData[i] + b.mData[i];
+		}
+	}
+
+	template<typename DerivedA, typename DataTypeA, typename DerivedB, typename DataTypeB, typename DerivedOut, typename DataTypeOut>
+	void Subtract(const MatrixBase<DerivedA, DataTypeA>& a, const MatrixBase<DerivedB, DataTypeB>& b, MatrixBase<DerivedOut, DataTypeOut>& out)
+	{
+		if (!a.SameSize(b) || !a.SameSize(out))
+		{
+			throw std::invalid_argument("Matrices must be the same size to subtract them.");
+		}
+		for (size_t i = 0; i < a.mNumRows * a.mNumCols; ++i)
+		{
+			out.mData[i] = a.mData[i] - b.mData[i];
+		}
+	}
+
+	template<typename DerivedA, typename DataTypeA, typename DerivedOut, typename DataTypeOut>
+	void Transpose(const MatrixBase<DerivedA, DataTypeA>& a, MatrixBase<DerivedOut, DataTypeOut>& out)
+	{
+		if (out.mNumRows != a.mNumCols || out.mNumCols != a.mNumRows)
+		{
+			throw std::invalid_argument("Output must have the transposed shape of the input.");
+		}
+		if (Aliases(a, out))
+		{
+			throw std::invalid_argument("Output must not alias the input of Transpose; use TransposeInPlace.");
+		}
+		for (size_t i = 0; i < a.mNumRows; ++i)
+		{
+			for (size_t j = 0; j < a.mNumCols; ++j)
+			{
+				out.mData[j * a.mNumRows + i] = a.mData[i * a.mNumCols + j];
+			}
+		}
+	}
+
+	template<typename DataTypeA, typename DataTypeB, typename DataTypeOut>
+	void Multiply(const Matrix<DataTypeA>& a, const Matrix<DataTypeB>& b, Matrix<DataTypeOut>& out)
+	{
+		if (a.mNumCols != b.mNumRows)
+		{
+			throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+		}
+		if (out.mNumRows != a.mNumRows || out.mNumCols != b.mNumCols)
+		{
+			throw std::invalid_argument("Output matrix must be sized rows(A) x cols(B).");
+		}
+		if (Aliases(a, out) || Aliases(b, out))
+		{
+			throw std::invalid_argument("Output matrix must not alias an input of Multiply.");
+		}
+		if constexpr (std::is_same<DataTypeA, DataTypeOut>::value && std::is_same<DataTypeB, DataTypeOut>::value)
+		{
+			const size_t crossover = MultiplySettings::StrassenCrossover.load(std::memory_order_relaxed);
+			if (MultiplySettings::Algorithm.load(std::memory_order_relaxed) == MultiplyAlgorithm::Strassen &&
+				std::min(a.mNumRows, std::min(a.mNumCols, b.mNumCols)) > crossover)
+			{
+				StrassenOptions options;
+				options.Crossover = crossover;
+				StrassenMultiply(a, b, out, options);
+				return;
+			}
+			Gemm(DataTypeOut(1), Op::NoTrans, a, Op::NoTrans, b, DataTypeOut(0), out);
+			return;
+		}
+		const size_t n = b.mNumCols;
+		for (size_t i = 0; i < a.mNumRows; ++i)
+		{
+			DataTypeOut* row = out.mData + i * n;
+			for (size_t j = 0; j < n; ++j)
+			{
+				row[j] = 0;
+			}
+			for (size_t k = 0; k < a.mNumCols; ++k)
+			{
+				const DataTypeA aik = a.mData[i * a.mNumCols + k];
+				const DataTypeB* bRow = b.mData + k * n;
+				for (size_t j = 0; j < n; ++j)
+				{
+					row[j] += aik * bRow[j];
+				}
+			}
+		}
+	}
+
+	template<typename DataTypeA, typename DataTypeX, bool RowVectorX, typename DataTypeOut, bool RowVectorOut>
+	void Multiply(const Matrix<DataTypeA>& a, const Vector<DataTypeX, RowVectorX>& x, Vector<DataTypeOut, RowVectorOut>& out)
+	{
+		if (a.mNumCols != x.GetSize())
+		{
+			throw std::invalid_argument("Number of columns in matrix must match size of vector.");
+		}
+		if (out.GetSize() != a.mNumRows)
+		{
+			throw std::invalid_argument("Output vector must have one entry per matrix row.");
+		}
+		if (Aliases(x, out))
+		{
+			throw std::invalid_argument("Output vector must not alias the input of Multiply.");
+		}
+		if constexpr (std::is_same<DataTypeA, DataTypeOut>::value && std::is_same<DataTypeX, DataTypeOut>::value)
+		{
+			Gemv(DataTypeOut(1), Op::NoTrans, a, x, DataTypeOut(0), out);
+			return;
+		}
+		for (size_t i = 0; i < a.mNumRows; ++i)
+		{
+			const DataTypeA* row = a.mData + i * a.mNumCols;
+			DataTypeOut sum = 0;
+			for (size_t j = 0; j < a.mNumCols; ++j)
+			{
+				sum += row[j] * x.mData[j];
+			}
+			out.mData[i] = sum;
+		}
+	}
+} // namespace LAR
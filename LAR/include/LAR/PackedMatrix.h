@@ -0,0 +1,777 @@
+#pragma once
+#include "Matrix.h"
+#include "Vector.h"
+#include "Gemm.h"
+#include "Memory.h"
+#include "Parallel.h"
+#include "LAR_export.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace LAR
+{
+	enum class Triangle
+	{
+		Lower,
+		Upper
+	};
+
+	namespace Detail
+	{
+		// Rows of a symmetric rank-k update computed per GEMM call: each panel also covers every
+		// earlier column, so the update does about half the work of the full product.
+		constexpr size_t PackedPanelRows = 64;
+		// Below this many multiply-adds a banded product runs on the calling thread.
+		constexpr size_t BandedParallelWork = 1 << 15;
+
+		// Row-major packed offsets: the lower triangle keeps row i as columns 0 .. i, the upper one as
+		// columns i .. n - 1, so every row is contiguous.
+		inline size_t PackedLowerOffset(const size_t i, const size_t j)
+		{
+			return i * (i + 1) / 2 + j;
+		}
+
+		inline size_t PackedUpperOffset(const size_t n, const size_t i, const size_t j)
+		{
+			return i * (2 * n - i + 1) / 2 + (j - i);
+		}
+
+		template<typename DataType>
+		DataType PackedDot(const DataType* x, const DataType* y, const size_t count)
+		{
+			DataType sum = DataType(0);
+			for (size_t p = 0; p < count; ++p)
+			{
+				sum += x[p] * y[p];
+			}
+			return sum;
+		}
+	} // namespace Detail
+
+	// Triangular matrix storing only its triangle, n (n + 1) / 2 entries packed row by row.
+	template<typename DataType>
+	class LAR_EXPORT TriangularMatrix
+	{
+	public:
+		// An all-zero n x n triangular matrix.
+		TriangularMatrix(const size_t size, const Triangle triangle)
+			: mSize(size), mTriangle(triangle), mData(size * (size + 1) / 2, DataType(0))
+		{
+		}
+
+		// Adopts packed rows in the layout described above.
+		TriangularMatrix(const size_t size, const Triangle triangle, std::vector<DataType> packed)
+			: mSize(size), mTriangle(triangle), mData(std::move(packed))
+		{
+			if (mData.size() != size * (size + 1) / 2)
+			{
+				throw std::invalid_argument("Packed storage must hold n (n + 1) / 2 entries.");
+			}
+		}
+
+		// Copies the given triangle of a square matrix; the other one is ignored.
+		TriangularMatrix(const Matrix<DataType>& dense, const Triangle triangle)
+			: TriangularMatrix(dense.GetRows(), triangle)
+		{
+			if (!dense.IsSquare())
+			{
+				throw std::invalid_argument("Matrix must be square.");
+			}
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				const size_t first = RowBegin(i);
+				std::copy(dense.mData + i * mSize + first, dense.mData + i * mSize + RowEnd(i), mData.data() + Offset(i, first));
+			}
+		}
+
+		size_t GetSize() const { return mSize; }
+		size_t GetRows() const { return mSize; }
+		size_t GetCols() const { return mSize; }
+		Triangle GetTriangle() const { return mTriangle; }
+		const std::vector<DataType>& Packed() const { return mData; }
+
+		bool Contains(const size_t row, const size_t col) const
+		{
+			return mTriangle == Triangle::Lower ? col <= row : col >= row;
+		}
+
+		DataType operator()(const size_t row, const size_t col) const
+		{
+			if (row >= mSize || col >= mSize)
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			return Contains(row, col) ? mData[Offset(row, col)] : DataType(0);
+		}
+
+		// Entries outside the stored triangle are structurally zero and cannot be written.
+		DataType& operator()(const size_t row, const size_t col)
+		{
+			if (row >= mSize || col >= mSize || !Contains(row, col))
+			{
+				throw std::out_of_range("Entry is outside the stored triangle.");
+			}
+			return mData[Offset(row, col)];
+		}
+
+		Matrix<DataType> ToDense() const
+		{
+			Matrix<DataType> result(mSize, mSize);
+			std::fill(result.mData, result.mData + mSize * mSize, DataType(0));
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				const size_t first = RowBegin(i);
+				std::copy(mData.data() + Offset(i, first), mData.data() + Offset(i, first) + RowEnd(i) - first,
+					result.mData + i * mSize + first);
+			}
+			return result;
+		}
+
+		TriangularMatrix Transpose() const
+		{
+			const Triangle other = mTriangle == Triangle::Lower ? Triangle::Upper : Triangle::Lower;
+			TriangularMatrix result(mSize, other);
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				for (size_t j = RowBegin(i); j < RowEnd(i); ++j)
+				{
+					result.mData[result.Offset(j, i)] = mData[Offset(i, j)];
+				}
+			}
+			return result;
+		}
+
+		// y = T x.
+		void Apply(const DataType* x, DataType* y) const
+		{
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				const size_t first = RowBegin(i);
+				y[i] = Detail::PackedDot(mData.data() + Offset(i, first), x + first, RowEnd(i) - first);
+			}
+		}
+
+		template<bool RowVector>
+		Vector<DataType> operator*(const Vector<DataType, RowVector>& vector) const
+		{
+			if (mSize != vector.GetSize())
+			{
+				throw std::invalid_argument("Number of columns in matrix must match size of vector.");
+			}
+			Vector<DataType> result(mSize);
+			Apply(vector.Data(), result.Data());
+			return result;
+		}
+
+		Matrix<DataType> operator*(const Matrix<DataType>& dense) const
+		{
+			if (mSize != dense.GetRows())
+			{
+				throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+			}
+			const size_t k = dense.GetCols();
+			Matrix<DataType> result(mSize, k);
+			std::fill(result.mData, result.mData + mSize * k, DataType(0));
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				DataType* out = result.mData + i * k;
+				for (size_t j = RowBegin(i); j < RowEnd(i); ++j)
+				{
+					const DataType a = mData[Offset(i, j)];
+					const DataType* in = dense.mData + j * k;
+					for (size_t c = 0; c < k; ++c)
+					{
+						out[c] += a * in[c];
+					}
+				}
+			}
+			return result;
+		}
+
+		// Solves T x = b by substitution; every step is a dot product with one packed row.
+		Vector<DataType> Solve(const Vector<DataType>& b) const
+		{
+			if (b.GetSize() != mSize)
+			{
+				throw std::invalid_argument("Right-hand side must match the matrix size.");
+			}
+			Vector<DataType> x(b);
+			Solve(x.Data(), 1);
+			return x;
+		}
+
+		// Solves T X = B for every column of B.
+		Matrix<DataType> Solve(const Matrix<DataType>& b) const
+		{
+			if (b.GetRows() != mSize)
+			{
+				throw std::invalid_argument("Right-hand side must match the matrix size.");
+			}
+			Matrix<DataType> x(b);
+			Solve(x.mData, b.GetCols());
+			return x;
+		}
+
+	private:
+		size_t Offset(const size_t row, const size_t col) const
+		{
+			return mTriangle == Triangle::Lower ? Detail::PackedLowerOffset(row, col) : Detail::PackedUpperOffset(mSize, row, col);
+		}
+
+		size_t RowBegin(const size_t row) const { return mTriangle == Triangle::Lower ? 0 : row; }
+		size_t RowEnd(const size_t row) const { return mTriangle == Triangle::Lower ? row + 1 : mSize; }
+
+		// In-place substitution on a row-major right-hand side with k columns.
+		void Solve(DataType* x, const size_t k) const
+		{
+			const bool lower = mTriangle == Triangle::Lower;
+			for (size_t step = 0; step < mSize; ++step)
+			{
+				const size_t i = lower ? step : mSize - 1 - step;
+				const DataType diagonal = mData[Offset(i, i)];
+				if (diagonal == DataType(0))
+				{
+					throw std::runtime_error("Matrix is singular.");
+				}
+				DataType* out = x + i * k;
+				for (size_t j = RowBegin(i); j < RowEnd(i); ++j)
+				{
+					if (j == i)
+					{
+						continue;
+					}
+					const DataType a = mData[Offset(i, j)];
+					const DataType* in = x + j * k;
+					for (size_t c = 0; c < k; ++c)
+					{
+						out[c] -= a * in[c];
+					}
+				}
+				for (size_t c = 0; c < k; ++c)
+				{
+					out[c] /= diagonal;
+				}
+			}
+		}
+
+		size_t mSize;
+		Triangle mTriangle;
+		std::vector<DataType> mData;
+	};
+
+	// Symmetric matrix storing its lower triangle packed row by row: half the memory of a Matrix,
+	// e.g. for covariance and Gram matrices.
+	template<typename DataType>
+	class LAR_EXPORT SymmetricMatrix
+	{
+	public:
+		// An all-zero n x n symmetric matrix.
+		explicit SymmetricMatrix(const size_t size)
+			: mSize(size), mData(size * (size + 1) / 2, DataType(0))
+		{
+		}
+
+		// Copies the lower triangle of a square matrix; the upper one is taken to mirror it.
+		explicit SymmetricMatrix(const Matrix<DataType>& dense)
+			: SymmetricMatrix(dense.GetRows())
+		{
+			if (!dense.IsSquare())
+			{
+				throw std::invalid_argument("Matrix must be square.");
+			}
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				std::copy(dense.mData + i * mSize, dense.mData + i * mSize + i + 1, mData.data() + Detail::PackedLowerOffset(i, 0));
+			}
+		}
+
+		size_t GetSize() const { return mSize; }
+		size_t GetRows() const { return mSize; }
+		size_t GetCols() const { return mSize; }
+		const std::vector<DataType>& Packed() const { return mData; }
+
+		DataType operator()(const size_t row, const size_t col) const
+		{
+			if (row >= mSize || col >= mSize)
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			return mData[Detail::PackedLowerOffset(std::max(row, col), std::min(row, col))];
+		}
+
+		// (row, col) and (col, row) are the same stored entry.
+		DataType& operator()(const size_t row, const size_t col)
+		{
+			if (row >= mSize || col >= mSize)
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			return mData[Detail::PackedLowerOffset(std::max(row, col), std::min(row, col))];
+		}
+
+		Matrix<DataType> ToDense() const
+		{
+			Matrix<DataType> result(mSize, mSize);
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				for (size_t j = 0; j <= i; ++j)
+				{
+					result.mData[i * mSize + j] = result.mData[j * mSize + i] = mData[Detail::PackedLowerOffset(i, j)];
+				}
+			}
+			return result;
+		}
+
+		// y = S x: row i of the lower triangle gives a dot product for y_i and, below the diagonal,
+		// the mirrored contributions x_i S(i, j) to y_j.
+		void Apply(const DataType* x, DataType* y) const
+		{
+			std::fill(y, y + mSize, DataType(0));
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				const DataType* row = mData.data() + Detail::PackedLowerOffset(i, 0);
+				const DataType xi = x[i];
+				DataType sum = row[i] * xi;
+				for (size_t j = 0; j < i; ++j)
+				{
+					sum += row[j] * x[j];
+					y[j] += row[j] * xi;
+				}
+				y[i] += sum;
+			}
+		}
+
+		template<bool RowVector>
+		Vector<DataType> operator*(const Vector<DataType, RowVector>& vector) const
+		{
+			if (mSize != vector.GetSize())
+			{
+				throw std::invalid_argument("Number of columns in matrix must match size of vector.");
+			}
+			Vector<DataType> result(mSize);
+			Apply(vector.Data(), result.Data());
+			return result;
+		}
+
+		Matrix<DataType> operator*(const Matrix<DataType>& dense) const
+		{
+			if (mSize != dense.GetRows())
+			{
+				throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+			}
+			const size_t k = dense.GetCols();
+			Matrix<DataType> result(mSize, k);
+			std::fill(result.mData, result.mData + mSize * k, DataType(0));
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				const DataType* row = mData.data() + Detail::PackedLowerOffset(i, 0);
+				DataType* outI = result.mData + i * k;
+				const DataType* inI = dense.mData + i * k;
+				for (size_t j = 0; j <= i; ++j)
+				{
+					const DataType a = row[j];
+					const DataType* inJ = dense.mData + j * k;
+					DataType* outJ = result.mData + j * k;
+					for (size_t c = 0; c < k; ++c)
+					{
+						outI[c] += a * inJ[c];
+					}
+					if (j < i)
+					{
+						for (size_t c = 0; c < k; ++c)
+						{
+							outJ[c] += a * inI[c];
+						}
+					}
+				}
+			}
+			return result;
+		}
+
+		// Symmetric rank-k update S += alpha op(A) op(A)^T: A A^T for an n x k A (NoTrans) or A^T A
+		// for a k x n A (Trans, e.g. the Gram matrix of k samples). Only the lower triangle is
+		// computed, panel by panel with the packed GEMM.
+		void RankKUpdate(const DataType alpha, const Matrix<DataType>& a, const Op op = Op::NoTrans)
+		{
+			const size_t n = op == Op::NoTrans ? a.GetRows() : a.GetCols();
+			const size_t k = op == Op::NoTrans ? a.GetCols() : a.GetRows();
+			if (n != mSize)
+			{
+				throw std::invalid_argument("Update must have as many rows as the symmetric matrix.");
+			}
+			if (n == 0 || k == 0)
+			{
+				return;
+			}
+			const size_t lda = a.GetCols();
+			ScratchScope scope;
+			ScratchBuffer<DataType> panel(std::min(Detail::PackedPanelRows, n) * n);
+			for (size_t i0 = 0; i0 < n; i0 += Detail::PackedPanelRows)
+			{
+				const size_t rows = std::min(Detail::PackedPanelRows, n - i0);
+				const size_t cols = i0 + rows;
+				std::fill(panel.Data(), panel.Data() + rows * cols, DataType(0));
+				// Panel = alpha op(A)[i0 : i0 + rows, :] op(A)[0 : cols, :]^T.
+				const DataType* first = op == Op::NoTrans ? a.mData + i0 * lda : a.mData + i0;
+				const Op opB = op == Op::NoTrans ? Op::Trans : Op::NoTrans;
+				Detail::ParallelGemmAccumulate(rows, cols, k, alpha, first, lda, op, a.mData, lda, opB, panel.Data(), cols);
+				for (size_t r = 0; r < rows; ++r)
+				{
+					DataType* row = mData.data() + Detail::PackedLowerOffset(i0 + r, 0);
+					const DataType* update = panel.Data() + r * cols;
+					for (size_t j = 0; j <= i0 + r; ++j)
+					{
+						row[j] += update[j];
+					}
+				}
+			}
+		}
+
+		// Cholesky factor L with S = L L^T, computed row by row on the packed rows (every step is a
+		// dot product of two contiguous row prefixes).
+		TriangularMatrix<DataType> CholeskyFactor() const
+		{
+			std::vector<DataType> factor(mData.size());
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				DataType* li = factor.data() + Detail::PackedLowerOffset(i, 0);
+				const DataType* si = mData.data() + Detail::PackedLowerOffset(i, 0);
+				for (size_t j = 0; j < i; ++j)
+				{
+					const DataType* lj = factor.data() + Detail::PackedLowerOffset(j, 0);
+					li[j] = (si[j] - Detail::PackedDot(li, lj, j)) / lj[j];
+				}
+				const DataType pivot = si[i] - Detail::PackedDot(li, li, i);
+				if (!(pivot > DataType(0)))
+				{
+					throw std::runtime_error("Matrix is not positive definite.");
+				}
+				li[i] = std::sqrt(pivot);
+			}
+			return TriangularMatrix<DataType>(mSize, Triangle::Lower, std::move(factor));
+		}
+
+	private:
+		size_t mSize;
+		std::vector<DataType> mData;
+	};
+
+	// Square banded matrix with kl sub- and ku superdiagonals, stored as n rows of kl + ku + 1
+	// entries: (i, j) lives at row i, slot j - i + kl. Products cost O(n (kl + ku)).
+	template<typename DataType>
+	class LAR_EXPORT BandedMatrix
+	{
+	public:
+		// An all-zero n x n matrix with the given bandwidths.
+		BandedMatrix(const size_t size, const size_t lower, const size_t upper)
+			: mSize(size), mLower(lower), mUpper(upper), mData(size * (lower + upper + 1), DataType(0))
+		{
+		}
+
+		// Copies the band of a square matrix; throws if a nonzero lies outside it.
+		BandedMatrix(const Matrix<DataType>& dense, const size_t lower, const size_t upper)
+			: BandedMatrix(dense.GetRows(), lower, upper)
+		{
+			if (!dense.IsSquare())
+			{
+				throw std::invalid_argument("Matrix must be square.");
+			}
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				for (size_t j = 0; j < mSize; ++j)
+				{
+					const DataType value = dense.mData[i * mSize + j];
+					if (Contains(i, j))
+					{
+						mData[Offset(i, j)] = value;
+					}
+					else if (value != DataType(0))
+					{
+						throw std::invalid_argument("Matrix has nonzeros outside the band.");
+					}
+				}
+			}
+		}
+
+		// Copies a square matrix with the smallest band that holds all of its nonzeros.
+		explicit BandedMatrix(const Matrix<DataType>& dense)
+			: BandedMatrix(dense, Bandwidth(dense, true), Bandwidth(dense, false))
+		{
+		}
+
+		size_t GetSize() const { return mSize; }
+		size_t GetRows() const { return mSize; }
+		size_t GetCols() const { return mSize; }
+		size_t GetLowerBandwidth() const { return mLower; }
+		size_t GetUpperBandwidth() const { return mUpper; }
+		const std::vector<DataType>& Band() const { return mData; }
+
+		bool Contains(const size_t row, const size_t col) const
+		{
+			return col + mLower >= row && col <= row + mUpper;
+		}
+
+		DataType operator()(const size_t row, const size_t col) const
+		{
+			if (row >= mSize || col >= mSize)
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			return Contains(row, col) ? mData[Offset(row, col)] : DataType(0);
+		}
+
+		// Entries outside the band are structurally zero and cannot be written.
+		DataType& operator()(const size_t row, const size_t col)
+		{
+			if (row >= mSize || col >= mSize || !Contains(row, col))
+			{
+				throw std::out_of_range("Entry is outside the band.");
+			}
+			return mData[Offset(row, col)];
+		}
+
+		Matrix<DataType> ToDense() const
+		{
+			Matrix<DataType> result(mSize, mSize);
+			std::fill(result.mData, result.mData + mSize * mSize, DataType(0));
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				for (size_t j = ColBegin(i); j < ColEnd(i); ++j)
+				{
+					result.mData[i * mSize + j] = mData[Offset(i, j)];
+				}
+			}
+			return result;
+		}
+
+		// y = A x, rows split across threads when the band is large enough.
+		void Apply(const DataType* x, DataType* y) const
+		{
+			const size_t width = mLower + mUpper + 1;
+			ParallelFor(0, mSize, std::max<size_t>(1, Detail::BandedParallelWork / width), [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					const size_t first = ColBegin(i);
+					y[i] = Detail::PackedDot(mData.data() + Offset(i, first), x + first, ColEnd(i) - first);
+				}
+			});
+		}
+
+		template<bool RowVector>
+		Vector<DataType> operator*(const Vector<DataType, RowVector>& vector) const
+		{
+			if (mSize != vector.GetSize())
+			{
+				throw std::invalid_argument("Number of columns in matrix must match size of vector.");
+			}
+			Vector<DataType> result(mSize);
+			Apply(vector.Data(), result.Data());
+			return result;
+		}
+
+		Matrix<DataType> operator*(const Matrix<DataType>& dense) const
+		{
+			if (mSize != dense.GetRows())
+			{
+				throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+			}
+			const size_t k = dense.GetCols();
+			const size_t width = mLower + mUpper + 1;
+			Matrix<DataType> result(mSize, k);
+			ParallelFor(0, mSize, std::max<size_t>(1, Detail::BandedParallelWork / (width * std::max<size_t>(k, 1))),
+				[&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					DataType* out = result.mData + i * k;
+					std::fill(out, out + k, DataType(0));
+					for (size_t j = ColBegin(i); j < ColEnd(i); ++j)
+					{
+						const DataType a = mData[Offset(i, j)];
+						const DataType* in = dense.mData + j * k;
+						for (size_t c = 0; c < k; ++c)
+						{
+							out[c] += a * in[c];
+						}
+					}
+				}
+			});
+			return result;
+		}
+
+	private:
+		static size_t Bandwidth(const Matrix<DataType>& dense, const bool lower)
+		{
+			size_t width = 0;
+			for (size_t i = 0; i < dense.GetRows(); ++i)
+			{
+				for (size_t j = 0; j < dense.GetCols(); ++j)
+				{
+					if (dense.mData[i * dense.GetCols() + j] != DataType(0))
+					{
+						width = std::max(width, lower ? (i > j ? i - j : 0) : (j > i ? j - i : 0));
+					}
+				}
+			}
+			return width;
+		}
+
+		size_t Offset(const size_t row, const size_t col) const { return row * (mLower + mUpper + 1) + col + mLower - row; }
+		size_t ColBegin(const size_t row) const { return row > mLower ? row - mLower : 0; }
+		size_t ColEnd(const size_t row) const { return std::min(mSize, row + mUpper + 1); }
+
+		size_t mSize;
+		size_t mLower;
+		size_t mUpper;
+		std::vector<DataType> mData;
+	};
+
+	// LU factorization of a banded matrix with partial pivoting (as LAPACK gbtrf): row swaps widen
+	// U to kl + ku superdiagonals, L keeps kl multipliers per column. Factoring costs
+	// O(n kl (kl + ku)) and each solve O(n (2 kl + ku)), against O(n^3) for a dense LU.
+	template<typename DataType>
+	class LAR_EXPORT BandedLU
+	{
+	public:
+		explicit BandedLU(const BandedMatrix<DataType>& a)
+			: mSize(a.GetSize()), mLower(a.GetLowerBandwidth()), mUpper(a.GetLowerBandwidth() + a.GetUpperBandwidth()),
+			mWidth(mLower + mUpper + 1), mFactor(mSize * mWidth, DataType(0)), mMultipliers(mSize * mLower, DataType(0)),
+			mPivots(mSize)
+		{
+			// Row i of the work array holds columns i - kl .. i + kl + ku at slots 0 .. 2 kl + ku.
+			const size_t n = mSize;
+			const size_t kl = mLower;
+			for (size_t i = 0; i < n; ++i)
+			{
+				const size_t first = i > kl ? i - kl : 0;
+				const size_t last = std::min(n, i + a.GetUpperBandwidth() + 1);
+				for (size_t j = first; j < last; ++j)
+				{
+					mFactor[Slot(i, j)] = a(i, j);
+				}
+			}
+			for (size_t k = 0; k < n; ++k)
+			{
+				const size_t rowsBelow = std::min(kl, n - 1 - k);
+				const size_t lastCol = std::min(n, k + mUpper + 1);
+				size_t pivot = k;
+				for (size_t r = k + 1; r <= k + rowsBelow; ++r)
+				{
+					pivot = std::abs(mFactor[Slot(r, k)]) > std::abs(mFactor[Slot(pivot, k)]) ? r : pivot;
+				}
+				if (mFactor[Slot(pivot, k)] == DataType(0))
+				{
+					throw std::runtime_error("Matrix is singular.");
+				}
+				mPivots[k] = pivot;
+				if (pivot != k)
+				{
+					for (size_t j = k; j < lastCol; ++j)
+					{
+						std::swap(mFactor[Slot(k, j)], mFactor[Slot(pivot, j)]);
+					}
+				}
+				const DataType diagonal = mFactor[Slot(k, k)];
+				for (size_t r = k + 1; r <= k + rowsBelow; ++r)
+				{
+					const DataType m = mFactor[Slot(r, k)] / diagonal;
+					mMultipliers[k * kl + (r - k - 1)] = m;
+					mFactor[Slot(r, k)] = DataType(0);
+					for (size_t j = k + 1; j < lastCol; ++j)
+					{
+						mFactor[Slot(r, j)] -= m * mFactor[Slot(k, j)];
+					}
+				}
+			}
+		}
+
+		size_t GetSize() const { return mSize; }
+
+		Vector<DataType> Solve(const Vector<DataType>& b) const
+		{
+			if (b.GetSize() != mSize)
+			{
+				throw std::invalid_argument("Right-hand side must match the matrix size.");
+			}
+			Vector<DataType> x(b);
+			Solve(x.Data(), 1);
+			return x;
+		}
+
+		// Solves A X = B for every column of B.
+		Matrix<DataType> Solve(const Matrix<DataType>& b) const
+		{
+			if (b.GetRows() != mSize)
+			{
+				throw std::invalid_argument("Right-hand side must match the matrix size.");
+			}
+			Matrix<DataType> x(b);
+			Solve(x.mData, b.GetCols());
+			return x;
+		}
+
+		// x = A^-1 b on raw arrays.
+		void Apply(const DataType* b, DataType* x) const
+		{
+			std::copy(b, b + mSize, x);
+			Solve(x, 1);
+		}
+
+	private:
+		size_t Slot(const size_t row, const size_t col) const { return row * mWidth + col + mLower - row; }
+
+		// In-place solve on a row-major right-hand side with k columns.
+		void Solve(DataType* x, const size_t k) const
+		{
+			const size_t n = mSize;
+			for (size_t step = 0; step < n; ++step)
+			{
+				DataType* row = x + step * k;
+				if (mPivots[step] != step)
+				{
+					std::swap_ranges(row, row + k, x + mPivots[step] * k);
+				}
+				for (size_t r = step + 1; r <= std::min(step + mLower, n - 1); ++r)
+				{
+					const DataType m = mMultipliers[step * mLower + (r - step - 1)];
+					DataType* target = x + r * k;
+					for (size_t c = 0; c < k; ++c)
+					{
+						target[c] -= m * row[c];
+					}
+				}
+			}
+			for (size_t step = n; step-- > 0;)
+			{
+				DataType* row = x + step * k;
+				for (size_t j = step + 1; j < std::min(n, step + mUpper + 1); ++j)
+				{
+					const DataType u = mFactor[Slot(step, j)];
+					const DataType* solved = x + j * k;
+					for (size_t c = 0; c < k; ++c)
+					{
+						row[c] -= u * solved[c];
+					}
+				}
+				const DataType diagonal = mFactor[Slot(step, step)];
+				for (size_t c = 0; c < k; ++c)
+				{
+					row[c] /= diagonal;
+				}
+			}
+		}
+
+		size_t mSize;
+		size_t mLower;
+		// Upper bandwidth of U, kl + ku after pivoting.
+		size_t mUpper;
+		size_t mWidth;
+		std::vector<DataType> mFactor;
+		std::vector<DataType> mMultipliers;
+		std::vector<size_t> mPivots;
+	};
+} // namespace LAR
@@ -0,0 +1,219 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LAR
+{
+	// Upper bound on the worker threads a single LAR kernel may use; 0 means hardware concurrency.
+	struct ParallelSettings
+	{
+		static inline std::atomic<size_t> MaxThreads{ 0 };
+	};
+
+	inline void SetMaxThreads(const size_t threads)
+	{
+		ParallelSettings::MaxThreads.store(threads, std::memory_order_relaxed);
+	}
+
+	inline size_t GetMaxThreads()
+	{
+		const size_t configured = ParallelSettings::MaxThreads.load(std::memory_order_relaxed);
+		if (configured != 0)
+		{
+			return configured;
+		}
+		// hardware_concurrency() may read /sys on every call; kernels with many small ParallelFor
+		// calls would spend more time there than in their loops.
+		static const size_t hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+		return hardware;
+	}
+
+	namespace Detail
+	{
+		// Idle workers poll for new work this many times (yielding in between) before they block, so
+		// back-to-back loops, such as the levels of a triangular sweep, skip the wake-up latency.
+		constexpr size_t WorkerSpinLimit = 1 << 10;
+
+		// Worker threads shared by every ParallelFor. Started on first use and kept for the life of the
+		// process, so a loop costs a wake-up per worker rather than a thread creation and join.
+		class WorkerPool
+		{
+		public:
+			static WorkerPool& Instance()
+			{
+				static WorkerPool pool;
+				return pool;
+			}
+
+			WorkerPool(const WorkerPool&) = delete;
+			WorkerPool& operator=(const WorkerPool&) = delete;
+
+			~WorkerPool()
+			{
+				for (const std::unique_ptr<Worker>& worker : mWorkers)
+				{
+					{
+						std::lock_guard<std::mutex> lock(worker->Mutex);
+						worker->Stop = true;
+					}
+					worker->Wake.notify_one();
+					worker->Thread.join();
+				}
+			}
+
+			// Runs task(t) for every t in [0, tasks), task 0 on the calling thread; task must not throw.
+			// Returns false without running anything while the pool is busy with another loop (a
+			// nested call from inside a task, or a loop started on another thread).
+			template<typename Task>
+			bool Run(const size_t tasks, const Task& task)
+			{
+				bool idle = false;
+				if (!mBusy.compare_exchange_strong(idle, true, std::memory_order_acquire))
+				{
+					return false;
+				}
+				while (mWorkers.size() + 1 < tasks)
+				{
+					mWorkers.push_back(std::make_unique<Worker>());
+					Worker* worker = mWorkers.back().get();
+					worker->Thread = std::thread([this, worker, index = mWorkers.size()]() { Work(*worker, index); });
+				}
+				mTask = &task;
+				mInvoke = [](const void* context, const size_t t) { (*static_cast<const Task*>(context))(t); };
+				mRemaining.store(tasks - 1, std::memory_order_relaxed);
+				for (size_t w = 0; w + 1 < tasks; ++w)
+				{
+					Worker& worker = *mWorkers[w];
+					{
+						std::lock_guard<std::mutex> lock(worker.Mutex);
+						worker.Generation.fetch_add(1, std::memory_order_release);
+					}
+					worker.Wake.notify_one();
+				}
+				task(0);
+				for (size_t spin = 0; spin < WorkerSpinLimit && mRemaining.load(std::memory_order_acquire) != 0; ++spin)
+				{
+					std::this_thread::yield();
+				}
+				if (mRemaining.load(std::memory_order_acquire) != 0)
+				{
+					std::unique_lock<std::mutex> lock(mDoneMutex);
+					mDone.wait(lock, [this]() { return mRemaining.load(std::memory_order_acquire) == 0; });
+				}
+				mBusy.store(false, std::memory_order_release);
+				return true;
+			}
+
+		private:
+			struct Worker
+			{
+				std::thread Thread;
+				std::mutex Mutex;
+				std::condition_variable Wake;
+				// Bumped once per task handed to this worker.
+				std::atomic<size_t> Generation{ 0 };
+				bool Stop = false;
+			};
+
+			WorkerPool() = default;
+
+			void Work(Worker& worker, const size_t index)
+			{
+				size_t seen = 0;
+				for (;;)
+				{
+					for (size_t spin = 0; spin < WorkerSpinLimit && worker.Generation.load(std::memory_order_acquire) == seen; ++spin)
+					{
+						std::this_thread::yield();
+					}
+					if (worker.Generation.load(std::memory_order_acquire) == seen)
+					{
+						std::unique_lock<std::mutex> lock(worker.Mutex);
+						worker.Wake.wait(lock, [&worker, seen]() { return worker.Stop || worker.Generation.load(std::memory_order_acquire) != seen; });
+						if (worker.Stop)
+						{
+							return;
+						}
+					}
+					seen = worker.Generation.load(std::memory_order_acquire);
+					mInvoke(mTask, index);
+					if (mRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					{
+						{
+							std::lock_guard<std::mutex> lock(mDoneMutex);
+						}
+						mDone.notify_one();
+					}
+				}
+			}
+
+			std::vector<std::unique_ptr<Worker>> mWorkers;
+			std::atomic<bool> mBusy{ false };
+			// The loop being run; only workers handed a task read these, and all finish before Run returns.
+			const void* mTask = nullptr;
+			void (*mInvoke)(const void*, size_t) = nullptr;
+			std::atomic<size_t> mRemaining{ 0 };
+			std::mutex mDoneMutex;
+			std::condition_variable mDone;
+		};
+	}
+
+	// Splits [begin, end) into at most GetMaxThreads() contiguous chunks of at least minChunk
+	// iterations and calls body(chunkBegin, chunkEnd) for each, the first chunk on the calling thread
+	// and the rest on the shared worker pool. Small ranges, and loops started while the pool is busy
+	// (nested inside another loop, or concurrent with one on another thread), run inline. The first
+	// exception thrown by any chunk is rethrown once all have finished.
+	template<typename Body>
+	void ParallelFor(const size_t begin, const size_t end, const size_t minChunk, Body&& body)
+	{
+		if (end <= begin)
+		{
+			return;
+		}
+		const size_t count = end - begin;
+		const size_t threads = std::min(GetMaxThreads(), std::max<size_t>(1, count / std::max<size_t>(1, minChunk)));
+		if (threads <= 1)
+		{
+			body(begin, end);
+			return;
+		}
+
+		const size_t chunk = count / threads;
+		const size_t remainder = count % threads;
+		std::mutex errorMutex;
+		std::exception_ptr error;
+		const auto task = [&](const size_t t)
+		{
+			const size_t chunkBegin = begin + t * chunk + std::min(t, remainder);
+			const size_t chunkEnd = chunkBegin + chunk + (t < remainder ? 1 : 0);
+			try
+			{
+				body(chunkBegin, chunkEnd);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error)
+				{
+					error = std::current_exception();
+				}
+			}
+		};
+		if (!Detail::WorkerPool::Instance().Run(threads, task))
+		{
+			body(begin, end);
+			return;
+		}
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+} // namespace LAR
@@ -0,0 +1,692 @@
+#pragma once
+#include "Matrix.h"
+#include "Vector.h"
+#include "Parallel.h"
+#include "SparseMatrix.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace LAR
+{
+	// Preconditioners approximate A^-1 and plug into the Krylov solvers through their Apply member:
+	// Apply(x, y) sets y = M^-1 x. All of them are built once and are read-only afterwards, so one
+	// instance can serve concurrent solves.
+
+	namespace Detail
+	{
+		// Compressed sparse rows with sorted column indices; the working format of the
+		// incomplete factorizations and triangular sweeps below.
+		template<typename DataType>
+		struct CompressedRows
+		{
+			size_t Size = 0;
+			std::vector<size_t> RowStart;
+			std::vector<size_t> Columns;
+			std::vector<DataType> Values;
+
+			// Nonzeros of the square matrix a; the diagonal is always stored, even when zero.
+			static CompressedRows FromDense(const Matrix<DataType>& a)
+			{
+				if (!a.IsSquare())
+				{
+					throw std::invalid_argument("Preconditioners need a square matrix.");
+				}
+				CompressedRows result;
+				const size_t n = a.GetRows();
+				result.Size = n;
+				result.RowStart.assign(1, 0);
+				for (size_t i = 0; i < n; ++i)
+				{
+					const DataType* row = a.mData + i * n;
+					for (size_t j = 0; j < n; ++j)
+					{
+						if (row[j] != DataType(0) || i == j)
+						{
+							result.Columns.push_back(j);
+							result.Values.push_back(row[j]);
+						}
+					}
+					result.RowStart.push_back(result.Columns.size());
+				}
+				return result;
+			}
+
+			// Stored entries of a square sparse matrix, plus an explicit zero wherever the diagonal is missing.
+			template<SparseFormat Format>
+			static CompressedRows FromSparse(const SparseMatrix<DataType, Format>& a)
+			{
+				if (!a.IsSquare())
+				{
+					throw std::invalid_argument("Preconditioners need a square matrix.");
+				}
+				const SparseMatrix<DataType, SparseFormat::CSR> rows(a);
+				CompressedRows result;
+				const size_t n = a.GetRows();
+				result.Size = n;
+				result.RowStart.assign(1, 0);
+				result.Columns.reserve(rows.GetNonZeros() + n);
+				result.Values.reserve(rows.GetNonZeros() + n);
+				for (size_t i = 0; i < n; ++i)
+				{
+					bool diagonal = false;
+					for (size_t p = rows.OuterStart()[i]; p < rows.OuterStart()[i + 1]; ++p)
+					{
+						const size_t j = rows.InnerIndices()[p];
+						if (!diagonal && j > i)
+						{
+							result.Columns.push_back(i);
+							result.Values.push_back(DataType(0));
+						}
+						diagonal = diagonal || j >= i;
+						result.Columns.push_back(j);
+						result.Values.push_back(rows.Values()[p]);
+					}
+					if (!diagonal)
+					{
+						result.Columns.push_back(i);
+						result.Values.push_back(DataType(0));
+					}
+					result.RowStart.push_back(result.Columns.size());
+				}
+				return result;
+			}
+
+			// Index of the diagonal entry of each row.
+			std::vector<size_t> DiagonalPositions() const
+			{
+				std::vector<size_t> positions(Size);
+				for (size_t i = 0; i < Size; ++i)
+				{
+					const auto first = Columns.begin() + RowStart[i];
+					const auto last = Columns.begin() + RowStart[i + 1];
+					const auto found = std::lower_bound(first, last, i);
+					if (found == last || *found != i)
+					{
+						throw std::invalid_argument("Matrix has no stored diagonal entry.");
+					}
+					positions[i] = size_t(found - Columns.begin());
+				}
+				return positions;
+			}
+
+			CompressedRows Transpose() const
+			{
+				CompressedRows result;
+				result.Size = Size;
+				result.RowStart.assign(Size + 1, 0);
+				for (const size_t column : Columns)
+				{
+					++result.RowStart[column + 1];
+				}
+				for (size_t i = 0; i < Size; ++i)
+				{
+					result.RowStart[i + 1] += result.RowStart[i];
+				}
+				result.Columns.resize(Columns.size());
+				result.Values.resize(Values.size());
+				std::vector<size_t> next(result.RowStart.begin(), result.RowStart.end() - 1);
+				for (size_t i = 0; i < Size; ++i)
+				{
+					for (size_t p = RowStart[i]; p < RowStart[i + 1]; ++p)
+					{
+						const size_t q = next[Columns[p]]++;
+						result.Columns[q] = i;
+						result.Values[q] = Values[p];
+					}
+				}
+				return result;
+			}
+		};
+
+		// Rows of a sparse triangular solve grouped into levels: every row depends only on rows of
+		// earlier levels, so the rows of one level can be solved in parallel.
+		struct LevelSchedule
+		{
+			std::vector<size_t> Rows;
+			std::vector<size_t> LevelStart;
+		};
+
+		template<typename DataType>
+		LevelSchedule BuildLevelSchedule(const CompressedRows<DataType>& m, const bool lower)
+		{
+			const size_t n = m.Size;
+			std::vector<size_t> level(n, 0);
+			size_t levels = 0;
+			for (size_t step = 0; step < n; ++step)
+			{
+				const size_t i = lower ? step : n - 1 - step;
+				size_t depth = 0;
+				for (size_t p = m.RowStart[i]; p < m.RowStart[i + 1]; ++p)
+				{
+					const size_t j = m.Columns[p];
+					if (lower ? j < i : j > i)
+					{
+						depth = std::max(depth, level[j] + 1);
+					}
+				}
+				level[i] = depth;
+				levels = std::max(levels, depth + 1);
+			}
+			LevelSchedule schedule;
+			schedule.LevelStart.assign(levels + 1, 0);
+			for (size_t i = 0; i < n; ++i)
+			{
+				++schedule.LevelStart[level[i] + 1];
+			}
+			for (size_t l = 0; l < levels; ++l)
+			{
+				schedule.LevelStart[l + 1] += schedule.LevelStart[l];
+			}
+			schedule.Rows.resize(n);
+			std::vector<size_t> next(schedule.LevelStart.begin(), schedule.LevelStart.end() - 1);
+			for (size_t i = 0; i < n; ++i)
+			{
+				schedule.Rows[next[level[i]]++] = i;
+			}
+			return schedule;
+		}
+
+		// Rows per thread below which a level runs on the calling thread. A 5- or 7-point stencil row
+		// costs about 10 ns, so a chunk is some 40 us of work against the few microseconds it takes to
+		// hand it to a pool worker.
+		constexpr size_t LevelParallelRows = 4096;
+
+		// In-place x = T^-1 x for the strictly lower (or upper) part of m plus the given diagonal
+		// (unit when diagonal is null). When the levels are too small on average for any to split
+		// across threads (fewer than 2 * LevelParallelRows rows each, as in 2D stencils and most
+		// ILU(0)/IC(0) factors), the sweep runs serially in row order: one pass over contiguous
+		// memory instead of one pool round trip per level. Otherwise it goes one level at a time.
+		template<typename DataType>
+		void TriangularSolveLevels(const CompressedRows<DataType>& m, const LevelSchedule& schedule, const bool lower,
+			const DataType* diagonal, DataType* x)
+		{
+			const auto solveRow = [&](const size_t i)
+			{
+				DataType sum = x[i];
+				for (size_t p = m.RowStart[i]; p < m.RowStart[i + 1]; ++p)
+				{
+					const size_t j = m.Columns[p];
+					if (lower ? j < i : j > i)
+					{
+						sum -= m.Values[p] * x[j];
+					}
+				}
+				x[i] = diagonal == nullptr ? sum : sum / diagonal[i];
+			};
+			const size_t levels = schedule.LevelStart.size() - 1;
+			if (m.Size < 2 * LevelParallelRows * levels || GetMaxThreads() == 1)
+			{
+				for (size_t step = 0; step < m.Size; ++step)
+				{
+					solveRow(lower ? step : m.Size - 1 - step);
+				}
+				return;
+			}
+			for (size_t l = 0; l < levels; ++l)
+			{
+				ParallelFor(schedule.LevelStart[l], schedule.LevelStart[l + 1], LevelParallelRows, [&](const size_t begin, const size_t end)
+				{
+					for (size_t r = begin; r < end; ++r)
+					{
+						solveRow(schedule.Rows[r]);
+					}
+				});
+			}
+		}
+
+		// In-place LU with partial pivoting of the n x n row-major block a.
+		template<typename DataType>
+		void FactorDenseLU(DataType* a, const size_t n, size_t* pivots)
+		{
+			for (size_t k = 0; k < n; ++k)
+			{
+				size_t pivot = k;
+				for (size_t i = k + 1; i < n; ++i)
+				{
+					if (std::abs(a[i * n + k]) > std::abs(a[pivot * n + k]))
+					{
+						pivot = i;
+					}
+				}
+				pivots[k] = pivot;
+				if (a[pivot * n + k] == DataType(0))
+				{
+					throw std::runtime_error("Diagonal block is singular.");
+				}
+				if (pivot != k)
+				{
+					std::swap_ranges(a + k * n, a + (k + 1) * n, a + pivot * n);
+				}
+				const DataType inverse = DataType(1) / a[k * n + k];
+				for (size_t i = k + 1; i < n; ++i)
+				{
+					DataType* row = a + i * n;
+					const DataType factor = row[k] * inverse;
+					row[k] = factor;
+					for (size_t j = k + 1; j < n; ++j)
+					{
+						row[j] -= factor * a[k * n + j];
+					}
+				}
+			}
+		}
+
+		template<typename DataType>
+		void SolveDenseLU(const DataType* lu, const size_t n, const size_t* pivots, DataType* x)
+		{
+			for (size_t k = 0; k < n; ++k)
+			{
+				std::swap(x[k], x[pivots[k]]);
+			}
+			for (size_t i = 1; i < n; ++i)
+			{
+				DataType sum = x[i];
+				for (size_t j = 0; j < i; ++j)
+				{
+					sum -= lu[i * n + j] * x[j];
+				}
+				x[i] = sum;
+			}
+			for (size_t i = n; i-- > 0;)
+			{
+				DataType sum = x[i];
+				for (size_t j = i + 1; j < n; ++j)
+				{
+					sum -= lu[i * n + j] * x[j];
+				}
+				x[i] = sum / lu[i * n + i];
+			}
+		}
+	} // namespace Detail
+
+	// M = diag(A).
+	template<typename DataType>
+	class LAR_EXPORT JacobiPreconditioner
+	{
+		static_assert(std::is_floating_point<DataType>::value, "Preconditioners require a floating-point element type.");
+
+	public:
+		explicit JacobiPreconditioner(const Matrix<DataType>& a)
+		{
+			if (!a.IsSquare())
+			{
+				throw std::invalid_argument("Preconditioners need a square matrix.");
+			}
+			Vector<DataType> diagonal(a.GetRows());
+			for (size_t i = 0; i < a.GetRows(); ++i)
+			{
+				diagonal[i] = a(i, i);
+			}
+			Invert(diagonal);
+		}
+
+		template<SparseFormat Format>
+		explicit JacobiPreconditioner(const SparseMatrix<DataType, Format>& a)
+		{
+			if (!a.IsSquare())
+			{
+				throw std::invalid_argument("Preconditioners need a square matrix.");
+			}
+			Invert(a.Diagonal());
+		}
+
+		size_t GetSize() const { return mInverseDiagonal.size(); }
+
+		void Apply(const DataType* x, DataType* y) const
+		{
+			for (size_t i = 0; i < mInverseDiagonal.size(); ++i)
+			{
+				y[i] = mInverseDiagonal[i] * x[i];
+			}
+		}
+
+	private:
+		void Invert(const Vector<DataType>& diagonal)
+		{
+			mInverseDiagonal.resize(diagonal.GetSize());
+			for (size_t i = 0; i < diagonal.GetSize(); ++i)
+			{
+				if (diagonal[i] == DataType(0))
+				{
+					throw std::invalid_argument("Jacobi preconditioner needs a nonzero diagonal.");
+				}
+				mInverseDiagonal[i] = DataType(1) / diagonal[i];
+			}
+		}
+
+		std::vector<DataType> mInverseDiagonal;
+	};
+
+	// M = blockdiag(A) with consecutive diagonal blocks of BlockSize rows (the last may be smaller).
+	// Each block is LU-factored once; Apply solves the blocks in parallel.
+	template<typename DataType>
+	class LAR_EXPORT BlockJacobiPreconditioner
+	{
+		static_assert(std::is_floating_point<DataType>::value, "Preconditioners require a floating-point element type.");
+
+	public:
+		BlockJacobiPreconditioner(const Matrix<DataType>& a, const size_t blockSize)
+			: BlockJacobiPreconditioner(Detail::CompressedRows<DataType>::FromDense(a), blockSize)
+		{
+		}
+
+		template<SparseFormat Format>
+		BlockJacobiPreconditioner(const SparseMatrix<DataType, Format>& a, const size_t blockSize)
+			: BlockJacobiPreconditioner(Detail::CompressedRows<DataType>::FromSparse(a), blockSize)
+		{
+		}
+
+		size_t GetSize() const { return mSize; }
+
+		void Apply(const DataType* x, DataType* y) const
+		{
+			std::copy(x, x + mSize, y);
+			const size_t blocks = (mSize + mBlockSize - 1) / mBlockSize;
+			// A block solve costs about BlockSize^2 row operations, so a chunk holds LevelParallelRows
+			// rows' worth of work.
+			ParallelFor(0, blocks, std::max<size_t>(1, Detail::LevelParallelRows / (mBlockSize * mBlockSize)), [&](const size_t begin, const size_t end)
+			{
+				for (size_t block = begin; block < end; ++block)
+				{
+					const size_t first = block * mBlockSize;
+					const size_t size = std::min(mBlockSize, mSize - first);
+					Detail::SolveDenseLU(mFactors.data() + block * mBlockSize * mBlockSize, size, mPivots.data() + first, y + first);
+				}
+			});
+		}
+
+	private:
+		BlockJacobiPreconditioner(const Detail::CompressedRows<DataType>& a, const size_t blockSize)
+			: mSize(a.Size), mBlockSize(std::max<size_t>(1, blockSize))
+		{
+			const size_t blocks = (mSize + mBlockSize - 1) / mBlockSize;
+			mFactors.assign(blocks * mBlockSize * mBlockSize, DataType(0));
+			mPivots.resize(blocks * mBlockSize);
+			ParallelFor(0, blocks, 1, [&](const size_t begin, const size_t end)
+			{
+				for (size_t block = begin; block < end; ++block)
+				{
+					const size_t first = block * mBlockSize;
+					const size_t size = std::min(mBlockSize, mSize - first);
+					DataType* lu = mFactors.data() + block * mBlockSize * mBlockSize;
+					for (size_t i = 0; i < size; ++i)
+					{
+						const size_t row = first + i;
+						const auto columns = a.Columns.begin();
+						for (size_t p = size_t(std::lower_bound(columns + a.RowStart[row], columns + a.RowStart[row + 1], first) - columns);
+							p < a.RowStart[row + 1] && a.Columns[p] < first + size; ++p)
+						{
+							lu[i * size + a.Columns[p] - first] = a.Values[p];
+						}
+					}
+					Detail::FactorDenseLU(lu, size, mPivots.data() + first);
+				}
+			});
+		}
+
+		size_t mSize;
+		size_t mBlockSize;
+		std::vector<DataType> mFactors;
+		std::vector<size_t> mPivots;
+	};
+
+	// Symmetric SOR: M = 1 / (2 - omega) (D / omega + L) (D / omega)^-1 (D / omega + U) for
+	// 0 < omega < 2, symmetric positive definite whenever A is. The forward and backward sweeps are
+	// level-scheduled triangular solves.
+	template<typename DataType>
+	class LAR_EXPORT SSORPreconditioner
+	{
+		static_assert(std::is_floating_point<DataType>::value, "Preconditioners require a floating-point element type.");
+
+	public:
+		explicit SSORPreconditioner(const Matrix<DataType>& a, const DataType omega = DataType(1))
+			: SSORPreconditioner(Detail::CompressedRows<DataType>::FromDense(a), omega)
+		{
+		}
+
+		template<SparseFormat Format>
+		explicit SSORPreconditioner(const SparseMatrix<DataType, Format>& a, const DataType omega = DataType(1))
+			: SSORPreconditioner(Detail::CompressedRows<DataType>::FromSparse(a), omega)
+		{
+		}
+
+		size_t GetSize() const { return mMatrix.Size; }
+
+		void Apply(const DataType* x, DataType* y) const
+		{
+			const size_t n = mMatrix.Size;
+			std::copy(x, x + n, y);
+			Detail::TriangularSolveLevels(mMatrix, mLower, true, mScaledDiagonal.data(), y);
+			const DataType scale = DataType(2) - mOmega;
+			for (size_t i = 0; i < n; ++i)
+			{
+				y[i] *= scale * mScaledDiagonal[i];
+			}
+			Detail::TriangularSolveLevels(mMatrix, mUpper, false, mScaledDiagonal.data(), y);
+		}
+
+	private:
+		SSORPreconditioner(Detail::CompressedRows<DataType>&& a, const DataType omega)
+			: mMatrix(std::move(a)), mOmega(omega)
+		{
+			if (!(omega > DataType(0) && omega < DataType(2)))
+			{
+				throw std::invalid_argument("SSOR relaxation factor must lie in (0, 2).");
+			}
+			const std::vector<size_t> diagonal = mMatrix.DiagonalPositions();
+			mScaledDiagonal.resize(mMatrix.Size);
+			for (size_t i = 0; i < mMatrix.Size; ++i)
+			{
+				if (mMatrix.Values[diagonal[i]] == DataType(0))
+				{
+					throw std::invalid_argument("SSOR preconditioner needs a nonzero diagonal.");
+				}
+				mScaledDiagonal[i] = mMatrix.Values[diagonal[i]] / omega;
+			}
+			mLower = Detail::BuildLevelSchedule(mMatrix, true);
+			mUpper = Detail::BuildLevelSchedule(mMatrix, false);
+		}
+
+		Detail::CompressedRows<DataType> mMatrix;
+		DataType mOmega;
+		std::vector<DataType> mScaledDiagonal;
+		Detail::LevelSchedule mLower;
+		Detail::LevelSchedule mUpper;
+	};
+
+	// Incomplete LU with zero fill-in: L (unit lower) and U keep exactly the sparsity pattern of A.
+	template<typename DataType>
+	class LAR_EXPORT ILU0Preconditioner
+	{
+		static_assert(std::is_floating_point<DataType>::value, "Preconditioners require a floating-point element type.");
+
+	public:
+		explicit ILU0Preconditioner(const Matrix<DataType>& a)
+			: ILU0Preconditioner(Detail::CompressedRows<DataType>::FromDense(a))
+		{
+		}
+
+		template<SparseFormat Format>
+		explicit ILU0Preconditioner(const SparseMatrix<DataType, Format>& a)
+			: ILU0Preconditioner(Detail::CompressedRows<DataType>::FromSparse(a))
+		{
+		}
+
+		size_t GetSize() const { return mFactors.Size; }
+
+		void Apply(const DataType* x, DataType* y) const
+		{
+			std::copy(x, x + mFactors.Size, y);
+			Detail::TriangularSolveLevels(mFactors, mLower, true, static_cast<const DataType*>(nullptr), y);
+			Detail::TriangularSolveLevels(mFactors, mUpper, false, mDiagonal.data(), y);
+		}
+
+	private:
+		explicit ILU0Preconditioner(Detail::CompressedRows<DataType>&& a)
+			: mFactors(std::move(a))
+		{
+			const size_t n = mFactors.Size;
+			const std::vector<size_t> diagonal = mFactors.DiagonalPositions();
+			const std::vector<size_t>& start = mFactors.RowStart;
+			const std::vector<size_t>& columns = mFactors.Columns;
+			std::vector<DataType>& values = mFactors.Values;
+			// position[j] = index of (i, j) in the current row i, or npos.
+			const size_t npos = size_t(-1);
+			std::vector<size_t> position(n, npos);
+			for (size_t i = 0; i < n; ++i)
+			{
+				for (size_t p = start[i]; p < start[i + 1]; ++p)
+				{
+					position[columns[p]] = p;
+				}
+				for (size_t p = start[i]; p < start[i + 1] && columns[p] < i; ++p)
+				{
+					const size_t k = columns[p];
+					const DataType pivot = values[diagonal[k]];
+					if (pivot == DataType(0))
+					{
+						throw std::runtime_error("ILU(0) encountered a zero pivot.");
+					}
+					const DataType factor = values[p] / pivot;
+					values[p] = factor;
+					for (size_t q = diagonal[k] + 1; q < start[k + 1]; ++q)
+					{
+						const size_t target = position[columns[q]];
+						if (target != npos)
+						{
+							values[target] -= factor * values[q];
+						}
+					}
+				}
+				for (size_t p = start[i]; p < start[i + 1]; ++p)
+				{
+					position[columns[p]] = npos;
+				}
+			}
+			mDiagonal.resize(n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				mDiagonal[i] = values[diagonal[i]];
+				if (mDiagonal[i] == DataType(0))
+				{
+					throw std::runtime_error("ILU(0) encountered a zero pivot.");
+				}
+			}
+			mLower = Detail::BuildLevelSchedule(mFactors, true);
+			mUpper = Detail::BuildLevelSchedule(mFactors, false);
+		}
+
+		Detail::CompressedRows<DataType> mFactors;
+		std::vector<DataType> mDiagonal;
+		Detail::LevelSchedule mLower;
+		Detail::LevelSchedule mUpper;
+	};
+
+	// Incomplete Cholesky with zero fill-in, A ~ L L^T on the lower-triangular pattern of A, for
+	// symmetric positive definite A (only the lower triangle is read). L^T is stored separately so
+	// both sweeps walk rows.
+	template<typename DataType>
+	class LAR_EXPORT IC0Preconditioner
+	{
+		static_assert(std::is_floating_point<DataType>::value, "Preconditioners require a floating-point element type.");
+
+	public:
+		explicit IC0Preconditioner(const Matrix<DataType>& a)
+			: IC0Preconditioner(Detail::CompressedRows<DataType>::FromDense(a))
+		{
+		}
+
+		template<SparseFormat Format>
+		explicit IC0Preconditioner(const SparseMatrix<DataType, Format>& a)
+			: IC0Preconditioner(Detail::CompressedRows<DataType>::FromSparse(a))
+		{
+		}
+
+		size_t GetSize() const { return mFactor.Size; }
+
+		void Apply(const DataType* x, DataType* y) const
+		{
+			std::copy(x, x + mFactor.Size, y);
+			Detail::TriangularSolveLevels(mFactor, mLower, true, mDiagonal.data(), y);
+			Detail::TriangularSolveLevels(mTransposed, mUpper, false, mDiagonal.data(), y);
+		}
+
+	private:
+		explicit IC0Preconditioner(const Detail::CompressedRows<DataType>& a)
+		{
+			// Keep the lower triangle only.
+			const size_t n = a.Size;
+			mFactor.Size = n;
+			mFactor.RowStart.assign(1, 0);
+			for (size_t i = 0; i < n; ++i)
+			{
+				for (size_t p = a.RowStart[i]; p < a.RowStart[i + 1] && a.Columns[p] <= i; ++p)
+				{
+					mFactor.Columns.push_back(a.Columns[p]);
+					mFactor.Values.push_back(a.Values[p]);
+				}
+				mFactor.RowStart.push_back(mFactor.Columns.size());
+			}
+
+			// Row-oriented: L(i, j) = (A(i, j) - sum_k<j L(i, k) L(j, k)) / L(j, j), merging the sorted rows i and j.
+			const std::vector<size_t>& start = mFactor.RowStart;
+			const std::vector<size_t>& columns = mFactor.Columns;
+			std::vector<DataType>& values = mFactor.Values;
+			mDiagonal.resize(n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				for (size_t p = start[i]; p < start[i + 1]; ++p)
+				{
+					const size_t j = columns[p];
+					DataType sum = values[p];
+					size_t pi = start[i];
+					size_t pj = start[j];
+					while (pi < p && pj < start[j + 1] && columns[pj] < j)
+					{
+						if (columns[pi] == columns[pj])
+						{
+							sum -= values[pi++] * values[pj++];
+						}
+						else if (columns[pi] < columns[pj])
+						{
+							++pi;
+						}
+						else
+						{
+							++pj;
+						}
+					}
+					if (j < i)
+					{
+						values[p] = sum / mDiagonal[j];
+					}
+					else
+					{
+						if (!(sum > DataType(0)))
+						{
+							throw std::runtime_error("IC(0) encountered a non-positive pivot.");
+						}
+						mDiagonal[i] = std::sqrt(sum);
+						values[p] = mDiagonal[i];
+					}
+				}
+				if (start[i + 1] == start[i] || columns[start[i + 1] - 1] != i)
+				{
+					throw std::invalid_argument("Matrix has no stored diagonal entry.");
+				}
+			}
+			mTransposed = mFactor.Transpose();
+			mLower = Detail::BuildLevelSchedule(mFactor, true);
+			mUpper = Detail::BuildLevelSchedule(mTransposed, false);
+		}
+
+		Detail::CompressedRows<DataType> mFactor;
+		Detail::CompressedRows<DataType> mTransposed;
+		std::vector<DataType> mDiagonal;
+		Detail::LevelSchedule mLower;
+		Detail::LevelSchedule mUpper;
+	};
+} // namespace LAR
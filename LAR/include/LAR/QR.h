@@ -0,0 +1,558 @@
+#pragma once
+#include "Matrix.h"
+#include "Vector.h"
+#include "Gemm.h"
+#include "Memory.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace LAR
+{
+	struct QROptions
+	{
+		// Rank-revealing QR with column pivoting; the factorization then uses Level-2 updates.
+		bool ColumnPivoting = false;
+		// Columns per panel in the blocked (compact WY) factorization.
+		size_t BlockSize = 32;
+	};
+
+	namespace Detail
+	{
+		// Euclidean norm of a strided array, scaled by the largest magnitude to avoid overflow/underflow.
+		template<typename DataType>
+		DataType Norm2(const DataType* x, const size_t count, const size_t stride)
+		{
+			DataType scale = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				scale = std::max(scale, std::abs(x[i * stride]));
+			}
+			if (scale == DataType(0))
+			{
+				return DataType(0);
+			}
+			DataType sum = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				const DataType value = x[i * stride] / scale;
+				sum += value * value;
+			}
+			return scale * std::sqrt(sum);
+		}
+
+		// Generates the Householder reflector H = I - tau * v * v^T with H * [alpha; x] = [beta; 0] and
+		// v(0) = 1. alpha is overwritten by beta and x by v(1:); returns tau.
+		template<typename DataType>
+		DataType HouseholderVector(DataType& alpha, DataType* x, const size_t count, const size_t stride)
+		{
+			const DataType norm = Norm2(x, count, stride);
+			if (norm == DataType(0))
+			{
+				return DataType(0);
+			}
+			const DataType beta = alpha >= DataType(0) ? -std::hypot(alpha, norm) : std::hypot(alpha, norm);
+			const DataType tau = (beta - alpha) / beta;
+			const DataType scale = DataType(1) / (alpha - beta);
+			for (size_t i = 0; i < count; ++i)
+			{
+				x[i * stride] *= scale;
+			}
+			alpha = beta;
+			return tau;
+		}
+
+		// Applies H = I - tau * v * v^T from the left to the rows x cols block c (row stride ldc). The
+		// row-wise formulation streams c contiguously twice.
+		template<typename DataType>
+		void ApplyHouseholder(const DataType* v, const DataType tau, const size_t rows, const size_t cols,
+			DataType* c, const size_t ldc, DataType* work)
+		{
+			if (tau == DataType(0) || cols == 0)
+			{
+				return;
+			}
+			std::fill(work, work + cols, DataType(0));
+			for (size_t r = 0; r < rows; ++r)
+			{
+				const DataType vr = v[r];
+				const DataType* row = c + r * ldc;
+				for (size_t j = 0; j < cols; ++j)
+				{
+					work[j] += vr * row[j];
+				}
+			}
+			for (size_t r = 0; r < rows; ++r)
+			{
+				const DataType scale = tau * v[r];
+				DataType* row = c + r * ldc;
+				for (size_t j = 0; j < cols; ++j)
+				{
+					row[j] -= scale * work[j];
+				}
+			}
+		}
+
+		// Builds the upper triangular factor T of the compact WY form H_0 H_1 ... H_{k-1} = I - V T V^T
+		// (LAPACK's forward, column-wise larft). V is rows x k with row stride ldv; only its strictly
+		// lower part is read, the unit diagonal is implied, so V can sit under R in a compact factor.
+		template<typename DataType>
+		void BlockReflectorFactor(const DataType* v, const size_t ldv, const size_t rows, const size_t k, const DataType* tau,
+			DataType* t)
+		{
+			std::fill(t, t + k * k, DataType(0));
+			for (size_t i = 0; i < k; ++i)
+			{
+				t[i * k + i] = tau[i];
+				if (tau[i] == DataType(0))
+				{
+					continue;
+				}
+				// z = -tau_i * V(:, 0:i)^T * v_i, then T(0:i, i) = T(0:i, 0:i) * z.
+				for (size_t j = 0; j < i; ++j)
+				{
+					t[j * k + i] = v[i * ldv + j];
+				}
+				for (size_t r = i + 1; r < rows; ++r)
+				{
+					const DataType vri = v[r * ldv + i];
+					for (size_t j = 0; j < i; ++j)
+					{
+						t[j * k + i] += v[r * ldv + j] * vri;
+					}
+				}
+				for (size_t j = 0; j < i; ++j)
+				{
+					t[j * k + i] *= -tau[i];
+				}
+				for (size_t j = 0; j < i; ++j)
+				{
+					DataType sum = 0;
+					for (size_t l = j; l < i; ++l)
+					{
+						sum += t[j * k + l] * t[l * k + i];
+					}
+					t[j * k + i] = sum;
+				}
+			}
+		}
+
+		// c = (I - V op(T) V^T) c for the rows x cols block c, with V laid out as for
+		// BlockReflectorFactor (LAPACK's larfb). V splits into its unit lower triangular top k rows V1
+		// and the rest V2: the V2 products are two Gemm calls, the V1 ones small triangular loops, and
+		// op(T) is applied in between.
+		template<typename DataType>
+		void ApplyBlockReflector(const DataType* v, const size_t ldv, const size_t rows, const size_t k, const DataType* t,
+			const Op opT, DataType* c, const size_t ldc, const size_t cols)
+		{
+			if (cols == 0 || k == 0)
+			{
+				return;
+			}
+			ScratchBuffer<DataType> work(k * cols);
+			DataType* w = work.Data();
+			// W = V1^T C1 + V2^T C2.
+			for (size_t i = 0; i < k; ++i)
+			{
+				DataType* wi = w + i * cols;
+				std::copy(c + i * ldc, c + i * ldc + cols, wi);
+				for (size_t r = i + 1; r < k; ++r)
+				{
+					const DataType vri = v[r * ldv + i];
+					const DataType* cr = c + r * ldc;
+					for (size_t j = 0; j < cols; ++j)
+					{
+						wi[j] += vri * cr[j];
+					}
+				}
+			}
+			if (rows > k)
+			{
+				GemmAccumulate(k, cols, rows - k, DataType(1), v + k * ldv, ldv, Op::Trans, c + k * ldc, ldc, Op::NoTrans, w, cols);
+			}
+			if (opT == Op::NoTrans)
+			{
+				for (size_t i = 0; i < k; ++i)
+				{
+					DataType* wi = w + i * cols;
+					for (size_t j = 0; j < cols; ++j)
+					{
+						wi[j] *= t[i * k + i];
+					}
+					for (size_t l = i + 1; l < k; ++l)
+					{
+						const DataType til = t[i * k + l];
+						const DataType* wl = w + l * cols;
+						for (size_t j = 0; j < cols; ++j)
+						{
+							wi[j] += til * wl[j];
+						}
+					}
+				}
+			}
+			else
+			{
+				for (size_t i = k; i-- > 0;)
+				{
+					DataType* wi = w + i * cols;
+					for (size_t j = 0; j < cols; ++j)
+					{
+						wi[j] *= t[i * k + i];
+					}
+					for (size_t l = 0; l < i; ++l)
+					{
+						const DataType tli = t[l * k + i];
+						const DataType* wl = w + l * cols;
+						for (size_t j = 0; j < cols; ++j)
+						{
+							wi[j] += tli * wl[j];
+						}
+					}
+				}
+			}
+			// C2 -= V2 W, then C1 -= V1 W.
+			if (rows > k)
+			{
+				GemmAccumulate(rows - k, cols, k, DataType(-1), v + k * ldv, ldv, Op::NoTrans, w, cols, Op::NoTrans, c + k * ldc, ldc);
+			}
+			for (size_t i = 0; i < k; ++i)
+			{
+				DataType* ci = c + i * ldc;
+				for (size_t j = 0; j < cols; ++j)
+				{
+					ci[j] -= w[i * cols + j];
+				}
+				for (size_t l = 0; l < i; ++l)
+				{
+					const DataType vil = v[i * ldv + l];
+					const DataType* wl = w + l * cols;
+					for (size_t j = 0; j < cols; ++j)
+					{
+						ci[j] -= vil * wl[j];
+					}
+				}
+			}
+		}
+
+		// Solves R(0:n, 0:n) x = b in place by back substitution; R is upper triangular with row stride ldr.
+		template<typename DataType>
+		void SolveUpperTriangular(const DataType* r, const size_t ldr, const size_t n, DataType* b, const size_t ldb,
+			const size_t nrhs)
+		{
+			for (size_t i = n; i-- > 0;)
+			{
+				DataType* bi = b + i * ldb;
+				for (size_t l = i + 1; l < n; ++l)
+				{
+					const DataType ril = r[i * ldr + l];
+					const DataType* bl = b + l * ldb;
+					for (size_t j = 0; j < nrhs; ++j)
+					{
+						bi[j] -= ril * bl[j];
+					}
+				}
+				const DataType diagonal = r[i * ldr + i];
+				if (diagonal == DataType(0))
+				{
+					throw std::invalid_argument("Triangular factor is singular.");
+				}
+				for (size_t j = 0; j < nrhs; ++j)
+				{
+					bi[j] /= diagonal;
+				}
+			}
+		}
+	} // namespace Detail
+
+	// Householder QR factorization A P = Q R of an m x n matrix. R and the Householder vectors share
+	// one m x n buffer (R on and above the diagonal, the vectors below it), and Q is only ever applied
+	// implicitly through compact WY block reflectors I - V T V^T, so the trailing-matrix updates and
+	// every application of Q are Gemm calls. P is the identity unless column pivoting is requested.
+	template<typename DataType>
+	class LAR_EXPORT QR
+	{
+		static_assert(std::is_floating_point<DataType>::value, "QR requires a floating-point element type.");
+
+	public:
+		explicit QR(const Matrix<DataType>& a, const QROptions& options = QROptions())
+			: mFactors(a), mTau(std::min(a.GetRows(), a.GetCols())), mPermutation(a.GetCols()),
+			mBlockSize(std::max<size_t>(1, options.BlockSize)), mPivoted(options.ColumnPivoting)
+		{
+			std::iota(mPermutation.begin(), mPermutation.end(), size_t(0));
+			if (options.ColumnPivoting)
+			{
+				FactorPivoted();
+			}
+			else
+			{
+				FactorBlocked();
+			}
+		}
+
+		size_t GetRows() const { return mFactors.GetRows(); }
+		size_t GetCols() const { return mFactors.GetCols(); }
+		size_t GetReflectorCount() const { return mTau.size(); }
+
+		// Column j of A P is column Permutation()[j] of A.
+		const std::vector<size_t>& Permutation() const { return mPermutation; }
+
+		// The min(m, n) x n upper trapezoidal factor.
+		Matrix<DataType> R() const
+		{
+			const size_t k = mTau.size();
+			const size_t n = GetCols();
+			Matrix<DataType> result(k, n);
+			for (size_t i = 0; i < k; ++i)
+			{
+				for (size_t j = 0; j < n; ++j)
+				{
+					result(i, j) = j >= i ? mFactors(i, j) : DataType(0);
+				}
+			}
+			return result;
+		}
+
+		// Numerical rank: diagonal entries of R above tolerance, by default max(m, n) * eps * |R(0, 0)|.
+		// Only meaningful with column pivoting, which orders |R(i, i)| decreasingly.
+		size_t Rank(DataType tolerance = DataType(-1)) const
+		{
+			const size_t k = mTau.size();
+			if (k == 0)
+			{
+				return 0;
+			}
+			if (tolerance < DataType(0))
+			{
+				tolerance = std::max(GetRows(), GetCols()) * std::numeric_limits<DataType>::epsilon() * std::abs(mFactors(0, 0));
+			}
+			size_t rank = 0;
+			while (rank < k && std::abs(mFactors(rank, rank)) > tolerance)
+			{
+				++rank;
+			}
+			return rank;
+		}
+
+		// b = op(Q) * b for an m-row matrix b, without forming Q.
+		void ApplyQ(Matrix<DataType>& b, const Op op) const
+		{
+			if (b.GetRows() != GetRows())
+			{
+				throw std::invalid_argument("Matrix must have as many rows as the factored matrix.");
+			}
+			ApplyQ(b.mData, b.GetCols(), b.GetCols(), op);
+		}
+
+		void ApplyQ(Vector<DataType>& b, const Op op) const
+		{
+			if (b.GetSize() != GetRows())
+			{
+				throw std::invalid_argument("Vector must have as many entries as the factored matrix has rows.");
+			}
+			ApplyQ(b.mData, 1, 1, op);
+		}
+
+		// The first min(m, n) columns of Q, formed explicitly; prefer ApplyQ where possible.
+		Matrix<DataType> ThinQ() const
+		{
+			const size_t m = GetRows();
+			const size_t k = mTau.size();
+			Matrix<DataType> q(m, k);
+			for (size_t i = 0; i < m; ++i)
+			{
+				for (size_t j = 0; j < k; ++j)
+				{
+					q(i, j) = i == j ? DataType(1) : DataType(0);
+				}
+			}
+			ApplyQ(q.mData, k, k, Op::NoTrans);
+			return q;
+		}
+
+		// Least-squares solution of A X = B (minimum residual). With column pivoting, rank deficiency is
+		// handled by returning the basic solution that is zero in the trailing n - Rank() components.
+		Matrix<DataType> Solve(const Matrix<DataType>& b) const
+		{
+			if (b.GetRows() != GetRows())
+			{
+				throw std::invalid_argument("Right-hand side must have as many rows as the factored matrix.");
+			}
+			const size_t nrhs = b.GetCols();
+			Matrix<DataType> qtb(b);
+			ApplyQ(qtb.mData, nrhs, nrhs, Op::Trans);
+			const size_t rank = mPivoted ? Rank() : mTau.size();
+			Detail::SolveUpperTriangular(mFactors.mData, GetCols(), rank, qtb.mData, nrhs, nrhs);
+
+			Matrix<DataType> x(GetCols(), nrhs);
+			for (size_t j = 0; j < GetCols(); ++j)
+			{
+				for (size_t c = 0; c < nrhs; ++c)
+				{
+					x(mPermutation[j], c) = j < rank ? qtb(j, c) : DataType(0);
+				}
+			}
+			return x;
+		}
+
+		Vector<DataType> Solve(const Vector<DataType>& b) const
+		{
+			if (b.GetSize() != GetRows())
+			{
+				throw std::invalid_argument("Right-hand side must have as many entries as the factored matrix has rows.");
+			}
+			Matrix<DataType> rhs(b.mData, b.GetSize(), 1);
+			Matrix<DataType> x = Solve(rhs);
+			return Vector<DataType>(x.mData, x.GetRows());
+		}
+
+	private:
+		void FactorBlocked()
+		{
+			const size_t m = GetRows();
+			const size_t n = GetCols();
+			const size_t k = mTau.size();
+			DataType* a = mFactors.mData;
+			ScratchBuffer<DataType> work(n);
+			ScratchBuffer<DataType> column(m);
+
+			for (size_t j0 = 0; j0 < k; j0 += mBlockSize)
+			{
+				const size_t jb = std::min(mBlockSize, k - j0);
+				const size_t rows = m - j0;
+
+				// Unblocked factorization of the panel, updating only the panel's own columns.
+				for (size_t i = j0; i < j0 + jb; ++i)
+				{
+					mTau[i] = Detail::HouseholderVector(a[i * n + i], a + (i + 1) * n + i, m - i - 1, n);
+					column[0] = DataType(1);
+					for (size_t r = i + 1; r < m; ++r)
+					{
+						column[r - i] = a[r * n + i];
+					}
+					Detail::ApplyHouseholder(column.Data(), mTau[i], m - i, j0 + jb - i - 1, a + i * n + i + 1, n, work.Data());
+				}
+
+				const std::vector<DataType>& t = AddBlockReflector(j0, jb);
+
+				// Trailing update A(j0:m, j0+jb:n) = H^T A(j0:m, j0+jb:n) with H = I - V T V^T, V read in
+				// place below the panel's diagonal.
+				Detail::ApplyBlockReflector(a + j0 * n + j0, n, rows, jb, t.data(), Op::Trans, a + j0 * n + j0 + jb, n, n - j0 - jb);
+			}
+		}
+
+		// Businger-Golub pivoting with LAPACK's safeguarded downdating of the partial column norms.
+		void FactorPivoted()
+		{
+			const size_t m = GetRows();
+			const size_t n = GetCols();
+			const size_t k = mTau.size();
+			DataType* a = mFactors.mData;
+			const DataType tolerance = std::sqrt(std::numeric_limits<DataType>::epsilon());
+			std::vector<DataType> norms(n);
+			std::vector<DataType> originalNorms(n);
+			for (size_t j = 0; j < n; ++j)
+			{
+				norms[j] = originalNorms[j] = Detail::Norm2(a + j, m, n);
+			}
+			ScratchBuffer<DataType> work(n);
+			ScratchBuffer<DataType> v(m);
+
+			for (size_t i = 0; i < k; ++i)
+			{
+				const size_t pivot = static_cast<size_t>(std::max_element(norms.begin() + i, norms.end()) - norms.begin());
+				if (pivot != i)
+				{
+					mFactors.SwapCols(i, pivot);
+					std::swap(mPermutation[i], mPermutation[pivot]);
+					std::swap(norms[i], norms[pivot]);
+					std::swap(originalNorms[i], originalNorms[pivot]);
+				}
+
+				mTau[i] = Detail::HouseholderVector(a[i * n + i], a + (i + 1) * n + i, m - i - 1, n);
+				v[0] = DataType(1);
+				for (size_t r = i + 1; r < m; ++r)
+				{
+					v[r - i] = a[r * n + i];
+				}
+				Detail::ApplyHouseholder(v.Data(), mTau[i], m - i, n - i - 1, a + i * n + i + 1, n, work.Data());
+
+				for (size_t j = i + 1; j < n; ++j)
+				{
+					if (norms[j] == DataType(0))
+					{
+						continue;
+					}
+					const DataType ratio = std::abs(a[i * n + j]) / norms[j];
+					const DataType remaining = std::max(DataType(0), (DataType(1) - ratio) * (DataType(1) + ratio));
+					const DataType scaled = norms[j] / originalNorms[j];
+					if (remaining * scaled * scaled <= tolerance)
+					{
+						norms[j] = originalNorms[j] = Detail::Norm2(a + (i + 1) * n + j, m - i - 1, n);
+					}
+					else
+					{
+						norms[j] *= std::sqrt(remaining);
+					}
+				}
+			}
+
+			// Group the reflectors into the same compact WY blocks the blocked path produces.
+			for (size_t j0 = 0; j0 < k; j0 += mBlockSize)
+			{
+				AddBlockReflector(j0, std::min(mBlockSize, k - j0));
+			}
+		}
+
+		// Stores T for the reflectors of columns [j0, j0 + jb), once the panel is final. V stays in
+		// mFactors below the diagonal, so a block adds only jb x jb entries.
+		const std::vector<DataType>& AddBlockReflector(const size_t j0, const size_t jb)
+		{
+			std::vector<DataType> t(jb * jb);
+			Detail::BlockReflectorFactor(mFactors.mData + j0 * GetCols() + j0, GetCols(), GetRows() - j0, jb, mTau.data() + j0, t.data());
+			mBlockT.push_back(std::move(t));
+			return mBlockT.back();
+		}
+
+		// Q = H_0 H_1 ... H_{k-1}: Q^T applies the blocks first to last with T^T, Q last to first with T.
+		void ApplyQ(DataType* b, const size_t ldb, const size_t cols, const Op op) const
+		{
+			const size_t m = GetRows();
+			const size_t n = GetCols();
+			const size_t k = mTau.size();
+			const size_t blocks = mBlockT.size();
+			for (size_t step = 0; step < blocks; ++step)
+			{
+				const size_t index = op == Op::Trans ? step : blocks - 1 - step;
+				const size_t j0 = index * mBlockSize;
+				const size_t jb = std::min(mBlockSize, k - j0);
+				Detail::ApplyBlockReflector(mFactors.mData + j0 * n + j0, n, m - j0, jb, mBlockT[index].data(),
+					op == Op::Trans ? Op::Trans : Op::NoTrans, b + j0 * ldb, ldb, cols);
+			}
+		}
+
+		Matrix<DataType> mFactors;
+		std::vector<DataType> mTau;
+		std::vector<size_t> mPermutation;
+		// T of each compact WY block, built once during factorization; V is read from mFactors.
+		std::vector<std::vector<DataType>> mBlockT;
+		size_t mBlockSize;
+		bool mPivoted;
+	};
+
+	// Minimum-norm-residual solution of A x = b through a Householder QR of A.
+	template<typename DataType>
+	Vector<DataType> LeastSquares(const Matrix<DataType>& a, const Vector<DataType>& b, const QROptions& options = QROptions())
+	{
+		return QR<DataType>(a, options).Solve(b);
+	}
+
+	template<typename DataType>
+	Matrix<DataType> LeastSquares(const Matrix<DataType>& a, const Matrix<DataType>& b, const QROptions& options = QROptions())
+	{
+		return QR<DataType>(a, options).Solve(b);
+	}
+} // namespace LAR
@@ -0,0 +1,189 @@
+#pragma once
+#include "Matrix.h"
+#include "Vector.h"
+#include "Gemm.h"
+#include "Parallel.h"
+#include "QR.h"
+#include "SVD.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace LAR
+{
+	enum class SketchType
+	{
+		// Dense test matrix with standard normal entries; one Gemm per pass.
+		Gaussian,
+		// Each row of the test matrix holds a few random +-1 entries, so sketching A costs
+		// O(m n SparseSignNonzeros) instead of a Gemm with the full sketch width.
+		SparseSign
+	};
+
+	struct RandomizedSVDOptions
+	{
+		// Number of singular triplets returned.
+		size_t Rank = 10;
+		// Extra sketch columns beyond Rank; 5-10 is usually enough.
+		size_t Oversampling = 10;
+		// Passes with (A A^T) that sharpen a slowly decaying spectrum; each costs two Gemm calls and two QRs.
+		size_t PowerIterations = 2;
+		SketchType Sketch = SketchType::Gaussian;
+		size_t SparseSignNonzeros = 8;
+		// 0 draws a fresh seed from std::random_device; any other value makes the result reproducible.
+		uint64_t Seed = 0;
+	};
+
+	namespace Detail
+	{
+		// Orthonormal basis of the columns of y (rows >= cols) through the blocked QR.
+		template<typename DataType>
+		Matrix<DataType> OrthonormalBasis(const Matrix<DataType>& y)
+		{
+			return QR<DataType>(y).ThinQ();
+		}
+
+		// y = a * omega for the sparse sign test matrix given as, per row of omega, the column indices
+		// cols[j * nonzeros ..] and signs[j * nonzeros ..]. Rows of y are independent and split across threads.
+		template<typename DataType>
+		void SparseSignSketch(const Matrix<DataType>& a, const std::vector<size_t>& cols, const std::vector<DataType>& signs,
+			const size_t nonzeros, Matrix<DataType>& y)
+		{
+			const size_t n = a.GetCols();
+			const size_t width = y.GetCols();
+			std::fill(y.mData, y.mData + y.GetRows() * width, DataType(0));
+			ParallelFor(0, a.GetRows(), std::max<size_t>(1, 16384 / (n * nonzeros + 1)), [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					const DataType* row = a.mData + i * n;
+					DataType* out = y.mData + i * width;
+					for (size_t j = 0; j < n; ++j)
+					{
+						for (size_t s = 0; s < nonzeros; ++s)
+						{
+							out[cols[j * nonzeros + s]] += signs[j * nonzeros + s] * row[j];
+						}
+					}
+				}
+			});
+		}
+	} // namespace Detail
+
+	// Rank-k approximation A ~ U diag(sigma) V^T by randomized range finding (Halko, Martinsson and
+	// Tropp): sketch Y = A Omega with k + p columns, orthonormalize, optionally refine with power
+	// iterations, and take the exact SVD of the small (k + p) x n matrix Q^T A. The work is a handful of
+	// Gemm calls and thin QRs over A, which is far cheaper than a full SVD when k << min(m, n).
+	template<typename DataType>
+	class LAR_EXPORT RandomizedSVD
+	{
+		static_assert(std::is_floating_point<DataType>::value, "RandomizedSVD requires a floating-point element type.");
+
+	public:
+		explicit RandomizedSVD(const Matrix<DataType>& a, const RandomizedSVDOptions& options = RandomizedSVDOptions())
+			: mSingularValues(0), mU(0, 0), mV(0, 0)
+		{
+			const size_t m = a.GetRows();
+			const size_t n = a.GetCols();
+			if (options.Rank == 0 || options.Rank > std::min(m, n))
+			{
+				throw std::invalid_argument("Rank must be between 1 and min(rows, cols).");
+			}
+			const size_t k = options.Rank;
+			const size_t width = std::min(k + options.Oversampling, std::min(m, n));
+			std::mt19937_64 generator(options.Seed != 0 ? options.Seed : std::random_device()());
+
+			Matrix<DataType> y(m, width);
+			if (options.Sketch == SketchType::Gaussian)
+			{
+				std::normal_distribution<DataType> normal;
+				Matrix<DataType> omega(n, width);
+				for (size_t i = 0; i < n * width; ++i)
+				{
+					omega.mData[i] = normal(generator);
+				}
+				Multiply(a, Op::NoTrans, omega, y);
+			}
+			else
+			{
+				const size_t nonzeros = std::max<size_t>(1, std::min(options.SparseSignNonzeros, width));
+				std::vector<size_t> cols(n * nonzeros);
+				std::vector<DataType> signs(n * nonzeros);
+				std::vector<size_t> pool(width);
+				std::iota(pool.begin(), pool.end(), size_t(0));
+				const DataType scale = DataType(1) / std::sqrt(DataType(nonzeros));
+				for (size_t j = 0; j < n; ++j)
+				{
+					// Distinct columns per row: a partial Fisher-Yates shuffle of the pool.
+					for (size_t s = 0; s < nonzeros; ++s)
+					{
+						std::swap(pool[s], pool[s + generator() % (width - s)]);
+						cols[j * nonzeros + s] = pool[s];
+						signs[j * nonzeros + s] = (generator() & 1) != 0 ? scale : -scale;
+					}
+				}
+				Detail::SparseSignSketch(a, cols, signs, nonzeros, y);
+			}
+
+			Matrix<DataType> q = Detail::OrthonormalBasis(y);
+			Matrix<DataType> z(n, width);
+			for (size_t iteration = 0; iteration < options.PowerIterations; ++iteration)
+			{
+				// Re-orthonormalizing after each product keeps the small singular directions from being
+				// lost to rounding.
+				Multiply(a, Op::Trans, q, z);
+				z = Detail::OrthonormalBasis(z);
+				Multiply(a, Op::NoTrans, z, y);
+				q = Detail::OrthonormalBasis(y);
+			}
+
+			// B = Q^T A, stored as B^T = A^T Q so the product reads A row-wise.
+			Multiply(a, Op::Trans, q, z);
+			SVD<DataType> small(z);
+			mSingularValues = Vector<DataType>(k);
+			mU = Matrix<DataType>(m, k);
+			mV = Matrix<DataType>(n, k);
+			for (size_t j = 0; j < k; ++j)
+			{
+				mSingularValues[j] = small.SingularValues()[j];
+			}
+			// B^T = V_B S U_B^T, so V comes from the left vectors of the small problem and U = Q U_B.
+			for (size_t i = 0; i < n; ++i)
+			{
+				std::copy(small.U().mData + i * width, small.U().mData + i * width + k, mV.mData + i * k);
+			}
+			Matrix<DataType> rightK(width, k);
+			for (size_t i = 0; i < width; ++i)
+			{
+				std::copy(small.V().mData + i * width, small.V().mData + i * width + k, rightK.mData + i * k);
+			}
+			std::fill(mU.mData, mU.mData + m * k, DataType(0));
+			Detail::ParallelGemmAccumulate(m, k, width, DataType(1), q.mData, width, Op::NoTrans, rightK.mData, k, Op::NoTrans,
+				mU.mData, k);
+		}
+
+		const Vector<DataType>& SingularValues() const { return mSingularValues; }
+		const Matrix<DataType>& U() const { return mU; }
+		const Matrix<DataType>& V() const { return mV; }
+
+	private:
+		// c = op(a) * b for the m x n input a, rows of c split across threads.
+		static void Multiply(const Matrix<DataType>& a, const Op op, const Matrix<DataType>& b, Matrix<DataType>& c)
+		{
+			const size_t rows = op == Op::NoTrans ? a.GetRows() : a.GetCols();
+			const size_t inner = op == Op::NoTrans ? a.GetCols() : a.GetRows();
+			std::fill(c.mData, c.mData + rows * b.GetCols(), DataType(0));
+			Detail::ParallelGemmAccumulate(rows, b.GetCols(), inner, DataType(1), a.mData, a.GetCols(), op, b.mData, b.GetCols(),
+				Op::NoTrans, c.mData, c.GetCols());
+		}
+
+		Vector<DataType> mSingularValues;
+		Matrix<DataType> mU;
+		Matrix<DataType> mV;
+	};
+} // namespace LAR
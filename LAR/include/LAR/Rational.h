@@ -1,10 +1,11 @@
 #pragma once
+#include "LAR_export.h"
 #include <iostream>
 #include <numeric> // For std::gcd
 
 namespace LAR
 {
-	class Rational
+	class LAR_EXPORT Rational
 	{
 	private:
 		int mNumerator;
@@ -37,11 +38,11 @@ namespace LAR
 		bool operator<(const Rational& other) const;
 	};
 
-	Rational operator+(const int value, const Rational& rational);
-	Rational operator-(const int value, const Rational& rational);
-	Rational operator*(const int value, const Rational& rational);
-	Rational operator/(const int value, const Rational& rational);
+	LAR_EXPORT Rational operator+(const int value, const Rational& rational);
+	LAR_EXPORT Rational operator-(const int value, const Rational& rational);
+	LAR_EXPORT Rational operator*(const int value, const Rational& rational);
+	LAR_EXPORT Rational operator/(const int value, const Rational& rational);
 
-	std::ostream& operator<<(std::ostream& os, const Rational& rational);
-	Rational RandomValue(const Rational& min, const Rational& max);
+	LAR_EXPORT std::ostream& operator<<(std::ostream& os, const Rational& rational);
+	LAR_EXPORT Rational RandomValue(const Rational& min, const Rational& max);
 }
\ No newline at end of file
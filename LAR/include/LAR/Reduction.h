@@ -0,0 +1,210 @@
+#pragma once
+#include "Parallel.h"
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace LAR
+{
+	enum class ReductionMode
+	{
+		// Single accumulator, strictly left to right.
+		Naive,
+		// Independent partial sums per SIMD lane; vectorizes and breaks the serial dependency chain.
+		Fast,
+		// Recursive halving over lane-summed leaves; error grows with log(n) instead of n.
+		Pairwise,
+		// Compensated (Neumaier) summation, with exact products via fma for dot products.
+		Kahan,
+		// Fixed-size blocks reduced in a fixed order, blocks spread over threads. The result is
+		// bitwise identical for any thread count.
+		Reproducible
+	};
+
+	// Mode used by Vector::DotProduct, Vector::operator*, SparseVector::DotProduct and Matrix::Trace
+	// unless one is passed. Naive by default, so results match a plain left-to-right loop; the
+	// other modes, Fast included, are opt-in.
+	struct ReductionSettings
+	{
+		static inline std::atomic<ReductionMode> Mode{ ReductionMode::Naive };
+	};
+
+	inline void SetReductionMode(const ReductionMode mode)
+	{
+		ReductionSettings::Mode.store(mode, std::memory_order_relaxed);
+	}
+
+	inline ReductionMode GetReductionMode()
+	{
+		return ReductionSettings::Mode.load(std::memory_order_relaxed);
+	}
+
+	namespace Detail
+	{
+		constexpr size_t ReductionLanes = 8;
+		constexpr size_t PairwiseLeaf = 128;
+		constexpr size_t ReproducibleBlock = 1024;
+		constexpr size_t ReproducibleParallelBlocks = 64;
+
+		template<typename T, typename Term>
+		T ReduceNaive(const size_t begin, const size_t end, const Term& term)
+		{
+			T sum = 0;
+			for (size_t i = begin; i < end; ++i)
+			{
+				sum += term(i);
+			}
+			return sum;
+		}
+
+		template<typename T, typename Term>
+		T ReduceLanes(const size_t begin, const size_t end, const Term& term)
+		{
+			T lanes[ReductionLanes] = {};
+			size_t i = begin;
+			for (; i + ReductionLanes <= end; i += ReductionLanes)
+			{
+				for (size_t l = 0; l < ReductionLanes; ++l)
+				{
+					lanes[l] += term(i + l);
+				}
+			}
+			for (size_t l = 0; i < end; ++i, ++l)
+			{
+				lanes[l] += term(i);
+			}
+			for (size_t width = ReductionLanes / 2; width > 0; width /= 2)
+			{
+				for (size_t l = 0; l < width; ++l)
+				{
+					lanes[l] += lanes[l + width];
+				}
+			}
+			return lanes[0];
+		}
+
+		template<typename T, typename Term>
+		T ReducePairwise(const size_t begin, const size_t end, const Term& term)
+		{
+			if (end - begin <= PairwiseLeaf)
+			{
+				return ReduceLanes<T>(begin, end, term);
+			}
+			const size_t middle = begin + (end - begin) / 2;
+			return ReducePairwise<T>(begin, middle, term) + ReducePairwise<T>(middle, end, term);
+		}
+
+		// Neumaier's variant of Kahan summation: also correct when a term is larger than the sum.
+		template<typename T, typename Term>
+		T ReduceCompensated(const size_t begin, const size_t end, const Term& term)
+		{
+			if constexpr (std::is_floating_point<T>::value)
+			{
+				T sum = 0;
+				T compensation = 0;
+				for (size_t i = begin; i < end; ++i)
+				{
+					const T value = term(i);
+					const T next = sum + value;
+					compensation += std::abs(sum) >= std::abs(value) ? (sum - next) + value : (value - next) + sum;
+					sum = next;
+				}
+				return sum + compensation;
+			}
+			else
+			{
+				// Exact types have no rounding to compensate for.
+				return ReduceNaive<T>(begin, end, term);
+			}
+		}
+
+		template<typename T, typename Term>
+		T ReduceReproducible(const size_t begin, const size_t end, const Term& term)
+		{
+			const size_t count = end - begin;
+			const size_t blocks = (count + ReproducibleBlock - 1) / ReproducibleBlock;
+			if (blocks <= 1)
+			{
+				return ReducePairwise<T>(begin, end, term);
+			}
+			std::vector<T> partials(blocks);
+			ParallelFor(0, blocks, ReproducibleParallelBlocks, [&](const size_t first, const size_t last)
+			{
+				for (size_t b = first; b < last; ++b)
+				{
+					const size_t blockBegin = begin + b * ReproducibleBlock;
+					const size_t blockEnd = blockBegin + ReproducibleBlock < end ? blockBegin + ReproducibleBlock : end;
+					partials[b] = ReducePairwise<T>(blockBegin, blockEnd, term);
+				}
+			});
+			return ReducePairwise<T>(0, blocks, [&](const size_t b) { return partials[b]; });
+		}
+
+		// Sum of term(i) for i in [0, n), accumulated in T.
+		template<typename T, typename Term>
+		T Reduce(const size_t n, const ReductionMode mode, const Term& term)
+		{
+			switch (mode)
+			{
+			case ReductionMode::Naive:
+				return ReduceNaive<T>(0, n, term);
+			case ReductionMode::Pairwise:
+				return ReducePairwise<T>(0, n, term);
+			case ReductionMode::Kahan:
+				return ReduceCompensated<T>(0, n, term);
+			case ReductionMode::Reproducible:
+				return ReduceReproducible<T>(0, n, term);
+			case ReductionMode::Fast:
+			default:
+				return ReduceLanes<T>(0, n, term);
+			}
+		}
+
+		// Compensated dot product (Ogita-Rump-Oishi Dot2): products are split exactly with fma and
+		// both rounding errors are carried in the compensation term.
+		template<typename T, typename U, typename V>
+		T DotCompensated(const U* x, const V* y, const size_t n)
+		{
+			if constexpr (std::is_floating_point<T>::value)
+			{
+				T sum = 0;
+				T compensation = 0;
+				for (size_t i = 0; i < n; ++i)
+				{
+					const T a = static_cast<T>(x[i]);
+					const T b = static_cast<T>(y[i]);
+					const T product = a * b;
+					const T productError = std::fma(a, b, -product);
+					const T next = sum + product;
+					const T z = next - sum;
+					compensation += ((sum - (next - z)) + (product - z)) + productError;
+					sum = next;
+				}
+				return sum + compensation;
+			}
+			else
+			{
+				return ReduceNaive<T>(0, n, [&](const size_t i) { return x[i] * y[i]; });
+			}
+		}
+	} // namespace Detail
+
+	template<typename T>
+	T Sum(const T* data, const size_t n, const ReductionMode mode = GetReductionMode())
+	{
+		return Detail::Reduce<T>(n, mode, [data](const size_t i) { return data[i]; });
+	}
+
+	// Dot product of two contiguous arrays, accumulated in T.
+	template<typename T, typename U, typename V>
+	T Dot(const U* x, const V* y, const size_t n, const ReductionMode mode = GetReductionMode())
+	{
+		if (mode == ReductionMode::Kahan)
+		{
+			return Detail::DotCompensated<T>(x, y, n);
+		}
+		return Detail::Reduce<T>(n, mode, [x, y](const size_t i) { return x[i] * y[i]; });
+	}
+} // namespace LAR
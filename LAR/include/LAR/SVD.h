@@ -0,0 +1,675 @@
+#pragma once
+#include "Matrix.h"
+#include "Vector.h"
+#include "Gemm.h"
+#include "Hessenberg.h"
+#include "Memory.h"
+#include "Parallel.h"
+#include "QR.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace LAR
+{
+	enum class SVDAlgorithm
+	{
+		// Jacobi for small matrices, bidiagonalization otherwise.
+		Auto,
+		// Householder bidiagonalization followed by Golub-Reinsch implicit QR on the bidiagonal.
+		Bidiagonal,
+		// One-sided (Hestenes) Jacobi; column pairs of each round are rotated in parallel. Slower, but
+		// small singular values are computed to high relative accuracy.
+		Jacobi
+	};
+
+	enum class SVDVectors
+	{
+		// Singular values only.
+		None,
+		// U is m x min(m, n) and V is n x min(m, n).
+		Thin,
+		// U is m x m and V is n x n.
+		Full
+	};
+
+	struct SVDOptions
+	{
+		SVDAlgorithm Algorithm = SVDAlgorithm::Auto;
+		SVDVectors Vectors = SVDVectors::Thin;
+		// Sweeps allowed before the Jacobi path gives up.
+		size_t MaxJacobiSweeps = 60;
+	};
+
+	namespace Detail
+	{
+		// Auto picks Jacobi up to this many columns.
+		constexpr size_t SVDJacobiMaximum = 64;
+		// Tall matrices are first reduced to their n x n R factor once m exceeds this ratio (times 3).
+		constexpr size_t SVDQRRatioTimesThree = 5;
+
+		// Golub-Kahan bidiagonalization of the m x n matrix a (m >= n, row stride n) by alternating
+		// Householder reflectors: a = Q B P^T with B upper bidiagonal. d receives the diagonal, e(i)
+		// the superdiagonal entry coupling i-1 and i (e(0) = 0). With ut/vt, the rows of Q^T (n x m)
+		// and P^T (n x n) are formed.
+		template<typename DataType>
+		void Bidiagonalize(DataType* a, const size_t m, const size_t n, DataType* d, DataType* e, DataType* ut, DataType* vt)
+		{
+			std::vector<DataType> tauQ(n), tauP(n);
+			std::vector<DataType> v(std::max(m, n));
+			std::vector<DataType> work(std::max(m, n));
+			e[0] = DataType(0);
+			for (size_t i = 0; i < n; ++i)
+			{
+				tauQ[i] = HouseholderVector(a[i * n + i], a + (i + 1) * n + i, m - i - 1, n);
+				d[i] = a[i * n + i];
+				v[0] = DataType(1);
+				for (size_t r = i + 1; r < m; ++r)
+				{
+					v[r - i] = a[r * n + i];
+				}
+				ApplyHouseholder(v.data(), tauQ[i], m - i, n - i - 1, a + i * n + i + 1, n, work.data());
+				if (i + 1 < n)
+				{
+					tauP[i] = HouseholderVector(a[i * n + i + 1], a + i * n + i + 2, n - i - 2, size_t(1));
+					e[i + 1] = a[i * n + i + 1];
+					v[0] = DataType(1);
+					std::copy(a + i * n + i + 2, a + i * n + n, v.data() + 1);
+					ApplyHouseholderRight(v.data(), tauP[i], m - i - 1, n - i - 1, a + (i + 1) * n + i + 1, n);
+				}
+			}
+
+			if (ut != nullptr)
+			{
+				// Q [I; 0] one reflector at a time from the last, then transposed into rows.
+				Matrix<DataType> q(m, n);
+				std::fill(q.mData, q.mData + m * n, DataType(0));
+				for (size_t i = 0; i < n; ++i)
+				{
+					q.mData[i * n + i] = DataType(1);
+				}
+				for (size_t i = n; i-- > 0;)
+				{
+					v[0] = DataType(1);
+					for (size_t r = i + 1; r < m; ++r)
+					{
+						v[r - i] = a[r * n + i];
+					}
+					ApplyHouseholder(v.data(), tauQ[i], m - i, n - i, q.mData + i * n + i, n, work.data());
+				}
+				for (size_t r = 0; r < m; ++r)
+				{
+					for (size_t c = 0; c < n; ++c)
+					{
+						ut[c * m + r] = q.mData[r * n + c];
+					}
+				}
+			}
+			if (vt != nullptr)
+			{
+				// P = G_0 ... G_{n-2} by the same backward accumulation, transposed in place.
+				std::fill(vt, vt + n * n, DataType(0));
+				for (size_t i = 0; i < n; ++i)
+				{
+					vt[i * n + i] = DataType(1);
+				}
+				for (size_t i = n - 1; i-- > 0;)
+				{
+					v[0] = DataType(1);
+					std::copy(a + i * n + i + 2, a + i * n + n, v.data() + 1);
+					ApplyHouseholder(v.data(), tauP[i], n - i - 1, n - i - 1, vt + (i + 1) * n + i + 1, n, work.data());
+				}
+				for (size_t r = 0; r < n; ++r)
+				{
+					for (size_t c = r + 1; c < n; ++c)
+					{
+						std::swap(vt[r * n + c], vt[c * n + r]);
+					}
+				}
+			}
+		}
+
+		// Rotates rows i and j of the count-column row-major block x: (x_i, x_j) <- (c x_i + s x_j, c x_j - s x_i).
+		template<typename DataType>
+		void RotateRows(DataType* x, const size_t count, const size_t i, const size_t j, const DataType c, const DataType s)
+		{
+			DataType* first = x + i * count;
+			DataType* second = x + j * count;
+			for (size_t k = 0; k < count; ++k)
+			{
+				const DataType a = first[k];
+				const DataType b = second[k];
+				first[k] = a * c + b * s;
+				second[k] = b * c - a * s;
+			}
+		}
+
+		// Golub-Reinsch implicit-shift QR on the upper bidiagonal (d, e), with e(i) coupling i-1 and i.
+		// On exit d holds the (unsorted, non-negative) singular values. The left and right rotations are
+		// applied to the rows of ut (n x m) and vt (n x n) when given.
+		template<typename DataType>
+		void BidiagonalQR(DataType* d, DataType* e, const size_t n, DataType* ut, const size_t m, DataType* vt)
+		{
+			const DataType eps = std::numeric_limits<DataType>::epsilon();
+			DataType norm = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				norm = std::max(norm, std::abs(d[i]) + std::abs(e[i]));
+			}
+			for (size_t k = n; k-- > 0;)
+			{
+				for (size_t iteration = 0;; ++iteration)
+				{
+					// Find l with e(l) negligible; if instead d(l-1) is negligible, e(l) is chased away first.
+					bool cancel = true;
+					size_t l = k;
+					for (;; --l)
+					{
+						if (l == 0 || std::abs(e[l]) <= eps * norm)
+						{
+							cancel = false;
+							break;
+						}
+						if (std::abs(d[l - 1]) <= eps * norm)
+						{
+							break;
+						}
+					}
+					if (cancel)
+					{
+						DataType c = 0, s = 1;
+						for (size_t i = l; i <= k; ++i)
+						{
+							const DataType f = s * e[i];
+							e[i] = c * e[i];
+							if (std::abs(f) <= eps * norm)
+							{
+								break;
+							}
+							const DataType g = d[i];
+							const DataType h = std::hypot(f, g);
+							d[i] = h;
+							c = g / h;
+							s = -f / h;
+							if (ut != nullptr)
+							{
+								RotateRows(ut, m, l - 1, i, c, s);
+							}
+						}
+					}
+					const DataType z = d[k];
+					if (l == k)
+					{
+						if (z < DataType(0))
+						{
+							d[k] = -z;
+							if (vt != nullptr)
+							{
+								for (size_t j = 0; j < n; ++j)
+								{
+									vt[k * n + j] = -vt[k * n + j];
+								}
+							}
+						}
+						break;
+					}
+					if (iteration >= 75)
+					{
+						throw std::runtime_error("Bidiagonal QR iteration did not converge.");
+					}
+
+					// Shift from the trailing 2 x 2 block of B^T B, then one implicit QR sweep.
+					DataType x = d[l];
+					DataType y = d[k - 1];
+					DataType g = e[k - 1];
+					DataType h = e[k];
+					DataType f = ((y - z) * (y + z) + (g - h) * (g + h)) / (DataType(2) * h * y);
+					g = std::hypot(f, DataType(1));
+					f = ((x - z) * (x + z) + h * ((y / (f + std::copysign(g, f))) - h)) / x;
+					DataType c = 1, s = 1;
+					for (size_t j = l; j < k; ++j)
+					{
+						const size_t i = j + 1;
+						g = e[i];
+						y = d[i];
+						h = s * g;
+						g = c * g;
+						DataType r = std::hypot(f, h);
+						e[j] = r;
+						c = f / r;
+						s = h / r;
+						f = x * c + g * s;
+						g = g * c - x * s;
+						h = y * s;
+						y *= c;
+						if (vt != nullptr)
+						{
+							RotateRows(vt, n, j, i, c, s);
+						}
+						r = std::hypot(f, h);
+						d[j] = r;
+						if (r != DataType(0))
+						{
+							c = f / r;
+							s = h / r;
+						}
+						f = c * g + s * y;
+						x = c * y - s * g;
+						if (ut != nullptr)
+						{
+							RotateRows(ut, m, j, i, c, s);
+						}
+					}
+					e[l] = DataType(0);
+					e[k] = f;
+					d[k] = x;
+				}
+			}
+		}
+
+		// One-sided Jacobi on the n rows of g (n x m, the columns of A): pairs of rows are rotated until
+		// all are mutually orthogonal, and the rotations are accumulated into the rows of vt (n x n).
+		// Each sweep is a round-robin tournament, so the n/2 pairs of a round are disjoint and are
+		// processed in parallel. Rows whose norm is negligible next to the largest are left alone and
+		// end up exactly zero: their inner products are rounding noise that no rotation can remove, so
+		// rank-deficient input would otherwise never converge.
+		template<typename DataType>
+		void OneSidedJacobi(DataType* g, const size_t n, const size_t m, DataType* vt, const size_t maxSweeps)
+		{
+			const DataType epsilon = std::numeric_limits<DataType>::epsilon();
+			const DataType tolerance = epsilon * std::sqrt(DataType(m));
+			// Work at unit scale so that the squared norms below neither underflow nor overflow.
+			DataType scale = 0;
+			for (size_t i = 0; i < n * m; ++i)
+			{
+				scale = std::max(scale, std::abs(g[i]));
+			}
+			if (scale == DataType(0))
+			{
+				return;
+			}
+			for (size_t i = 0; i < n * m; ++i)
+			{
+				g[i] /= scale;
+			}
+			const auto squaredNorm = [g, m](const size_t row)
+			{
+				DataType sum = 0;
+				for (size_t i = 0; i < m; ++i)
+				{
+					sum += g[row * m + i] * g[row * m + i];
+				}
+				return sum;
+			};
+
+			const size_t players = n + n % 2;
+			std::vector<size_t> order(players);
+			std::iota(order.begin(), order.end(), size_t(0));
+			const size_t pairs = players / 2;
+			const size_t minPairs = m * n >= (1u << 16) ? std::max<size_t>(1, 4096 / (m + n)) : pairs;
+
+			DataType negligible = 0;
+			for (size_t sweep = 0; sweep < maxSweeps; ++sweep)
+			{
+				DataType largest = 0;
+				for (size_t row = 0; row < n; ++row)
+				{
+					largest = std::max(largest, squaredNorm(row));
+				}
+				negligible = tolerance * tolerance * largest;
+
+				std::atomic<size_t> rotations{ 0 };
+				for (size_t round = 0; round + 1 < players; ++round)
+				{
+					ParallelFor(0, pairs, minPairs, [&](const size_t begin, const size_t end)
+					{
+						size_t local = 0;
+						for (size_t k = begin; k < end; ++k)
+						{
+							size_t p = order[k];
+							size_t q = order[players - 1 - k];
+							if (p >= n || q >= n)
+							{
+								continue;
+							}
+							if (p > q)
+							{
+								std::swap(p, q);
+							}
+							DataType* gp = g + p * m;
+							DataType* gq = g + q * m;
+							DataType alpha = 0, beta = 0, gamma = 0;
+							for (size_t i = 0; i < m; ++i)
+							{
+								alpha += gp[i] * gp[i];
+								beta += gq[i] * gq[i];
+								gamma += gp[i] * gq[i];
+							}
+							if (alpha <= negligible || beta <= negligible || gamma == DataType(0) ||
+								std::abs(gamma) <= tolerance * std::sqrt(alpha * beta))
+							{
+								continue;
+							}
+							const DataType zeta = (beta - alpha) / (DataType(2) * gamma);
+							const DataType t = std::copysign(DataType(1), zeta) / (std::abs(zeta) + std::hypot(DataType(1), zeta));
+							const DataType c = DataType(1) / std::hypot(DataType(1), t);
+							const DataType s = c * t;
+							RotateRows(g, m, p, q, c, -s);
+							if (vt != nullptr)
+							{
+								RotateRows(vt, n, p, q, c, -s);
+							}
+							++local;
+						}
+						rotations += local;
+					});
+					std::rotate(order.begin() + 1, order.end() - 1, order.end());
+				}
+				if (rotations.load() == 0)
+				{
+					for (size_t row = 0; row < n; ++row)
+					{
+						DataType* gr = g + row * m;
+						if (squaredNorm(row) <= negligible)
+						{
+							std::fill(gr, gr + m, DataType(0));
+						}
+						for (size_t i = 0; i < m; ++i)
+						{
+							gr[i] *= scale;
+						}
+					}
+					return;
+				}
+			}
+			throw std::runtime_error("One-sided Jacobi did not converge.");
+		}
+
+		// Replaces the rows of x (count x m) flagged in missing with unit vectors orthogonal to every
+		// other row, by Gram-Schmidt on the coordinate vectors.
+		template<typename DataType>
+		void CompleteOrthonormalRows(DataType* x, const size_t count, const size_t m, const std::vector<bool>& missing)
+		{
+			size_t candidate = 0;
+			for (size_t r = 0; r < count; ++r)
+			{
+				if (!missing[r])
+				{
+					continue;
+				}
+				DataType* row = x + r * m;
+				while (true)
+				{
+					std::fill(row, row + m, DataType(0));
+					row[candidate++ % m] = DataType(1);
+					for (size_t pass = 0; pass < 2; ++pass)
+					{
+						for (size_t o = 0; o < count; ++o)
+						{
+							if (o == r || (missing[o] && o > r))
+							{
+								continue;
+							}
+							const DataType* other = x + o * m;
+							DataType dot = 0;
+							for (size_t i = 0; i < m; ++i)
+							{
+								dot += other[i] * row[i];
+							}
+							for (size_t i = 0; i < m; ++i)
+							{
+								row[i] -= dot * other[i];
+							}
+						}
+					}
+					const DataType norm = Norm2(row, m, size_t(1));
+					if (norm > DataType(0.5))
+					{
+						for (size_t i = 0; i < m; ++i)
+						{
+							row[i] /= norm;
+						}
+						break;
+					}
+				}
+			}
+		}
+	} // namespace Detail
+
+	// Singular value decomposition A = U diag(sigma) V^T with descending sigma. Wide matrices are
+	// handled through A^T. Tall matrices (or any m > n with full U) are first reduced to the R factor
+	// of a blocked Householder QR, so the SVD proper runs on an n x n matrix and U is recovered by
+	// applying Q.
+	template<typename DataType>
+	class LAR_EXPORT SVD
+	{
+		static_assert(std::is_floating_point<DataType>::value, "SVD requires a floating-point element type.");
+
+	public:
+		explicit SVD(const Matrix<DataType>& a, const SVDOptions& options = SVDOptions())
+			: mRows(a.GetRows()), mCols(a.GetCols()), mSingularValues(std::min(a.GetRows(), a.GetCols())), mU(0, 0), mV(0, 0)
+		{
+			const bool transposed = mRows < mCols;
+			const size_t m = transposed ? mCols : mRows;
+			const size_t n = transposed ? mRows : mCols;
+			Matrix<DataType> work = transposed ? a.Transpose() : Matrix<DataType>(a);
+			SVDAlgorithm algorithm = options.Algorithm;
+			if (algorithm == SVDAlgorithm::Auto)
+			{
+				algorithm = n <= Detail::SVDJacobiMaximum ? SVDAlgorithm::Jacobi : SVDAlgorithm::Bidiagonal;
+			}
+			const bool wantVectors = options.Vectors != SVDVectors::None;
+			const bool full = options.Vectors == SVDVectors::Full;
+			if (n == 0)
+			{
+				if (full)
+				{
+					mU = Matrix<DataType>::Identity(mRows);
+					mV = Matrix<DataType>::Identity(mCols);
+				}
+				return;
+			}
+
+			// The n x n (or m x n) matrix the core algorithm sees.
+			const bool useQR = m > n && (full || 3 * m >= Detail::SVDQRRatioTimesThree * n);
+			std::unique_ptr<QR<DataType>> qr;
+			if (useQR)
+			{
+				qr = std::make_unique<QR<DataType>>(work);
+				work = qr->R();
+			}
+			const size_t rows = work.GetRows();
+
+			std::vector<DataType> sigma(n);
+			Matrix<DataType> ut(wantVectors ? n : 0, wantVectors ? rows : 0);
+			Matrix<DataType> vt(wantVectors ? n : 0, wantVectors ? n : 0);
+			if (algorithm == SVDAlgorithm::Jacobi)
+			{
+				Matrix<DataType> g = work.Transpose();
+				if (wantVectors)
+				{
+					std::fill(vt.mData, vt.mData + n * n, DataType(0));
+					for (size_t i = 0; i < n; ++i)
+					{
+						vt.mData[i * n + i] = DataType(1);
+					}
+				}
+				Detail::OneSidedJacobi(g.mData, n, rows, wantVectors ? vt.mData : nullptr, options.MaxJacobiSweeps);
+				std::vector<bool> missing(n, false);
+				for (size_t j = 0; j < n; ++j)
+				{
+					sigma[j] = Detail::Norm2(g.mData + j * rows, rows, size_t(1));
+					if (wantVectors)
+					{
+						missing[j] = sigma[j] == DataType(0);
+						for (size_t i = 0; i < rows && !missing[j]; ++i)
+						{
+							ut.mData[j * rows + i] = g.mData[j * rows + i] / sigma[j];
+						}
+					}
+				}
+				if (wantVectors)
+				{
+					Detail::CompleteOrthonormalRows(ut.mData, n, rows, missing);
+				}
+			}
+			else
+			{
+				std::vector<DataType> e(n);
+				Detail::Bidiagonalize(work.mData, rows, n, sigma.data(), e.data(), wantVectors ? ut.mData : nullptr,
+					wantVectors ? vt.mData : nullptr);
+				Detail::BidiagonalQR(sigma.data(), e.data(), n, wantVectors ? ut.mData : nullptr, rows, wantVectors ? vt.mData : nullptr);
+			}
+
+			std::vector<size_t> order(n);
+			std::iota(order.begin(), order.end(), size_t(0));
+			std::stable_sort(order.begin(), order.end(), [&sigma](const size_t x, const size_t y) { return sigma[x] > sigma[y]; });
+			for (size_t j = 0; j < n; ++j)
+			{
+				mSingularValues[j] = sigma[order[j]];
+			}
+			if (!wantVectors)
+			{
+				return;
+			}
+
+			// Left vectors of the working matrix as columns, padded with the identity for full U.
+			const size_t leftCols = full ? m : n;
+			Matrix<DataType> left(m, leftCols);
+			std::fill(left.mData, left.mData + m * leftCols, DataType(0));
+			for (size_t j = 0; j < n; ++j)
+			{
+				const DataType* source = ut.mData + order[j] * rows;
+				for (size_t i = 0; i < rows; ++i)
+				{
+					left.mData[i * leftCols + j] = source[i];
+				}
+			}
+			for (size_t j = n; j < leftCols; ++j)
+			{
+				left.mData[j * leftCols + j] = DataType(1);
+			}
+			if (useQR)
+			{
+				qr->ApplyQ(left, Op::NoTrans);
+			}
+			Matrix<DataType> right(n, n);
+			for (size_t j = 0; j < n; ++j)
+			{
+				const DataType* source = vt.mData + order[j] * n;
+				for (size_t i = 0; i < n; ++i)
+				{
+					right.mData[i * n + j] = source[i];
+				}
+			}
+			if (transposed)
+			{
+				mU = std::move(right);
+				mV = std::move(left);
+			}
+			else
+			{
+				mU = std::move(left);
+				mV = std::move(right);
+			}
+		}
+
+		const Vector<DataType>& SingularValues() const { return mSingularValues; }
+
+		// Empty when vectors were not requested.
+		const Matrix<DataType>& U() const { return mU; }
+		const Matrix<DataType>& V() const { return mV; }
+
+		// Default tolerance max(m, n) * eps * sigma_max, as in LAPACK and MATLAB.
+		DataType DefaultTolerance() const
+		{
+			const size_t k = mSingularValues.GetSize();
+			return k == 0 ? DataType(0) : std::max(mRows, mCols) * std::numeric_limits<DataType>::epsilon() * mSingularValues[0];
+		}
+
+		size_t Rank(DataType tolerance = DataType(-1)) const
+		{
+			if (tolerance < DataType(0))
+			{
+				tolerance = DefaultTolerance();
+			}
+			size_t rank = 0;
+			while (rank < mSingularValues.GetSize() && mSingularValues[rank] > tolerance)
+			{
+				++rank;
+			}
+			return rank;
+		}
+
+		// sigma_max / sigma_min in the 2-norm; infinite for a singular matrix.
+		DataType ConditionNumber() const
+		{
+			const size_t k = mSingularValues.GetSize();
+			if (k == 0)
+			{
+				return DataType(0);
+			}
+			const DataType smallest = mSingularValues[k - 1];
+			return smallest == DataType(0) ? std::numeric_limits<DataType>::infinity() : mSingularValues[0] / smallest;
+		}
+
+		// Moore-Penrose pseudo-inverse V diag(1 / sigma) U^T over the singular values above tolerance.
+		Matrix<DataType> PseudoInverse(DataType tolerance = DataType(-1)) const
+		{
+			if (mU.GetRows() != mRows || mV.GetRows() != mCols)
+			{
+				throw std::invalid_argument("The pseudo-inverse needs the singular vectors.");
+			}
+			const size_t rank = Rank(tolerance);
+			Matrix<DataType> scaled(mCols, rank);
+			for (size_t i = 0; i < mCols; ++i)
+			{
+				for (size_t j = 0; j < rank; ++j)
+				{
+					scaled.mData[i * rank + j] = mV(i, j) / mSingularValues[j];
+				}
+			}
+			Matrix<DataType> result(mCols, mRows);
+			std::fill(result.mData, result.mData + mCols * mRows, DataType(0));
+			Detail::GemmAccumulate(mCols, mRows, rank, DataType(1), scaled.mData, rank, Op::NoTrans, mU.mData, mU.GetCols(),
+				Op::Trans, result.mData, mRows);
+			return result;
+		}
+
+	private:
+		size_t mRows;
+		size_t mCols;
+		Vector<DataType> mSingularValues;
+		Matrix<DataType> mU;
+		Matrix<DataType> mV;
+	};
+
+	// Numerical rank from the singular values; a negative tolerance selects SVD::DefaultTolerance.
+	template<typename DataType>
+	size_t Rank(const Matrix<DataType>& a, const DataType tolerance = DataType(-1))
+	{
+		SVDOptions options;
+		options.Vectors = SVDVectors::None;
+		return SVD<DataType>(a, options).Rank(tolerance);
+	}
+
+	template<typename DataType>
+	DataType ConditionNumber(const Matrix<DataType>& a)
+	{
+		SVDOptions options;
+		options.Vectors = SVDVectors::None;
+		return SVD<DataType>(a, options).ConditionNumber();
+	}
+
+	template<typename DataType>
+	Matrix<DataType> PseudoInverse(const Matrix<DataType>& a, const DataType tolerance = DataType(-1))
+	{
+		return SVD<DataType>(a).PseudoInverse(tolerance);
+	}
+} // namespace LAR
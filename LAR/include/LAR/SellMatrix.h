@@ -0,0 +1,159 @@
+#pragma once
+#include "SparseMatrix.h"
+#include "SparseKernels.h"
+#include "Vector.h"
+#include "LAR_export.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace LAR
+{
+	// SELL-C-sigma storage (Kreutzer et al.) for SpMV on matrices with irregular row lengths. Rows are
+	// sorted by length inside windows of Sigma rows, grouped into slices of C rows, and each slice is
+	// padded to its longest row and stored column by column. One SpMV step then updates C rows at
+	// once with a single gather of x, which vectorizes across the slice; sorting keeps the padding
+	// small. Built once from a SparseMatrix and applied many times.
+	template<typename DataType>
+	class LAR_EXPORT SellMatrix
+	{
+	public:
+		static constexpr size_t MaxChunkHeight = 64;
+
+		template<SparseFormat Format>
+		explicit SellMatrix(const SparseMatrix<DataType, Format>& a, const size_t chunkHeight = Detail::ReductionLanes,
+			const size_t sortWindow = 256)
+			: mNumRows(a.GetRows()), mNumCols(a.GetCols()), mChunk(chunkHeight), mNonZeros(a.GetNonZeros())
+		{
+			if (chunkHeight == 0 || chunkHeight > MaxChunkHeight)
+			{
+				throw std::invalid_argument("Chunk height must be between 1 and MaxChunkHeight.");
+			}
+			const SparseMatrix<DataType, SparseFormat::CSR> rows(a);
+			const std::vector<size_t>& start = rows.OuterStart();
+			const size_t window = std::max(sortWindow, size_t(1));
+			std::vector<size_t> order(mNumRows);
+			std::iota(order.begin(), order.end(), size_t(0));
+			for (size_t first = 0; first < mNumRows; first += window)
+			{
+				const size_t last = std::min(first + window, mNumRows);
+				std::stable_sort(order.begin() + first, order.begin() + last, [&start](const size_t x, const size_t y)
+				{
+					return start[x + 1] - start[x] > start[y + 1] - start[y];
+				});
+			}
+
+			const size_t slices = (mNumRows + mChunk - 1) / mChunk;
+			mRowOrder.assign(slices * mChunk, NoRow);
+			std::copy(order.begin(), order.end(), mRowOrder.begin());
+			mSliceStart.assign(slices + 1, 0);
+			for (size_t slice = 0; slice < slices; ++slice)
+			{
+				size_t width = 0;
+				for (size_t lane = 0; lane < mChunk; ++lane)
+				{
+					const size_t row = mRowOrder[slice * mChunk + lane];
+					width = row == NoRow ? width : std::max(width, start[row + 1] - start[row]);
+				}
+				mSliceStart[slice + 1] = mSliceStart[slice] + width * mChunk;
+			}
+			mColumns.assign(mSliceStart[slices], 0);
+			mValues.assign(mSliceStart[slices], DataType(0));
+			for (size_t slice = 0; slice < slices; ++slice)
+			{
+				const size_t width = (mSliceStart[slice + 1] - mSliceStart[slice]) / mChunk;
+				for (size_t lane = 0; lane < mChunk; ++lane)
+				{
+					const size_t row = mRowOrder[slice * mChunk + lane];
+					const size_t length = row == NoRow ? 0 : start[row + 1] - start[row];
+					for (size_t k = 0; k < width; ++k)
+					{
+						const size_t target = mSliceStart[slice] + k * mChunk + lane;
+						if (k < length)
+						{
+							mColumns[target] = rows.InnerIndices()[start[row] + k];
+							mValues[target] = rows.Values()[start[row] + k];
+						}
+						else if (length > 0)
+						{
+							// Padding repeats the row's last column with a zero value, so the gather stays in cache.
+							mColumns[target] = rows.InnerIndices()[start[row + 1] - 1];
+						}
+					}
+				}
+			}
+		}
+
+		size_t GetRows() const { return mNumRows; }
+		size_t GetCols() const { return mNumCols; }
+		size_t GetChunkHeight() const { return mChunk; }
+		size_t GetNonZeros() const { return mNonZeros; }
+		// Stored entries including the zero padding of each slice.
+		size_t GetStoredEntries() const { return mValues.size(); }
+
+		// y = A x, slices split across threads.
+		void Apply(const DataType* x, DataType* y) const
+		{
+			const size_t slices = mSliceStart.size() - 1;
+			const size_t work = mValues.size();
+			const size_t minSlices = work < Detail::SparseParallelWork ? slices
+				: std::max<size_t>(1, Detail::SparseParallelWork * slices / work);
+			ParallelFor(0, slices, std::max<size_t>(1, minSlices), [&](const size_t begin, const size_t end)
+			{
+				DataType sums[MaxChunkHeight];
+				for (size_t slice = begin; slice < end; ++slice)
+				{
+					std::fill(sums, sums + mChunk, DataType(0));
+					const size_t* column = mColumns.data() + mSliceStart[slice];
+					const DataType* value = mValues.data() + mSliceStart[slice];
+					const size_t width = (mSliceStart[slice + 1] - mSliceStart[slice]) / mChunk;
+					for (size_t k = 0; k < width; ++k)
+					{
+						for (size_t lane = 0; lane < mChunk; ++lane)
+						{
+							sums[lane] += value[lane] * x[column[lane]];
+						}
+						column += mChunk;
+						value += mChunk;
+					}
+					for (size_t lane = 0; lane < mChunk; ++lane)
+					{
+						const size_t row = mRowOrder[slice * mChunk + lane];
+						if (row != NoRow)
+						{
+							y[row] = sums[lane];
+						}
+					}
+				}
+			});
+		}
+
+		template<bool RowVector>
+		Vector<DataType> operator*(const Vector<DataType, RowVector>& vector) const
+		{
+			if (mNumCols != vector.GetSize())
+			{
+				throw std::invalid_argument("Number of columns in matrix must match size of vector.");
+			}
+			Vector<DataType> result(mNumRows);
+			Apply(vector.Data(), result.Data());
+			return result;
+		}
+
+	private:
+		static constexpr size_t NoRow = size_t(-1);
+
+		size_t mNumRows;
+		size_t mNumCols;
+		size_t mChunk;
+		size_t mNonZeros;
+		// Offset of each slice's first entry; slice s is (mSliceStart[s + 1] - mSliceStart[s]) / C wide.
+		std::vector<size_t> mSliceStart;
+		// Original row of every lane, NoRow for the padding lanes of the last slice.
+		std::vector<size_t> mRowOrder;
+		std::vector<size_t> mColumns;
+		std::vector<DataType> mValues;
+	};
+} // namespace LAR
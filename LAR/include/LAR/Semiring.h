@@ -0,0 +1,56 @@
+#pragma once
+#include <algorithm>
+
+namespace LAR
+{
+	// Semirings for the sparse product: Add combines the products that land on the same entry and
+	// Multiply combines A(i, k) with B(k, j). Entries that are not stored act as the additive
+	// identity, so only stored pairs are ever combined.
+
+	// Ordinary arithmetic.
+	template<typename DataType>
+	struct PlusTimesSemiring
+	{
+		DataType Add(const DataType a, const DataType b) const { return a + b; }
+		DataType Multiply(const DataType a, const DataType b) const { return a * b; }
+	};
+
+	// Tropical (min, +): with edge weights as entries, A * A holds the shortest two-hop paths.
+	// Missing entries stand for infinity.
+	template<typename DataType>
+	struct MinPlusSemiring
+	{
+		DataType Add(const DataType a, const DataType b) const { return std::min(a, b); }
+		DataType Multiply(const DataType a, const DataType b) const { return a + b; }
+	};
+
+	// Boolean (or, and) on 0/1 values: A * A marks every pair joined by a two-hop path.
+	template<typename DataType>
+	struct OrAndSemiring
+	{
+		DataType Add(const DataType a, const DataType b) const
+		{
+			return a != DataType(0) || b != DataType(0) ? DataType(1) : DataType(0);
+		}
+		DataType Multiply(const DataType a, const DataType b) const
+		{
+			return a != DataType(0) && b != DataType(0) ? DataType(1) : DataType(0);
+		}
+	};
+
+	namespace Detail
+	{
+		// The same semiring with the operands of Multiply exchanged, for products computed as
+		// (B^T A^T)^T.
+		template<typename Semiring>
+		struct SwappedSemiring
+		{
+			Semiring Base;
+
+			template<typename DataType>
+			DataType Add(const DataType a, const DataType b) const { return Base.Add(a, b); }
+			template<typename DataType>
+			DataType Multiply(const DataType a, const DataType b) const { return Base.Multiply(b, a); }
+		};
+	} // namespace Detail
+} // namespace LAR
@@ -0,0 +1,939 @@
+#pragma once
+#include "SparseMatrix.h"
+#include "SparseOrdering.h"
+#include "Preconditioners.h"
+#include "Gemm.h"
+#include "Memory.h"
+#include "Parallel.h"
+#include "Vector.h"
+#include "LAR_export.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace LAR
+{
+	namespace Detail
+	{
+		// Block size of the supernode kernels: row panels of the Schur complement update (each stops
+		// at the diagonal, so only the lower trapezoid is computed) and column blocks of the
+		// triangular solves, whose trailing updates go through GEMM.
+		constexpr size_t SupernodeBlock = 64;
+		// Off-diagonal rows per thread in the supernode triangular solves.
+		constexpr size_t SupernodeParallelRows = 256;
+		// Relaxed amalgamation: a supernode merges into its parent when the merged width is at most
+		// SupernodeRelaxWidth[r] and at most SupernodeRelaxZeros[r] of its stored entries are explicit
+		// zeros, for some r. Larger dense blocks trade a little storage for far fewer, faster updates.
+		constexpr size_t SupernodeRelaxWidth[] = { 4, 16, 48 };
+		constexpr double SupernodeRelaxZeros[] = { 0.8, 0.1, 0.05 };
+		// Threshold partial pivoting test of SparseLU: a pivot chosen inside its supernode must be at
+		// least this fraction of every entry below it in its column, i.e. every multiplier in L21 is
+		// bounded by its inverse. Beyond that, growth compounds from one supernode to the next.
+		constexpr double SparseLUPivotThreshold = 0.01;
+
+		// Symbolic factorization of P (A + A^T) P^T: consecutive columns with (nearly) the same
+		// structure below the diagonal are grouped into supernodes, each stored as one dense block
+		// whose rows are the supernode's structure (its own columns first, then the rows below,
+		// ascending).
+		struct SupernodalStructure
+		{
+			size_t Size = 0;
+			// Permutation[new] = old, Inverse[old] = new. Fill-reducing ordering followed by an
+			// elimination tree postorder, so supernodes are contiguous.
+			std::vector<size_t> Permutation;
+			std::vector<size_t> Inverse;
+			// Columns of supernode s are [SuperStart[s], SuperStart[s + 1]).
+			std::vector<size_t> SuperStart;
+			std::vector<size_t> SuperOf;
+			// Rows of supernode s are Rows[RowStart[s] .. RowStart[s + 1]).
+			std::vector<size_t> RowStart;
+			std::vector<size_t> Rows;
+
+			size_t GetSupernodes() const { return SuperStart.size() - 1; }
+			size_t Width(const size_t s) const { return SuperStart[s + 1] - SuperStart[s]; }
+			size_t Height(const size_t s) const { return RowStart[s + 1] - RowStart[s]; }
+
+			// Position of global row `row` within the rows of supernode s.
+			size_t LocalRow(const size_t s, const size_t row) const
+			{
+				return std::lower_bound(Rows.begin() + RowStart[s], Rows.begin() + RowStart[s + 1], row) - Rows.begin() - RowStart[s];
+			}
+		};
+
+		// Elimination tree of the permuted pattern (Liu's algorithm with path compression).
+		inline std::vector<size_t> EliminationTree(const AdjacencyGraph& graph, const std::vector<size_t>& permutation,
+			const std::vector<size_t>& inverse)
+		{
+			constexpr size_t None = size_t(-1);
+			const size_t n = graph.Size;
+			std::vector<size_t> parent(n, None);
+			std::vector<size_t> ancestor(n, None);
+			for (size_t k = 0; k < n; ++k)
+			{
+				const size_t old = permutation[k];
+				for (size_t p = graph.Start[old]; p < graph.Start[old + 1]; ++p)
+				{
+					size_t i = inverse[graph.Adjacent[p]];
+					while (i < k)
+					{
+						const size_t next = ancestor[i];
+						ancestor[i] = k;
+						if (next == None)
+						{
+							parent[i] = k;
+							break;
+						}
+						i = next;
+					}
+				}
+			}
+			return parent;
+		}
+
+		// X = X L^-T for row-major X (rows x w) and lower-triangular L (w x w), both with stride w.
+		template<typename DataType>
+		void SolveLowerTransposedRight(const size_t rows, const size_t w, const DataType* l, DataType* x)
+		{
+			for (size_t jb = 0; jb < w; jb += SupernodeBlock)
+			{
+				const size_t je = std::min(w, jb + SupernodeBlock);
+				for (size_t i = 0; i < rows; ++i)
+				{
+					DataType* xi = x + i * w;
+					for (size_t j = jb; j < je; ++j)
+					{
+						DataType sum = xi[j];
+						for (size_t k = jb; k < j; ++k)
+						{
+							sum -= xi[k] * l[j * w + k];
+						}
+						xi[j] = sum / l[j * w + j];
+					}
+				}
+				if (je < w)
+				{
+					GemmAccumulate(rows, w - je, je - jb, DataType(-1), x + jb, w, Op::NoTrans, l + je * w + jb, w, Op::Trans, x + je, w);
+				}
+			}
+		}
+
+		// X = X U^-1 for row-major X (rows x w) and upper-triangular U (w x w), both with stride w.
+		template<typename DataType>
+		void SolveUpperRight(const size_t rows, const size_t w, const DataType* u, DataType* x)
+		{
+			for (size_t jb = 0; jb < w; jb += SupernodeBlock)
+			{
+				const size_t je = std::min(w, jb + SupernodeBlock);
+				for (size_t i = 0; i < rows; ++i)
+				{
+					DataType* xi = x + i * w;
+					for (size_t j = jb; j < je; ++j)
+					{
+						DataType sum = xi[j];
+						for (size_t k = jb; k < j; ++k)
+						{
+							sum -= xi[k] * u[k * w + j];
+						}
+						xi[j] = sum / u[j * w + j];
+					}
+				}
+				if (je < w)
+				{
+					GemmAccumulate(rows, w - je, je - jb, DataType(-1), x + jb, w, Op::NoTrans, u + jb * w + je, w, Op::NoTrans, x + je, w);
+				}
+			}
+		}
+
+		// Y = L^-1 Y for unit lower-triangular L (w x w, stride w) and row-major Y (w x m).
+		template<typename DataType>
+		void SolveUnitLowerLeft(const size_t w, const size_t m, const DataType* l, DataType* y)
+		{
+			for (size_t ib = 0; ib < w; ib += SupernodeBlock)
+			{
+				const size_t ie = std::min(w, ib + SupernodeBlock);
+				for (size_t i = ib + 1; i < ie; ++i)
+				{
+					DataType* yi = y + i * m;
+					for (size_t k = ib; k < i; ++k)
+					{
+						const DataType lik = l[i * w + k];
+						const DataType* yk = y + k * m;
+						for (size_t c = 0; c < m; ++c)
+						{
+							yi[c] -= lik * yk[c];
+						}
+					}
+				}
+				if (ie < w)
+				{
+					ParallelGemmAccumulate(w - ie, m, ie - ib, DataType(-1), l + ie * w + ib, w, Op::NoTrans, y + ib * m, m, Op::NoTrans, y + ie * m, m);
+				}
+			}
+		}
+
+		inline SupernodalStructure AnalyzeSupernodes(const AdjacencyGraph& graph, const std::vector<size_t>& ordering)
+		{
+			constexpr size_t None = size_t(-1);
+			const size_t n = graph.Size;
+			SupernodalStructure result;
+			result.Size = n;
+			result.Inverse.resize(n);
+			for (size_t k = 0; k < n; ++k)
+			{
+				result.Inverse[ordering[k]] = k;
+			}
+			std::vector<size_t> parent = EliminationTree(graph, ordering, result.Inverse);
+
+			// Postorder the tree (children in increasing order) and fold it into the permutation.
+			std::vector<size_t> childStart(n + 1, 0);
+			for (size_t j = 0; j < n; ++j)
+			{
+				if (parent[j] != None)
+				{
+					++childStart[parent[j] + 1];
+				}
+			}
+			for (size_t j = 0; j < n; ++j)
+			{
+				childStart[j + 1] += childStart[j];
+			}
+			std::vector<size_t> children(childStart[n]);
+			std::vector<size_t> nextChild(childStart.begin(), childStart.end() - 1);
+			for (size_t j = 0; j < n; ++j)
+			{
+				if (parent[j] != None)
+				{
+					children[nextChild[parent[j]]++] = j;
+				}
+			}
+			std::vector<size_t> postorder;
+			postorder.reserve(n);
+			std::vector<std::pair<size_t, size_t>> stack;
+			for (size_t root = 0; root < n; ++root)
+			{
+				if (parent[root] != None)
+				{
+					continue;
+				}
+				stack.emplace_back(root, childStart[root]);
+				while (!stack.empty())
+				{
+					auto& [node, child] = stack.back();
+					if (child < childStart[node + 1])
+					{
+						const size_t next = children[child++];
+						stack.emplace_back(next, childStart[next]);
+					}
+					else
+					{
+						postorder.push_back(node);
+						stack.pop_back();
+					}
+				}
+			}
+			result.Permutation.resize(n);
+			std::vector<size_t> position(n);
+			for (size_t k = 0; k < n; ++k)
+			{
+				result.Permutation[k] = ordering[postorder[k]];
+				position[postorder[k]] = k;
+			}
+			for (size_t k = 0; k < n; ++k)
+			{
+				result.Inverse[result.Permutation[k]] = k;
+			}
+			std::vector<size_t> postParent(n, None);
+			std::vector<size_t> childCount(n, 0);
+			for (size_t j = 0; j < n; ++j)
+			{
+				if (parent[j] != None)
+				{
+					postParent[position[j]] = position[parent[j]];
+					++childCount[position[parent[j]]];
+				}
+			}
+			parent.swap(postParent);
+
+			// Column counts of L: row k of L is the union of the tree paths from its entries up to k.
+			std::vector<size_t> mark(n, None);
+			std::vector<size_t> count(n, 1);
+			const auto rowSubtree = [&](const size_t k, auto&& visit)
+			{
+				mark[k] = k;
+				const size_t old = result.Permutation[k];
+				for (size_t p = graph.Start[old]; p < graph.Start[old + 1]; ++p)
+				{
+					for (size_t j = result.Inverse[graph.Adjacent[p]]; j < k && mark[j] != k; j = parent[j])
+					{
+						mark[j] = k;
+						visit(j);
+					}
+				}
+			};
+			for (size_t k = 0; k < n; ++k)
+			{
+				rowSubtree(k, [&count](const size_t j) { ++count[j]; });
+			}
+
+			// Fundamental supernodes: j joins j - 1 when j is its only child and the structures nest.
+			std::vector<size_t> fundamental;
+			for (size_t j = 0; j < n; ++j)
+			{
+				if (j == 0 || parent[j - 1] != j || childCount[j] != 1 || count[j - 1] != count[j] + 1)
+				{
+					fundamental.push_back(j);
+				}
+			}
+			fundamental.push_back(n);
+
+			// Relaxed supernodes: a run of fundamental ones, each the parent of the previous run's last
+			// column. A run's structure is its own columns followed by the rows of its last member.
+			const auto stored = [](const size_t width, const size_t height) { return width * height - width * (width - 1) / 2; };
+			std::vector<size_t> lastMember;
+			size_t width = 0;
+			size_t exact = 0;
+			for (size_t f = 0; f + 1 < fundamental.size(); ++f)
+			{
+				const size_t first = fundamental[f];
+				const size_t w = fundamental[f + 1] - first;
+				const size_t h = count[first];
+				const size_t mergedWidth = width + w;
+				const size_t mergedHeight = width + h;
+				const size_t mergedExact = exact + stored(w, h);
+				bool merge = f > 0 && parent[first - 1] == first;
+				if (merge)
+				{
+					const double zeros = 1.0 - double(mergedExact) / double(stored(mergedWidth, mergedHeight));
+					merge = false;
+					for (size_t r = 0; r < 3 && !merge; ++r)
+					{
+						merge = mergedWidth <= SupernodeRelaxWidth[r] && zeros <= SupernodeRelaxZeros[r];
+					}
+				}
+				if (merge)
+				{
+					width = mergedWidth;
+					exact = mergedExact;
+					lastMember.back() = f;
+				}
+				else
+				{
+					result.SuperStart.push_back(first);
+					lastMember.push_back(f);
+					width = w;
+					exact = stored(w, h);
+				}
+			}
+			result.SuperStart.push_back(n);
+			const size_t supernodes = result.GetSupernodes();
+			result.SuperOf.resize(n);
+			for (size_t s = 0; s < supernodes; ++s)
+			{
+				std::fill(result.SuperOf.begin() + result.SuperStart[s], result.SuperOf.begin() + result.SuperStart[s + 1], s);
+			}
+
+			// Rows of each fundamental supernode's first column, filled row by row so they come out sorted.
+			const size_t fundamentals = fundamental.size() - 1;
+			std::vector<size_t> fundamentalOf(n);
+			std::vector<size_t> rowStart(fundamentals + 1, 0);
+			for (size_t f = 0; f < fundamentals; ++f)
+			{
+				std::fill(fundamentalOf.begin() + fundamental[f], fundamentalOf.begin() + fundamental[f + 1], f);
+				rowStart[f + 1] = rowStart[f] + count[fundamental[f]];
+			}
+			std::vector<size_t> rows(rowStart[fundamentals]);
+			std::vector<size_t> next(rowStart.begin(), rowStart.end() - 1);
+			std::fill(mark.begin(), mark.end(), None);
+			for (size_t k = 0; k < n; ++k)
+			{
+				const auto add = [&](const size_t j)
+				{
+					const size_t f = fundamentalOf[j];
+					if (fundamental[f] == j)
+					{
+						rows[next[f]++] = k;
+					}
+				};
+				add(k);
+				rowSubtree(k, add);
+			}
+			result.RowStart.assign(supernodes + 1, 0);
+			for (size_t s = 0; s < supernodes; ++s)
+			{
+				const size_t f = lastMember[s];
+				for (size_t j = result.SuperStart[s]; j < fundamental[f]; ++j)
+				{
+					result.Rows.push_back(j);
+				}
+				result.Rows.insert(result.Rows.end(), rows.begin() + rowStart[f], rows.begin() + rowStart[f + 1]);
+				result.RowStart[s + 1] = result.Rows.size();
+			}
+			return result;
+		}
+	} // namespace Detail
+
+	// Shared part of the supernodal factorizations: the symbolic analysis, the pattern it was built
+	// for, and where each stored entry of A lands in the factor storage. Refactoring a matrix with
+	// the same pattern only zeroes the factor, scatters the new values and repeats the numeric phase.
+	template<typename DataType>
+	class LAR_EXPORT SparseFactorizationBase
+	{
+	public:
+		size_t GetSize() const { return mStructure.Size; }
+		size_t GetSupernodes() const { return mStructure.GetSupernodes(); }
+		// Permutation[k] is the original index of the k-th pivot.
+		const std::vector<size_t>& GetPermutation() const { return mStructure.Permutation; }
+
+		// Stored entries of the factor(s), counting the dense supernode blocks in full.
+		size_t GetFactorEntries() const { return mFactor.size(); }
+
+	protected:
+		static constexpr size_t NoEntry = size_t(-1);
+
+		SparseFactorizationBase() = default;
+
+		// Ordering, symbolic factorization, and a copy of the pattern of a.
+		template<SparseFormat Format>
+		void AnalyzePattern(const SparseMatrix<DataType, Format>& a, const SparseOrdering ordering)
+		{
+			const Detail::AdjacencyGraph graph = Detail::SymmetricAdjacency(a);
+			mStructure = Detail::AnalyzeSupernodes(graph, Detail::FillReducingOrdering(graph, ordering));
+			const SparseMatrix<DataType, SparseFormat::CSR> rows(a);
+			mPatternStart = rows.OuterStart();
+			mPatternColumns = rows.InnerIndices();
+		}
+
+		// position(i, j) gives the factor index of permuted entry (i, j), or NoEntry for entries the
+		// factorization ignores.
+		template<typename Position>
+		void BuildAssembly(Position&& position)
+		{
+			mAssembly.resize(mPatternColumns.size());
+			for (size_t r = 0; r < GetSize(); ++r)
+			{
+				for (size_t p = mPatternStart[r]; p < mPatternStart[r + 1]; ++p)
+				{
+					mAssembly[p] = position(mStructure.Inverse[r], mStructure.Inverse[mPatternColumns[p]]);
+				}
+			}
+		}
+
+		// Zeroes the factor storage and scatters the values of a (which must have the analyzed pattern).
+		template<SparseFormat Format>
+		void Assemble(const SparseMatrix<DataType, Format>& a, const size_t factorSize)
+		{
+			const SparseMatrix<DataType, SparseFormat::CSR> rows(a);
+			if (rows.GetRows() != GetSize() || rows.GetCols() != GetSize() || rows.OuterStart() != mPatternStart
+				|| rows.InnerIndices() != mPatternColumns)
+			{
+				throw std::invalid_argument("Matrix pattern differs from the analyzed one.");
+			}
+			mFactor.assign(factorSize, DataType(0));
+			const std::vector<DataType>& values = rows.Values();
+			for (size_t p = 0; p < values.size(); ++p)
+			{
+				if (mAssembly[p] != NoEntry)
+				{
+					mFactor[mAssembly[p]] += values[p];
+				}
+			}
+		}
+
+		void CheckRightHandSide(const size_t size) const
+		{
+			if (size != GetSize())
+			{
+				throw std::invalid_argument("Size of right-hand side must match the matrix.");
+			}
+		}
+
+		// y = P b and x = P^T y around the permuted solve.
+		void Permute(const DataType* b, DataType* y) const
+		{
+			for (size_t k = 0; k < GetSize(); ++k)
+			{
+				y[k] = b[mStructure.Permutation[k]];
+			}
+		}
+
+		void Unpermute(const DataType* y, DataType* x) const
+		{
+			for (size_t k = 0; k < GetSize(); ++k)
+			{
+				x[mStructure.Permutation[k]] = y[k];
+			}
+		}
+
+		// Lower-trapezoid panels of update = -L21 * op(B), both with row stride w. Row panels are
+		// independent and run in parallel; each calls the packed GEMM kernel.
+		static void SchurUpdate(const size_t m, const size_t w, const DataType* l21, const DataType* b, const size_t ldb,
+			const Op opB, DataType* update, const bool lowerOnly)
+		{
+			std::fill(update, update + m * m, DataType(0));
+			const size_t panels = (m + Detail::SupernodeBlock - 1) / Detail::SupernodeBlock;
+			const size_t minPanels = m * m * w >= 8 * Detail::GemmSmallWork ? 1 : panels;
+			ParallelFor(0, panels, minPanels, [&](const size_t begin, const size_t end)
+			{
+				for (size_t panel = begin; panel < end; ++panel)
+				{
+					const size_t r0 = panel * Detail::SupernodeBlock;
+					const size_t rows = std::min(Detail::SupernodeBlock, m - r0);
+					const size_t cols = lowerOnly ? r0 + rows : m;
+					Detail::GemmAccumulate(rows, cols, w, DataType(-1), l21 + r0 * w, w, Op::NoTrans, b, ldb, opB, update + r0 * m, m);
+				}
+			});
+		}
+
+		// relative[row] = position of row within the rows of supernode t.
+		void FillRelative(const size_t t, std::vector<size_t>& relative) const
+		{
+			for (size_t q = mStructure.RowStart[t]; q < mStructure.RowStart[t + 1]; ++q)
+			{
+				relative[mStructure.Rows[q]] = q - mStructure.RowStart[t];
+			}
+		}
+
+		// Offsets of the lower blocks (Height x Width) of every supernode.
+		std::vector<size_t> LowerOffsets() const
+		{
+			std::vector<size_t> offset(GetSupernodes() + 1, 0);
+			for (size_t s = 0; s < GetSupernodes(); ++s)
+			{
+				offset[s + 1] = offset[s] + mStructure.Height(s) * mStructure.Width(s);
+			}
+			return offset;
+		}
+
+		Detail::SupernodalStructure mStructure;
+		std::vector<size_t> mPatternStart;
+		std::vector<size_t> mPatternColumns;
+		std::vector<size_t> mAssembly;
+		std::vector<DataType> mFactor;
+	};
+
+	// Supernodal sparse Cholesky P A P^T = L L^T for symmetric positive definite A. A may store one
+	// triangle or both: only one triangle of A is read (the lower one when any entry lies below the
+	// diagonal, otherwise the upper one). Throws runtime_error when a pivot is not positive.
+	template<typename DataType>
+	class LAR_EXPORT SparseCholesky : public SparseFactorizationBase<DataType>
+	{
+	public:
+		template<SparseFormat Format>
+		explicit SparseCholesky(const SparseMatrix<DataType, Format>& a, const SparseOrdering ordering = SparseOrdering::MinimumDegree)
+		{
+			Analyze(a, ordering);
+			Factorize(a);
+		}
+
+		// Symbolic phase only; the ordering and supernodes depend on the pattern of a, not its values.
+		template<SparseFormat Format>
+		void Analyze(const SparseMatrix<DataType, Format>& a, const SparseOrdering ordering = SparseOrdering::MinimumDegree)
+		{
+			this->AnalyzePattern(a, ordering);
+			mLowerOffset = this->LowerOffsets();
+			bool lower = false;
+			for (size_t r = 0; r < this->GetSize() && !lower; ++r)
+			{
+				lower = this->mPatternStart[r] < this->mPatternStart[r + 1] && this->mPatternColumns[this->mPatternStart[r]] < r;
+			}
+			// Entries of the original triangle that is read land at (max, min) of their permuted
+			// indices; the other triangle is its mirror and is skipped.
+			this->BuildAssembly([this, lower](size_t i, size_t j)
+			{
+				const size_t row = this->mStructure.Permutation[i];
+				const size_t col = this->mStructure.Permutation[j];
+				if (lower ? row < col : row > col)
+				{
+					return Base::NoEntry;
+				}
+				if (i < j)
+				{
+					std::swap(i, j);
+				}
+				const size_t s = this->mStructure.SuperOf[j];
+				return mLowerOffset[s] + this->mStructure.LocalRow(s, i) * this->mStructure.Width(s) + j - this->mStructure.SuperStart[s];
+			});
+		}
+
+		// Numeric phase for a matrix with the analyzed pattern.
+		template<SparseFormat Format>
+		void Factorize(const SparseMatrix<DataType, Format>& a)
+		{
+			this->Assemble(a, mLowerOffset.back());
+			// The many small GEMM calls take their packing buffers from this thread's arena.
+			ScratchScope scratch;
+			const Detail::SupernodalStructure& st = this->mStructure;
+			std::vector<size_t> relative(st.Size);
+			std::vector<DataType> update;
+			for (size_t s = 0; s < st.GetSupernodes(); ++s)
+			{
+				const size_t w = st.Width(s);
+				const size_t height = st.Height(s);
+				const size_t* rows = st.Rows.data() + st.RowStart[s];
+				DataType* block = this->mFactor.data() + mLowerOffset[s];
+
+				// Dense Cholesky of the diagonal block, then L21 = A21 L11^-T.
+				for (size_t j = 0; j < w; ++j)
+				{
+					DataType* rj = block + j * w;
+					DataType d = rj[j];
+					for (size_t k = 0; k < j; ++k)
+					{
+						d -= rj[k] * rj[k];
+					}
+					if (!(d > DataType(0)))
+					{
+						throw std::runtime_error("Matrix is not positive definite.");
+					}
+					rj[j] = std::sqrt(d);
+					for (size_t i = j + 1; i < w; ++i)
+					{
+						DataType* ri = block + i * w;
+						DataType sum = ri[j];
+						for (size_t k = 0; k < j; ++k)
+						{
+							sum -= ri[k] * rj[k];
+						}
+						ri[j] = sum / rj[j];
+					}
+				}
+				ParallelFor(w, height, Detail::SupernodeParallelRows, [&](const size_t begin, const size_t end)
+				{
+					Detail::SolveLowerTransposedRight(end - begin, w, block, block + begin * w);
+				});
+
+				// Schur complement -L21 L21^T, scattered into the supernodes that own its columns.
+				const size_t m = height - w;
+				if (m == 0)
+				{
+					continue;
+				}
+				update.resize(m * m);
+				const DataType* l21 = block + w * w;
+				Base::SchurUpdate(m, w, l21, l21, w, Op::Trans, update.data(), true);
+				for (size_t c = 0; c < m;)
+				{
+					const size_t t = st.SuperOf[rows[w + c]];
+					const size_t tw = st.Width(t);
+					const size_t tFirst = st.SuperStart[t];
+					this->FillRelative(t, relative);
+					DataType* target = this->mFactor.data() + mLowerOffset[t];
+					for (; c < m && st.SuperOf[rows[w + c]] == t; ++c)
+					{
+						const size_t j = rows[w + c] - tFirst;
+						for (size_t r = c; r < m; ++r)
+						{
+							target[relative[rows[w + r]] * tw + j] += update[r * m + c];
+						}
+					}
+				}
+			}
+		}
+
+		// Entries of L: the lower trapezoid of every supernode block, including the explicit zeros that
+		// relaxed supernodes carry.
+		size_t GetFactorNonZeros() const
+		{
+			size_t count = 0;
+			for (size_t s = 0; s < this->GetSupernodes(); ++s)
+			{
+				const size_t w = this->mStructure.Width(s);
+				count += this->mStructure.Height(s) * w - w * (w - 1) / 2;
+			}
+			return count;
+		}
+
+		template<bool RowVector>
+		Vector<DataType> Solve(const Vector<DataType, RowVector>& b) const
+		{
+			this->CheckRightHandSide(b.GetSize());
+			Vector<DataType> x(this->GetSize());
+			Apply(b.Data(), x.Data());
+			return x;
+		}
+
+		// x = A^-1 b on raw arrays; also the operator hook for use as a Krylov preconditioner.
+		void Apply(const DataType* b, DataType* x) const
+		{
+			const Detail::SupernodalStructure& st = this->mStructure;
+			std::vector<DataType> y(st.Size);
+			this->Permute(b, y.data());
+			for (size_t s = 0; s < st.GetSupernodes(); ++s)
+			{
+				const size_t w = st.Width(s);
+				const size_t first = st.SuperStart[s];
+				const size_t* rows = st.Rows.data() + st.RowStart[s];
+				const DataType* block = this->mFactor.data() + mLowerOffset[s];
+				DataType* ys = y.data() + first;
+				for (size_t j = 0; j < w; ++j)
+				{
+					DataType sum = ys[j];
+					for (size_t k = 0; k < j; ++k)
+					{
+						sum -= block[j * w + k] * ys[k];
+					}
+					ys[j] = sum / block[j * w + j];
+				}
+				for (size_t i = w; i < st.Height(s); ++i)
+				{
+					DataType sum = DataType(0);
+					for (size_t j = 0; j < w; ++j)
+					{
+						sum += block[i * w + j] * ys[j];
+					}
+					y[rows[i]] -= sum;
+				}
+			}
+			for (size_t s = st.GetSupernodes(); s-- > 0;)
+			{
+				const size_t w = st.Width(s);
+				const size_t first = st.SuperStart[s];
+				const size_t* rows = st.Rows.data() + st.RowStart[s];
+				const DataType* block = this->mFactor.data() + mLowerOffset[s];
+				DataType* ys = y.data() + first;
+				for (size_t i = w; i < st.Height(s); ++i)
+				{
+					const DataType yi = y[rows[i]];
+					for (size_t j = 0; j < w; ++j)
+					{
+						ys[j] -= block[i * w + j] * yi;
+					}
+				}
+				for (size_t j = w; j-- > 0;)
+				{
+					DataType sum = ys[j];
+					for (size_t i = j + 1; i < w; ++i)
+					{
+						sum -= block[i * w + j] * ys[i];
+					}
+					ys[j] = sum / block[j * w + j];
+				}
+			}
+			this->Unpermute(y.data(), x);
+		}
+
+	private:
+		using Base = SparseFactorizationBase<DataType>;
+
+		std::vector<size_t> mLowerOffset;
+	};
+
+	// Supernodal sparse LU for general square A, factored on the symmetric pattern of A + A^T:
+	// Q P A P^T = L U with partial pivoting confined to the diagonal block of each supernode, which
+	// keeps the symbolic analysis static and reusable. That suits matrices whose diagonal is strong
+	// enough to pivot on locally (FEM, circuit and convection-diffusion matrices). There is no
+	// delayed pivoting, so a matrix that needs a pivot from outside the current supernode is not
+	// supported, even when it is nonsingular: a cyclic shift with a zero or tiny diagonal, for
+	// example. Factorize throws runtime_error when a diagonal block is singular, and when a pivot
+	// falls below SparseLUPivotThreshold of an entry beneath it in its column, instead of returning
+	// factors with unbounded growth.
+	template<typename DataType>
+	class LAR_EXPORT SparseLU : public SparseFactorizationBase<DataType>
+	{
+	public:
+		template<SparseFormat Format>
+		explicit SparseLU(const SparseMatrix<DataType, Format>& a, const SparseOrdering ordering = SparseOrdering::MinimumDegree)
+		{
+			Analyze(a, ordering);
+			Factorize(a);
+		}
+
+		// Symbolic phase only; the ordering and supernodes depend on the pattern of a, not its values.
+		template<SparseFormat Format>
+		void Analyze(const SparseMatrix<DataType, Format>& a, const SparseOrdering ordering = SparseOrdering::MinimumDegree)
+		{
+			this->AnalyzePattern(a, ordering);
+			const Detail::SupernodalStructure& st = this->mStructure;
+			mLowerOffset = this->LowerOffsets();
+			mUpperOffset.assign(st.GetSupernodes() + 1, mLowerOffset.back());
+			for (size_t s = 0; s < st.GetSupernodes(); ++s)
+			{
+				mUpperOffset[s + 1] = mUpperOffset[s] + st.Width(s) * (st.Height(s) - st.Width(s));
+			}
+			mPivots.resize(st.Size);
+			this->BuildAssembly([this, &st](const size_t i, const size_t j)
+			{
+				const size_t s = st.SuperOf[j];
+				if (i >= j || st.SuperOf[i] == s)
+				{
+					return mLowerOffset[s] + st.LocalRow(s, i) * st.Width(s) + j - st.SuperStart[s];
+				}
+				const size_t t = st.SuperOf[i];
+				const size_t tw = st.Width(t);
+				return mUpperOffset[t] + (i - st.SuperStart[t]) * (st.Height(t) - tw) + st.LocalRow(t, j) - tw;
+			});
+		}
+
+		// Numeric phase for a matrix with the analyzed pattern.
+		template<SparseFormat Format>
+		void Factorize(const SparseMatrix<DataType, Format>& a)
+		{
+			this->Assemble(a, mUpperOffset.back());
+			// The many small GEMM calls take their packing buffers from this thread's arena.
+			ScratchScope scratch;
+			const Detail::SupernodalStructure& st = this->mStructure;
+			std::vector<size_t> relative(st.Size);
+			std::vector<DataType> update;
+			for (size_t s = 0; s < st.GetSupernodes(); ++s)
+			{
+				const size_t w = st.Width(s);
+				const size_t height = st.Height(s);
+				const size_t m = height - w;
+				const size_t first = st.SuperStart[s];
+				const size_t* rows = st.Rows.data() + st.RowStart[s];
+				DataType* block = this->mFactor.data() + mLowerOffset[s];
+				DataType* upper = this->mFactor.data() + mUpperOffset[s];
+
+				// LU of the diagonal block; its row interchanges also move the rows of U12.
+				size_t* pivots = mPivots.data() + first;
+				Detail::FactorDenseLU(block, w, pivots);
+				for (size_t k = 0; k < w; ++k)
+				{
+					if (pivots[k] != k)
+					{
+						std::swap_ranges(upper + k * m, upper + (k + 1) * m, upper + pivots[k] * m);
+					}
+				}
+				// U12 = L11^-1 A12 and L21 = A21 U11^-1.
+				Detail::SolveUnitLowerLeft(w, m, block, upper);
+				ParallelFor(w, height, Detail::SupernodeParallelRows, [&](const size_t begin, const size_t end)
+				{
+					Detail::SolveUpperRight(end - begin, w, block, block + begin * w);
+				});
+				if (m == 0)
+				{
+					continue;
+				}
+				const double limit = 1.0 / Detail::SparseLUPivotThreshold;
+				for (size_t p = w * w; p < height * w; ++p)
+				{
+					if (!(std::abs(block[p]) <= limit))
+					{
+						throw std::runtime_error("Pivot too small for its supernode; the matrix needs pivoting across supernodes.");
+					}
+				}
+
+				// Schur complement -L21 U12. Entries on or below the diagonal go to the lower block of the
+				// supernode owning their column, the rest to the upper block of the one owning their row.
+				update.resize(m * m);
+				Base::SchurUpdate(m, w, block + w * w, upper, m, Op::NoTrans, update.data(), false);
+				for (size_t c = 0; c < m;)
+				{
+					const size_t t = st.SuperOf[rows[w + c]];
+					this->FillRelative(t, relative);
+					DataType* target = this->mFactor.data() + mLowerOffset[t];
+					const size_t tw = st.Width(t);
+					const size_t tFirst = st.SuperStart[t];
+					for (; c < m && st.SuperOf[rows[w + c]] == t; ++c)
+					{
+						const size_t j = rows[w + c] - tFirst;
+						for (size_t r = c; r < m; ++r)
+						{
+							target[relative[rows[w + r]] * tw + j] += update[r * m + c];
+						}
+					}
+				}
+				for (size_t r = 0; r < m;)
+				{
+					const size_t t = st.SuperOf[rows[w + r]];
+					this->FillRelative(t, relative);
+					DataType* lower = this->mFactor.data() + mLowerOffset[t];
+					DataType* target = this->mFactor.data() + mUpperOffset[t];
+					const size_t tw = st.Width(t);
+					const size_t tm = st.Height(t) - tw;
+					const size_t tFirst = st.SuperStart[t];
+					for (; r < m && st.SuperOf[rows[w + r]] == t; ++r)
+					{
+						const size_t i = rows[w + r] - tFirst;
+						for (size_t c = r + 1; c < m; ++c)
+						{
+							const size_t local = relative[rows[w + c]];
+							(local < tw ? lower[i * tw + local] : target[i * tm + local - tw]) += update[r * m + c];
+						}
+					}
+				}
+			}
+		}
+
+		template<bool RowVector>
+		Vector<DataType> Solve(const Vector<DataType, RowVector>& b) const
+		{
+			this->CheckRightHandSide(b.GetSize());
+			Vector<DataType> x(this->GetSize());
+			Apply(b.Data(), x.Data());
+			return x;
+		}
+
+		// x = A^-1 b on raw arrays; also the operator hook for use as a Krylov preconditioner.
+		void Apply(const DataType* b, DataType* x) const
+		{
+			const Detail::SupernodalStructure& st = this->mStructure;
+			std::vector<DataType> y(st.Size);
+			this->Permute(b, y.data());
+			for (size_t s = 0; s < st.GetSupernodes(); ++s)
+			{
+				const size_t w = st.Width(s);
+				const size_t first = st.SuperStart[s];
+				const size_t* rows = st.Rows.data() + st.RowStart[s];
+				const DataType* block = this->mFactor.data() + mLowerOffset[s];
+				DataType* ys = y.data() + first;
+				for (size_t k = 0; k < w; ++k)
+				{
+					std::swap(ys[k], ys[mPivots[first + k]]);
+				}
+				for (size_t j = 1; j < w; ++j)
+				{
+					DataType sum = ys[j];
+					for (size_t k = 0; k < j; ++k)
+					{
+						sum -= block[j * w + k] * ys[k];
+					}
+					ys[j] = sum;
+				}
+				for (size_t i = w; i < st.Height(s); ++i)
+				{
+					DataType sum = DataType(0);
+					for (size_t j = 0; j < w; ++j)
+					{
+						sum += block[i * w + j] * ys[j];
+					}
+					y[rows[i]] -= sum;
+				}
+			}
+			for (size_t s = st.GetSupernodes(); s-- > 0;)
+			{
+				const size_t w = st.Width(s);
+				const size_t m = st.Height(s) - w;
+				const size_t first = st.SuperStart[s];
+				const size_t* rows = st.Rows.data() + st.RowStart[s] + w;
+				const DataType* block = this->mFactor.data() + mLowerOffset[s];
+				const DataType* upper = this->mFactor.data() + mUpperOffset[s];
+				DataType* ys = y.data() + first;
+				for (size_t j = w; j-- > 0;)
+				{
+					DataType sum = ys[j];
+					for (size_t c = 0; c < m; ++c)
+					{
+						sum -= upper[j * m + c] * y[rows[c]];
+					}
+					for (size_t k = j + 1; k < w; ++k)
+					{
+						sum -= block[j * w + k] * ys[k];
+					}
+					ys[j] = sum / block[j * w + j];
+				}
+			}
+			this->Unpermute(y.data(), x);
+		}
+
+	private:
+		using Base = SparseFactorizationBase<DataType>;
+
+		std::vector<size_t> mLowerOffset;
+		// U12 blocks (Width x (Height - Width)) follow all lower blocks in the factor storage.
+		std::vector<size_t> mUpperOffset;
+		// Row interchanges inside each diagonal block, local to the supernode.
+		std::vector<size_t> mPivots;
+	};
+} // namespace LAR
@@ -0,0 +1,386 @@
+#pragma once
+#include "SparseMatrix.h"
+#include "Matrix.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace LAR
+{
+	namespace Detail
+	{
+		// Columns inspected per Markowitz pivot search, cheapest counts first (as in MA28/MA48).
+		constexpr size_t MarkowitzSearchColumns = 4;
+
+		// Items bucketed by an integer count in doubly linked lists: O(1) updates and in-order scans.
+		class CountBuckets
+		{
+		public:
+			static constexpr size_t None = size_t(-1);
+
+			CountBuckets(const size_t items, const size_t maxCount)
+				: mHead(maxCount + 1, None), mNext(items, None), mPrevious(items, None), mCount(items, None)
+			{
+			}
+
+			void Insert(const size_t item, const size_t count)
+			{
+				mCount[item] = count;
+				mPrevious[item] = None;
+				mNext[item] = mHead[count];
+				if (mHead[count] != None)
+				{
+					mPrevious[mHead[count]] = item;
+				}
+				mHead[count] = item;
+			}
+
+			void Remove(const size_t item)
+			{
+				if (mCount[item] == None)
+				{
+					return;
+				}
+				(mPrevious[item] != None ? mNext[mPrevious[item]] : mHead[mCount[item]]) = mNext[item];
+				if (mNext[item] != None)
+				{
+					mPrevious[mNext[item]] = mPrevious[item];
+				}
+				mCount[item] = None;
+			}
+
+			void Update(const size_t item, const size_t count)
+			{
+				Remove(item);
+				Insert(item, count);
+			}
+
+			size_t GetMaxCount() const { return mHead.size() - 1; }
+			size_t Head(const size_t count) const { return mHead[count]; }
+			size_t Next(const size_t item) const { return mNext[item]; }
+
+		private:
+			std::vector<size_t> mHead;
+			std::vector<size_t> mNext;
+			std::vector<size_t> mPrevious;
+			std::vector<size_t> mCount;
+		};
+
+		// Sparse row stored as (column, value) pairs in increasing column order.
+		template<typename DataType>
+		using EliminationRow = std::vector<std::pair<size_t, DataType>>;
+
+		// Value of column col in row, or nullptr when it is not stored.
+		template<typename DataType>
+		const DataType* FindEntry(const EliminationRow<DataType>& row, const size_t col)
+		{
+			const auto it = std::lower_bound(row.begin(), row.end(), col, [](const auto& entry, const size_t c) { return entry.first < c; });
+			return it != row.end() && it->first == col ? &it->second : nullptr;
+		}
+
+		// target -= factor * source, dropping exact zeros. onFill(col) and onCancel(col) report columns
+		// that enter or leave target, so callers can keep their column structures current.
+		template<typename DataType, typename OnFill, typename OnCancel>
+		void SubtractRow(EliminationRow<DataType>& target, const EliminationRow<DataType>& source, const DataType& factor,
+			EliminationRow<DataType>& scratch, OnFill&& onFill, OnCancel&& onCancel)
+		{
+			scratch.clear();
+			scratch.reserve(target.size() + source.size());
+			size_t p = 0;
+			size_t q = 0;
+			while (p < target.size() || q < source.size())
+			{
+				const size_t a = p < target.size() ? target[p].first : size_t(-1);
+				const size_t b = q < source.size() ? source[q].first : size_t(-1);
+				if (a < b)
+				{
+					scratch.push_back(target[p++]);
+				}
+				else if (b < a)
+				{
+					scratch.emplace_back(b, -(factor * source[q++].second));
+					onFill(b);
+				}
+				else
+				{
+					const DataType value = target[p++].second - factor * source[q++].second;
+					if (value == DataType(0))
+					{
+						onCancel(a);
+					}
+					else
+					{
+						scratch.emplace_back(a, value);
+					}
+				}
+			}
+			target.swap(scratch);
+		}
+
+		template<typename DataType>
+		void ScaleRow(EliminationRow<DataType>& row, const DataType& scale)
+		{
+			for (auto& entry : row)
+			{
+				entry.second *= scale;
+			}
+		}
+
+		// Gaussian elimination over exact arithmetic with Markowitz pivoting: each step takes the
+		// stored entry minimizing (r_i - 1)(c_j - 1) among the sparsest few columns, eliminates its
+		// column from the active rows, and retires its row (scaled to a unit pivot) into the basis.
+		// Only stored entries are ever touched and exact cancellations are dropped. Returns the
+		// basis rows, each with its pivot column; their count is the rank.
+		template<typename DataType>
+		std::vector<std::pair<size_t, EliminationRow<DataType>>> MarkowitzEliminate(std::vector<EliminationRow<DataType>>& rows,
+			const size_t cols)
+		{
+			const size_t m = rows.size();
+			std::vector<std::vector<size_t>> columnRows(cols);
+			std::vector<size_t> columnCount(cols, 0);
+			for (size_t i = 0; i < m; ++i)
+			{
+				for (const auto& entry : rows[i])
+				{
+					columnRows[entry.first].push_back(i);
+					++columnCount[entry.first];
+				}
+			}
+			CountBuckets buckets(cols, m);
+			size_t minCount = m;
+			for (size_t j = 0; j < cols; ++j)
+			{
+				if (columnCount[j] > 0)
+				{
+					buckets.Insert(j, columnCount[j]);
+					minCount = std::min(minCount, columnCount[j]);
+				}
+			}
+			const auto setCount = [&](const size_t j, const size_t count)
+			{
+				columnCount[j] = count;
+				if (count == 0)
+				{
+					buckets.Remove(j);
+				}
+				else
+				{
+					buckets.Update(j, count);
+					minCount = std::min(minCount, count);
+				}
+			};
+
+			std::vector<char> active(m, 1);
+			std::vector<std::pair<size_t, EliminationRow<DataType>>> basis;
+			EliminationRow<DataType> scratch;
+			while (true)
+			{
+				// Markowitz search over the sparsest columns; column lists are cleaned as they are read.
+				size_t bestRow = CountBuckets::None;
+				size_t bestCol = CountBuckets::None;
+				size_t bestCost = size_t(-1);
+				size_t examined = 0;
+				while (minCount <= m && buckets.Head(minCount) == CountBuckets::None)
+				{
+					++minCount;
+				}
+				for (size_t count = minCount; count <= m && examined < MarkowitzSearchColumns && bestCost > 0; ++count)
+				{
+					for (size_t j = buckets.Head(count); j != CountBuckets::None && examined < MarkowitzSearchColumns && bestCost > 0;
+						j = buckets.Next(j))
+					{
+						++examined;
+						std::vector<size_t>& list = columnRows[j];
+						list.erase(std::remove_if(list.begin(), list.end(),
+							[&](const size_t i) { return !active[i] || FindEntry(rows[i], j) == nullptr; }), list.end());
+						for (const size_t i : list)
+						{
+							const size_t cost = (rows[i].size() - 1) * (count - 1);
+							if (cost < bestCost)
+							{
+								bestCost = cost;
+								bestRow = i;
+								bestCol = j;
+							}
+						}
+					}
+				}
+				if (bestRow == CountBuckets::None)
+				{
+					break;
+				}
+
+				// Unit pivot, then the row leaves the active submatrix.
+				EliminationRow<DataType>& pivot = rows[bestRow];
+				ScaleRow(pivot, DataType(1) / *FindEntry(pivot, bestCol));
+				active[bestRow] = 0;
+				for (const auto& entry : pivot)
+				{
+					setCount(entry.first, columnCount[entry.first] - 1);
+				}
+				std::vector<size_t> targets;
+				targets.swap(columnRows[bestCol]);
+				for (const size_t i : targets)
+				{
+					const DataType* factor = active[i] ? FindEntry(rows[i], bestCol) : nullptr;
+					if (factor == nullptr)
+					{
+						continue;
+					}
+					const DataType f = *factor;
+					SubtractRow(rows[i], pivot, f, scratch,
+						[&](const size_t j)
+						{
+							columnRows[j].push_back(i);
+							setCount(j, columnCount[j] + 1);
+						},
+						[&](const size_t j) { setCount(j, columnCount[j] - 1); });
+				}
+				buckets.Remove(bestCol);
+				basis.emplace_back(bestCol, std::move(pivot));
+			}
+			return basis;
+		}
+
+		// Reduced row echelon form of the span of independent rows (pivot column, row). Back
+		// substitution first clears every basis row of the later pivot columns; a Gauss-Jordan pass in
+		// column order then moves the pivots to the leftmost independent columns, which is where the
+		// (unique) RREF has them. When Markowitz already picked those columns that pass only scales.
+		template<typename DataType>
+		std::vector<EliminationRow<DataType>> ReduceBasis(std::vector<std::pair<size_t, EliminationRow<DataType>>>& basis,
+			const size_t cols)
+		{
+			const size_t rank = basis.size();
+			std::vector<size_t> pivotOf(cols, CountBuckets::None);
+			for (size_t k = 0; k < rank; ++k)
+			{
+				pivotOf[basis[k].first] = k;
+			}
+			EliminationRow<DataType> scratch;
+			const auto ignore = [](const size_t) {};
+			for (size_t k = rank; k-- > 0;)
+			{
+				std::vector<std::pair<size_t, DataType>> later;
+				for (const auto& entry : basis[k].second)
+				{
+					if (pivotOf[entry.first] != CountBuckets::None && pivotOf[entry.first] > k)
+					{
+						later.emplace_back(pivotOf[entry.first], entry.second);
+					}
+				}
+				for (const auto& [l, factor] : later)
+				{
+					SubtractRow(basis[k].second, basis[l].second, factor, scratch, ignore, ignore);
+				}
+			}
+
+			std::vector<std::vector<size_t>> columnRows(cols);
+			for (size_t k = 0; k < rank; ++k)
+			{
+				for (const auto& entry : basis[k].second)
+				{
+					columnRows[entry.first].push_back(k);
+				}
+			}
+			std::vector<char> used(rank, 0);
+			std::vector<EliminationRow<DataType>> result;
+			result.reserve(rank);
+			std::vector<size_t> order;
+			for (size_t j = 0; j < cols && order.size() < rank; ++j)
+			{
+				std::vector<size_t>& list = columnRows[j];
+				list.erase(std::remove_if(list.begin(), list.end(), [&](const size_t k) { return FindEntry(basis[k].second, j) == nullptr; }),
+					list.end());
+				size_t pivot = CountBuckets::None;
+				for (const size_t k : list)
+				{
+					if (!used[k] && (pivot == CountBuckets::None || basis[k].second.size() < basis[pivot].second.size()))
+					{
+						pivot = k;
+					}
+				}
+				if (pivot == CountBuckets::None)
+				{
+					continue;
+				}
+				used[pivot] = 1;
+				order.push_back(pivot);
+				EliminationRow<DataType>& row = basis[pivot].second;
+				ScaleRow(row, DataType(1) / *FindEntry(row, j));
+				for (const size_t k : std::vector<size_t>(list))
+				{
+					if (k == pivot)
+					{
+						continue;
+					}
+					const DataType factor = *FindEntry(basis[k].second, j);
+					SubtractRow(basis[k].second, row, factor, scratch, [&](const size_t c) { columnRows[c].push_back(k); }, ignore);
+				}
+				list.assign(1, pivot);
+			}
+			for (const size_t k : order)
+			{
+				result.push_back(std::move(basis[k].second));
+			}
+			return result;
+		}
+
+		template<typename DataType, SparseFormat Format>
+		std::vector<EliminationRow<DataType>> LoadRows(const SparseMatrix<DataType, Format>& a)
+		{
+			std::vector<EliminationRow<DataType>> rows(a.GetRows());
+			const SparseMatrix<DataType, SparseFormat::CSR> csr(a);
+			for (size_t i = 0; i < a.GetRows(); ++i)
+			{
+				for (size_t p = csr.OuterStart()[i]; p < csr.OuterStart()[i + 1]; ++p)
+				{
+					if (csr.Values()[p] != DataType(0))
+					{
+						rows[i].emplace_back(csr.InnerIndices()[p], csr.Values()[p]);
+					}
+				}
+			}
+			return rows;
+		}
+	} // namespace Detail
+
+	// Rank by sparse elimination with exact zero tests; meant for exact types such as Rational.
+	template<typename DataType, SparseFormat Format>
+	size_t Rank(const SparseMatrix<DataType, Format>& a)
+	{
+		std::vector<Detail::EliminationRow<DataType>> rows = Detail::LoadRows(a);
+		return Detail::MarkowitzEliminate(rows, a.GetCols()).size();
+	}
+
+	// Reduced row echelon form by sparse elimination with Markowitz pivoting; identical to
+	// Matrix::RowEchelonForm for exact types (nonzero rows first, zero rows last).
+	template<typename DataType, SparseFormat Format>
+	SparseMatrix<DataType> RowEchelonForm(const SparseMatrix<DataType, Format>& a)
+	{
+		std::vector<Detail::EliminationRow<DataType>> rows = Detail::LoadRows(a);
+		std::vector<std::pair<size_t, Detail::EliminationRow<DataType>>> basis = Detail::MarkowitzEliminate(rows, a.GetCols());
+		const std::vector<Detail::EliminationRow<DataType>> reduced = Detail::ReduceBasis(basis, a.GetCols());
+		std::vector<size_t> start(a.GetRows() + 1, 0);
+		std::vector<size_t> columns;
+		std::vector<DataType> values;
+		for (size_t i = 0; i < reduced.size(); ++i)
+		{
+			for (const auto& entry : reduced[i])
+			{
+				columns.push_back(entry.first);
+				values.push_back(entry.second);
+			}
+			start[i + 1] = columns.size();
+		}
+		std::fill(start.begin() + reduced.size() + 1, start.end(), columns.size());
+		return SparseMatrix<DataType>(a.GetRows(), a.GetCols(), std::move(start), std::move(columns), std::move(values));
+	}
+
+	// Matrix::RowEchelonForm computed through the sparse path, for dense-stored inputs that are
+	// mostly zeros.
+	template<typename DataType>
+	Matrix<DataType> SparseRowEchelonForm(const Matrix<DataType>& a)
+	{
+		return RowEchelonForm(SparseMatrix<DataType>(a)).ToDense();
+	}
+} // namespace LAR
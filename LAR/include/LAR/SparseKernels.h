@@ -0,0 +1,412 @@
+#pragma once
+#include "Parallel.h"
+#include "Reduction.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace LAR
+{
+	namespace Detail
+	{
+		// Below this many stored entries a sparse kernel runs on the calling thread.
+		constexpr size_t SparseParallelWork = 1 << 15;
+		// Partitions per thread; a few more than one absorbs uneven per-row cost.
+		constexpr size_t SparsePartitionsPerThread = 4;
+		// Rows at least this long are summed with independent lane accumulators (vectorized gathers);
+		// shorter rows are cheaper with a single accumulator.
+		constexpr size_t SparseLaneRowLength = 2 * ReductionLanes;
+		// SpGEMM rows accumulate in a dense array when the output has at most this many columns, or
+		// when a row's products cover at least 1 / SpGemmDenseRatio of them; otherwise in a hash table.
+		constexpr size_t SpGemmDenseColumns = 1 << 14;
+		constexpr size_t SpGemmDenseRatio = 16;
+
+		// Splits rows [0, rows) into `parts` contiguous ranges holding about the same number of
+		// stored entries plus rows (so empty rows still cost something). bounds gets parts + 1 entries.
+		inline void BalancedRowPartition(const std::vector<size_t>& rowStart, const size_t rows, const size_t parts,
+			std::vector<size_t>& bounds)
+		{
+			bounds.assign(parts + 1, rows);
+			bounds[0] = 0;
+			const size_t total = rowStart[rows] + rows;
+			for (size_t part = 1; part < parts; ++part)
+			{
+				const size_t target = total * part / parts;
+				// First row r with rowStart[r] + r >= target.
+				size_t low = bounds[part - 1];
+				size_t high = rows;
+				while (low < high)
+				{
+					const size_t middle = low + (high - low) / 2;
+					if (rowStart[middle] + middle < target)
+					{
+						low = middle + 1;
+					}
+					else
+					{
+						high = middle;
+					}
+				}
+				bounds[part] = low;
+			}
+		}
+
+		// Runs body(rowBegin, rowEnd) over nonzero-balanced row ranges, in parallel when the matrix is
+		// large enough.
+		template<typename Body>
+		void ForBalancedRows(const std::vector<size_t>& rowStart, const size_t rows, const size_t work, Body&& body)
+		{
+			const size_t threads = GetMaxThreads();
+			if (threads <= 1 || work < SparseParallelWork || rows < 2)
+			{
+				body(size_t(0), rows);
+				return;
+			}
+			const size_t parts = std::min(rows, threads * SparsePartitionsPerThread);
+			std::vector<size_t> bounds;
+			BalancedRowPartition(rowStart, rows, parts, bounds);
+			ParallelFor(0, parts, 1, [&](const size_t begin, const size_t end)
+			{
+				for (size_t part = begin; part < end; ++part)
+				{
+					body(bounds[part], bounds[part + 1]);
+				}
+			});
+		}
+
+		// y = A x for CSR arrays.
+		template<typename DataType>
+		void CsrSpMV(const size_t rows, const std::vector<size_t>& rowStart, const std::vector<size_t>& columns,
+			const std::vector<DataType>& values, const DataType* x, DataType* y)
+		{
+			const size_t* column = columns.data();
+			const DataType* value = values.data();
+			ForBalancedRows(rowStart, rows, values.size(), [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					const size_t first = rowStart[i];
+					const size_t last = rowStart[i + 1];
+					if (last - first >= SparseLaneRowLength)
+					{
+						y[i] = ReduceLanes<DataType>(first, last, [column, value, x](const size_t p) { return value[p] * x[column[p]]; });
+					}
+					else
+					{
+						DataType sum = DataType(0);
+						for (size_t p = first; p < last; ++p)
+						{
+							sum += value[p] * x[column[p]];
+						}
+						y[i] = sum;
+					}
+				}
+			});
+		}
+
+		// C = A B for CSR A and a dense row-major B with k columns (ldb, ldc strides). Each stored entry
+		// is loaded once and applied to a whole row of B, so index traffic is amortized over k.
+		template<typename DataType>
+		void CsrSpMM(const size_t rows, const std::vector<size_t>& rowStart, const std::vector<size_t>& columns,
+			const std::vector<DataType>& values, const size_t k, const DataType* b, const size_t ldb, DataType* c, const size_t ldc)
+		{
+			ForBalancedRows(rowStart, rows, values.size() * k, [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					DataType* out = c + i * ldc;
+					std::fill(out, out + k, DataType(0));
+					for (size_t p = rowStart[i]; p < rowStart[i + 1]; ++p)
+					{
+						const DataType a = values[p];
+						const DataType* in = b + columns[p] * ldb;
+						for (size_t j = 0; j < k; ++j)
+						{
+							out[j] += a * in[j];
+						}
+					}
+				}
+			});
+		}
+
+		// C = D B for a dense row-major D (m rows, stride ldd) and CSR B with n columns. Dense rows
+		// are the outer loop: row r of C is the sum of B's rows weighted by row r of D, scattered into
+		// the contiguous output row, so D is read once and C written in cache.
+		template<typename DataType>
+		void DenseCsrMM(const size_t m, const size_t inner, const DataType* d, const size_t ldd, const std::vector<size_t>& rowStart,
+			const std::vector<size_t>& columns, const std::vector<DataType>& values, const size_t n, DataType* c, const size_t ldc)
+		{
+			const size_t perRow = std::max<size_t>(1, values.size());
+			ParallelFor(0, m, std::max<size_t>(1, SparseParallelWork / perRow), [&](const size_t begin, const size_t end)
+			{
+				for (size_t r = begin; r < end; ++r)
+				{
+					DataType* out = c + r * ldc;
+					std::fill(out, out + n, DataType(0));
+					const DataType* in = d + r * ldd;
+					for (size_t i = 0; i < inner; ++i)
+					{
+						const DataType a = in[i];
+						if (a == DataType(0))
+						{
+							continue;
+						}
+						for (size_t p = rowStart[i]; p < rowStart[i + 1]; ++p)
+						{
+							out[columns[p]] += a * values[p];
+						}
+					}
+				}
+			});
+		}
+
+		// C = D B as above for CSC B: each entry of a dense row of C is a gather-dot of the row of D
+		// (kept in cache) with one stored column of B.
+		template<typename DataType>
+		void DenseCscMM(const size_t m, const DataType* d, const size_t ldd, const std::vector<size_t>& colStart,
+			const std::vector<size_t>& rows, const std::vector<DataType>& values, const size_t n, DataType* c, const size_t ldc)
+		{
+			const size_t perRow = std::max<size_t>(1, values.size());
+			ParallelFor(0, m, std::max<size_t>(1, SparseParallelWork / perRow), [&](const size_t begin, const size_t end)
+			{
+				for (size_t r = begin; r < end; ++r)
+				{
+					DataType* out = c + r * ldc;
+					const DataType* in = d + r * ldd;
+					for (size_t j = 0; j < n; ++j)
+					{
+						DataType sum = DataType(0);
+						for (size_t p = colStart[j]; p < colStart[j + 1]; ++p)
+						{
+							sum += in[rows[p]] * values[p];
+						}
+						out[j] = sum;
+					}
+				}
+			});
+		}
+
+		// Gustavson row accumulator, one per thread: a dense array indexed by column (entries told
+		// apart by a per-row stamp, so it is never cleared), or an open-addressing hash table sized to
+		// the row's product count, which stays in cache when the output is wide.
+		template<typename DataType>
+		class SpGemmAccumulator
+		{
+		public:
+			explicit SpGemmAccumulator(const size_t cols)
+				: mCols(cols)
+			{
+			}
+
+			// Starts a row with at most `products` partial products.
+			void Begin(const size_t products)
+			{
+				mDense = mCols <= SpGemmDenseColumns || products * SpGemmDenseRatio >= mCols;
+				mTouched.clear();
+				if (mDense)
+				{
+					if (mMark.empty())
+					{
+						mMark.assign(mCols, NoEntry);
+						mDenseValues.resize(mCols);
+					}
+					++mStamp;
+				}
+				else
+				{
+					size_t size = 16;
+					mShift = 60;
+					while (size < 2 * products)
+					{
+						size *= 2;
+						--mShift;
+					}
+					mKeys.assign(size, NoEntry);
+					mHashValues.resize(size);
+					mMask = size - 1;
+				}
+			}
+
+			// Records that column col occurs in the row (symbolic phase).
+			void Insert(const size_t col)
+			{
+				if (mDense)
+				{
+					if (mMark[col] != mStamp)
+					{
+						mMark[col] = mStamp;
+						mTouched.push_back(col);
+					}
+				}
+				else
+				{
+					const size_t slot = Find(col);
+					if (mKeys[slot] == NoEntry)
+					{
+						mKeys[slot] = col;
+						mTouched.push_back(slot);
+					}
+				}
+			}
+
+			// Adds value to column col of the row (numeric phase).
+			template<typename Semiring>
+			void Accumulate(const size_t col, const DataType value, const Semiring& semiring)
+			{
+				if (mDense)
+				{
+					if (mMark[col] != mStamp)
+					{
+						mMark[col] = mStamp;
+						mDenseValues[col] = value;
+						mTouched.push_back(col);
+					}
+					else
+					{
+						mDenseValues[col] = semiring.Add(mDenseValues[col], value);
+					}
+				}
+				else
+				{
+					const size_t slot = Find(col);
+					if (mKeys[slot] == NoEntry)
+					{
+						mKeys[slot] = col;
+						mHashValues[slot] = value;
+						mTouched.push_back(slot);
+					}
+					else
+					{
+						mHashValues[slot] = semiring.Add(mHashValues[slot], value);
+					}
+				}
+			}
+
+			size_t GetSize() const { return mTouched.size(); }
+
+			// Writes the row's columns in increasing order, with their values.
+			void Extract(size_t* columns, DataType* values)
+			{
+				if (mDense)
+				{
+					std::sort(mTouched.begin(), mTouched.end());
+					for (size_t i = 0; i < mTouched.size(); ++i)
+					{
+						columns[i] = mTouched[i];
+						values[i] = mDenseValues[mTouched[i]];
+					}
+				}
+				else
+				{
+					mEntries.clear();
+					for (const size_t slot : mTouched)
+					{
+						mEntries.emplace_back(mKeys[slot], mHashValues[slot]);
+					}
+					std::sort(mEntries.begin(), mEntries.end(), [](const auto& x, const auto& y) { return x.first < y.first; });
+					for (size_t i = 0; i < mEntries.size(); ++i)
+					{
+						columns[i] = mEntries[i].first;
+						values[i] = mEntries[i].second;
+					}
+				}
+			}
+
+		private:
+			static constexpr size_t NoEntry = size_t(-1);
+
+			// Linear probing from a multiplicative (Fibonacci) hash; the table is at least half empty. The
+			// slot comes from the high bits of the product, which depend on every bit of col, so strided
+			// columns still spread across the table.
+			size_t Find(const size_t col) const
+			{
+				size_t slot = size_t((std::uint64_t(col) * 0x9E3779B97F4A7C15ull) >> mShift);
+				while (mKeys[slot] != NoEntry && mKeys[slot] != col)
+				{
+					slot = (slot + 1) & mMask;
+				}
+				return slot;
+			}
+
+			size_t mCols;
+			bool mDense = true;
+			size_t mStamp = 0;
+			size_t mMask = 0;
+			// 64 - log2 of the hash table size.
+			unsigned mShift = 60;
+			std::vector<size_t> mMark;
+			std::vector<DataType> mDenseValues;
+			std::vector<size_t> mKeys;
+			std::vector<DataType> mHashValues;
+			std::vector<size_t> mTouched;
+			std::vector<std::pair<size_t, DataType>> mEntries;
+		};
+
+		// C = A B for CSR arrays over a semiring (Gustavson). A symbolic pass counts the entries of
+		// every row of C, so the numeric pass writes each row in place and the two can run in
+		// parallel over row ranges balanced by partial-product count.
+		template<typename DataType, typename Semiring>
+		void CsrSpGemm(const size_t rows, const size_t cols, const std::vector<size_t>& aStart,
+			const std::vector<size_t>& aColumns, const std::vector<DataType>& aValues, const std::vector<size_t>& bStart,
+			const std::vector<size_t>& bColumns, const std::vector<DataType>& bValues, const Semiring& semiring,
+			std::vector<size_t>& cStart, std::vector<size_t>& cColumns, std::vector<DataType>& cValues)
+		{
+			std::vector<size_t> products(rows + 1, 0);
+			for (size_t i = 0; i < rows; ++i)
+			{
+				size_t count = 0;
+				for (size_t p = aStart[i]; p < aStart[i + 1]; ++p)
+				{
+					count += bStart[aColumns[p] + 1] - bStart[aColumns[p]];
+				}
+				products[i + 1] = products[i] + count;
+			}
+
+			cStart.assign(rows + 1, 0);
+			ForBalancedRows(products, rows, products[rows], [&](const size_t begin, const size_t end)
+			{
+				SpGemmAccumulator<DataType> accumulator(cols);
+				for (size_t i = begin; i < end; ++i)
+				{
+					accumulator.Begin(products[i + 1] - products[i]);
+					for (size_t p = aStart[i]; p < aStart[i + 1]; ++p)
+					{
+						const size_t k = aColumns[p];
+						for (size_t q = bStart[k]; q < bStart[k + 1]; ++q)
+						{
+							accumulator.Insert(bColumns[q]);
+						}
+					}
+					cStart[i + 1] = accumulator.GetSize();
+				}
+			});
+			for (size_t i = 0; i < rows; ++i)
+			{
+				cStart[i + 1] += cStart[i];
+			}
+
+			cColumns.resize(cStart[rows]);
+			cValues.resize(cStart[rows]);
+			ForBalancedRows(products, rows, products[rows], [&](const size_t begin, const size_t end)
+			{
+				SpGemmAccumulator<DataType> accumulator(cols);
+				for (size_t i = begin; i < end; ++i)
+				{
+					accumulator.Begin(products[i + 1] - products[i]);
+					for (size_t p = aStart[i]; p < aStart[i + 1]; ++p)
+					{
+						const DataType a = aValues[p];
+						const size_t k = aColumns[p];
+						for (size_t q = bStart[k]; q < bStart[k + 1]; ++q)
+						{
+							accumulator.Accumulate(bColumns[q], semiring.Multiply(a, bValues[q]), semiring);
+						}
+					}
+					accumulator.Extract(cColumns.data() + cStart[i], cValues.data() + cStart[i]);
+				}
+			});
+		}
+	} // namespace Detail
+} // namespace LAR
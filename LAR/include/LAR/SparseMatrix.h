@@ -0,0 +1,628 @@
+#pragma once
+#include "Matrix.h"
+#include "Vector.h"
+#include "LAR_export.h"
+#include "SparseKernels.h"
+#include "Semiring.h"
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace LAR
+{
+	// Compressed sparse storage: CSR compresses rows (the outer dimension) and keeps the column of
+	// every nonzero, CSC the other way round.
+	enum class SparseFormat
+	{
+		CSR,
+		CSC
+	};
+
+	template<typename DataType>
+	struct Triplet
+	{
+		size_t Row;
+		size_t Col;
+		DataType Value;
+	};
+
+	namespace Detail
+	{
+		// Counting-sort transpose of a compressed structure with outerSize outer and innerSize inner
+		// indices. Inner indices of the result come out sorted.
+		template<typename DataType>
+		void TransposeCompressed(const size_t outerSize, const size_t innerSize, const std::vector<size_t>& start,
+			const std::vector<size_t>& inner, const std::vector<DataType>& values, std::vector<size_t>& resultStart,
+			std::vector<size_t>& resultInner, std::vector<DataType>& resultValues)
+		{
+			resultStart.assign(innerSize + 1, 0);
+			for (const size_t index : inner)
+			{
+				++resultStart[index + 1];
+			}
+			for (size_t i = 0; i < innerSize; ++i)
+			{
+				resultStart[i + 1] += resultStart[i];
+			}
+			resultInner.resize(inner.size());
+			resultValues.resize(values.size());
+			std::vector<size_t> next(resultStart.begin(), resultStart.end() - 1);
+			for (size_t o = 0; o < outerSize; ++o)
+			{
+				for (size_t p = start[o]; p < start[o + 1]; ++p)
+				{
+					const size_t q = next[inner[p]]++;
+					resultInner[q] = o;
+					resultValues[q] = values[p];
+				}
+			}
+		}
+	} // namespace Detail
+
+	// Sparse matrix whose memory is proportional to its nonzeros. Products with dense Vector and
+	// Matrix follow the dense operator* semantics; the compressed arrays are exposed read-only for
+	// kernels that want them directly.
+	template<typename DataType, SparseFormat Format = SparseFormat::CSR>
+	class LAR_EXPORT SparseMatrix
+	{
+	public:
+		SparseMatrix()
+			: SparseMatrix(0, 0)
+		{
+		}
+
+		// An all-zero rows x cols matrix.
+		SparseMatrix(const size_t rows, const size_t cols)
+			: mNumRows(rows), mNumCols(cols), mOuterStart((Format == SparseFormat::CSR ? rows : cols) + 1, 0)
+		{
+		}
+
+		// Adopts compressed arrays; inner indices must be strictly increasing within each outer slice.
+		SparseMatrix(const size_t rows, const size_t cols, std::vector<size_t> outerStart, std::vector<size_t> inner,
+			std::vector<DataType> values)
+			: mNumRows(rows), mNumCols(cols), mOuterStart(std::move(outerStart)), mInner(std::move(inner)), mValues(std::move(values))
+		{
+			const size_t outer = GetOuterSize();
+			const size_t innerSize = Format == SparseFormat::CSR ? mNumCols : mNumRows;
+			if (mOuterStart.size() != outer + 1 || mOuterStart.front() != 0 || mOuterStart.back() != mInner.size()
+				|| mInner.size() != mValues.size())
+			{
+				throw std::invalid_argument("Compressed arrays do not describe a matrix of this size.");
+			}
+			for (size_t o = 0; o < outer; ++o)
+			{
+				if (mOuterStart[o] > mOuterStart[o + 1])
+				{
+					throw std::invalid_argument("Outer start offsets must be non-decreasing.");
+				}
+				for (size_t p = mOuterStart[o]; p < mOuterStart[o + 1]; ++p)
+				{
+					if (mInner[p] >= innerSize || (p > mOuterStart[o] && mInner[p] <= mInner[p - 1]))
+					{
+						throw std::invalid_argument("Inner indices must be in range and strictly increasing.");
+					}
+				}
+			}
+		}
+
+		// Assembles from (row, col, value) entries in any order; duplicates are summed.
+		static SparseMatrix FromTriplets(const size_t rows, const size_t cols, const std::vector<Triplet<DataType>>& triplets)
+		{
+			SparseMatrix result(rows, cols);
+			const size_t outer = result.GetOuterSize();
+			std::vector<size_t>& start = result.mOuterStart;
+			for (const Triplet<DataType>& t : triplets)
+			{
+				if (t.Row >= rows || t.Col >= cols)
+				{
+					throw std::invalid_argument("Triplet index out of range.");
+				}
+				++start[OuterOf(t.Row, t.Col) + 1];
+			}
+			for (size_t o = 0; o < outer; ++o)
+			{
+				start[o + 1] += start[o];
+			}
+			std::vector<std::pair<size_t, DataType>> entries(triplets.size());
+			std::vector<size_t> next(start.begin(), start.end() - 1);
+			for (const Triplet<DataType>& t : triplets)
+			{
+				entries[next[OuterOf(t.Row, t.Col)]++] = { InnerOf(t.Row, t.Col), t.Value };
+			}
+
+			// Sort each slice by inner index (stable, so duplicates are summed in input order) and merge.
+			result.mInner.reserve(entries.size());
+			result.mValues.reserve(entries.size());
+			size_t written = 0;
+			for (size_t o = 0; o < outer; ++o)
+			{
+				const auto first = entries.begin() + start[o];
+				const auto last = entries.begin() + start[o + 1];
+				std::stable_sort(first, last, [](const auto& x, const auto& y) { return x.first < y.first; });
+				for (auto it = first; it != last; ++it)
+				{
+					if (result.mInner.size() > written && result.mInner.back() == it->first)
+					{
+						result.mValues.back() += it->second;
+					}
+					else
+					{
+						result.mInner.push_back(it->first);
+						result.mValues.push_back(it->second);
+					}
+				}
+				start[o] = written;
+				written = result.mInner.size();
+			}
+			start[outer] = written;
+			return result;
+		}
+
+		// Stores the nonzeros of a dense matrix.
+		explicit SparseMatrix(const Matrix<DataType>& dense)
+			: SparseMatrix(dense.GetRows(), dense.GetCols())
+		{
+			const size_t outer = GetOuterSize();
+			const size_t innerSize = Format == SparseFormat::CSR ? mNumCols : mNumRows;
+			for (size_t o = 0; o < outer; ++o)
+			{
+				for (size_t i = 0; i < innerSize; ++i)
+				{
+					const DataType value = Format == SparseFormat::CSR ? dense(o, i) : dense(i, o);
+					if (value != DataType(0))
+					{
+						mInner.push_back(i);
+						mValues.push_back(value);
+					}
+				}
+				mOuterStart[o + 1] = mInner.size();
+			}
+		}
+
+		// Converts between CSR and CSC.
+		template<SparseFormat OtherFormat>
+		explicit SparseMatrix(const SparseMatrix<DataType, OtherFormat>& other)
+			: mNumRows(other.GetRows()), mNumCols(other.GetCols())
+		{
+			if constexpr (OtherFormat == Format)
+			{
+				mOuterStart = other.OuterStart();
+				mInner = other.InnerIndices();
+				mValues = other.Values();
+			}
+			else
+			{
+				Detail::TransposeCompressed(other.GetOuterSize(), GetOuterSize(), other.OuterStart(), other.InnerIndices(),
+					other.Values(), mOuterStart, mInner, mValues);
+			}
+		}
+
+		size_t GetRows() const { return mNumRows; }
+		size_t GetCols() const { return mNumCols; }
+		size_t GetNonZeros() const { return mValues.size(); }
+		size_t GetOuterSize() const { return Format == SparseFormat::CSR ? mNumRows : mNumCols; }
+		bool IsSquare() const { return mNumRows == mNumCols; }
+		static constexpr SparseFormat GetFormat() { return Format; }
+
+		const std::vector<size_t>& OuterStart() const { return mOuterStart; }
+		const std::vector<size_t>& InnerIndices() const { return mInner; }
+		const std::vector<DataType>& Values() const { return mValues; }
+		// Values may be updated in place; the sparsity pattern may not.
+		std::vector<DataType>& Values() { return mValues; }
+
+		// Element (row, col), zero when not stored; a binary search within the slice.
+		DataType operator()(const size_t row, const size_t col) const
+		{
+			if (row >= mNumRows || col >= mNumCols)
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			const size_t o = OuterOf(row, col);
+			const auto first = mInner.begin() + mOuterStart[o];
+			const auto last = mInner.begin() + mOuterStart[o + 1];
+			const auto found = std::lower_bound(first, last, InnerOf(row, col));
+			return found != last && *found == InnerOf(row, col) ? mValues[found - mInner.begin()] : DataType(0);
+		}
+
+		Matrix<DataType> ToDense() const
+		{
+			Matrix<DataType> result(mNumRows, mNumCols);
+			std::fill(result.mData, result.mData + mNumRows * mNumCols, DataType(0));
+			for (size_t o = 0; o < GetOuterSize(); ++o)
+			{
+				for (size_t p = mOuterStart[o]; p < mOuterStart[o + 1]; ++p)
+				{
+					const size_t row = Format == SparseFormat::CSR ? o : mInner[p];
+					const size_t col = Format == SparseFormat::CSR ? mInner[p] : o;
+					result.mData[row * mNumCols + col] = mValues[p];
+				}
+			}
+			return result;
+		}
+
+		// The main diagonal, zeros where nothing is stored.
+		Vector<DataType> Diagonal() const
+		{
+			const size_t count = std::min(mNumRows, mNumCols);
+			Vector<DataType> result(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				result[i] = (*this)(i, i);
+			}
+			return result;
+		}
+
+		SparseMatrix Transpose() const
+		{
+			SparseMatrix result(mNumCols, mNumRows);
+			Detail::TransposeCompressed(GetOuterSize(), result.GetOuterSize(), mOuterStart, mInner, mValues, result.mOuterStart,
+				result.mInner, result.mValues);
+			return result;
+		}
+
+		// Removes stored entries equal to zero, e.g. after cancellation in a sum.
+		SparseMatrix& Prune()
+		{
+			size_t written = 0;
+			size_t begin = 0;
+			for (size_t o = 0; o < GetOuterSize(); ++o)
+			{
+				const size_t end = mOuterStart[o + 1];
+				for (size_t p = begin; p < end; ++p)
+				{
+					if (mValues[p] != DataType(0))
+					{
+						mInner[written] = mInner[p];
+						mValues[written] = mValues[p];
+						++written;
+					}
+				}
+				begin = end;
+				mOuterStart[o + 1] = written;
+			}
+			mInner.resize(written);
+			mValues.resize(written);
+			return *this;
+		}
+
+#pragma region Element-wise
+		template<SparseFormat OtherFormat>
+		SparseMatrix operator+(const SparseMatrix<DataType, OtherFormat>& other) const
+		{
+			if (mNumRows != other.GetRows() || mNumCols != other.GetCols())
+			{
+				throw std::invalid_argument("Matrices must be the same size to add them.");
+			}
+			return Merge(other, [](const DataType a, const DataType b) { return a + b; }, true);
+		}
+
+		template<SparseFormat OtherFormat>
+		SparseMatrix operator-(const SparseMatrix<DataType, OtherFormat>& other) const
+		{
+			if (mNumRows != other.GetRows() || mNumCols != other.GetCols())
+			{
+				throw std::invalid_argument("Matrices must be the same size to subtract them.");
+			}
+			return Merge(other, [](const DataType a, const DataType b) { return a - b; }, true);
+		}
+
+		// Hadamard product; only positions stored in both operands survive.
+		template<SparseFormat OtherFormat>
+		SparseMatrix ElementwiseProduct(const SparseMatrix<DataType, OtherFormat>& other) const
+		{
+			if (mNumRows != other.GetRows() || mNumCols != other.GetCols())
+			{
+				throw std::invalid_argument("Matrices must be the same size to multiply them element-wise.");
+			}
+			return Merge(other, [](const DataType a, const DataType b) { return a * b; }, false);
+		}
+
+		// Adding a dense matrix gives a dense result.
+		Matrix<DataType> operator+(const Matrix<DataType>& dense) const
+		{
+			if (mNumRows != dense.GetRows() || mNumCols != dense.GetCols())
+			{
+				throw std::invalid_argument("Matrices must be the same size to add them.");
+			}
+			Matrix<DataType> result(dense);
+			ForEach([&result, this](const size_t row, const size_t col, const DataType value) { result.mData[row * mNumCols + col] += value; });
+			return result;
+		}
+
+		SparseMatrix operator-() const
+		{
+			SparseMatrix result(*this);
+			for (DataType& value : result.mValues)
+			{
+				value = -value;
+			}
+			return result;
+		}
+
+		SparseMatrix& operator*=(const DataType scalar)
+		{
+			for (DataType& value : mValues)
+			{
+				value *= scalar;
+			}
+			return *this;
+		}
+
+		SparseMatrix& operator/=(const DataType scalar)
+		{
+			for (DataType& value : mValues)
+			{
+				value /= scalar;
+			}
+			return *this;
+		}
+
+		SparseMatrix operator*(const DataType scalar) const
+		{
+			SparseMatrix result(*this);
+			return result *= scalar;
+		}
+
+		SparseMatrix operator/(const DataType scalar) const
+		{
+			SparseMatrix result(*this);
+			return result /= scalar;
+		}
+#pragma endregion Element-wise
+
+#pragma region Products
+		// y = A x on raw arrays; this is the operator hook used by the Krylov solvers. CSR rows are
+		// split across threads by nonzero count; CSC scatters column by column on one thread.
+		void Apply(const DataType* x, DataType* y) const
+		{
+			if constexpr (Format == SparseFormat::CSR)
+			{
+				Detail::CsrSpMV(mNumRows, mOuterStart, mInner, mValues, x, y);
+			}
+			else
+			{
+				std::fill(y, y + mNumRows, DataType(0));
+				for (size_t j = 0; j < mNumCols; ++j)
+				{
+					const DataType xj = x[j];
+					for (size_t p = mOuterStart[j]; p < mOuterStart[j + 1]; ++p)
+					{
+						y[mInner[p]] += mValues[p] * xj;
+					}
+				}
+			}
+		}
+
+		template<bool RowVector>
+		Vector<DataType> operator*(const Vector<DataType, RowVector>& vector) const
+		{
+			if (mNumCols != vector.GetSize())
+			{
+				throw std::invalid_argument("Number of columns in matrix must match size of vector.");
+			}
+			Vector<DataType> result(mNumRows);
+			Apply(vector.Data(), result.Data());
+			return result;
+		}
+
+		// Sparse times dense: every stored entry scales one row of the dense operand.
+		Matrix<DataType> operator*(const Matrix<DataType>& dense) const
+		{
+			if (mNumCols != dense.GetRows())
+			{
+				throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+			}
+			const size_t k = dense.GetCols();
+			Matrix<DataType> result(mNumRows, k);
+			if constexpr (Format == SparseFormat::CSR)
+			{
+				Detail::CsrSpMM(mNumRows, mOuterStart, mInner, mValues, k, dense.mData, k, result.mData, k);
+			}
+			else
+			{
+				std::fill(result.mData, result.mData + mNumRows * k, DataType(0));
+				ForEach([&](const size_t row, const size_t col, const DataType value)
+				{
+					DataType* out = result.mData + row * k;
+					const DataType* in = dense.mData + col * k;
+					for (size_t c = 0; c < k; ++c)
+					{
+						out[c] += value * in[c];
+					}
+				});
+			}
+			return result;
+		}
+
+		// Sparse times sparse; the result keeps this matrix's format.
+		template<SparseFormat OtherFormat>
+		SparseMatrix operator*(const SparseMatrix<DataType, OtherFormat>& other) const
+		{
+			SparseMatrix result;
+			Multiply(*this, other, result);
+			return result;
+		}
+#pragma endregion Products
+
+		// Calls f(row, col, value) for every stored entry, in storage order.
+		template<typename Function>
+		void ForEach(Function&& f) const
+		{
+			for (size_t o = 0; o < GetOuterSize(); ++o)
+			{
+				for (size_t p = mOuterStart[o]; p < mOuterStart[o + 1]; ++p)
+				{
+					if constexpr (Format == SparseFormat::CSR)
+					{
+						f(o, mInner[p], mValues[p]);
+					}
+					else
+					{
+						f(mInner[p], o, mValues[p]);
+					}
+				}
+			}
+		}
+
+	private:
+		static size_t OuterOf(const size_t row, const size_t col) { return Format == SparseFormat::CSR ? row : col; }
+		static size_t InnerOf(const size_t row, const size_t col) { return Format == SparseFormat::CSR ? col : row; }
+
+		// Slice-by-slice merge, converting the other operand to this format first if needed. The union
+		// keeps entries present in either (the missing side reads as zero), otherwise only the
+		// intersection is kept.
+		template<SparseFormat OtherFormat, typename Operation>
+		SparseMatrix Merge(const SparseMatrix<DataType, OtherFormat>& other, Operation operation, const bool keepUnion) const
+		{
+			if constexpr (OtherFormat == Format)
+			{
+				return MergeSameFormat(other, operation, keepUnion);
+			}
+			else
+			{
+				return MergeSameFormat(SparseMatrix(other), operation, keepUnion);
+			}
+		}
+
+		template<typename Operation>
+		SparseMatrix MergeSameFormat(const SparseMatrix& other, Operation operation, const bool keepUnion) const
+		{
+			SparseMatrix result(mNumRows, mNumCols);
+			result.mInner.reserve(keepUnion ? GetNonZeros() + other.GetNonZeros() : std::min(GetNonZeros(), other.GetNonZeros()));
+			result.mValues.reserve(result.mInner.capacity());
+			for (size_t o = 0; o < GetOuterSize(); ++o)
+			{
+				size_t p = mOuterStart[o];
+				size_t q = other.mOuterStart[o];
+				const size_t pEnd = mOuterStart[o + 1];
+				const size_t qEnd = other.mOuterStart[o + 1];
+				while (p < pEnd || q < qEnd)
+				{
+					const size_t a = p < pEnd ? mInner[p] : size_t(-1);
+					const size_t b = q < qEnd ? other.mInner[q] : size_t(-1);
+					if (a == b)
+					{
+						result.mInner.push_back(a);
+						result.mValues.push_back(operation(mValues[p++], other.mValues[q++]));
+					}
+					else if (a < b)
+					{
+						if (keepUnion)
+						{
+							result.mInner.push_back(a);
+							result.mValues.push_back(operation(mValues[p], DataType(0)));
+						}
+						++p;
+					}
+					else
+					{
+						if (keepUnion)
+						{
+							result.mInner.push_back(b);
+							result.mValues.push_back(operation(DataType(0), other.mValues[q]));
+						}
+						++q;
+					}
+				}
+				result.mOuterStart[o + 1] = result.mInner.size();
+			}
+			return result;
+		}
+
+		size_t mNumRows;
+		size_t mNumCols;
+		std::vector<size_t> mOuterStart;
+		std::vector<size_t> mInner;
+		std::vector<DataType> mValues;
+	};
+
+	template<typename DataType, SparseFormat Format>
+	SparseMatrix<DataType, Format> operator*(const DataType scalar, const SparseMatrix<DataType, Format>& matrix)
+	{
+		return matrix * scalar;
+	}
+
+	// Row vector times sparse matrix.
+	template<typename DataType, SparseFormat Format>
+	Vector<DataType, true> operator*(const Vector<DataType, true>& vector, const SparseMatrix<DataType, Format>& matrix)
+	{
+		if (vector.GetSize() != matrix.GetRows())
+		{
+			throw std::invalid_argument("Number of columns in vector must match number of rows in matrix.");
+		}
+		Vector<DataType, true> result(matrix.GetCols());
+		std::fill(result.begin(), result.end(), DataType(0));
+		matrix.ForEach([&](const size_t row, const size_t col, const DataType value) { result[col] += vector[row] * value; });
+		return result;
+	}
+
+	// Dense times sparse, one dense row at a time: row r of the result accumulates A(r, i) times row
+	// i of the sparse operand (CSR), or takes one dot product per stored column (CSC).
+	template<typename DataType, SparseFormat Format>
+	Matrix<DataType> operator*(const Matrix<DataType>& dense, const SparseMatrix<DataType, Format>& matrix)
+	{
+		if (dense.GetCols() != matrix.GetRows())
+		{
+			throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+		}
+		const size_t m = dense.GetRows();
+		const size_t n = matrix.GetCols();
+		const size_t inner = dense.GetCols();
+		Matrix<DataType> result(m, n);
+		if constexpr (Format == SparseFormat::CSR)
+		{
+			Detail::DenseCsrMM(m, inner, dense.mData, inner, matrix.OuterStart(), matrix.InnerIndices(), matrix.Values(), n, result.mData, n);
+		}
+		else
+		{
+			Detail::DenseCscMM(m, dense.mData, inner, matrix.OuterStart(), matrix.InnerIndices(), matrix.Values(), n, result.mData, n);
+		}
+		return result;
+	}
+
+	// out = A B over a semiring, in A's format (B is converted to it first if needed). Memory is
+	// proportional to the nonzeros of A, B and the result plus one row accumulator per thread.
+	template<typename DataType, SparseFormat FormatA, SparseFormat FormatB, typename Semiring = PlusTimesSemiring<DataType>>
+	void Multiply(const SparseMatrix<DataType, FormatA>& a, const SparseMatrix<DataType, FormatB>& b,
+		SparseMatrix<DataType, FormatA>& out, const Semiring& semiring = Semiring())
+	{
+		if (a.GetCols() != b.GetRows())
+		{
+			throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+		}
+		if constexpr (FormatB != FormatA)
+		{
+			Multiply(a, SparseMatrix<DataType, FormatA>(b), out, semiring);
+		}
+		else
+		{
+			std::vector<size_t> start;
+			std::vector<size_t> inner;
+			std::vector<DataType> values;
+			if constexpr (FormatA == SparseFormat::CSR)
+			{
+				Detail::CsrSpGemm(a.GetRows(), b.GetCols(), a.OuterStart(), a.InnerIndices(), a.Values(), b.OuterStart(),
+					b.InnerIndices(), b.Values(), semiring, start, inner, values);
+			}
+			else
+			{
+				// CSC arrays are the CSR arrays of the transpose, and C^T = B^T A^T.
+				Detail::CsrSpGemm(b.GetCols(), a.GetRows(), b.OuterStart(), b.InnerIndices(), b.Values(), a.OuterStart(),
+					a.InnerIndices(), a.Values(), Detail::SwappedSemiring<Semiring>{ semiring }, start, inner, values);
+			}
+			out = SparseMatrix<DataType, FormatA>(a.GetRows(), b.GetCols(), std::move(start), std::move(inner), std::move(values));
+		}
+	}
+
+	template<typename DataType, SparseFormat Format>
+	std::ostream& operator<<(std::ostream& os, const SparseMatrix<DataType, Format>& matrix)
+	{
+		matrix.ForEach([&os](const size_t row, const size_t col, const DataType value)
+		{
+			os << "(" << row << ", " << col << ") " << value << std::endl;
+		});
+		return os;
+	}
+} // namespace LAR
@@ -0,0 +1,620 @@
+#pragma once
+#include "SparseMatrix.h"
+#include "Algorithms.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace LAR
+{
+	// Fill-reducing symmetric orderings for sparse factorizations. An ordering is returned as a
+	// permutation p with p[k] the original index of the k-th pivot, so the permuted matrix is
+	// A(p[i], p[j]).
+	enum class SparseOrdering
+	{
+		Natural,
+		// Minimum degree on the quotient graph with approximate (AMD-style) external degrees.
+		MinimumDegree,
+		// Recursive level-structure bisection, separators last; minimum degree on the small pieces.
+		NestedDissection,
+		// Reverse Cuthill-McKee: small bandwidth and profile rather than least fill, for banded and
+		// envelope solvers and for SpMV locality.
+		ReverseCuthillMcKee
+	};
+
+	namespace Detail
+	{
+		// Subgraphs this small are ordered by minimum degree instead of being dissected further.
+		constexpr size_t NestedDissectionLeaf = 128;
+
+		// Undirected graph in compressed form: the neighbours of v are Adjacent[Start[v] .. Start[v + 1]).
+		struct AdjacencyGraph
+		{
+			size_t Size = 0;
+			std::vector<size_t> Start;
+			std::vector<size_t> Adjacent;
+		};
+
+		// Pattern of A + A^T without the diagonal, neighbours sorted.
+		template<typename DataType, SparseFormat Format>
+		AdjacencyGraph SymmetricAdjacency(const SparseMatrix<DataType, Format>& a)
+		{
+			if (!a.IsSquare())
+			{
+				throw std::invalid_argument("Matrix must be square.");
+			}
+			AdjacencyGraph graph;
+			graph.Size = a.GetRows();
+			graph.Start.assign(graph.Size + 1, 0);
+			a.ForEach([&graph](const size_t row, const size_t col, const DataType)
+			{
+				if (row != col)
+				{
+					++graph.Start[row + 1];
+					++graph.Start[col + 1];
+				}
+			});
+			for (size_t v = 0; v < graph.Size; ++v)
+			{
+				graph.Start[v + 1] += graph.Start[v];
+			}
+			std::vector<size_t> adjacent(graph.Start.back());
+			std::vector<size_t> next(graph.Start.begin(), graph.Start.end() - 1);
+			a.ForEach([&](const size_t row, const size_t col, const DataType)
+			{
+				if (row != col)
+				{
+					adjacent[next[row]++] = col;
+					adjacent[next[col]++] = row;
+				}
+			});
+
+			// Both triangles usually hold the same entries; drop the duplicates.
+			graph.Adjacent.reserve(adjacent.size());
+			for (size_t v = 0; v < graph.Size; ++v)
+			{
+				const auto first = adjacent.begin() + graph.Start[v];
+				const auto last = adjacent.begin() + graph.Start[v + 1];
+				std::sort(first, last);
+				graph.Start[v] = graph.Adjacent.size();
+				graph.Adjacent.insert(graph.Adjacent.end(), first, std::unique(first, last));
+			}
+			graph.Start[graph.Size] = graph.Adjacent.size();
+			return graph;
+		}
+
+		// Minimum degree ordering on the quotient graph: eliminated nodes become elements that stand
+		// for the clique they created, so the graph never grows. Degrees are AMD's upper bound
+		// |A_i| + |L_p \ i| + sum |L_e \ L_p|, and elements covered by the new one are absorbed.
+		inline std::vector<size_t> MinimumDegreeOrdering(const AdjacencyGraph& graph)
+		{
+			constexpr size_t None = size_t(-1);
+			const size_t n = graph.Size;
+			std::vector<std::vector<size_t>> variables(n);
+			std::vector<std::vector<size_t>> elements(n);
+			std::vector<std::vector<size_t>> members(n);
+			std::vector<size_t> degree(n);
+			std::vector<size_t> head(n + 1, None);
+			std::vector<size_t> next(n, None);
+			std::vector<size_t> previous(n, None);
+			const auto insert = [&](const size_t v)
+			{
+				next[v] = head[degree[v]];
+				previous[v] = None;
+				if (head[degree[v]] != None)
+				{
+					previous[head[degree[v]]] = v;
+				}
+				head[degree[v]] = v;
+			};
+			const auto remove = [&](const size_t v)
+			{
+				(previous[v] != None ? next[previous[v]] : head[degree[v]]) = next[v];
+				if (next[v] != None)
+				{
+					previous[next[v]] = previous[v];
+				}
+			};
+			for (size_t v = 0; v < n; ++v)
+			{
+				variables[v].assign(graph.Adjacent.begin() + graph.Start[v], graph.Adjacent.begin() + graph.Start[v + 1]);
+				degree[v] = variables[v].size();
+				insert(v);
+			}
+
+			std::vector<char> eliminated(n, 0);
+			std::vector<char> absorbed(n, 0);
+			std::vector<size_t> mark(n, 0);
+			std::vector<size_t> weight(n, 0);
+			std::vector<size_t> weightMark(n, 0);
+			std::vector<size_t> order;
+			order.reserve(n);
+			size_t minDegree = 0;
+			for (size_t k = 0; k < n; ++k)
+			{
+				while (head[minDegree] == None)
+				{
+					++minDegree;
+				}
+				const size_t p = head[minDegree];
+				remove(p);
+				eliminated[p] = 1;
+				order.push_back(p);
+				const size_t stamp = k + 1;
+
+				// The new element: p's variable neighbours plus the members of every element it absorbs.
+				std::vector<size_t>& element = members[p];
+				mark[p] = stamp;
+				for (const size_t v : variables[p])
+				{
+					if (!eliminated[v] && mark[v] != stamp)
+					{
+						mark[v] = stamp;
+						element.push_back(v);
+					}
+				}
+				for (const size_t e : elements[p])
+				{
+					if (absorbed[e])
+					{
+						continue;
+					}
+					for (const size_t v : members[e])
+					{
+						if (mark[v] != stamp)
+						{
+							mark[v] = stamp;
+							element.push_back(v);
+						}
+					}
+					absorbed[e] = 1;
+					std::vector<size_t>().swap(members[e]);
+				}
+				std::vector<size_t>().swap(variables[p]);
+				std::vector<size_t>().swap(elements[p]);
+
+				// Prune the lists of every member and count |L_e \ L_p| for the elements they touch.
+				for (const size_t i : element)
+				{
+					remove(i);
+					std::vector<size_t>& touching = elements[i];
+					touching.erase(std::remove_if(touching.begin(), touching.end(), [&absorbed](const size_t e) { return absorbed[e] != 0; }),
+						touching.end());
+					for (const size_t e : touching)
+					{
+						if (weightMark[e] != stamp)
+						{
+							weightMark[e] = stamp;
+							weight[e] = members[e].size();
+						}
+						--weight[e];
+					}
+					touching.push_back(p);
+					// Variables in L_p are now reached through p.
+					std::vector<size_t>& neighbours = variables[i];
+					neighbours.erase(std::remove_if(neighbours.begin(), neighbours.end(),
+						[&](const size_t v) { return eliminated[v] || mark[v] == stamp; }), neighbours.end());
+				}
+				const size_t remaining = n - k - 1;
+				for (const size_t i : element)
+				{
+					size_t bound = variables[i].size() + element.size() - 1;
+					for (const size_t e : elements[i])
+					{
+						if (e == p || absorbed[e])
+						{
+							continue;
+						}
+						if (weight[e] == 0)
+						{
+							absorbed[e] = 1;
+							std::vector<size_t>().swap(members[e]);
+						}
+						else
+						{
+							bound += weight[e];
+						}
+					}
+					degree[i] = std::min(bound, remaining - 1);
+					insert(i);
+					minDegree = std::min(minDegree, degree[i]);
+				}
+			}
+			return order;
+		}
+
+		// Scratch shared by the whole nested dissection: member tags the nodes of the current subgraph,
+		// level and local are per-node work arrays.
+		struct DissectionState
+		{
+			static constexpr size_t None = size_t(-1);
+
+			explicit DissectionState(const size_t n)
+				: Member(n, None), Level(n), Local(n)
+			{
+			}
+
+			// Tags nodes as the subgraph with a fresh id and returns it.
+			size_t Enter(const std::vector<size_t>& nodes)
+			{
+				const size_t id = NextId++;
+				for (const size_t v : nodes)
+				{
+					Member[v] = id;
+				}
+				return id;
+			}
+
+			std::vector<size_t> Member;
+			std::vector<size_t> Level;
+			std::vector<size_t> Local;
+			size_t NextId = 0;
+		};
+
+		// Appends the minimum degree order of the subgraph induced by nodes to order.
+		inline void MinimumDegreeLeaf(const AdjacencyGraph& graph, const std::vector<size_t>& nodes, std::vector<size_t>& order,
+			DissectionState& state)
+		{
+			const size_t id = state.Enter(nodes);
+			AdjacencyGraph sub;
+			sub.Size = nodes.size();
+			sub.Start.push_back(0);
+			for (size_t q = 0; q < nodes.size(); ++q)
+			{
+				state.Local[nodes[q]] = q;
+			}
+			for (const size_t v : nodes)
+			{
+				for (size_t p = graph.Start[v]; p < graph.Start[v + 1]; ++p)
+				{
+					if (state.Member[graph.Adjacent[p]] == id)
+					{
+						sub.Adjacent.push_back(state.Local[graph.Adjacent[p]]);
+					}
+				}
+				sub.Start.push_back(sub.Adjacent.size());
+			}
+			for (const size_t q : MinimumDegreeOrdering(sub))
+			{
+				order.push_back(nodes[q]);
+			}
+		}
+
+		inline void DissectComponents(const AdjacencyGraph& graph, const std::vector<size_t>& nodes, std::vector<size_t>& order,
+			DissectionState& state);
+
+		// Appends the nested dissection order of the connected subgraph induced by nodes to order.
+		inline void NestedDissect(const AdjacencyGraph& graph, const std::vector<size_t>& nodes, std::vector<size_t>& order,
+			DissectionState& state)
+		{
+			constexpr size_t None = DissectionState::None;
+			if (nodes.size() <= NestedDissectionLeaf)
+			{
+				MinimumDegreeLeaf(graph, nodes, order, state);
+				return;
+			}
+			const size_t id = state.Enter(nodes);
+			std::vector<size_t>& level = state.Level;
+			const std::vector<size_t>& member = state.Member;
+
+			// Breadth-first level structure, rooted at a pseudo-peripheral node found by restarting from
+			// the last node reached.
+			std::vector<size_t> queue;
+			queue.reserve(nodes.size());
+			const auto bfs = [&](const size_t root)
+			{
+				for (const size_t v : nodes)
+				{
+					level[v] = None;
+				}
+				queue.clear();
+				queue.push_back(root);
+				level[root] = 0;
+				for (size_t head = 0; head < queue.size(); ++head)
+				{
+					const size_t v = queue[head];
+					for (size_t p = graph.Start[v]; p < graph.Start[v + 1]; ++p)
+					{
+						const size_t w = graph.Adjacent[p];
+						if (member[w] == id && level[w] == None)
+						{
+							level[w] = level[v] + 1;
+							queue.push_back(w);
+						}
+					}
+				}
+			};
+			bfs(nodes.front());
+			bfs(queue.back());
+
+			const size_t depth = level[queue.back()];
+			if (depth < 2)
+			{
+				MinimumDegreeLeaf(graph, nodes, order, state);
+				return;
+			}
+			// The level holding the median node; only its nodes that touch the next level separate.
+			const size_t middle = std::min(std::max<size_t>(level[queue[queue.size() / 2]], 1), depth - 1);
+			std::vector<size_t> first;
+			std::vector<size_t> second;
+			std::vector<size_t> separator;
+			for (const size_t v : queue)
+			{
+				if (level[v] < middle)
+				{
+					first.push_back(v);
+				}
+				else if (level[v] > middle)
+				{
+					second.push_back(v);
+				}
+				else
+				{
+					bool touchesNext = false;
+					for (size_t p = graph.Start[v]; p < graph.Start[v + 1] && !touchesNext; ++p)
+					{
+						const size_t w = graph.Adjacent[p];
+						touchesNext = member[w] == id && level[w] == middle + 1;
+					}
+					(touchesNext ? separator : first).push_back(v);
+				}
+			}
+			// Removing the separator can disconnect either side.
+			DissectComponents(graph, first, order, state);
+			DissectComponents(graph, second, order, state);
+			order.insert(order.end(), separator.begin(), separator.end());
+		}
+
+		// Orders each connected component of the subgraph induced by nodes on its own, all found in one
+		// pass. Single nodes go straight to the order, components up to NestedDissectionLeaf nodes are
+		// batched into shared minimum degree leaves, and only larger ones are dissected.
+		inline void DissectComponents(const AdjacencyGraph& graph, const std::vector<size_t>& nodes, std::vector<size_t>& order,
+			DissectionState& state)
+		{
+			constexpr size_t None = DissectionState::None;
+			const size_t id = state.Enter(nodes);
+			std::vector<size_t>& level = state.Level;
+			for (const size_t v : nodes)
+			{
+				level[v] = None;
+			}
+			std::vector<std::vector<size_t>> leaves;
+			std::vector<std::vector<size_t>> large;
+			std::vector<size_t> component;
+			for (const size_t root : nodes)
+			{
+				if (level[root] != None)
+				{
+					continue;
+				}
+				component.clear();
+				component.push_back(root);
+				level[root] = 0;
+				for (size_t head = 0; head < component.size(); ++head)
+				{
+					const size_t v = component[head];
+					for (size_t p = graph.Start[v]; p < graph.Start[v + 1]; ++p)
+					{
+						const size_t w = graph.Adjacent[p];
+						if (state.Member[w] == id && level[w] == None)
+						{
+							level[w] = 0;
+							component.push_back(w);
+						}
+					}
+				}
+				if (component.size() == 1)
+				{
+					order.push_back(root);
+				}
+				else if (component.size() <= NestedDissectionLeaf)
+				{
+					if (leaves.empty() || leaves.back().size() + component.size() > NestedDissectionLeaf)
+					{
+						leaves.emplace_back();
+					}
+					leaves.back().insert(leaves.back().end(), component.begin(), component.end());
+				}
+				else
+				{
+					large.push_back(component);
+				}
+			}
+			// The leaves and dissections below retag the nodes, so they run once the scan is over.
+			for (const std::vector<size_t>& leaf : leaves)
+			{
+				MinimumDegreeLeaf(graph, leaf, order, state);
+			}
+			for (const std::vector<size_t>& part : large)
+			{
+				NestedDissect(graph, part, order, state);
+			}
+		}
+
+		inline std::vector<size_t> NestedDissectionOrdering(const AdjacencyGraph& graph)
+		{
+			const size_t n = graph.Size;
+			std::vector<size_t> nodes(n);
+			for (size_t v = 0; v < n; ++v)
+			{
+				nodes[v] = v;
+			}
+			std::vector<size_t> order;
+			order.reserve(n);
+			DissectionState state(n);
+			DissectComponents(graph, nodes, order, state);
+			return order;
+		}
+
+		// Breadth-first levels of the component holding root among nodes with mark[v] != stamp; marks
+		// what it reaches. Returns the nodes in visiting order; level gets each one's distance.
+		inline std::vector<size_t> LevelStructure(const AdjacencyGraph& graph, const size_t root, std::vector<size_t>& mark,
+			const size_t stamp, std::vector<size_t>& level)
+		{
+			std::vector<size_t> queue(1, root);
+			mark[root] = stamp;
+			level[root] = 0;
+			for (size_t head = 0; head < queue.size(); ++head)
+			{
+				const size_t v = queue[head];
+				for (size_t p = graph.Start[v]; p < graph.Start[v + 1]; ++p)
+				{
+					const size_t w = graph.Adjacent[p];
+					if (mark[w] != stamp && mark[w] != 0)
+					{
+						mark[w] = stamp;
+						level[w] = level[v] + 1;
+						queue.push_back(w);
+					}
+				}
+			}
+			return queue;
+		}
+
+		// Reverse Cuthill-McKee. Each component is searched breadth-first from a pseudo-peripheral node
+		// (George-Liu: restart from a minimum degree node of the last level while the depth grows),
+		// neighbours taken by increasing degree; reversing the order shrinks the profile further.
+		inline std::vector<size_t> ReverseCuthillMcKeeOrdering(const AdjacencyGraph& graph)
+		{
+			const size_t n = graph.Size;
+			const auto degree = [&graph](const size_t v) { return graph.Start[v + 1] - graph.Start[v]; };
+			// mark: 0 once ordered, otherwise the stamp of the last search that reached the node.
+			std::vector<size_t> mark(n, 1);
+			std::vector<size_t> level(n);
+			std::vector<size_t> order;
+			order.reserve(n);
+			size_t stamp = 1;
+			for (size_t seed = 0; seed < n; ++seed)
+			{
+				if (mark[seed] == 0)
+				{
+					continue;
+				}
+				size_t root = seed;
+				std::vector<size_t> reached = LevelStructure(graph, root, mark, ++stamp, level);
+				while (true)
+				{
+					const size_t depth = level[reached.back()];
+					size_t candidate = reached.back();
+					for (auto it = reached.rbegin(); it != reached.rend() && level[*it] == depth; ++it)
+					{
+						candidate = degree(*it) < degree(candidate) ? *it : candidate;
+					}
+					std::vector<size_t> next = LevelStructure(graph, candidate, mark, ++stamp, level);
+					if (level[next.back()] <= depth)
+					{
+						break;
+					}
+					root = candidate;
+					reached.swap(next);
+				}
+
+				const size_t first = order.size();
+				order.push_back(root);
+				mark[root] = 0;
+				for (size_t head = first; head < order.size(); ++head)
+				{
+					const size_t v = order[head];
+					const size_t begin = order.size();
+					for (size_t p = graph.Start[v]; p < graph.Start[v + 1]; ++p)
+					{
+						const size_t w = graph.Adjacent[p];
+						if (mark[w] != 0)
+						{
+							mark[w] = 0;
+							order.push_back(w);
+						}
+					}
+					std::stable_sort(order.begin() + begin, order.end(), [&degree](const size_t x, const size_t y) { return degree(x) < degree(y); });
+				}
+			}
+			std::reverse(order.begin(), order.end());
+			return order;
+		}
+
+		inline std::vector<size_t> FillReducingOrdering(const AdjacencyGraph& graph, const SparseOrdering ordering)
+		{
+			switch (ordering)
+			{
+			case SparseOrdering::MinimumDegree:
+				return MinimumDegreeOrdering(graph);
+			case SparseOrdering::NestedDissection:
+				return NestedDissectionOrdering(graph);
+			case SparseOrdering::ReverseCuthillMcKee:
+				return ReverseCuthillMcKeeOrdering(graph);
+			default:
+			{
+				std::vector<size_t> order(graph.Size);
+				for (size_t v = 0; v < graph.Size; ++v)
+				{
+					order[v] = v;
+				}
+				return order;
+			}
+			}
+		}
+	} // namespace Detail
+
+	// Fill- or bandwidth-reducing ordering of the pattern of A + A^T.
+	template<typename DataType, SparseFormat Format>
+	std::vector<size_t> FillReducingOrdering(const SparseMatrix<DataType, Format>& a, const SparseOrdering ordering)
+	{
+		return Detail::FillReducingOrdering(Detail::SymmetricAdjacency(a), ordering);
+	}
+
+	// B(i, j) = A(rowPermutation[i], colPermutation[j]): what Matrix::PermuteRows and PermuteCols do to
+	// a dense matrix, in one pass over the entries. An empty permutation leaves that dimension as is;
+	// an ordering p from this header is applied symmetrically as Permute(a, p, p).
+	template<typename DataType, SparseFormat Format>
+	SparseMatrix<DataType, Format> Permute(const SparseMatrix<DataType, Format>& a, const std::vector<size_t>& rowPermutation,
+		const std::vector<size_t>& colPermutation)
+	{
+		const bool byRows = Format == SparseFormat::CSR;
+		const std::vector<size_t>& outerPermutation = byRows ? rowPermutation : colPermutation;
+		const std::vector<size_t>& innerPermutation = byRows ? colPermutation : rowPermutation;
+		const size_t outer = a.GetOuterSize();
+		const size_t innerSize = byRows ? a.GetCols() : a.GetRows();
+		if (!outerPermutation.empty())
+		{
+			Detail::CheckPermutation(outerPermutation, outer);
+		}
+		std::vector<size_t> innerInverse;
+		if (!innerPermutation.empty())
+		{
+			Detail::CheckPermutation(innerPermutation, innerSize);
+			innerInverse.resize(innerSize);
+			for (size_t i = 0; i < innerSize; ++i)
+			{
+				innerInverse[innerPermutation[i]] = i;
+			}
+		}
+
+		std::vector<size_t> start(outer + 1, 0);
+		std::vector<size_t> inner;
+		std::vector<DataType> values;
+		inner.reserve(a.GetNonZeros());
+		values.reserve(a.GetNonZeros());
+		std::vector<std::pair<size_t, DataType>> slice;
+		for (size_t o = 0; o < outer; ++o)
+		{
+			const size_t old = outerPermutation.empty() ? o : outerPermutation[o];
+			slice.clear();
+			for (size_t p = a.OuterStart()[old]; p < a.OuterStart()[old + 1]; ++p)
+			{
+				const size_t index = a.InnerIndices()[p];
+				slice.emplace_back(innerInverse.empty() ? index : innerInverse[index], a.Values()[p]);
+			}
+			if (!innerInverse.empty())
+			{
+				std::sort(slice.begin(), slice.end(), [](const auto& x, const auto& y) { return x.first < y.first; });
+			}
+			for (const auto& entry : slice)
+			{
+				inner.push_back(entry.first);
+				values.push_back(entry.second);
+			}
+			start[o + 1] = inner.size();
+		}
+		return SparseMatrix<DataType, Format>(a.GetRows(), a.GetCols(), std::move(start), std::move(inner), std::move(values));
+	}
+} // namespace LAR
@@ -0,0 +1,252 @@
+#pragma once
+#include "SparseMatrix.h"
+#include "Reduction.h"
+#include "Vector.h"
+#include "LAR_export.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace LAR
+{
+	namespace Detail
+	{
+		// A sparse-sparse dot product merges both index lists; once one list is this many times longer,
+		// binary-searching its entries for each index of the shorter one is cheaper.
+		constexpr size_t SparseDotSearchRatio = 8;
+	} // namespace Detail
+
+	// Vector storing only its nonzeros as sorted index and value arrays, so products cost
+	// O(nonzeros) whatever the length (e.g. hashed features, ~100 entries out of 2^20).
+	template<typename DataType>
+	class LAR_EXPORT SparseVector
+	{
+	public:
+		SparseVector()
+			: SparseVector(0)
+		{
+		}
+
+		// An all-zero vector of the given size.
+		explicit SparseVector(const size_t size)
+			: mSize(size)
+		{
+		}
+
+		// Adopts index and value arrays; indices must be in range and strictly increasing.
+		SparseVector(const size_t size, std::vector<size_t> indices, std::vector<DataType> values)
+			: mSize(size), mIndices(std::move(indices)), mValues(std::move(values))
+		{
+			if (mIndices.size() != mValues.size())
+			{
+				throw std::invalid_argument("Index and value arrays must be the same length.");
+			}
+			for (size_t p = 0; p < mIndices.size(); ++p)
+			{
+				if (mIndices[p] >= mSize || (p > 0 && mIndices[p] <= mIndices[p - 1]))
+				{
+					throw std::invalid_argument("Indices must be in range and strictly increasing.");
+				}
+			}
+		}
+
+		// Stores the nonzeros of a dense vector.
+		template<bool RowVector>
+		explicit SparseVector(const Vector<DataType, RowVector>& dense)
+			: mSize(dense.GetSize())
+		{
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				if (dense[i] != DataType(0))
+				{
+					mIndices.push_back(i);
+					mValues.push_back(dense[i]);
+				}
+			}
+		}
+
+		// Builds from (index, value) entries in any order; duplicates are summed, as hashed features
+		// that collide should be.
+		static SparseVector FromEntries(const size_t size, std::vector<std::pair<size_t, DataType>> entries)
+		{
+			SparseVector result(size);
+			for (const auto& entry : entries)
+			{
+				if (entry.first >= size)
+				{
+					throw std::invalid_argument("Entry index out of range.");
+				}
+			}
+			std::stable_sort(entries.begin(), entries.end(), [](const auto& x, const auto& y) { return x.first < y.first; });
+			for (const auto& entry : entries)
+			{
+				if (!result.mIndices.empty() && result.mIndices.back() == entry.first)
+				{
+					result.mValues.back() += entry.second;
+				}
+				else
+				{
+					result.mIndices.push_back(entry.first);
+					result.mValues.push_back(entry.second);
+				}
+			}
+			return result;
+		}
+
+		size_t GetSize() const { return mSize; }
+		size_t GetNonZeros() const { return mValues.size(); }
+
+		const std::vector<size_t>& Indices() const { return mIndices; }
+		const std::vector<DataType>& Values() const { return mValues; }
+		// Values may be updated in place; the indices may not.
+		std::vector<DataType>& Values() { return mValues; }
+
+		// Element i, zero when not stored; a binary search.
+		DataType operator[](const size_t index) const
+		{
+			if (index >= mSize)
+			{
+				throw std::out_of_range("Index out of range.");
+			}
+			const auto found = std::lower_bound(mIndices.begin(), mIndices.end(), index);
+			return found != mIndices.end() && *found == index ? mValues[found - mIndices.begin()] : DataType(0);
+		}
+
+		Vector<DataType> ToDense() const
+		{
+			Vector<DataType> result(mSize);
+			std::fill(result.begin(), result.end(), DataType(0));
+			for (size_t p = 0; p < mIndices.size(); ++p)
+			{
+				result[mIndices[p]] = mValues[p];
+			}
+			return result;
+		}
+
+		SparseVector& operator*=(const DataType scalar)
+		{
+			for (DataType& value : mValues)
+			{
+				value *= scalar;
+			}
+			return *this;
+		}
+
+		SparseVector operator*(const DataType scalar) const
+		{
+			SparseVector result(*this);
+			return result *= scalar;
+		}
+
+		// Gathers the dense entries at the stored indices and sums the products in the given mode.
+		template<bool RowVector>
+		DataType DotProduct(const Vector<DataType, RowVector>& other, const ReductionMode mode = GetReductionMode()) const
+		{
+			if (mSize != other.GetSize())
+			{
+				throw std::invalid_argument("Vectors must be the same size to calculate the dot product.");
+			}
+			const DataType* x = other.Data();
+			const DataType* values = mValues.data();
+			const size_t* indices = mIndices.data();
+			return Detail::Reduce<DataType>(mIndices.size(), mode, [values, indices, x](const size_t p) { return values[p] * x[indices[p]]; });
+		}
+
+		// Sums over the indices stored in both vectors.
+		DataType DotProduct(const SparseVector& other) const
+		{
+			if (mSize != other.mSize)
+			{
+				throw std::invalid_argument("Vectors must be the same size to calculate the dot product.");
+			}
+			const SparseVector& shorter = GetNonZeros() <= other.GetNonZeros() ? *this : other;
+			const SparseVector& longer = GetNonZeros() <= other.GetNonZeros() ? other : *this;
+			DataType sum = DataType(0);
+			if (longer.GetNonZeros() >= Detail::SparseDotSearchRatio * shorter.GetNonZeros())
+			{
+				auto first = longer.mIndices.begin();
+				for (size_t p = 0; p < shorter.mIndices.size() && first != longer.mIndices.end(); ++p)
+				{
+					first = std::lower_bound(first, longer.mIndices.end(), shorter.mIndices[p]);
+					if (first != longer.mIndices.end() && *first == shorter.mIndices[p])
+					{
+						sum += shorter.mValues[p] * longer.mValues[first - longer.mIndices.begin()];
+					}
+				}
+				return sum;
+			}
+			size_t p = 0;
+			size_t q = 0;
+			while (p < mIndices.size() && q < other.mIndices.size())
+			{
+				if (mIndices[p] < other.mIndices[q])
+				{
+					++p;
+				}
+				else if (other.mIndices[q] < mIndices[p])
+				{
+					++q;
+				}
+				else
+				{
+					sum += mValues[p++] * other.mValues[q++];
+				}
+			}
+			return sum;
+		}
+
+		// x y^T with one entry per pair of stored entries, in CSR form.
+		SparseMatrix<DataType> OuterProduct(const SparseVector& other) const
+		{
+			const size_t nonZeros = other.GetNonZeros();
+			std::vector<size_t> start(mSize + 1, 0);
+			std::vector<size_t> inner;
+			std::vector<DataType> values;
+			inner.reserve(GetNonZeros() * nonZeros);
+			values.reserve(GetNonZeros() * nonZeros);
+			for (size_t p = 0; p < mIndices.size(); ++p)
+			{
+				inner.insert(inner.end(), other.mIndices.begin(), other.mIndices.end());
+				for (size_t q = 0; q < nonZeros; ++q)
+				{
+					values.push_back(mValues[p] * other.mValues[q]);
+				}
+				start[mIndices[p] + 1] = nonZeros;
+			}
+			for (size_t i = 0; i < mSize; ++i)
+			{
+				start[i + 1] += start[i];
+			}
+			return SparseMatrix<DataType>(mSize, other.mSize, std::move(start), std::move(inner), std::move(values));
+		}
+
+	private:
+		size_t mSize;
+		std::vector<size_t> mIndices;
+		std::vector<DataType> mValues;
+	};
+
+	template<typename DataType>
+	SparseVector<DataType> operator*(const DataType scalar, const SparseVector<DataType>& vector)
+	{
+		return vector * scalar;
+	}
+
+	// y += alpha x, touching only the entries of y at x's indices.
+	template<typename DataType, bool RowVector>
+	void Axpy(const DataType alpha, const SparseVector<DataType>& x, Vector<DataType, RowVector>& y)
+	{
+		if (x.GetSize() != y.GetSize())
+		{
+			throw std::invalid_argument("Vectors must be the same size.");
+		}
+		DataType* out = y.Data();
+		const std::vector<size_t>& indices = x.Indices();
+		const std::vector<DataType>& values = x.Values();
+		for (size_t p = 0; p < indices.size(); ++p)
+		{
+			out[indices[p]] += alpha * values[p];
+		}
+	}
+} // namespace LAR
@@ -0,0 +1,212 @@
+#pragma once
+#include "Gemm.h"
+#include "Memory.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace LAR
+{
+	enum class MultiplyAlgorithm
+	{
+		Blocked,
+		Strassen
+	};
+
+	struct StrassenOptions
+	{
+		// Sub-products with any dimension at or below this size use the blocked Gemm kernel.
+		size_t Crossover = 256;
+		// Recursion levels whose seven sub-products are computed concurrently.
+		size_t ParallelDepth = 1;
+	};
+
+	// Algorithm used by Multiply/Matrix::operator* for same-typed products. Strassen only kicks in
+	// once every dimension exceeds StrassenCrossover.
+	struct MultiplySettings
+	{
+		static inline std::atomic<MultiplyAlgorithm> Algorithm{ MultiplyAlgorithm::Blocked };
+		static inline std::atomic<size_t> StrassenCrossover{ 256 };
+	};
+
+	inline void SetMultiplyAlgorithm(const MultiplyAlgorithm algorithm, const size_t strassenCrossover = 256)
+	{
+		MultiplySettings::Algorithm.store(algorithm, std::memory_order_relaxed);
+		MultiplySettings::StrassenCrossover.store(strassenCrossover, std::memory_order_relaxed);
+	}
+
+	namespace Detail
+	{
+		template<typename DataType>
+		void AddBlocks(const size_t rows, const size_t cols, const DataType* x, const size_t ldx,
+			const DataType* y, const size_t ldy, DataType* out, const size_t ldo)
+		{
+			for (size_t i = 0; i < rows; ++i)
+			{
+				for (size_t j = 0; j < cols; ++j)
+				{
+					out[i * ldo + j] = x[i * ldx + j] + y[i * ldy + j];
+				}
+			}
+		}
+
+		template<typename DataType>
+		void SubtractBlocks(const size_t rows, const size_t cols, const DataType* x, const size_t ldx,
+			const DataType* y, const size_t ldy, DataType* out, const size_t ldo)
+		{
+			for (size_t i = 0; i < rows; ++i)
+			{
+				for (size_t j = 0; j < cols; ++j)
+				{
+					out[i * ldo + j] = x[i * ldx + j] - y[i * ldy + j];
+				}
+			}
+		}
+
+		// Elements of workspace needed below a product of the given shape.
+		inline size_t StrassenWorkspace(const size_t m, const size_t k, const size_t n, const size_t crossover,
+			const size_t parallelDepth)
+		{
+			if (std::min(m, std::min(k, n)) <= crossover)
+			{
+				return 0;
+			}
+			const size_t hm = m / 2, hk = k / 2, hn = n / 2;
+			const size_t local = 4 * hm * hk + 4 * hk * hn + 7 * hm * hn;
+			const size_t child = StrassenWorkspace(hm, hk, hn, crossover, parallelDepth == 0 ? 0 : parallelDepth - 1);
+			return local + (parallelDepth > 0 ? 7 : 1) * child;
+		}
+
+		// C = A * B on row-major strided blocks using the Winograd form of Strassen's recursion
+		// (7 products, 15 additions). Odd trailing rows/columns are peeled and fixed up with Gemm.
+		template<typename DataType>
+		void StrassenRecursive(const size_t m, const size_t k, const size_t n,
+			const DataType* a, const size_t lda, const DataType* b, const size_t ldb, DataType* c, const size_t ldc,
+			DataType* workspace, const size_t crossover, const size_t parallelDepth)
+		{
+			if (std::min(m, std::min(k, n)) <= crossover)
+			{
+				for (size_t i = 0; i < m; ++i)
+				{
+					std::fill(c + i * ldc, c + i * ldc + n, DataType(0));
+				}
+				GemmAccumulate(m, n, k, DataType(1), a, lda, Op::NoTrans, b, ldb, Op::NoTrans, c, ldc);
+				return;
+			}
+
+			const size_t hm = m / 2, hk = k / 2, hn = n / 2;
+			const DataType* a11 = a;
+			const DataType* a12 = a + hk;
+			const DataType* a21 = a + hm * lda;
+			const DataType* a22 = a21 + hk;
+			const DataType* b11 = b;
+			const DataType* b12 = b + hn;
+			const DataType* b21 = b + hk * ldb;
+			const DataType* b22 = b21 + hn;
+			DataType* c11 = c;
+			DataType* c12 = c + hn;
+			DataType* c21 = c + hm * ldc;
+			DataType* c22 = c21 + hn;
+
+			DataType* s[4];
+			DataType* t[4];
+			DataType* p[7];
+			DataType* next = workspace;
+			for (size_t i = 0; i < 4; ++i, next += hm * hk) s[i] = next;
+			for (size_t i = 0; i < 4; ++i, next += hk * hn) t[i] = next;
+			for (size_t i = 0; i < 7; ++i, next += hm * hn) p[i] = next;
+
+			AddBlocks(hm, hk, a21, lda, a22, lda, s[0], hk);      // S1 = A21 + A22
+			SubtractBlocks(hm, hk, s[0], hk, a11, lda, s[1], hk); // S2 = S1 - A11
+			SubtractBlocks(hm, hk, a11, lda, a21, lda, s[2], hk); // S3 = A11 - A21
+			SubtractBlocks(hm, hk, a12, lda, s[1], hk, s[3], hk); // S4 = A12 - S2
+			SubtractBlocks(hk, hn, b12, ldb, b11, ldb, t[0], hn); // T1 = B12 - B11
+			SubtractBlocks(hk, hn, b22, ldb, t[0], hn, t[1], hn); // T2 = B22 - T1
+			SubtractBlocks(hk, hn, b22, ldb, b12, ldb, t[2], hn); // T3 = B22 - B12
+			SubtractBlocks(hk, hn, t[1], hn, b21, ldb, t[3], hn); // T4 = T2 - B21
+
+			const DataType* left[7] = { a11, a12, s[3], a22, s[0], s[1], s[2] };
+			const size_t leftLd[7] = { lda, lda, hk, lda, hk, hk, hk };
+			const DataType* right[7] = { b11, b21, b22, t[3], t[0], t[1], t[2] };
+			const size_t rightLd[7] = { ldb, ldb, ldb, hn, hn, hn, hn };
+
+			const bool parallel = parallelDepth > 0;
+			const size_t childWorkspace = StrassenWorkspace(hm, hk, hn, crossover, parallel ? parallelDepth - 1 : 0);
+			auto product = [&](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					DataType* childSpace = next + (parallel ? i : 0) * childWorkspace;
+					StrassenRecursive(hm, hk, hn, left[i], leftLd[i], right[i], rightLd[i], p[i], hn,
+						childSpace, crossover, parallel ? parallelDepth - 1 : 0);
+				}
+			};
+			if (parallel)
+			{
+				ParallelFor(0, 7, 1, product);
+			}
+			else
+			{
+				product(0, 7);
+			}
+
+			AddBlocks(hm, hn, p[0], hn, p[1], hn, c11, ldc); // C11 = P1 + P2
+			AddBlocks(hm, hn, p[0], hn, p[5], hn, p[5], hn); // U2 = P1 + P6
+			AddBlocks(hm, hn, p[5], hn, p[6], hn, p[6], hn); // U3 = U2 + P7
+			AddBlocks(hm, hn, p[5], hn, p[4], hn, p[5], hn); // U4 = U2 + P5
+			AddBlocks(hm, hn, p[5], hn, p[2], hn, c12, ldc); // C12 = U4 + P3
+			SubtractBlocks(hm, hn, p[6], hn, p[3], hn, c21, ldc); // C21 = U3 - P4
+			AddBlocks(hm, hn, p[6], hn, p[4], hn, c22, ldc); // C22 = U3 + P5
+
+			const size_t m2 = 2 * hm, k2 = 2 * hk, n2 = 2 * hn;
+			if (k2 < k)
+			{
+				GemmAccumulate(m2, n2, k - k2, DataType(1), a + k2, lda, Op::NoTrans, b + k2 * ldb, ldb, Op::NoTrans, c, ldc);
+			}
+			if (n2 < n)
+			{
+				for (size_t i = 0; i < m2; ++i)
+				{
+					std::fill(c + i * ldc + n2, c + i * ldc + n, DataType(0));
+				}
+				GemmAccumulate(m2, n - n2, k, DataType(1), a, lda, Op::NoTrans, b + n2, ldb, Op::NoTrans, c + n2, ldc);
+			}
+			if (m2 < m)
+			{
+				for (size_t i = m2; i < m; ++i)
+				{
+					std::fill(c + i * ldc, c + i * ldc + n, DataType(0));
+				}
+				GemmAccumulate(m - m2, n, k, DataType(1), a + m2 * lda, lda, Op::NoTrans, b, ldb, Op::NoTrans, c + m2 * ldc, ldc);
+			}
+		}
+	} // namespace Detail
+
+	// C = A * B by Strassen-Winograd recursion down to options.Crossover, then the blocked Gemm
+	// kernel. The whole recursion shares one workspace allocated up front. Exact element types
+	// (Rational, integers) give identical results to the classical product; floating-point results
+	// carry a slightly larger error bound.
+	template<typename DataType>
+	void StrassenMultiply(const Matrix<DataType>& a, const Matrix<DataType>& b, Matrix<DataType>& c,
+		const StrassenOptions& options = StrassenOptions())
+	{
+		if (a.mNumCols != b.mNumRows)
+		{
+			throw std::invalid_argument("Number of columns in first matrix must match number of rows in second matrix.");
+		}
+		if (c.mNumRows != a.mNumRows || c.mNumCols != b.mNumCols)
+		{
+			throw std::invalid_argument("Output matrix must be sized rows(A) x cols(B).");
+		}
+		if (c.mData != nullptr && (c.mData == a.mData || c.mData == b.mData))
+		{
+			throw std::invalid_argument("Output matrix must not alias an input of StrassenMultiply.");
+		}
+		const size_t crossover = std::max<size_t>(options.Crossover, 1);
+		ScratchBuffer<DataType> workspace(Detail::StrassenWorkspace(a.mNumRows, a.mNumCols, b.mNumCols, crossover,
+			options.ParallelDepth));
+		Detail::StrassenRecursive(a.mNumRows, a.mNumCols, b.mNumCols, a.mData, a.mNumCols, b.mData, b.mNumCols,
+			c.mData, c.mNumCols, workspace.Data(), crossover, options.ParallelDepth);
+	}
+} // namespace LAR
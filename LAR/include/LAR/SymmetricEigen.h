@@ -0,0 +1,837 @@
+#pragma once
+#include "Matrix.h"
+#include "Vector.h"
+#include "Gemm.h"
+#include "Gemv.h"
+#include "Hessenberg.h"
+#include "Memory.h"
+#include "Parallel.h"
+#include "QR.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace LAR
+{
+	struct SymmetricEigenOptions
+	{
+		// Without eigenvectors only the tridiagonal QL sweep runs, O(n^2) after the reduction.
+		bool ComputeEigenvectors = true;
+		// When non-zero, only the TopK largest eigenpairs are kept. Their vectors come from inverse
+		// iteration on the tridiagonal matrix, so only TopK columns are back-transformed.
+		size_t TopK = 0;
+		// Columns per panel in the blocked tridiagonal reduction.
+		size_t BlockSize = 32;
+		// Recursion levels of divide and conquer whose two halves are solved concurrently.
+		size_t ParallelDepth = 3;
+	};
+
+	namespace Detail
+	{
+		// Subproblems at or below this size are solved directly by implicit QL.
+		constexpr size_t DivideConquerLeaf = 32;
+
+		// Reduces the symmetric n x n matrix a (both triangles stored, row stride n) to tridiagonal form
+		// Q^T A Q = T with Q = H_0 H_1 ... H_{n-2} (LAPACK's sytrd with latrd panels, lower storage).
+		// d and e receive the diagonal and subdiagonal of T, tau the reflector scalars. The reflectors are
+		// stored as ReduceHessenberg stores them, so ApplyHessenbergQ forms Q.
+		template<typename DataType>
+		void Tridiagonalize(DataType* a, const size_t n, const size_t blockSize, DataType* d, DataType* e, DataType* tau)
+		{
+			if (n == 0)
+			{
+				return;
+			}
+			ScratchBuffer<DataType> panelV(n * blockSize);
+			ScratchBuffer<DataType> panelW(n * blockSize);
+			ScratchBuffer<DataType> column(n);
+			ScratchBuffer<DataType> work(n);
+			ScratchBuffer<DataType> coefficients(2 * blockSize);
+
+			for (size_t j0 = 0; j0 < n; j0 += blockSize)
+			{
+				const size_t nb = std::min(blockSize, n - j0);
+				// V and W of the panel, rows j0..n-1, nb columns; row r of the panel is global row j0 + r.
+				DataType* v = panelV.Data();
+				DataType* w = panelW.Data();
+				std::fill(v, v + (n - j0) * nb, DataType(0));
+				std::fill(w, w + (n - j0) * nb, DataType(0));
+
+				for (size_t l = 0; l < nb; ++l)
+				{
+					const size_t i = j0 + l;
+					const size_t count = n - i;
+					// Column i with the panel's earlier rank-2 updates applied: A(i:n, i) -= V W(i, :)^T + W V(i, :)^T.
+					DataType* x = column.Data();
+					for (size_t r = 0; r < count; ++r)
+					{
+						x[r] = a[(i + r) * n + i];
+					}
+					for (size_t c = 0; c < l; ++c)
+					{
+						const DataType wi = w[(i - j0) * nb + c];
+						const DataType vi = v[(i - j0) * nb + c];
+						for (size_t r = 0; r < count; ++r)
+						{
+							x[r] -= v[(i - j0 + r) * nb + c] * wi + w[(i - j0 + r) * nb + c] * vi;
+						}
+					}
+					d[i] = x[0];
+					if (count == 1)
+					{
+						tau[i] = DataType(0);
+						break;
+					}
+
+					tau[i] = HouseholderVector(x[1], x + 2, count - 2, size_t(1));
+					e[i] = x[1];
+					for (size_t r = 2; r < count; ++r)
+					{
+						a[(i + r) * n + i] = x[r];
+					}
+					// x(1:) becomes the full reflector vector u with u(0) = 1, acting on rows i+1..n-1.
+					DataType* u = x + 1;
+					u[0] = DataType(1);
+					const size_t rows = count - 1;
+
+					// y = A(i+1:n, i+1:n) u - V (W^T u) - W (V^T u), with A not yet updated by this panel.
+					DataType* y = work.Data();
+					GemvRows(rows, rows, DataType(1), a + (i + 1) * n + i + 1, n, u, DataType(0), y);
+					DataType* wtu = coefficients.Data();
+					DataType* vtu = wtu + blockSize;
+					for (size_t c = 0; c < l; ++c)
+					{
+						DataType sumW = 0, sumV = 0;
+						for (size_t r = 0; r < rows; ++r)
+						{
+							sumW += w[(i + 1 - j0 + r) * nb + c] * u[r];
+							sumV += v[(i + 1 - j0 + r) * nb + c] * u[r];
+						}
+						wtu[c] = sumW;
+						vtu[c] = sumV;
+					}
+					for (size_t r = 0; r < rows; ++r)
+					{
+						DataType correction = 0;
+						for (size_t c = 0; c < l; ++c)
+						{
+							correction += v[(i + 1 - j0 + r) * nb + c] * wtu[c] + w[(i + 1 - j0 + r) * nb + c] * vtu[c];
+						}
+						y[r] -= correction;
+					}
+
+					// w = tau y - (tau^2 / 2)(y^T u) u, so that H A H = A - u w^T - w u^T.
+					DataType yu = 0;
+					for (size_t r = 0; r < rows; ++r)
+					{
+						y[r] *= tau[i];
+						yu += y[r] * u[r];
+					}
+					const DataType alpha = DataType(-0.5) * tau[i] * yu;
+					for (size_t r = 0; r < rows; ++r)
+					{
+						v[(i + 1 - j0 + r) * nb + l] = u[r];
+						w[(i + 1 - j0 + r) * nb + l] = y[r] + alpha * u[r];
+					}
+				}
+
+				// Rank-2k update of the trailing matrix, both triangles: A -= V W^T + W V^T.
+				const size_t t = j0 + nb;
+				if (t < n)
+				{
+					const size_t rows = n - t;
+					const DataType* vt = v + nb * nb;
+					const DataType* wt = w + nb * nb;
+					DataType* trailing = a + t * n + t;
+					ParallelGemmAccumulate(rows, rows, nb, DataType(-1), vt, nb, Op::NoTrans, wt, nb, Op::Trans, trailing, n);
+					ParallelGemmAccumulate(rows, rows, nb, DataType(-1), wt, nb, Op::NoTrans, vt, nb, Op::Trans, trailing, n);
+				}
+			}
+		}
+
+		// Implicit QL with Wilkinson shifts on the symmetric tridiagonal (d, e), e(i) coupling i and i+1.
+		// d receives the (unsorted) eigenvalues; e is destroyed. With z, the rotations are accumulated
+		// into its first n columns (row stride ldz, rows zRows).
+		template<typename DataType>
+		void TridiagonalQL(DataType* d, DataType* e, const size_t n, DataType* z, const size_t ldz, const size_t zRows)
+		{
+			if (n == 0)
+			{
+				return;
+			}
+			e[n - 1] = DataType(0);
+			const DataType eps = std::numeric_limits<DataType>::epsilon();
+			for (size_t l = 0; l < n; ++l)
+			{
+				size_t iterations = 0;
+				size_t m;
+				do
+				{
+					for (m = l; m + 1 < n; ++m)
+					{
+						if (std::abs(e[m]) <= eps * (std::abs(d[m]) + std::abs(d[m + 1])))
+						{
+							break;
+						}
+					}
+					if (m == l)
+					{
+						break;
+					}
+					if (++iterations > 60)
+					{
+						throw std::runtime_error("Tridiagonal QL iteration did not converge.");
+					}
+					DataType g = (d[l + 1] - d[l]) / (DataType(2) * e[l]);
+					DataType r = std::hypot(g, DataType(1));
+					g = d[m] - d[l] + e[l] / (g + std::copysign(r, g));
+					DataType s = 1, c = 1, p = 0;
+					bool underflow = false;
+					for (size_t i = m; i-- > l;)
+					{
+						DataType f = s * e[i];
+						const DataType b = c * e[i];
+						r = std::hypot(f, g);
+						e[i + 1] = r;
+						if (r == DataType(0))
+						{
+							d[i + 1] -= p;
+							e[m] = DataType(0);
+							underflow = true;
+							break;
+						}
+						s = f / r;
+						c = g / r;
+						g = d[i + 1] - p;
+						r = (d[i] - g) * s + DataType(2) * c * b;
+						p = s * r;
+						d[i + 1] = g + p;
+						g = c * r - b;
+						if (z != nullptr)
+						{
+							for (size_t k = 0; k < zRows; ++k)
+							{
+								DataType* row = z + k * ldz;
+								f = row[i + 1];
+								row[i + 1] = s * row[i] + c * f;
+								row[i] = c * row[i] - s * f;
+							}
+						}
+					}
+					if (underflow)
+					{
+						continue;
+					}
+					d[l] -= p;
+					e[l] = g;
+					e[m] = DataType(0);
+				} while (true);
+			}
+		}
+
+		// Sorts eigenvalues ascending and permutes the n columns of z (n rows, row stride ldz) to match.
+		template<typename DataType>
+		void SortEigenpairs(DataType* d, const size_t n, DataType* z, const size_t ldz)
+		{
+			std::vector<size_t> order(n);
+			std::iota(order.begin(), order.end(), size_t(0));
+			std::stable_sort(order.begin(), order.end(), [d](const size_t x, const size_t y) { return d[x] < d[y]; });
+			std::vector<DataType> values(n);
+			for (size_t j = 0; j < n; ++j)
+			{
+				values[j] = d[order[j]];
+			}
+			std::copy(values.begin(), values.end(), d);
+			if (z == nullptr)
+			{
+				return;
+			}
+			std::vector<DataType> row(n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				DataType* zi = z + i * ldz;
+				for (size_t j = 0; j < n; ++j)
+				{
+					row[j] = zi[order[j]];
+				}
+				std::copy(row.begin(), row.end(), zi);
+			}
+		}
+
+		// Root j of the secular equation 1 + rho * sum z_i^2 / (d_i - lambda) = 0 for ascending poles d,
+		// rho > 0 and |z| = 1. The root is returned as lambda = d[origin] + offset, relative to its
+		// nearest pole, so that d_i - lambda can later be formed without cancellation. Each step fits one
+		// rational term per side of the root (Bunch-Nielsen-Sorensen), safeguarded by bisection.
+		template<typename DataType>
+		void SecularRoot(const DataType* d, const DataType* z, const size_t k, const DataType rho, const size_t j,
+			size_t& origin, DataType& offset)
+		{
+			const DataType eps = std::numeric_limits<DataType>::epsilon();
+			const bool last = j + 1 == k;
+			DataType lower, upper;
+			origin = j;
+			if (last)
+			{
+				lower = 0;
+				upper = rho;
+			}
+			else
+			{
+				const DataType gap = d[j + 1] - d[j];
+				const DataType middle = gap / 2;
+				DataType f = 1;
+				for (size_t i = 0; i < k; ++i)
+				{
+					f += rho * z[i] * z[i] / ((d[i] - d[j]) - middle);
+				}
+				if (f >= DataType(0))
+				{
+					lower = 0;
+					upper = middle;
+				}
+				else
+				{
+					origin = j + 1;
+					lower = middle - gap;
+					upper = 0;
+				}
+			}
+			const DataType base = d[origin];
+			const DataType poleLow = d[j] - base;
+			const DataType poleHigh = last ? DataType(0) : d[j + 1] - base;
+			DataType x = (lower + upper) / 2;
+
+			for (size_t iteration = 0; iteration < 100; ++iteration)
+			{
+				DataType psi = 0, dpsi = 0, phi = 0, dphi = 0;
+				for (size_t i = 0; i <= j; ++i)
+				{
+					const DataType term = z[i] / ((d[i] - base) - x);
+					psi += z[i] * term;
+					dpsi += term * term;
+				}
+				for (size_t i = j + 1; i < k; ++i)
+				{
+					const DataType term = z[i] / ((d[i] - base) - x);
+					phi += z[i] * term;
+					dphi += term * term;
+				}
+				psi *= rho; dpsi *= rho; phi *= rho; dphi *= rho;
+				const DataType f = 1 + psi + phi;
+				if (f == DataType(0) || std::abs(f) <= 8 * eps * k * (1 + std::abs(psi) + std::abs(phi)))
+				{
+					break;
+				}
+				if (f > DataType(0))
+				{
+					upper = x;
+				}
+				else
+				{
+					lower = x;
+				}
+				if (upper - lower <= 2 * eps * std::max(std::abs(lower), std::abs(upper)))
+				{
+					break;
+				}
+
+				// psi ~ p + q / (poleLow - x), phi ~ r + s / (poleHigh - x), matching value and slope.
+				const DataType lowGap = poleLow - x;
+				const DataType q = dpsi * lowGap * lowGap;
+				DataType next;
+				if (last)
+				{
+					const DataType c = 1 + psi - dpsi * lowGap + phi;
+					next = c > DataType(0) ? poleLow + q / c : (lower + upper) / 2;
+				}
+				else
+				{
+					const DataType highGap = poleHigh - x;
+					const DataType s = dphi * highGap * highGap;
+					const DataType c = 1 + psi - dpsi * lowGap + phi - dphi * highGap;
+					const DataType b = c * (poleLow + poleHigh) + q + s;
+					const DataType constant = c * poleLow * poleHigh + q * poleHigh + s * poleLow;
+					if (c == DataType(0))
+					{
+						next = constant / b;
+					}
+					else
+					{
+						const DataType discriminant = std::max(DataType(0), b * b - 4 * c * constant);
+						const DataType first = (b + std::copysign(std::sqrt(discriminant), b)) / (2 * c);
+						const DataType second = first != DataType(0) ? constant / (c * first) : DataType(0);
+						next = first > poleLow && first < poleHigh ? first : second;
+					}
+				}
+				x = next > lower && next < upper ? next : (lower + upper) / 2;
+			}
+			offset = x;
+		}
+
+		// Cuppen's divide and conquer for the symmetric tridiagonal (d, e): T is split at m into two
+		// halves plus the rank-one tear beta * (e_{m-1} + e_m)(e_{m-1} + e_m)^T, both halves are solved
+		// recursively (concurrently near the root), and the merge solves D + rho z z^T through the
+		// secular equation. Deflation follows LAPACK's laed2 and the eigenvectors use the Gu-Eisenstat
+		// recomputed z so they stay orthogonal. On exit d is ascending and the columns of z (n x n,
+		// row stride ldz) are the eigenvectors.
+		template<typename DataType>
+		void TridiagonalDivideConquer(DataType* d, DataType* e, const size_t n, DataType* z, const size_t ldz,
+			const size_t parallelDepth)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				std::fill(z + i * ldz, z + i * ldz + n, DataType(0));
+				z[i * ldz + i] = DataType(1);
+			}
+			if (n <= DivideConquerLeaf)
+			{
+				TridiagonalQL(d, e, n, z, ldz, n);
+				SortEigenpairs(d, n, z, ldz);
+				return;
+			}
+
+			const size_t m = n / 2;
+			const DataType beta = e[m - 1];
+			d[m - 1] -= std::abs(beta);
+			d[m] -= std::abs(beta);
+			auto half = [&](const size_t begin, const size_t end)
+			{
+				for (size_t h = begin; h < end; ++h)
+				{
+					const size_t offset = h == 0 ? 0 : m;
+					const size_t size = h == 0 ? m : n - m;
+					TridiagonalDivideConquer(d + offset, e + offset, size, z + offset * ldz + offset, ldz,
+						parallelDepth == 0 ? 0 : parallelDepth - 1);
+				}
+			};
+			if (parallelDepth > 0)
+			{
+				ParallelFor(0, 2, 1, half);
+			}
+			else
+			{
+				half(0, 2);
+			}
+
+			// Q^T (sign(beta) e_{m-1} + e_m): the last row of Q1 and the first row of Q2. Taking |beta|
+			// as the tear keeps rho positive.
+			std::vector<DataType> zv(n);
+			const DataType sign = beta < DataType(0) ? DataType(-1) : DataType(1);
+			for (size_t j = 0; j < m; ++j)
+			{
+				zv[j] = sign * z[(m - 1) * ldz + j];
+			}
+			for (size_t j = m; j < n; ++j)
+			{
+				zv[j] = z[m * ldz + j];
+			}
+			const DataType scale = Norm2(zv.data(), n, size_t(1));
+			for (DataType& value : zv)
+			{
+				value /= scale;
+			}
+			const DataType rho = std::abs(beta) * scale * scale;
+
+			std::vector<size_t> order(n);
+			std::iota(order.begin(), order.end(), size_t(0));
+			std::stable_sort(order.begin(), order.end(), [d](const size_t x, const size_t y) { return d[x] < d[y]; });
+			std::vector<DataType> ds(n), zs(n);
+			DataType largest = rho;
+			for (size_t s = 0; s < n; ++s)
+			{
+				ds[s] = d[order[s]];
+				zs[s] = zv[order[s]];
+				largest = std::max(largest, std::abs(ds[s]));
+			}
+
+			// Deflation: negligible z components keep their pole as an eigenvalue, and nearly equal poles
+			// are merged by a Givens rotation that moves all of the weight onto one of them.
+			const DataType tolerance = 8 * std::numeric_limits<DataType>::epsilon() * largest;
+			struct Rotation { size_t First, Second; DataType C, S; };
+			std::vector<Rotation> rotations;
+			std::vector<bool> deflated(n, false);
+			size_t previous = n;
+			for (size_t s = 0; s < n; ++s)
+			{
+				if (rho * std::abs(zs[s]) <= tolerance)
+				{
+					deflated[s] = true;
+					continue;
+				}
+				if (previous != n)
+				{
+					const DataType tau = std::hypot(zs[previous], zs[s]);
+					const DataType c = zs[s] / tau;
+					const DataType sn = -zs[previous] / tau;
+					if (std::abs((ds[s] - ds[previous]) * c * sn) <= tolerance)
+					{
+						zs[s] = tau;
+						zs[previous] = DataType(0);
+						const DataType first = ds[previous] * c * c + ds[s] * sn * sn;
+						ds[s] = ds[previous] * sn * sn + ds[s] * c * c;
+						ds[previous] = first;
+						rotations.push_back({ previous, s, c, sn });
+						deflated[previous] = true;
+					}
+				}
+				previous = s;
+			}
+
+			std::vector<size_t> active;
+			for (size_t s = 0; s < n; ++s)
+			{
+				if (!deflated[s])
+				{
+					active.push_back(s);
+				}
+			}
+			std::stable_sort(active.begin(), active.end(), [&ds](const size_t x, const size_t y) { return ds[x] < ds[y]; });
+			const size_t k = active.size();
+			std::vector<DataType> dk(k), zk(k);
+			for (size_t t = 0; t < k; ++t)
+			{
+				dk[t] = ds[active[t]];
+				zk[t] = zs[active[t]];
+			}
+
+			std::vector<size_t> origins(k);
+			std::vector<DataType> offsets(k);
+			ParallelFor(0, k, 16, [&](const size_t begin, const size_t end)
+			{
+				for (size_t j = begin; j < end; ++j)
+				{
+					SecularRoot(dk.data(), zk.data(), k, rho, j, origins[j], offsets[j]);
+				}
+			});
+			// lambda_j - d_i, formed from the pole nearest to lambda_j.
+			auto shifted = [&](const size_t j, const size_t i) { return (dk[origins[j]] - dk[i]) + offsets[j]; };
+
+			// Loewner: the z for which the computed roots are exact eigenvalues.
+			std::vector<DataType> zhat(k);
+			for (size_t i = 0; i < k; ++i)
+			{
+				DataType product = shifted(k - 1, i) / rho;
+				for (size_t j = 0; j + 1 < k; ++j)
+				{
+					product *= shifted(j, i) / (j < i ? dk[j] - dk[i] : dk[j + 1] - dk[i]);
+				}
+				zhat[i] = std::copysign(std::sqrt(std::max(product, DataType(0))), zk[i]);
+			}
+
+			// Eigenvectors in the sorted, rotated basis: e_s for deflated poles, the secular vectors on the
+			// active rows otherwise. Column active[j] holds root j.
+			std::vector<DataType> values(n);
+			Matrix<DataType> u(n, n);
+			std::fill(u.mData, u.mData + n * n, DataType(0));
+			for (size_t s = 0; s < n; ++s)
+			{
+				if (deflated[s])
+				{
+					u.mData[s * n + s] = DataType(1);
+					values[s] = ds[s];
+				}
+			}
+			ParallelFor(0, k, 16, [&](const size_t begin, const size_t end)
+			{
+				std::vector<DataType> vector(k);
+				for (size_t j = begin; j < end; ++j)
+				{
+					for (size_t i = 0; i < k; ++i)
+					{
+						vector[i] = -zhat[i] / shifted(j, i);
+					}
+					const DataType norm = Norm2(vector.data(), k, size_t(1));
+					const size_t columnIndex = active[j];
+					for (size_t i = 0; i < k; ++i)
+					{
+						u.mData[active[i] * n + columnIndex] = vector[i] / norm;
+					}
+					values[columnIndex] = dk[origins[j]] + offsets[j];
+				}
+			});
+			for (size_t r = rotations.size(); r-- > 0;)
+			{
+				const Rotation& g = rotations[r];
+				DataType* first = u.mData + g.First * n;
+				DataType* second = u.mData + g.Second * n;
+				for (size_t j = 0; j < n; ++j)
+				{
+					const DataType x = first[j];
+					const DataType y = second[j];
+					first[j] = g.C * x - g.S * y;
+					second[j] = g.S * x + g.C * y;
+				}
+			}
+
+			// Back to the unsorted basis, then Z = diag(Q1, Q2) U.
+			Matrix<DataType> basis(n, n);
+			for (size_t s = 0; s < n; ++s)
+			{
+				std::copy(u.mData + s * n, u.mData + (s + 1) * n, basis.mData + order[s] * n);
+			}
+			Matrix<DataType> q1(m, m);
+			Matrix<DataType> q2(n - m, n - m);
+			for (size_t i = 0; i < m; ++i)
+			{
+				std::copy(z + i * ldz, z + i * ldz + m, q1.mData + i * m);
+			}
+			for (size_t i = m; i < n; ++i)
+			{
+				std::copy(z + i * ldz + m, z + i * ldz + n, q2.mData + (i - m) * (n - m));
+			}
+			for (size_t i = 0; i < n; ++i)
+			{
+				std::fill(z + i * ldz, z + i * ldz + n, DataType(0));
+			}
+			ParallelGemmAccumulate(m, n, m, DataType(1), q1.mData, m, Op::NoTrans, basis.mData, n, Op::NoTrans, z, ldz);
+			ParallelGemmAccumulate(n - m, n, n - m, DataType(1), q2.mData, n - m, Op::NoTrans, basis.mData + m * n, n,
+				Op::NoTrans, z + m * ldz, ldz);
+
+			std::copy(values.begin(), values.end(), d);
+			SortEigenpairs(d, n, z, ldz);
+		}
+
+		// Inverse iteration for TopK eigenvectors, after LAPACK's stein. Eigenvalues closer than
+		// InverseIterationClusterGap * ||T|| to their predecessor form one cluster, whose vectors are
+		// kept orthogonal to each other; a vector is accepted once ||T x - lambda x|| is at most
+		// InverseIterationTolerance * sqrt(n) * eps * ||T||.
+		constexpr double InverseIterationClusterGap = 1e-3;
+		constexpr double InverseIterationTolerance = 16;
+		constexpr size_t InverseIterationMaxSteps = 8;
+
+		// Eigenvector of the tridiagonal (d, e) for the eigenvalue lambda by inverse iteration with a
+		// pivoted LU of T - shift I (LAPACK's gttrf/gttrs), starting from a random vector. Every step
+		// orthogonalizes against the previous vectors of the same cluster (twice, as one Gram-Schmidt
+		// pass can leave a component behind when the solve amplifies it). Throws runtime_error when
+		// the residual does not drop below the tolerance.
+		template<typename DataType, typename Generator>
+		void TridiagonalInverseIteration(const DataType* d, const DataType* e, const size_t n, const DataType lambda,
+			const DataType shift, const DataType norm, const std::vector<const DataType*>& cluster, Generator& generator, DataType* x)
+		{
+			const DataType eps = std::numeric_limits<DataType>::epsilon();
+			const DataType tiny = eps * std::max(norm, std::numeric_limits<DataType>::min());
+			const DataType tolerance = DataType(InverseIterationTolerance) * std::sqrt(DataType(n)) * eps * std::max(norm, tiny);
+			std::vector<DataType> lower(n), diagonal(n), upper(n), upper2(n);
+			std::vector<bool> swapped(n, false);
+			for (size_t i = 0; i < n; ++i)
+			{
+				diagonal[i] = d[i] - shift;
+				if (i + 1 < n)
+				{
+					lower[i] = e[i];
+					upper[i] = e[i];
+				}
+			}
+			for (size_t i = 0; i + 1 < n; ++i)
+			{
+				if (std::abs(diagonal[i]) >= std::abs(lower[i]))
+				{
+					if (diagonal[i] == DataType(0))
+					{
+						diagonal[i] = tiny;
+					}
+					const DataType factor = lower[i] / diagonal[i];
+					lower[i] = factor;
+					diagonal[i + 1] -= factor * upper[i];
+				}
+				else
+				{
+					const DataType factor = diagonal[i] / lower[i];
+					diagonal[i] = lower[i];
+					lower[i] = factor;
+					const DataType temp = upper[i];
+					upper[i] = diagonal[i + 1];
+					diagonal[i + 1] = temp - factor * diagonal[i + 1];
+					if (i + 2 < n)
+					{
+						upper2[i] = upper[i + 1];
+						upper[i + 1] = -factor * upper[i + 1];
+					}
+					swapped[i] = true;
+				}
+			}
+			if (diagonal[n - 1] == DataType(0))
+			{
+				diagonal[n - 1] = tiny;
+			}
+
+			const auto orthonormalize = [&]()
+			{
+				for (size_t pass = 0; pass < 2; ++pass)
+				{
+					for (const DataType* other : cluster)
+					{
+						DataType projection = 0;
+						for (size_t i = 0; i < n; ++i)
+						{
+							projection += other[i] * x[i];
+						}
+						for (size_t i = 0; i < n; ++i)
+						{
+							x[i] -= projection * other[i];
+						}
+					}
+				}
+				const DataType length = Norm2(x, n, size_t(1));
+				for (size_t i = 0; i < n; ++i)
+				{
+					x[i] /= length;
+				}
+			};
+			std::uniform_real_distribution<DataType> distribution(DataType(-1), DataType(1));
+			for (size_t i = 0; i < n; ++i)
+			{
+				x[i] = distribution(generator);
+			}
+			orthonormalize();
+			for (size_t step = 0; step < InverseIterationMaxSteps; ++step)
+			{
+				for (size_t i = 0; i + 1 < n; ++i)
+				{
+					if (swapped[i])
+					{
+						const DataType temp = x[i];
+						x[i] = x[i + 1];
+						x[i + 1] = temp - lower[i] * x[i];
+					}
+					else
+					{
+						x[i + 1] -= lower[i] * x[i];
+					}
+				}
+				for (size_t i = n; i-- > 0;)
+				{
+					DataType value = x[i];
+					if (i + 1 < n) value -= upper[i] * x[i + 1];
+					if (i + 2 < n) value -= upper2[i] * x[i + 2];
+					x[i] = value / diagonal[i];
+				}
+				orthonormalize();
+
+				DataType residual = 0;
+				for (size_t i = 0; i < n; ++i)
+				{
+					DataType value = (d[i] - lambda) * x[i];
+					if (i > 0) value += e[i - 1] * x[i - 1];
+					if (i + 1 < n) value += e[i] * x[i + 1];
+					residual += value * value;
+				}
+				if (std::sqrt(residual) <= tolerance)
+				{
+					return;
+				}
+			}
+			throw std::runtime_error("Inverse iteration did not converge.");
+		}
+	} // namespace Detail
+
+	// Eigen-decomposition A = V diag(lambda) V^T of a symmetric matrix. Only the lower triangle of A
+	// is referenced. A is reduced to tridiagonal form by blocked Householder panels whose trailing
+	// rank-2k updates are Gemm calls, the tridiagonal problem is solved by divide and conquer, and the
+	// eigenvectors are back-transformed with compact WY block reflectors.
+	template<typename DataType>
+	class LAR_EXPORT SymmetricEigen
+	{
+		static_assert(std::is_floating_point<DataType>::value, "SymmetricEigen requires a floating-point element type.");
+
+	public:
+		explicit SymmetricEigen(const Matrix<DataType>& a, const SymmetricEigenOptions& options = SymmetricEigenOptions())
+			: mEigenvalues(0), mEigenvectors(0, 0)
+		{
+			if (!a.IsSquare())
+			{
+				throw std::invalid_argument("Matrix must be square to compute its eigenvalues.");
+			}
+			const size_t n = a.GetRows();
+			const size_t blockSize = std::max<size_t>(1, options.BlockSize);
+			const size_t count = options.TopK == 0 ? n : std::min(options.TopK, n);
+
+			Matrix<DataType> factors(a);
+			DataType* f = factors.mData;
+			for (size_t i = 0; i < n; ++i)
+			{
+				for (size_t j = i + 1; j < n; ++j)
+				{
+					f[i * n + j] = f[j * n + i];
+				}
+			}
+			std::vector<DataType> d(n), e(n), tau(n);
+			Detail::Tridiagonalize(f, n, blockSize, d.data(), e.data(), tau.data());
+
+			if (options.ComputeEigenvectors && count == n)
+			{
+				Matrix<DataType> z(n, n);
+				Detail::TridiagonalDivideConquer(d.data(), e.data(), n, z.mData, n, options.ParallelDepth);
+				Detail::ApplyHessenbergQ(f, n, tau.data(), blockSize, z.mData, n, n);
+				mEigenvectors = std::move(z);
+				mEigenvalues = Vector<DataType>(d.data(), n);
+				return;
+			}
+
+			std::vector<DataType> values(d);
+			std::vector<DataType> scratch(e);
+			Detail::TridiagonalQL(values.data(), scratch.data(), n, static_cast<DataType*>(nullptr), 0, 0);
+			std::sort(values.begin(), values.end());
+			mEigenvalues = Vector<DataType>(values.data() + (n - count), count);
+			if (!options.ComputeEigenvectors)
+			{
+				return;
+			}
+
+			// Top-k: inverse iteration on T for the selected eigenvalues, then back-transform k columns.
+			DataType norm = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				norm = std::max(norm, std::abs(d[i]) + (i + 1 < n ? std::abs(e[i]) : DataType(0)) + (i > 0 ? std::abs(e[i - 1]) : DataType(0)));
+			}
+			// Seeded, so the same matrix always yields the same vectors.
+			std::mt19937_64 generator(1);
+			const DataType clusterGap = DataType(Detail::InverseIterationClusterGap) * norm;
+			const DataType perturbation = DataType(10) * std::numeric_limits<DataType>::epsilon() * norm;
+			std::vector<DataType> vectors(count * n);
+			std::vector<const DataType*> cluster;
+			DataType shift = 0;
+			for (size_t j = 0; j < count; ++j)
+			{
+				const DataType lambda = mEigenvalues[j];
+				if (j > 0 && lambda - mEigenvalues[j - 1] <= clusterGap)
+				{
+					cluster.push_back(vectors.data() + (j - 1) * n);
+					// Equal eigenvalues still get distinct shifts, so each solve favours a new direction.
+					shift = std::max(lambda, shift + perturbation);
+				}
+				else
+				{
+					cluster.clear();
+					shift = lambda;
+				}
+				Detail::TridiagonalInverseIteration(d.data(), e.data(), n, lambda, shift, norm, cluster, generator, vectors.data() + j * n);
+			}
+			Matrix<DataType> z(n, count);
+			for (size_t i = 0; i < n; ++i)
+			{
+				for (size_t j = 0; j < count; ++j)
+				{
+					z.mData[i * count + j] = vectors[j * n + i];
+				}
+			}
+			Detail::ApplyHessenbergQ(f, n, tau.data(), blockSize, z.mData, count, count);
+			mEigenvectors = std::move(z);
+		}
+
+		// Ascending. With TopK these are the TopK largest eigenvalues, still in ascending order.
+		const Vector<DataType>& Eigenvalues() const { return mEigenvalues; }
+
+		// Column j belongs to Eigenvalues()[j]; empty when eigenvectors were not requested.
+		const Matrix<DataType>& Eigenvectors() const { return mEigenvectors; }
+
+	private:
+		Vector<DataType> mEigenvalues;
+		Matrix<DataType> mEigenvectors;
+	};
+} // namespace LAR
@@ -1,7 +1,12 @@
 #pragma once
 #include "MatrixBase.h"
 #include "LAR_export.h"
+#include "Gemv.h"
+#include "Reduction.h"
+#include <algorithm>
+#include <initializer_list>
 #include <ostream>
+#include <type_traits>
 
 namespace LAR
 {
@@ -17,29 +22,28 @@ namespace LAR
 		{
 		}
 
+		// Copies any single row or column; the orientation of the result is always RowVector's.
 		template<typename OtherDerived>
 		Vector(const MatrixBase<OtherDerived, DataType>& other)
-			: MatrixBase<Vector<DataType, RowVector>, DataType>(other)
+			: Vector(other.mNumRows * other.mNumCols)
 		{
+			if (other.mNumRows != 1 && other.mNumCols != 1)
+			{
+				throw std::invalid_argument("Only a single row or column can be converted to a vector.");
+			}
+			std::copy(other.mData, other.mData + GetSize(), this->mData);
 		}
 
 		Vector(const std::initializer_list<DataType>& list)
-			: MatrixBase<Vector<DataType, true>, DataType>(1, list.size())
+			: Vector(list.size())
 		{
-			size_t i = 0;
-			for (const auto& value : list)
-			{
-				(*this)[i++] = value;
-			}
+			std::copy(list.begin(), list.end(), this->mData);
 		}
 
-		Vector(const DataType* data, const size_t size, const bool rowVector = false)
-			: MatrixBase<Vector<DataType, RowVector>, DataType>(rowVector ? 1 : size, rowVector ? size : 1)
+		Vector(const DataType* data, const size_t size)
+			: Vector(size)
 		{
-			for (size_t i = 0; i < size; ++i)
-			{
-				(*this)[i] = data[i];
-			}
+			std::copy(data, data + size, this->mData);
 		}
 
 		template<typename OtherDataType, bool OtherRowVector>
@@ -49,28 +53,36 @@ namespace LAR
 			{
 				throw std::invalid_argument("Vectors must be the same size to multiply them.");
 			}
-			DataType result = 0;
-			for (size_t i = 0; i < GetSize(); ++i)
-			{
-				result += (*this)[i] * other[i];
-			}
-			return result;
+			return Dot<DataType>(this->mData, other.mData, GetSize());
 		}
 
 		template<typename OtherDataType>
 		auto operator*(const Matrix<OtherDataType>& other) const
 		{
-			if (GetCols() != other.GetRows())
+			if (this->GetCols() != other.GetRows())
 			{
 				throw std::invalid_argument("Number of columns in vector must match number of rows in matrix.");
 			}
-			Vector<decltype(DataType()* OtherDataType()), RowVector> result(other.GetCols());
-			for (size_t i = 0; i < other.GetCols(); ++i)
+			using ResultType = decltype(DataType()* OtherDataType());
+			Vector<ResultType, RowVector> result(other.GetCols());
+			if constexpr (std::is_same<DataType, ResultType>::value && std::is_same<OtherDataType, ResultType>::value)
+			{
+				// x^T * A == (A^T * x)^T, which Gemv evaluates by streaming the rows of A.
+				Gemv(ResultType(1), Op::Trans, other, *this, ResultType(0), result);
+			}
+			else
 			{
-				result[i] = 0;
+				for (size_t i = 0; i < other.GetCols(); ++i)
+				{
+					result[i] = 0;
+				}
 				for (size_t j = 0; j < GetSize(); ++j)
 				{
-					result[i] += (*this)[j] * other(j, i);
+					const DataType xj = (*this)[j];
+					for (size_t i = 0; i < other.GetCols(); ++i)
+					{
+						result[i] += xj * other(j, i);
+					}
 				}
 			}
 			return result;
@@ -78,46 +90,63 @@ namespace LAR
 
 		size_t GetSize() const
 		{
-			return mNumRows == 1 ? GetCols() : GetRows();
+			return RowVector ? this->mNumCols : this->mNumRows;
+		}
+
+		static constexpr bool IsRowVector()
+		{
+			return RowVector;
 		}
 
+		// Storage is contiguous for both orientations, so element i is always mData[i].
 		DataType& operator[](const size_t index)
 		{
-			if (GetRows() == 1)
-			{
-				return this->AsDerived().operator()(0, index);
-			}
-			else
-			{
-				return this->AsDerived().operator()(index, 0);
-			}
+			return this->mData[index];
 		}
 
 		DataType operator[](const size_t index) const
 		{
-			if (GetRows() == 1)
-			{
-				return this->AsDerived()(0, index);
-			}
-			else
-			{
-				return this->AsDerived()(index, 0);
-			}
+			return this->mData[index];
+		}
+
+		DataType* Data() { return this->mData; }
+		const DataType* Data() const { return this->mData; }
+
+		DataType* begin() { return this->mData; }
+		DataType* end() { return this->mData + GetSize(); }
+		const DataType* begin() const { return this->mData; }
+		const DataType* end() const { return this->mData + GetSize(); }
+
+		// Flipping orientation never reorders elements. Only the rvalue overload is zero-copy: it hands
+		// the buffer over, so write std::move(x).Transpose() when x is no longer needed. The lvalue
+		// overload must leave x intact and therefore copies all n elements. DotProduct, operator* and
+		// OuterProduct accept either orientation, so they never need a transpose first.
+		Vector<DataType, !RowVector> Transpose() const&
+		{
+			return Vector<DataType, !RowVector>(this->mData, GetSize());
 		}
 
+		Vector<DataType, !RowVector> Transpose()&&
+		{
+			Vector<DataType, !RowVector> result(typename Vector<DataType, !RowVector>::AdoptTag(), GetSize(), this->mData, this->mScratch);
+			this->mNumRows = 0;
+			this->mNumCols = 0;
+			this->mScratch = ScratchOwner();
+			this->mData = nullptr;
+			return result;
+		}
+
+		// The orientation is part of the type; use Transpose() to get the other one.
+		Vector& TransposeInPlace() = delete;
+
 		template<typename OtherDataType, bool OtherRowVector>
-		DataType DotProduct(const Vector<OtherDataType, OtherRowVector>& other) const
+		DataType DotProduct(const Vector<OtherDataType, OtherRowVector>& other, const ReductionMode mode = GetReductionMode()) const
 		{
 			if (GetSize() != other.GetSize())
 			{
 				throw std::invalid_argument("Vectors must be the same size to calculate the dot product.");
 			}
-			DataType result = 0;
-			for (size_t i = 0; i < GetSize(); ++i)
-			{
-				result += (*this)[i] * other[i];
-			}
-			return result;
+			return Dot<DataType>(this->mData, other.mData, GetSize(), mode);
 		}
 
 		template<typename OtherDataType, bool OtherRowVector>
@@ -127,25 +156,45 @@ namespace LAR
 			{
 				throw std::invalid_argument("Both vectors must be of size 3 to calculate the cross product.");
 			}
+			const DataType* a = this->mData;
+			const OtherDataType* b = other.mData;
 			Vector<DataType, RowVector> result(3);
-			result[0] = (*this)[1] * other[2] - (*this)[2] * other[1];
-			result[1] = (*this)[2] * other[0] - (*this)[0] * other[2];
-			result[2] = (*this)[0] * other[1] - (*this)[1] * other[0];
+			result.mData[0] = a[1] * b[2] - a[2] * b[1];
+			result.mData[1] = a[2] * b[0] - a[0] * b[2];
+			result.mData[2] = a[0] * b[1] - a[1] * b[0];
 			return result;
 		}
 
 		template<typename OtherDataType, bool OtherRowVector>
 		Matrix<DataType> OuterProduct(const Vector<OtherDataType, OtherRowVector>& other) const
 		{
-			Matrix<DataType> result(GetSize(), other.GetSize());
-			for (size_t i = 0; i < GetSize(); ++i)
+			const size_t rows = GetSize();
+			const size_t cols = other.GetSize();
+			const OtherDataType* y = other.mData;
+			Matrix<DataType> result(rows, cols);
+			for (size_t i = 0; i < rows; ++i)
 			{
-				for (size_t j = 0; j < other.GetSize(); ++j)
+				const DataType xi = this->mData[i];
+				DataType* row = result.mData + i * cols;
+				for (size_t j = 0; j < cols; ++j)
 				{
-					result(i, j) = (*this)[i] * other[j];
+					row[j] = xi * y[j];
 				}
 			}
 			return result;
 		}
+
+	private:
+		template<typename, bool>
+		friend class Vector;
+
+		struct AdoptTag
+		{
+		};
+
+		Vector(AdoptTag, const size_t size, DataType* data, const ScratchOwner& scratch)
+			: MatrixBase<Vector<DataType, RowVector>, DataType>(RowVector ? 1 : size, RowVector ? size : 1, data, scratch)
+		{
+		}
 	};
 }
\ No newline at end of file
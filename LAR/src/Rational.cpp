@@ -1,5 +1,6 @@
 #include "LAR/Rational.h"
 #include "LAR/Algorithms.h"
+#include <cmath>
 namespace LAR
 {
 	void Rational::Simplify()
@@ -37,24 +38,21 @@ namespace LAR
 
 	Rational Rational::operator+(const Rational& other) const
 	{
-		int num1, den1, num2, den2;
-		SimplifyForOperation(*this, other, num1, den1, num2, den2);
-
-		int newNumerator = num1 * den2 + num2 * den1;
-		int newDenominator = den1 * den2;
+		// Cross-cancellation only holds for products; sums go over the least common denominator.
+		const int gcd = std::gcd(mDenominator, other.mDenominator);
+		const int scale1 = other.mDenominator / gcd;
+		const int scale2 = mDenominator / gcd;
 
-		return Rational(newNumerator, newDenominator);
+		return Rational(mNumerator * scale1 + other.mNumerator * scale2, mDenominator * scale1);
 	}
 
 	Rational Rational::operator-(const Rational& other) const
 	{
-		int num1, den1, num2, den2;
-		SimplifyForOperation(*this, other, num1, den1, num2, den2);
-		
-		int newNumerator = num1 * den2 - num2 * den1;
-		int newDenominator = den1 * den2;
+		const int gcd = std::gcd(mDenominator, other.mDenominator);
+		const int scale1 = other.mDenominator / gcd;
+		const int scale2 = mDenominator / gcd;
 
-		return Rational(newNumerator, newDenominator);
+		return Rational(mNumerator * scale1 - other.mNumerator * scale2, mDenominator * scale1);
 	}
 
 	Rational Rational::operator*(const Rational& other) const
@@ -5,6 +5,31 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <cstddef>
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <set>
+
+// Counts heap allocations on the calling thread, so tests can check that a code path stays off the
+// heap. Storage comes from the aligned allocation functions, which are left as they are.
+static thread_local size_t HeapAllocations = 0;
+
+void* operator new(const size_t size)
+{
+	++HeapAllocations;
+	return ::operator new(size, std::align_val_t(alignof(std::max_align_t)));
+}
+
+void operator delete(void* data) noexcept
+{
+	::operator delete(data, std::align_val_t(alignof(std::max_align_t)));
+}
+
+void operator delete(void* data, size_t) noexcept
+{
+	::operator delete(data, std::align_val_t(alignof(std::max_align_t)));
+}
 
 TEST_CASE("MatrixTest", "[MatrixTest]")
 {
@@ -26,4 +51,1089 @@ TEST_CASE("MatrixTest", "[MatrixTest]")
 	std::cout << "m1 / 2: " << m8 << std::endl;
 	auto m9 = m1.Transpose();
 	std::cout << "m1.transpose(): " << m9 << std::endl;
-}
\ No newline at end of file
+}
+
+TEST_CASE("ScratchScopeTest", "[MatrixTest]")
+{
+	LAR::Matrix<double> m1 = LAR::Matrix<double>::Random(4, 4, 0, 20);
+	LAR::Matrix<double> kept(4, 4);
+	{
+		LAR::ScratchScope scope(true);
+		auto m2 = m1 * m1;
+		kept = m2 + m1;
+		REQUIRE(m2.mScratch);
+		REQUIRE(scope.GetStats().BytesServed >= 2 * 16 * sizeof(double));
+	}
+	REQUIRE(!kept.mScratch);
+	REQUIRE(kept == m1 * m1 + m1);
+
+	// Moving between nested scopes copies; a swap would leave the outer matrix with inner-scope memory.
+	{
+		LAR::ScratchScope outer(true);
+		LAR::Matrix<double> held = m1 * 1.0;
+		const LAR::ScratchOwner owner = held.mScratch;
+		{
+			LAR::ScratchScope inner(true);
+			LAR::Matrix<double> temporary = m1 * 2.0;
+			held = std::move(temporary);
+			REQUIRE(held.mScratch == owner);
+		}
+		REQUIRE(held == m1 * 2.0);
+	}
+	REQUIRE(!LAR::ScratchArena::Current().IsActive());
+}
+
+TEST_CASE("ScratchScopeAllocationTest", "[MatrixTest]")
+{
+	const LAR::Matrix<double> a = LAR::Matrix<double>::Random(6, 6, -1.0, 1.0);
+	const std::vector<size_t> permutation = { 3, 0, 5, 1, 4, 2 };
+	LAR::Matrix<double> kept(6, 6);
+	LAR::Matrix<double> permuted = a;
+	const auto work = [&]()
+	{
+		{
+			LAR::ScratchScope scope(true);
+			LAR::Matrix<double> sum = a + a.Transpose() - a * 2.0;
+			LAR::Matrix<double> reduced = (-sum).RowEchelonForm();
+			LAR::Matrix<double> minor = reduced.Minor(1, 2);
+			kept = sum * reduced + a / 2.0;
+			kept(0, 0) += minor(0, 0);
+		}
+		LAR::ScratchScope scope;
+		permuted.PermuteRows(permutation);
+		permuted.PermuteCols(permutation);
+	};
+	work(); // The first scope reserves the arena's block.
+	const size_t before = HeapAllocations;
+	work();
+	REQUIRE(HeapAllocations == before);
+	REQUIRE(!kept.mScratch);
+
+	// A scratch result released on another thread goes back to the arena that served it.
+	{
+		LAR::ScratchScope scope(true);
+		LAR::Matrix<double> local = a * 2.0;
+		REQUIRE(local.mScratch);
+		std::thread([moved = std::move(local)]() mutable { LAR::Matrix<double> sink = std::move(moved); }).join();
+	}
+	REQUIRE(!LAR::ScratchArena::Current().IsActive());
+}
+
+TEST_CASE("BufferPoolTest", "[MatrixTest]")
+{
+	LAR::SetBufferPoolEnabled(true);
+	LAR::Matrix<double> a = LAR::Matrix<double>::Random(8, 8, -1, 1);
+	LAR::Vector<double> x(8);
+	for (size_t i = 0; i < 8; ++i)
+	{
+		x[i] = 1;
+	}
+	x = a * x;
+	LAR::BufferPool<double>::ResetStats();
+	for (int i = 0; i < 10; ++i)
+	{
+		x = a * x;
+	}
+	LAR::PoolStats stats = LAR::BufferPool<double>::GetStats();
+	REQUIRE(stats.Misses == 0);
+	REQUIRE(stats.ThreadHits == 10);
+
+	// Buffers are keyed by element count: a 6x2 reuses a released 2x6, a 3x5 does not.
+	{
+		LAR::Matrix<double> wide(2, 6);
+	}
+	LAR::BufferPool<double>::ResetStats();
+	LAR::Matrix<double> tall(6, 2);
+	LAR::Matrix<double> other(3, 5);
+	stats = LAR::BufferPool<double>::GetStats();
+	REQUIRE(stats.ThreadHits == 1);
+	REQUIRE(stats.Misses == 1);
+	LAR::SetBufferPoolEnabled(false);
+	LAR::BufferPool<double>::Clear();
+}
+
+TEST_CASE("OutputParameterTest", "[MatrixTest]")
+{
+	LAR::Matrix<int> a = LAR::Matrix<int>::Random(3, 4, 0, 20);
+	LAR::Matrix<int> b = LAR::Matrix<int>::Random(4, 2, 0, 20);
+	LAR::Matrix<int> product(3, 2);
+	LAR::Multiply(a, b, product);
+	REQUIRE(product == a * b);
+
+	// Correctly shaped outputs that alias an input are rejected by the alias check itself.
+	LAR::Matrix<int> square = LAR::Matrix<int>::Random(3, 3, 0, 20);
+	LAR::Matrix<int> other = LAR::Matrix<int>::Random(3, 3, 0, 20);
+	const std::string aliasMessage = "Output matrix must not alias an input of Multiply.";
+	REQUIRE_THROWS_WITH(LAR::Multiply(square, square, square), aliasMessage);
+	REQUIRE_THROWS_WITH(LAR::Multiply(square, other, other), aliasMessage);
+	REQUIRE_THROWS_WITH(LAR::Multiply(square, other, square), aliasMessage);
+	LAR::Vector<int> x(3);
+	REQUIRE_THROWS_WITH(LAR::Multiply(square, x, x), "Output vector must not alias the input of Multiply.");
+	REQUIRE_THROWS_WITH(LAR::Transpose(square, square), "Output must not alias the input of Transpose; use TransposeInPlace.");
+
+	LAR::Matrix<int> sum(3, 4);
+	LAR::Add(a, a, sum);
+	REQUIRE(sum == a * 2);
+	sum -= a;
+	sum *= 3;
+	REQUIRE(sum == a * 3);
+
+	LAR::Matrix<int> transposed = a;
+	transposed.TransposeInPlace();
+	REQUIRE(transposed == a.Transpose());
+
+	std::vector<std::vector<LAR::Rational>> data = { {1, 2, 3}, {4, 5, 6} };
+	LAR::Matrix<LAR::Rational> r = data;
+	LAR::Matrix<LAR::Rational> echelon = r.RowEchelonForm();
+	REQUIRE(r.RowEchelonFormInPlace() == echelon);
+}
+
+TEST_CASE("GemmTest", "[MatrixTest]")
+{
+	LAR::Matrix<double> a = LAR::Matrix<double>::Random(70, 90, -1, 1);
+	LAR::Matrix<double> b = LAR::Matrix<double>::Random(70, 50, -1, 1);
+	LAR::Matrix<double> c = LAR::Matrix<double>::Random(90, 50, -1, 1);
+	LAR::Matrix<double> expected = a.Transpose() * b + c * 2;
+	LAR::Gemm(1.0, LAR::Op::Trans, a, LAR::Op::NoTrans, b, 2.0, c);
+	for (size_t i = 0; i < c.GetRows() * c.GetCols(); ++i)
+	{
+		REQUIRE(std::abs(c.mData[i] - expected.mData[i]) < 1e-9);
+	}
+
+	LAR::Matrix<double> bt = b.Transpose();
+	LAR::Matrix<double> product(90, 50);
+	LAR::Gemm(1.0, LAR::Op::Trans, a, LAR::Op::Trans, bt, 0.0, product);
+	LAR::Matrix<double> reference = a.Transpose() * b;
+	for (size_t i = 0; i < product.GetRows() * product.GetCols(); ++i)
+	{
+		REQUIRE(std::abs(product.mData[i] - reference.mData[i]) < 1e-9);
+	}
+}
+
+TEST_CASE("StrassenTest", "[MatrixTest]")
+{
+	LAR::Matrix<int> a = LAR::Matrix<int>::Random(67, 70, -5, 5);
+	LAR::Matrix<int> b = LAR::Matrix<int>::Random(70, 65, -5, 5);
+	LAR::Matrix<int> expected = a * b;
+	LAR::Matrix<int> c(67, 65);
+	LAR::StrassenOptions options;
+	options.Crossover = 8;
+	options.ParallelDepth = 2;
+	LAR::StrassenMultiply(a, b, c, options);
+	REQUIRE(c == expected);
+
+	LAR::SetMultiplyAlgorithm(LAR::MultiplyAlgorithm::Strassen, 16);
+	REQUIRE(a * b == expected);
+	LAR::SetMultiplyAlgorithm(LAR::MultiplyAlgorithm::Blocked);
+}
+
+TEST_CASE("GemvTest", "[MatrixTest]")
+{
+	LAR::Matrix<double> a = LAR::Matrix<double>::Random(37, 21, -1, 1);
+	LAR::Vector<double> x(37);
+	LAR::Vector<double> y(21);
+	for (size_t i = 0; i < 37; ++i)
+	{
+		x[i] = LAR::RandomValue(-1.0, 1.0);
+	}
+	for (size_t i = 0; i < 21; ++i)
+	{
+		y[i] = 1;
+	}
+	LAR::Matrix<double> at = a.Transpose();
+	LAR::Gemv(2.0, LAR::Op::Trans, a, x, 0.5, y);
+	auto product = at * x;
+	LAR::Vector<double, true> xRow = x.Transpose();
+	auto rowProduct = xRow * a;
+	for (size_t i = 0; i < 21; ++i)
+	{
+		REQUIRE(std::abs(y[i] - (2 * product[i] + 0.5)) < 1e-12);
+		REQUIRE(std::abs(rowProduct[i] - product[i]) < 1e-12);
+	}
+}
+
+TEST_CASE("VectorTest", "[MatrixTest]")
+{
+	LAR::Vector<int, true> row = { 1, 2, 3 };
+	REQUIRE(row.GetRows() == 1);
+	REQUIRE(row.GetSize() == 3);
+	LAR::Vector<int> col = { 4, 5, 6 };
+	REQUIRE(col.GetCols() == 1);
+	REQUIRE(row.DotProduct(col) == 32);
+	REQUIRE(row.CrossProduct(col) == LAR::Vector<int, true>({ -3, 6, -3 }));
+
+	// Transposing an lvalue copies and leaves the source alone; an rvalue hands its buffer over.
+	const int* data = col.Data();
+	const LAR::Vector<int, true> copied = col.Transpose();
+	REQUIRE(copied.Data() != data);
+	REQUIRE(col.Data() == data);
+	REQUIRE(copied == LAR::Vector<int, true>({ 4, 5, 6 }));
+	LAR::Vector<int, true> flipped = std::move(col).Transpose();
+	REQUIRE(flipped.Data() == data);
+	REQUIRE(flipped.GetRows() == 1);
+	REQUIRE(flipped[2] == 6);
+	REQUIRE(row.OuterProduct(flipped)(2, 1) == 15);
+}
+
+TEST_CASE("ReductionModeTest", "[MatrixTest]")
+{
+	const size_t n = 300000;
+	LAR::Vector<double> x(n);
+	LAR::Vector<double> y(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		x[i] = i % 2 == 0 ? 1e8 : 1e-8;
+		y[i] = i % 3 == 0 ? -1.0 : 1.0;
+	}
+	// The default stays a plain left-to-right loop; the other modes are opt-in.
+	REQUIRE(LAR::GetReductionMode() == LAR::ReductionMode::Naive);
+	double naive = 0.0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		naive += x[i] * y[i];
+	}
+	REQUIRE(x.DotProduct(y) == naive);
+	REQUIRE(x * y == naive);
+
+	const double kahan = x.DotProduct(y, LAR::ReductionMode::Kahan);
+	REQUIRE(std::abs(x.DotProduct(y, LAR::ReductionMode::Pairwise) - kahan) <= 1e-6 * std::abs(kahan));
+	REQUIRE(std::abs(x.DotProduct(y, LAR::ReductionMode::Fast) - kahan) <= 1e-6 * std::abs(kahan));
+
+	LAR::SetMaxThreads(1);
+	const double serial = x.DotProduct(y, LAR::ReductionMode::Reproducible);
+	LAR::SetMaxThreads(3);
+	REQUIRE(x.DotProduct(y, LAR::ReductionMode::Reproducible) == serial);
+	LAR::SetMaxThreads(0);
+
+	LAR::Matrix<int> magic = LAR::Matrix<int>::Magic(5);
+	REQUIRE(magic.Trace(LAR::ReductionMode::Pairwise) == magic.Trace(LAR::ReductionMode::Naive));
+}
+
+TEST_CASE("ParallelForTest", "[MatrixTest]")
+{
+	// Every index runs exactly once, loops reuse the same pool threads, a nested loop runs inline
+	// rather than waiting on the busy pool, and an exception from a worker chunk reaches the caller.
+	LAR::SetMaxThreads(4);
+	std::vector<std::atomic<int>> hits(1000);
+	std::mutex idMutex;
+	std::set<std::thread::id> ids;
+	for (size_t round = 0; round < 200; ++round)
+	{
+		LAR::ParallelFor(0, hits.size(), 1, [&](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				++hits[i];
+			}
+			std::lock_guard<std::mutex> lock(idMutex);
+			ids.insert(std::this_thread::get_id());
+		});
+	}
+	for (const std::atomic<int>& hit : hits)
+	{
+		REQUIRE(hit == 200);
+	}
+	REQUIRE(ids.size() <= 4);
+
+	std::atomic<size_t> inner{ 0 };
+	LAR::ParallelFor(0, 8, 1, [&inner](const size_t begin, const size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			LAR::ParallelFor(0, 100, 1, [&inner](const size_t b, const size_t e) { inner += e - b; });
+		}
+	});
+	REQUIRE(inner == 800);
+
+	REQUIRE_THROWS_WITH(LAR::ParallelFor(0, 100, 1, [](const size_t begin, const size_t)
+	{
+		if (begin != 0)
+		{
+			throw std::runtime_error("worker chunk");
+		}
+	}), "worker chunk");
+	LAR::SetMaxThreads(0);
+}
+
+TEST_CASE("QRTest", "[MatrixTest]")
+{
+	LAR::Matrix<double> a = LAR::Matrix<double>::Random(80, 45, -1, 1);
+	LAR::QROptions options;
+	options.BlockSize = 8;
+	LAR::QR<double> qr(a, options);
+	LAR::Matrix<double> q = qr.ThinQ();
+	LAR::Matrix<double> reconstructed = q * qr.R();
+	for (size_t i = 0; i < 80 * 45; ++i)
+	{
+		REQUIRE(std::abs(reconstructed.mData[i] - a.mData[i]) < 1e-12);
+	}
+
+	// Repeated applications reuse the stored block reflectors: Q Q^T b = b, and Q^T of A's columns is R.
+	LAR::Matrix<double> block = LAR::Matrix<double>::Random(80, 3, -1, 1);
+	LAR::Matrix<double> applied = block;
+	for (int pass = 0; pass < 3; ++pass)
+	{
+		qr.ApplyQ(applied, LAR::Op::Trans);
+		qr.ApplyQ(applied, LAR::Op::NoTrans);
+	}
+	for (size_t i = 0; i < 80 * 3; ++i)
+	{
+		REQUIRE(std::abs(applied.mData[i] - block.mData[i]) < 1e-12);
+	}
+	LAR::Matrix<double> qta = a;
+	qr.ApplyQ(qta, LAR::Op::Trans);
+	const LAR::Matrix<double> r = qr.R();
+	for (size_t i = 0; i < 80; ++i)
+	{
+		REQUIRE(std::abs(qta(i, 0) - (i == 0 ? r(0, 0) : 0.0)) < 1e-12);
+		REQUIRE(std::abs(qta(i, 44) - (i < 45 ? r(i, 44) : 0.0)) < 1e-12);
+	}
+
+	// The least-squares residual is orthogonal to the column space of A.
+	LAR::Vector<double> b(80);
+	for (size_t i = 0; i < 80; ++i)
+	{
+		b[i] = LAR::RandomValue(-1.0, 1.0);
+	}
+	LAR::Vector<double> x = LAR::LeastSquares(a, b);
+	LAR::Vector<double> residual = a * x - b;
+	LAR::Vector<double> normal = a.Transpose() * residual;
+	for (size_t i = 0; i < 45; ++i)
+	{
+		REQUIRE(std::abs(normal[i]) < 1e-10);
+	}
+
+	// Duplicated columns make the matrix rank deficient; pivoting reveals it.
+	LAR::Matrix<double> deficient(30, 6);
+	for (size_t i = 0; i < 30; ++i)
+	{
+		for (size_t j = 0; j < 3; ++j)
+		{
+			deficient(i, j) = deficient(i, j + 3) = LAR::RandomValue(-1.0, 1.0);
+		}
+	}
+	options.ColumnPivoting = true;
+	REQUIRE(LAR::QR<double>(deficient, options).Rank() == 3);
+}
+
+TEST_CASE("SymmetricEigenTest", "[MatrixTest]")
+{
+	const size_t n = 150;
+	LAR::Matrix<double> x = LAR::Matrix<double>::Random(n, n, -1, 1);
+	LAR::Matrix<double> a = x + x.Transpose();
+	// Repeated eigenvalues exercise the deflation path of divide and conquer.
+	LAR::Matrix<double> repeated(n, n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		for (size_t j = 0; j < n; ++j)
+		{
+			repeated(i, j) = i == j ? double(i % 4) : 0.0;
+		}
+	}
+	LAR::SymmetricEigenOptions options;
+	options.BlockSize = 16;
+	for (const LAR::Matrix<double>* matrix : { &a, &repeated })
+	{
+		LAR::SymmetricEigen<double> eigen(*matrix, options);
+		const LAR::Matrix<double>& v = eigen.Eigenvectors();
+		LAR::Matrix<double> av = *matrix * v;
+		LAR::Matrix<double> vtv = v.Transpose() * v;
+		for (size_t i = 0; i < n; ++i)
+		{
+			for (size_t j = 0; j < n; ++j)
+			{
+				REQUIRE(std::abs(av(i, j) - v(i, j) * eigen.Eigenvalues()[j]) < 1e-10);
+				REQUIRE(std::abs(vtv(i, j) - (i == j ? 1.0 : 0.0)) < 1e-10);
+			}
+		}
+	}
+
+	LAR::SymmetricEigen<double> full(a, options);
+	options.ComputeEigenvectors = false;
+	LAR::SymmetricEigen<double> values(a, options);
+	REQUIRE(values.Eigenvectors().GetCols() == 0);
+	options.ComputeEigenvectors = true;
+	options.TopK = 5;
+	LAR::SymmetricEigen<double> top(a, options);
+	REQUIRE(top.Eigenvectors().GetCols() == 5);
+	for (size_t j = 0; j < 5; ++j)
+	{
+		const double lambda = full.Eigenvalues()[n - 5 + j];
+		REQUIRE(std::abs(values.Eigenvalues()[n - 5 + j] - lambda) < 1e-10);
+		REQUIRE(std::abs(top.Eigenvalues()[j] - lambda) < 1e-10);
+		double residual = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			double row = -lambda * top.Eigenvectors()(i, j);
+			for (size_t k = 0; k < n; ++k)
+			{
+				row += a(i, k) * top.Eigenvectors()(k, j);
+			}
+			residual = std::max(residual, std::abs(row));
+		}
+		REQUIRE(residual < 1e-9);
+	}
+
+	// Top-k inside a repeated eigenvalue (three copies of 100) and a tight cluster (50 and 50 + 1e-9):
+	// the vectors must still be orthonormal eigenvectors.
+	const size_t m = 60;
+	const LAR::Matrix<double> q = LAR::QR<double>(LAR::Matrix<double>::Random(m, m, -1, 1)).ThinQ();
+	LAR::Matrix<double> scaledQ = q;
+	for (size_t i = 0; i < m; ++i)
+	{
+		for (size_t j = 0; j < m; ++j)
+		{
+			const double lambda = j >= m - 3 ? 100.0 : (j == m - 4 ? 50.0 + 1e-9 : (j == m - 5 ? 50.0 : double(j) / 4));
+			scaledQ(i, j) *= lambda;
+		}
+	}
+	LAR::Matrix<double> clustered = scaledQ * q.Transpose();
+	for (const LAR::Matrix<double>* matrix : { &clustered, &repeated })
+	{
+		options.TopK = 6;
+		LAR::SymmetricEigen<double> topClustered(*matrix, options);
+		const LAR::Matrix<double>& v = topClustered.Eigenvectors();
+		const LAR::Matrix<double> av = *matrix * v;
+		const LAR::Matrix<double> vtv = v.Transpose() * v;
+		for (size_t j = 0; j < 6; ++j)
+		{
+			for (size_t i = 0; i < matrix->GetRows(); ++i)
+			{
+				REQUIRE(std::abs(av(i, j) - v(i, j) * topClustered.Eigenvalues()[j]) < 1e-9);
+			}
+			for (size_t k = 0; k < 6; ++k)
+			{
+				REQUIRE(std::abs(vtv(j, k) - (j == k ? 1.0 : 0.0)) < 1e-10);
+			}
+		}
+	}
+}
+
+TEST_CASE("EigenTest", "[MatrixTest]")
+{
+	// Large enough for early deflation and its runs of double-shift sweeps to take part.
+	const size_t n = 120;
+	LAR::Matrix<double> a = LAR::Matrix<double>::Random(n, n, -1, 1);
+	LAR::EigenOptions options;
+	options.ComputeEigenvectors = true;
+	options.BlockSize = 16;
+	LAR::Eigen<double> eigen(a, options);
+
+	const LAR::Matrix<double>& t = eigen.Schur();
+	const LAR::Matrix<double>& z = eigen.SchurVectors();
+	LAR::Matrix<double> reconstructed = z * t * z.Transpose();
+	for (size_t i = 0; i < n; ++i)
+	{
+		for (size_t j = 0; j < n; ++j)
+		{
+			REQUIRE(std::abs(reconstructed(i, j) - a(i, j)) < 1e-11);
+			if (j + 1 < i)
+			{
+				REQUIRE(t(i, j) == 0.0);
+			}
+		}
+	}
+
+	// A v = lambda v, with complex vectors packed as (real, imaginary) column pairs.
+	const std::vector<std::complex<double>> values = eigen.Eigenvalues();
+	const LAR::Matrix<double>& v = eigen.Eigenvectors();
+	for (size_t k = 0; k < n; ++k)
+	{
+		const bool complex = values[k].imag() != 0.0;
+		const size_t re = complex && values[k].imag() < 0.0 ? k - 1 : k;
+		const double sign = values[k].imag() < 0.0 ? -1.0 : 1.0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			std::complex<double> av = 0;
+			for (size_t j = 0; j < n; ++j)
+			{
+				av += a(i, j) * std::complex<double>(v(j, re), complex ? sign * v(j, re + 1) : 0.0);
+			}
+			const std::complex<double> vi(v(i, re), complex ? sign * v(i, re + 1) : 0.0);
+			REQUIRE(std::abs(av - values[k] * vi) < 1e-10);
+		}
+	}
+
+	// Eigenvalues alone agree with the full computation.
+	LAR::Eigen<double> valuesOnly(a);
+	double trace = 0, sum = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		trace += a(i, i);
+		sum += valuesOnly.RealParts()[i];
+	}
+	REQUIRE(std::abs(trace - sum) < 1e-10);
+	REQUIRE(valuesOnly.Schur().GetRows() == 0);
+}
+
+TEST_CASE("SVDTest", "[MatrixTest]")
+{
+	const LAR::Matrix<double> tall = LAR::Matrix<double>::Random(90, 70, -1, 1);
+	const LAR::Matrix<double> wide = LAR::Matrix<double>::Random(20, 45, -1, 1);
+	for (const LAR::SVDAlgorithm algorithm : { LAR::SVDAlgorithm::Bidiagonal, LAR::SVDAlgorithm::Jacobi })
+	{
+		for (const LAR::Matrix<double>* a : { &tall, &wide })
+		{
+			LAR::SVDOptions options;
+			options.Algorithm = algorithm;
+			LAR::SVD<double> svd(*a, options);
+			const size_t k = std::min(a->GetRows(), a->GetCols());
+			LAR::Matrix<double> scaled = svd.U();
+			for (size_t i = 0; i < scaled.GetRows(); ++i)
+			{
+				for (size_t j = 0; j < k; ++j)
+				{
+					scaled(i, j) *= svd.SingularValues()[j];
+				}
+			}
+			LAR::Matrix<double> reconstructed = scaled * svd.V().Transpose();
+			for (size_t i = 0; i < a->GetRows(); ++i)
+			{
+				for (size_t j = 0; j < a->GetCols(); ++j)
+				{
+					REQUIRE(std::abs(reconstructed(i, j) - (*a)(i, j)) < 1e-12);
+				}
+			}
+			LAR::Matrix<double> gram = svd.V().Transpose() * svd.V();
+			for (size_t i = 0; i < k; ++i)
+			{
+				REQUIRE(std::abs(gram(i, i) - 1.0) < 1e-12);
+			}
+
+			// Full vectors and values only agree on the spectrum.
+			options.Vectors = LAR::SVDVectors::Full;
+			LAR::SVD<double> full(*a, options);
+			REQUIRE(full.U().GetRows() == a->GetRows());
+			REQUIRE(full.U().GetCols() == a->GetRows());
+			REQUIRE(full.V().GetCols() == a->GetCols());
+			options.Vectors = LAR::SVDVectors::None;
+			LAR::SVD<double> values(*a, options);
+			for (size_t i = 0; i < k; ++i)
+			{
+				REQUIRE(std::abs(full.SingularValues()[i] - svd.SingularValues()[i]) < 1e-12);
+				REQUIRE(std::abs(values.SingularValues()[i] - svd.SingularValues()[i]) < 1e-12);
+				if (i > 0)
+				{
+					REQUIRE(svd.SingularValues()[i] <= svd.SingularValues()[i - 1]);
+				}
+			}
+		}
+	}
+
+	// Rank 3 by construction; A pinv(A) A = A.
+	const LAR::Matrix<double> lowRank = LAR::Matrix<double>::Random(30, 3, -1, 1) * LAR::Matrix<double>::Random(3, 25, -1, 1);
+	REQUIRE(LAR::Rank(lowRank) == 3);
+	REQUIRE(LAR::ConditionNumber(lowRank) > 1e12);
+	const LAR::Matrix<double> pinv = LAR::PseudoInverse(lowRank);
+	const LAR::Matrix<double> roundTrip = lowRank * pinv * lowRank;
+	for (size_t i = 0; i < lowRank.GetRows(); ++i)
+	{
+		for (size_t j = 0; j < lowRank.GetCols(); ++j)
+		{
+			REQUIRE(std::abs(roundTrip(i, j) - lowRank(i, j)) < 1e-12);
+		}
+	}
+
+	// Rank-deficient input on the Jacobi path, which Auto picks for these sizes: negligible columns
+	// must not keep the sweeps rotating, and the vectors must stay orthonormal.
+	const LAR::Matrix<double> ones = LAR::Matrix<double>::Fill(9, 9, 1.0);
+	const LAR::Matrix<double> repeated(std::vector<std::vector<double>>{ { 1, 2, 1, 2 }, { 3, 4, 3, 4 }, { 5, 6, 5, 6 } });
+	const std::pair<const LAR::Matrix<double>*, size_t> deficient[] = { { &ones, 1 }, { &repeated, 2 }, { &lowRank, 3 } };
+	for (const auto& entry : deficient)
+	{
+		const LAR::Matrix<double>& a = *entry.first;
+		for (const LAR::SVDVectors vectors : { LAR::SVDVectors::Thin, LAR::SVDVectors::Full })
+		{
+			LAR::SVDOptions options;
+			options.Vectors = vectors;
+			LAR::SVD<double> svd(a, options);
+			REQUIRE(svd.Rank() == entry.second);
+			const size_t k = std::min(a.GetRows(), a.GetCols());
+			for (const LAR::Matrix<double>* q : { &svd.U(), &svd.V() })
+			{
+				const LAR::Matrix<double> gram = q->Transpose() * *q;
+				for (size_t i = 0; i < gram.GetRows(); ++i)
+				{
+					for (size_t j = 0; j < gram.GetCols(); ++j)
+					{
+						REQUIRE(std::abs(gram(i, j) - (i == j ? 1.0 : 0.0)) < 1e-12);
+					}
+				}
+			}
+			for (size_t i = 0; i < a.GetRows(); ++i)
+			{
+				for (size_t j = 0; j < a.GetCols(); ++j)
+				{
+					double sum = 0;
+					for (size_t l = 0; l < k; ++l)
+					{
+						sum += svd.U()(i, l) * svd.SingularValues()[l] * svd.V()(j, l);
+					}
+					REQUIRE(std::abs(sum - a(i, j)) < 1e-12);
+				}
+			}
+		}
+	}
+
+	LAR::SVD<float> single(LAR::Matrix<float>::Random(12, 8, -1, 1));
+	REQUIRE(single.Rank() == 8);
+	REQUIRE(single.ConditionNumber() >= 1.0f);
+}
+
+TEST_CASE("RandomizedSVDTest", "[MatrixTest]")
+{
+	// Exactly rank 8, so the sketch captures the whole range and the triplets are exact.
+	const LAR::Matrix<double> a = LAR::Matrix<double>::Random(200, 8, -1, 1) * LAR::Matrix<double>::Random(8, 120, -1, 1);
+	LAR::SVDOptions exactOptions;
+	exactOptions.Vectors = LAR::SVDVectors::None;
+	const LAR::SVD<double> exact(a, exactOptions);
+	for (const LAR::SketchType sketch : { LAR::SketchType::Gaussian, LAR::SketchType::SparseSign })
+	{
+		LAR::RandomizedSVDOptions options;
+		options.Rank = 8;
+		options.Oversampling = 4;
+		options.Sketch = sketch;
+		options.Seed = 42;
+		const LAR::RandomizedSVD<double> svd(a, options);
+		REQUIRE(svd.U().GetCols() == 8);
+		REQUIRE(svd.V().GetRows() == 120);
+		for (size_t i = 0; i < 8; ++i)
+		{
+			REQUIRE(std::abs(svd.SingularValues()[i] - exact.SingularValues()[i]) < 1e-10 * exact.SingularValues()[0]);
+		}
+		for (size_t i = 0; i < a.GetRows(); ++i)
+		{
+			for (size_t j = 0; j < a.GetCols(); ++j)
+			{
+				double sum = 0;
+				for (size_t l = 0; l < 8; ++l)
+				{
+					sum += svd.U()(i, l) * svd.SingularValues()[l] * svd.V()(j, l);
+				}
+				REQUIRE(std::abs(sum - a(i, j)) < 1e-10);
+			}
+		}
+
+		// The same seed reproduces the factorization bit for bit.
+		const LAR::RandomizedSVD<double> again(a, options);
+		REQUIRE(again.U()(17, 3) == svd.U()(17, 3));
+	}
+
+	LAR::RandomizedSVDOptions tooLarge;
+	tooLarge.Rank = 121;
+	REQUIRE_THROWS_AS(LAR::RandomizedSVD<double>(a, tooLarge), std::invalid_argument);
+}
+
+TEST_CASE("KrylovTest", "[MatrixTest]")
+{
+	// 5-point Laplacian on a 30 x 30 grid, matrix-free; shift < 0 makes it indefinite and
+	// convection > 0 nonsymmetric.
+	const size_t grid = 30;
+	const size_t n = grid * grid;
+	auto laplacian = [grid](const double shift, const double convection)
+	{
+		return [=](const double* x, double* y)
+		{
+			for (size_t i = 0; i < grid; ++i)
+			{
+				for (size_t j = 0; j < grid; ++j)
+				{
+					const size_t k = i * grid + j;
+					double sum = (4.0 + shift) * x[k];
+					sum -= i > 0 ? (1.0 + convection) * x[k - grid] : 0.0;
+					sum -= i + 1 < grid ? (1.0 - convection) * x[k + grid] : 0.0;
+					sum -= j > 0 ? x[k - 1] : 0.0;
+					sum -= j + 1 < grid ? x[k + 1] : 0.0;
+					y[k] = sum;
+				}
+			}
+		};
+	};
+	auto filled = [](const size_t size, const double value)
+	{
+		LAR::Vector<double> v(size);
+		std::fill(v.begin(), v.end(), value);
+		return v;
+	};
+	LAR::Vector<double> b(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		b[i] = 1.0 + double(i % 5);
+	}
+	auto trueResidual = [&](const auto& a, const LAR::Vector<double>& x)
+	{
+		std::vector<double> ax(n);
+		a(x.Data(), ax.data());
+		double sum = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			sum += (ax[i] - b[i]) * (ax[i] - b[i]);
+		}
+		return std::sqrt(sum / (b * b));
+	};
+	// A Jacobi-style preconditioner with the Apply member hook.
+	struct Scaling
+	{
+		double Factor;
+		size_t Size;
+		void Apply(const double* x, double* y) const
+		{
+			for (size_t i = 0; i < Size; ++i)
+			{
+				y[i] = Factor * x[i];
+			}
+		}
+	};
+
+	LAR::KrylovOptions options;
+	options.RecordHistory = true;
+	options.MaxIterations = 3000;
+	const auto spd = laplacian(0.0, 0.0);
+	const auto indefinite = laplacian(-0.5, 0.0);
+	const auto nonsymmetric = laplacian(0.0, 0.4);
+
+	LAR::ConjugateGradient<double> cg(options);
+	LAR::Vector<double> x = filled(n, 0.0);
+	LAR::KrylovResult<double> result = cg.Solve(spd, b, x, Scaling{ 0.25, n });
+	REQUIRE(result.Converged());
+	REQUIRE(result.History.size() == result.Iterations + 1);
+	REQUIRE(trueResidual(spd, x) < 1e-7);
+	// Warm start from the solution: nothing left to do, and the workspace is reused.
+	REQUIRE(cg.Solve(spd, b, x).Iterations == 0);
+
+	LAR::MINRES<double> minres(options);
+	x = filled(n, 0.0);
+	REQUIRE(minres.Solve(indefinite, b, x).Converged());
+	REQUIRE(trueResidual(indefinite, x) < 1e-7);
+
+	LAR::GMRES<double> gmres(options);
+	x = filled(n, 0.0);
+	REQUIRE(gmres.Solve(nonsymmetric, b, x, Scaling{ 0.25, n }).Converged());
+	REQUIRE(trueResidual(nonsymmetric, x) < 1e-7);
+
+	LAR::BiCGSTAB<double> bicgstab(options);
+	x = filled(n, 0.0);
+	REQUIRE(bicgstab.Solve(nonsymmetric, b, x).Converged());
+	REQUIRE(trueResidual(nonsymmetric, x) < 1e-7);
+
+	// Early stopping from the monitor, and the iteration limit.
+	options.Monitor = [](const size_t iteration, const double) { return iteration < 5; };
+	LAR::GMRES<double> stopped(options);
+	x = filled(n, 0.0);
+	result = stopped.Solve(nonsymmetric, b, x);
+	REQUIRE(result.Status == LAR::KrylovStatus::Stopped);
+	REQUIRE(result.Iterations == 5);
+	options.Monitor = nullptr;
+	options.MaxIterations = 3;
+	LAR::BiCGSTAB<double> limited(options);
+	x = filled(n, 0.0);
+	REQUIRE(limited.Solve(nonsymmetric, b, x).Status == LAR::KrylovStatus::IterationLimit);
+
+	// Singular A: the second Arnoldi column makes the Hessenberg matrix singular, but the first
+	// direction still takes the residual from sqrt(2) to its least-squares minimum of 1.
+	LAR::Matrix<double> singular(std::vector<std::vector<double>>{ { 1, 0 }, { 0, 0 } });
+	LAR::Vector<double> inconsistent = filled(2, 1.0);
+	LAR::Vector<double> partial = filled(2, 0.0);
+	REQUIRE(LAR::GMRES<double>().Solve(singular, inconsistent, partial).Status == LAR::KrylovStatus::Breakdown);
+	const LAR::Vector<double> remaining = inconsistent - singular * partial;
+	REQUIRE(std::abs(partial[0] - 1.0) < 1e-12);
+	REQUIRE(std::abs(std::sqrt(remaining * remaining) - 1.0) < 1e-12);
+
+	// A dense Matrix is an operator too.
+	LAR::Matrix<double> dense = LAR::Matrix<double>::Random(60, 60, -1, 1);
+	for (size_t i = 0; i < 60; ++i)
+	{
+		dense(i, i) += 20.0;
+	}
+	LAR::Vector<double> denseB = filled(60, 1.0);
+	LAR::Vector<double> denseX = filled(60, 0.0);
+	REQUIRE(LAR::GMRES<double>().Solve(dense, denseB, denseX).Converged());
+	LAR::Vector<double> check = dense * denseX;
+	for (size_t i = 0; i < 60; ++i)
+	{
+		REQUIRE(std::abs(check[i] - 1.0) < 1e-6);
+	}
+}
+
+TEST_CASE("PreconditionerTest", "[MatrixTest]")
+{
+	// Tridiagonal matrices have no fill-in, so ILU(0) and IC(0) are exact factorizations there.
+	const size_t size = 40;
+	LAR::Matrix<double> tridiagonal = LAR::Matrix<double>::Fill(size, size, 0.0);
+	for (size_t i = 0; i < size; ++i)
+	{
+		tridiagonal(i, i) = 3.0;
+		if (i > 0)
+		{
+			tridiagonal(i, i - 1) = -1.0;
+			tridiagonal(i - 1, i) = -1.0;
+		}
+	}
+	LAR::Vector<double> rhs(size);
+	for (size_t i = 0; i < size; ++i)
+	{
+		rhs[i] = double(i % 4) - 1.0;
+	}
+	auto requireInverse = [&](const auto& preconditioner)
+	{
+		LAR::Vector<double> solution(size);
+		preconditioner.Apply(rhs.Data(), solution.Data());
+		LAR::Vector<double> check = tridiagonal * solution;
+		for (size_t i = 0; i < size; ++i)
+		{
+			REQUIRE(std::abs(check[i] - rhs[i]) < 1e-12);
+		}
+	};
+	requireInverse(LAR::ILU0Preconditioner<double>(tridiagonal));
+	requireInverse(LAR::IC0Preconditioner<double>(tridiagonal));
+	requireInverse(LAR::BlockJacobiPreconditioner<double>(tridiagonal, size));
+
+	// 5-point Laplacian on a 20 x 20 grid: every preconditioner must speed CG up.
+	const size_t grid = 20;
+	const size_t n = grid * grid;
+	LAR::Matrix<double> laplacian = LAR::Matrix<double>::Fill(n, n, 0.0);
+	for (size_t i = 0; i < grid; ++i)
+	{
+		for (size_t j = 0; j < grid; ++j)
+		{
+			const size_t k = i * grid + j;
+			laplacian(k, k) = 4.0;
+			if (i + 1 < grid)
+			{
+				laplacian(k, k + grid) = laplacian(k + grid, k) = -1.0;
+			}
+			if (j + 1 < grid)
+			{
+				laplacian(k, k + 1) = laplacian(k + 1, k) = -1.0;
+			}
+		}
+	}
+	LAR::Vector<double> b(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		b[i] = 1.0 + double(i % 7);
+	}
+	LAR::ConjugateGradient<double> cg;
+	auto iterations = [&](const auto& preconditioner)
+	{
+		LAR::Vector<double> x(n);
+		std::fill(x.begin(), x.end(), 0.0);
+		const LAR::KrylovResult<double> result = cg.Solve(laplacian, b, x, preconditioner);
+		REQUIRE(result.Converged());
+		return result.Iterations;
+	};
+	const size_t plain = iterations(LAR::IdentityPreconditioner<double>{ n });
+	REQUIRE(iterations(LAR::JacobiPreconditioner<double>(laplacian)) <= plain);
+	REQUIRE(iterations(LAR::BlockJacobiPreconditioner<double>(laplacian, grid)) < plain);
+	REQUIRE(iterations(LAR::SSORPreconditioner<double>(laplacian, 1.5)) < plain / 2);
+	REQUIRE(iterations(LAR::IC0Preconditioner<double>(laplacian)) < plain / 2);
+
+	// ILU(0) on a nonsymmetric variant with GMRES.
+	for (size_t k = grid; k < n; ++k)
+	{
+		laplacian(k, k - grid) = -1.5;
+		laplacian(k - grid, k) = -0.5;
+	}
+	LAR::Vector<double> x(n);
+	std::fill(x.begin(), x.end(), 0.0);
+	REQUIRE(LAR::GMRES<double>().Solve(laplacian, b, x, LAR::ILU0Preconditioner<double>(laplacian)).Converged());
+
+	REQUIRE_THROWS_AS(LAR::IC0Preconditioner<double>(LAR::Matrix<double>::Fill(3, 3, -1.0)), std::runtime_error);
+	REQUIRE_THROWS_AS(LAR::SSORPreconditioner<double>(tridiagonal, 2.5), std::invalid_argument);
+}
+
+TEST_CASE("PackedMatrixTest", "[MatrixTest]")
+{
+	const auto requireClose = [](const LAR::Matrix<double>& a, const LAR::Matrix<double>& b, const double tolerance)
+	{
+		REQUIRE(a.GetRows() == b.GetRows());
+		REQUIRE(a.GetCols() == b.GetCols());
+		for (size_t i = 0; i < a.GetRows(); ++i)
+		{
+			for (size_t j = 0; j < a.GetCols(); ++j)
+			{
+				REQUIRE(std::abs(a(i, j) - b(i, j)) < tolerance);
+			}
+		}
+	};
+
+	// Rank-k updates across several panels, both orientations.
+	const size_t n = 150;
+	const size_t k = 40;
+	const LAR::Matrix<double> a = LAR::Matrix<double>::Random(n, k, -1.0, 1.0);
+	LAR::SymmetricMatrix<double> gram(n);
+	gram.RankKUpdate(1.0, a);
+	REQUIRE(gram.Packed().size() == n * (n + 1) / 2);
+	requireClose(gram.ToDense(), a * a.Transpose(), 1e-12);
+	const LAR::Matrix<double> samples = a.Transpose();
+	LAR::SymmetricMatrix<double> covariance(n);
+	covariance.RankKUpdate(0.5, samples, LAR::Op::Trans);
+	requireClose(covariance.ToDense(), (a * a.Transpose()) * 0.5, 1e-12);
+	REQUIRE(LAR::SymmetricMatrix<double>(gram.ToDense()).ToDense() == gram.ToDense());
+
+	// Products agree with the dense ones.
+	LAR::Vector<double> x(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		x[i] = std::sin(double(i));
+	}
+	const LAR::Vector<double> y = gram * x;
+	const LAR::Vector<double> expected = gram.ToDense() * x;
+	for (size_t i = 0; i < n; ++i)
+	{
+		REQUIRE(std::abs(y[i] - expected[i]) < 1e-10);
+	}
+	requireClose(gram * a, gram.ToDense() * a, 1e-10);
+
+	// Packed Cholesky and triangular solves.
+	LAR::SymmetricMatrix<double> spd = gram;
+	for (size_t i = 0; i < n; ++i)
+	{
+		spd(i, i) += double(n);
+	}
+	const LAR::TriangularMatrix<double> l = spd.CholeskyFactor();
+	REQUIRE(l.GetTriangle() == LAR::Triangle::Lower);
+	const LAR::TriangularMatrix<double> lt = l.Transpose();
+	REQUIRE(lt.GetTriangle() == LAR::Triangle::Upper);
+	requireClose(l.ToDense() * lt.ToDense(), spd.ToDense(), 1e-9);
+	const LAR::Vector<double> solution = lt.Solve(l.Solve(y));
+	const LAR::Vector<double> check = spd * solution;
+	for (size_t i = 0; i < n; ++i)
+	{
+		REQUIRE(std::abs(check[i] - y[i]) < 1e-9);
+	}
+	requireClose(l * a, l.ToDense() * a, 1e-12);
+	requireClose(lt.ToDense() * lt.Solve(a), a, 1e-10);
+	REQUIRE(LAR::TriangularMatrix<double>(gram.ToDense(), LAR::Triangle::Upper).ToDense().Transpose()
+		== LAR::TriangularMatrix<double>(gram.ToDense(), LAR::Triangle::Lower).ToDense());
+	LAR::TriangularMatrix<double> writable = l;
+	REQUIRE_THROWS_AS(writable(0, 1) = 1.0, std::out_of_range);
+	REQUIRE_THROWS_AS(LAR::SymmetricMatrix<double>(-1.0 * gram.ToDense()).CholeskyFactor(), std::runtime_error);
+
+	// Banded LU with pivoting on a band with a zero diagonal.
+	const size_t m = 300;
+	LAR::BandedMatrix<double> band(m, 2, 3);
+	for (size_t i = 0; i < m; ++i)
+	{
+		for (size_t j = i > 2 ? i - 2 : 0; j < std::min(m, i + 4); ++j)
+		{
+			band(i, j) = i == j ? (i % 5 == 0 ? 0.0 : 4.0) : std::cos(double(i * 7 + j));
+		}
+	}
+	const LAR::Matrix<double> dense = band.ToDense();
+	REQUIRE(LAR::BandedMatrix<double>(dense).GetUpperBandwidth() == 3);
+	REQUIRE(LAR::BandedMatrix<double>(dense).GetLowerBandwidth() == 2);
+	LAR::Vector<double> rhs(m);
+	for (size_t i = 0; i < m; ++i)
+	{
+		rhs[i] = 1.0 + double(i % 3);
+	}
+	const LAR::BandedLU<double> lu(band);
+	const LAR::Vector<double> bandSolution = lu.Solve(rhs);
+	const LAR::Vector<double> bandCheck = band * bandSolution;
+	const LAR::Vector<double> denseCheck = dense * bandSolution;
+	for (size_t i = 0; i < m; ++i)
+	{
+		REQUIRE(std::abs(bandCheck[i] - rhs[i]) < 1e-8);
+		REQUIRE(std::abs(denseCheck[i] - bandCheck[i]) < 1e-10);
+	}
+	const LAR::Matrix<double> block = LAR::Matrix<double>::Random(m, 3, -1.0, 1.0);
+	requireClose(band * lu.Solve(block), block, 1e-8);
+	REQUIRE_THROWS_AS(LAR::BandedMatrix<double>(dense, 1, 3), std::invalid_argument);
+	REQUIRE_THROWS_AS(band(0, 5) = 1.0, std::out_of_range);
+}
+
+TEST_CASE("ImplicitMatrixTest", "[MatrixTest]")
+{
+	const auto requireClose = [](const LAR::Matrix<double>& a, const LAR::Matrix<double>& b, const double tolerance)
+	{
+		REQUIRE(a.GetRows() == b.GetRows());
+		REQUIRE(a.GetCols() == b.GetCols());
+		for (size_t i = 0; i < a.GetRows(); ++i)
+		{
+			for (size_t j = 0; j < a.GetCols(); ++j)
+			{
+				REQUIRE(std::abs(a(i, j) - b(i, j)) <= tolerance);
+			}
+		}
+	};
+
+	const size_t n = 7;
+	const LAR::Matrix<double> a = LAR::Matrix<double>::Random(n, n, -1.0, 1.0);
+	const LAR::Matrix<double> tall = LAR::Matrix<double>::Random(n, 3, -1.0, 1.0);
+	LAR::Vector<double> x(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		x[i] = 1.0 + double(i);
+	}
+
+	// Identity, including the off-diagonal zeros of the dense form.
+	const LAR::Matrix<double> identity = LAR::Matrix<double>::Identity(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		for (size_t j = 0; j < n; ++j)
+		{
+			REQUIRE(identity(i, j) == (i == j ? 1.0 : 0.0));
+		}
+	}
+	const LAR::IdentityMatrix<double> eye(n);
+	requireClose(eye.ToDense(), identity, 0.0);
+	requireClose(eye * tall, tall, 0.0);
+	requireClose(a * eye, a, 0.0);
+	requireClose(a + eye, a + identity, 1e-14);
+	requireClose(eye - a, identity - a, 1e-14);
+	REQUIRE((eye * x)[n - 1] == x[n - 1]);
+
+	// Constant.
+	const LAR::ConstantMatrix<double> ones(4, n, 0.5);
+	requireClose(ones * tall, ones.ToDense() * tall, 1e-12);
+	requireClose(tall.Transpose() * LAR::ConstantMatrix<double>(n, 5, -2.0), tall.Transpose() * LAR::Matrix<double>::Fill(n, 5, -2.0), 1e-12);
+	requireClose(a - LAR::ConstantMatrix<double>(n, n, 3.0), a - LAR::Matrix<double>::Fill(n, n, 3.0), 1e-14);
+	REQUIRE(std::abs((ones * x)[2] - 0.5 * 28.0) < 1e-12);
+
+	// Diagonal.
+	LAR::Vector<double> diagonal(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		diagonal[i] = 2.0 - double(i) * 0.3;
+	}
+	const LAR::DiagonalMatrix<double> d(diagonal);
+	const LAR::Matrix<double> denseD = d.ToDense();
+	requireClose(d * tall, denseD * tall, 1e-14);
+	requireClose(a * d, a * denseD, 1e-14);
+	requireClose(a + d, a + denseD, 1e-14);
+	requireClose((d * d).ToDense(), denseD * denseD, 1e-14);
+	requireClose((d * d.Inverse()).ToDense(), identity, 1e-14);
+	const LAR::Vector<double> dx = d * x;
+	const LAR::Vector<double> denseDx = denseD * x;
+	for (size_t i = 0; i < n; ++i)
+	{
+		REQUIRE(std::abs(dx[i] - denseDx[i]) < 1e-14);
+	}
+	REQUIRE_THROWS_AS(LAR::DiagonalMatrix<double>({ 1.0, 0.0 }).Inverse(), std::runtime_error);
+
+	// Permutation: lazily recorded swaps match swapping the rows of a matrix.
+	LAR::PermutationMatrix<double> p(n);
+	LAR::Matrix<double> swapped = a;
+	const size_t swaps[][2] = { { 0, 3 }, { 5, 1 }, { 3, 6 }, { 2, 2 }, { 4, 0 } };
+	for (const auto& swap : swaps)
+	{
+		p.SwapRows(swap[0], swap[1]);
+		swapped.SwapRows(swap[0], swap[1]);
+	}
+	const LAR::Matrix<double> denseP = p.ToDense();
+	requireClose(p * a, swapped, 0.0);
+	requireClose(denseP * a, swapped, 1e-14);
+	requireClose(a * p, a * denseP, 1e-14);
+	requireClose(p.Transpose() * (p * a), a, 0.0);
+	requireClose(p + a, denseP + a, 1e-14);
+	const LAR::PermutationMatrix<double> q(std::vector<size_t>{ 6, 5, 4, 3, 2, 1, 0 });
+	requireClose((p * q).ToDense(), denseP * q.ToDense(), 1e-14);
+	const LAR::Vector<double> px = p * x;
+	for (size_t i = 0; i < n; ++i)
+	{
+		REQUIRE(px[i] == x[p.Permutation()[i]]);
+	}
+	REQUIRE_THROWS_AS(LAR::PermutationMatrix<double>(std::vector<size_t>{ 0, 0, 1 }), std::invalid_argument);
+	REQUIRE_THROWS_AS(p * LAR::Matrix<double>(n + 1, 2), std::invalid_argument);
+}
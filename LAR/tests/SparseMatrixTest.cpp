@@ -0,0 +1,821 @@
+#include "LAR/LAR.h"
+#define CATCH_CONFIG_RUNNER
+#include "catch.hpp"
+
+#include <vector>
+
+namespace
+{
+	// 5-point Laplacian on a grid x grid mesh, assembled from triplets.
+	LAR::SparseMatrix<double> Laplacian(const size_t grid)
+	{
+		std::vector<LAR::Triplet<double>> triplets;
+		for (size_t i = 0; i < grid; ++i)
+		{
+			for (size_t j = 0; j < grid; ++j)
+			{
+				const size_t k = i * grid + j;
+				triplets.push_back({ k, k, 4.0 });
+				if (i + 1 < grid)
+				{
+					triplets.push_back({ k, k + grid, -1.0 });
+					triplets.push_back({ k + grid, k, -1.0 });
+				}
+				if (j + 1 < grid)
+				{
+					triplets.push_back({ k, k + 1, -1.0 });
+					triplets.push_back({ k + 1, k, -1.0 });
+				}
+			}
+		}
+		return LAR::SparseMatrix<double>::FromTriplets(grid * grid, grid * grid, triplets);
+	}
+}
+
+TEST_CASE("SparseConstructionTest", "[SparseMatrixTest]")
+{
+	// Unordered triplets with a duplicate at (1, 2).
+	const std::vector<LAR::Triplet<double>> triplets = { { 2, 0, 5.0 }, { 1, 2, 1.0 }, { 0, 1, 2.0 }, { 1, 2, 3.0 }, { 2, 3, -1.0 } };
+	const LAR::SparseMatrix<double> csr = LAR::SparseMatrix<double>::FromTriplets(3, 4, triplets);
+	REQUIRE(csr.GetNonZeros() == 4);
+	REQUIRE(csr(1, 2) == 4.0);
+	REQUIRE(csr(0, 0) == 0.0);
+	REQUIRE(csr.OuterStart() == std::vector<size_t>{ 0, 1, 2, 4 });
+	REQUIRE(csr.InnerIndices() == std::vector<size_t>{ 1, 2, 0, 3 });
+
+	const LAR::SparseMatrix<double, LAR::SparseFormat::CSC> csc(csr);
+	REQUIRE(csc.OuterStart().size() == 5);
+	const LAR::Matrix<double> dense = csr.ToDense();
+	const LAR::Matrix<double> fromCsc = csc.ToDense();
+	for (size_t i = 0; i < 3; ++i)
+	{
+		for (size_t j = 0; j < 4; ++j)
+		{
+			REQUIRE(dense(i, j) == csr(i, j));
+			REQUIRE(fromCsc(i, j) == dense(i, j));
+		}
+	}
+	REQUIRE(LAR::SparseMatrix<double>(dense).InnerIndices() == csr.InnerIndices());
+
+	const LAR::SparseMatrix<double> transposed = csr.Transpose();
+	REQUIRE(transposed.GetRows() == 4);
+	REQUIRE(transposed(3, 2) == -1.0);
+	REQUIRE(transposed(2, 1) == 4.0);
+
+	REQUIRE_THROWS_AS(LAR::SparseMatrix<double>::FromTriplets(2, 2, { { 2, 0, 1.0 } }), std::invalid_argument);
+	REQUIRE_THROWS_AS(LAR::SparseMatrix<double>(2, 2, { 0, 2, 2 }, { 1, 0 }, { 1.0, 1.0 }), std::invalid_argument);
+}
+
+TEST_CASE("SparseArithmeticTest", "[SparseMatrixTest]")
+{
+	const LAR::Matrix<double> a = LAR::Matrix<double>::Random(30, 20, -1, 1);
+	const LAR::Matrix<double> b = LAR::Matrix<double>::Random(30, 20, -1, 1);
+	LAR::Matrix<double> sparseA = a;
+	LAR::Matrix<double> sparseB = b;
+	for (size_t i = 0; i < 30; ++i)
+	{
+		for (size_t j = 0; j < 20; ++j)
+		{
+			sparseA(i, j) = (i + 2 * j) % 3 == 0 ? a(i, j) : 0.0;
+			sparseB(i, j) = (2 * i + j) % 4 == 0 ? b(i, j) : 0.0;
+		}
+	}
+	const LAR::SparseMatrix<double> x(sparseA);
+	const LAR::SparseMatrix<double, LAR::SparseFormat::CSC> y(sparseB);
+
+	const LAR::Matrix<double> sum = (x + y).ToDense();
+	const LAR::Matrix<double> difference = (x - y).ToDense();
+	const LAR::Matrix<double> product = x.ElementwiseProduct(y).ToDense();
+	const LAR::Matrix<double> scaled = (2.0 * x / 4.0).ToDense();
+	const LAR::Matrix<double> negated = (-x).ToDense();
+	for (size_t i = 0; i < 30; ++i)
+	{
+		for (size_t j = 0; j < 20; ++j)
+		{
+			REQUIRE(sum(i, j) == sparseA(i, j) + sparseB(i, j));
+			REQUIRE(difference(i, j) == sparseA(i, j) - sparseB(i, j));
+			REQUIRE(product(i, j) == sparseA(i, j) * sparseB(i, j));
+			REQUIRE(scaled(i, j) == sparseA(i, j) * 2.0 / 4.0);
+			REQUIRE(negated(i, j) == -sparseA(i, j));
+		}
+	}
+	REQUIRE((x - x).Prune().GetNonZeros() == 0);
+}
+
+TEST_CASE("SparseProductTest", "[SparseMatrixTest]")
+{
+	LAR::Matrix<double> dense = LAR::Matrix<double>::Random(40, 25, -1, 1);
+	for (size_t i = 0; i < 40; ++i)
+	{
+		for (size_t j = 0; j < 25; ++j)
+		{
+			dense(i, j) = (i * j) % 5 == 1 ? dense(i, j) : 0.0;
+		}
+	}
+	const LAR::SparseMatrix<double> csr(dense);
+	const LAR::SparseMatrix<double, LAR::SparseFormat::CSC> csc(dense);
+	const LAR::Vector<double> v = LAR::Matrix<double>::Random(25, 1, -1, 1);
+	const LAR::Vector<double> expected = dense * v;
+	const LAR::Vector<double> fromCsr = csr * v;
+	const LAR::Vector<double> fromCsc = csc * v;
+	for (size_t i = 0; i < 40; ++i)
+	{
+		REQUIRE(std::abs(fromCsr[i] - expected[i]) < 1e-12);
+		REQUIRE(std::abs(fromCsc[i] - expected[i]) < 1e-12);
+	}
+
+	const LAR::Matrix<double> right = LAR::Matrix<double>::Random(25, 7, -1, 1);
+	const LAR::Matrix<double> left = LAR::Matrix<double>::Random(6, 40, -1, 1);
+	const LAR::Matrix<double> sparseDense = csr * right;
+	const LAR::Matrix<double> denseSparse = left * csc;
+	const LAR::Matrix<double> denseCsr = left * csr;
+	const LAR::Matrix<double> expectedRight = dense * right;
+	const LAR::Matrix<double> expectedLeft = left * dense;
+	for (size_t i = 0; i < 40; ++i)
+	{
+		for (size_t j = 0; j < 7; ++j)
+		{
+			REQUIRE(std::abs(sparseDense(i, j) - expectedRight(i, j)) < 1e-12);
+		}
+	}
+	for (size_t i = 0; i < 6; ++i)
+	{
+		for (size_t j = 0; j < 25; ++j)
+		{
+			REQUIRE(std::abs(denseSparse(i, j) - expectedLeft(i, j)) < 1e-12);
+			REQUIRE(std::abs(denseCsr(i, j) - expectedLeft(i, j)) < 1e-12);
+		}
+	}
+
+	LAR::Vector<double, true> row(40);
+	for (size_t i = 0; i < 40; ++i)
+	{
+		row[i] = double(i % 3);
+	}
+	const LAR::Vector<double, true> rowProduct = row * csr;
+	const LAR::Vector<double, true> rowExpected = row * dense;
+	for (size_t j = 0; j < 25; ++j)
+	{
+		REQUIRE(std::abs(rowProduct[j] - rowExpected[j]) < 1e-12);
+	}
+	REQUIRE_THROWS_AS(csr * right.Transpose(), std::invalid_argument);
+}
+
+TEST_CASE("SparseSolveTest", "[SparseMatrixTest]")
+{
+	// A sparse matrix plugs straight into the Krylov solvers and preconditioners.
+	const size_t grid = 40;
+	const LAR::SparseMatrix<double> laplacian = Laplacian(grid);
+	REQUIRE(laplacian.GetNonZeros() == 5 * grid * grid - 4 * grid);
+	LAR::Vector<double> b(grid * grid);
+	LAR::Vector<double> x(grid * grid);
+	for (size_t i = 0; i < grid * grid; ++i)
+	{
+		b[i] = 1.0;
+		x[i] = 0.0;
+	}
+	LAR::ConjugateGradient<double> cg;
+	const LAR::KrylovResult<double> result = cg.Solve(laplacian, b, x, LAR::IC0Preconditioner<double>(laplacian));
+	REQUIRE(result.Converged());
+	const LAR::Vector<double> check = laplacian * x;
+	for (size_t i = 0; i < grid * grid; ++i)
+	{
+		REQUIRE(std::abs(check[i] - 1.0) < 1e-6);
+	}
+
+	// Row i couples only with i +- half: two wide levels per sweep, so the triangular solves go level
+	// by level across threads, and ILU(0) is exact. The serial row-order sweep gives the same bits.
+	const size_t half = 20000;
+	std::vector<LAR::Triplet<double>> pairs;
+	for (size_t i = 0; i < half; ++i)
+	{
+		pairs.push_back({ i, i, 4.0 + double(i % 3) });
+		pairs.push_back({ i + half, i + half, 5.0 });
+		pairs.push_back({ i, i + half, -1.0 });
+		pairs.push_back({ i + half, i, -2.0 });
+	}
+	const LAR::SparseMatrix<double> paired = LAR::SparseMatrix<double>::FromTriplets(2 * half, 2 * half, pairs);
+	const LAR::ILU0Preconditioner<double> ilu(paired);
+	LAR::Vector<double> rhs(2 * half);
+	for (size_t i = 0; i < 2 * half; ++i)
+	{
+		rhs[i] = std::sin(double(i));
+	}
+	LAR::Vector<double> parallel(2 * half);
+	LAR::Vector<double> serial(2 * half);
+	LAR::SetMaxThreads(4);
+	ilu.Apply(rhs.Data(), parallel.Data());
+	LAR::SetMaxThreads(1);
+	ilu.Apply(rhs.Data(), serial.Data());
+	LAR::SetMaxThreads(0);
+	const LAR::Vector<double> pairedCheck = paired * parallel;
+	for (size_t i = 0; i < 2 * half; ++i)
+	{
+		REQUIRE(parallel[i] == serial[i]);
+		REQUIRE(std::abs(pairedCheck[i] - rhs[i]) < 1e-12);
+	}
+}
+
+TEST_CASE("SparseKernelTest", "[SparseMatrixTest]")
+{
+	// Irregular row lengths, including empty rows, and a row count that is not a multiple of the chunk height.
+	const size_t rows = 203;
+	const size_t cols = 57;
+	std::vector<LAR::Triplet<double>> triplets;
+	for (size_t i = 0; i < rows; ++i)
+	{
+		const size_t length = (i * 7) % 11 == 0 ? 0 : (i * i) % 37;
+		for (size_t k = 0; k < length; ++k)
+		{
+			triplets.push_back({ i, (i + 3 * k) % cols, double(k % 5) - 1.5 });
+		}
+	}
+	const LAR::SparseMatrix<double> csr = LAR::SparseMatrix<double>::FromTriplets(rows, cols, triplets);
+	const LAR::Matrix<double> dense = csr.ToDense();
+	const LAR::Vector<double> v = LAR::Matrix<double>::Random(cols, 1, -1, 1);
+	const LAR::Vector<double> expected = dense * v;
+	const LAR::Vector<double> fromCsr = csr * v;
+	for (const size_t chunk : { size_t(1), size_t(4), size_t(8), size_t(32) })
+	{
+		const LAR::SellMatrix<double> sell(csr, chunk, 16);
+		REQUIRE(sell.GetNonZeros() == csr.GetNonZeros());
+		REQUIRE(sell.GetStoredEntries() >= sell.GetNonZeros());
+		const LAR::Vector<double> fromSell = sell * v;
+		for (size_t i = 0; i < rows; ++i)
+		{
+			REQUIRE(std::abs(fromSell[i] - expected[i]) < 1e-12);
+			REQUIRE(std::abs(fromCsr[i] - expected[i]) < 1e-12);
+		}
+	}
+	REQUIRE(LAR::SellMatrix<double>(csr, 1).GetStoredEntries() == csr.GetNonZeros());
+	REQUIRE_THROWS_AS(LAR::SellMatrix<double>(csr, 0), std::invalid_argument);
+
+	std::vector<size_t> bounds;
+	LAR::Detail::BalancedRowPartition(csr.OuterStart(), rows, 6, bounds);
+	REQUIRE(bounds.size() == 7);
+	REQUIRE(bounds.front() == 0);
+	REQUIRE(bounds.back() == rows);
+	REQUIRE(std::is_sorted(bounds.begin(), bounds.end()));
+
+	const LAR::Matrix<double> right = LAR::Matrix<double>::Random(cols, 9, -1, 1);
+	const LAR::Matrix<double> product = csr * right;
+	const LAR::Matrix<double> expectedProduct = dense * right;
+	for (size_t i = 0; i < rows; ++i)
+	{
+		for (size_t j = 0; j < 9; ++j)
+		{
+			REQUIRE(std::abs(product(i, j) - expectedProduct(i, j)) < 1e-12);
+		}
+	}
+}
+
+TEST_CASE("SparseSparseProductTest", "[SparseMatrixTest]")
+{
+	LAR::Matrix<double> left = LAR::Matrix<double>::Random(35, 50, -1, 1);
+	LAR::Matrix<double> right = LAR::Matrix<double>::Random(50, 28, -1, 1);
+	for (size_t i = 0; i < 50; ++i)
+	{
+		for (size_t j = 0; j < 35; ++j)
+		{
+			left(j, i) = (i + 3 * j) % 7 == 0 ? left(j, i) : 0.0;
+		}
+		for (size_t j = 0; j < 28; ++j)
+		{
+			right(i, j) = (2 * i + j) % 5 == 0 ? right(i, j) : 0.0;
+		}
+	}
+	const LAR::SparseMatrix<double> a(left);
+	const LAR::SparseMatrix<double, LAR::SparseFormat::CSC> b(right);
+	const LAR::Matrix<double> expected = left * right;
+	const LAR::Matrix<double> fromCsr = (a * b).ToDense();
+	const LAR::Matrix<double> fromCsc = (LAR::SparseMatrix<double, LAR::SparseFormat::CSC>(a) * b).ToDense();
+	for (size_t i = 0; i < 35; ++i)
+	{
+		for (size_t j = 0; j < 28; ++j)
+		{
+			REQUIRE(std::abs(fromCsr(i, j) - expected(i, j)) < 1e-12);
+			REQUIRE(std::abs(fromCsc(i, j) - expected(i, j)) < 1e-12);
+		}
+	}
+	REQUIRE_THROWS_AS(a * a, std::invalid_argument);
+
+	// A wide product goes through the hash accumulator.
+	const size_t wide = 100000;
+	std::vector<LAR::Triplet<double>> triplets;
+	for (size_t k = 0; k < 4; ++k)
+	{
+		for (size_t j = 0; j < 6; ++j)
+		{
+			triplets.push_back({ k, (k * 7919 + j * 15013) % wide, double(j + 1) });
+		}
+	}
+	const LAR::SparseMatrix<double> hashed = LAR::SparseMatrix<double>::FromTriplets(4, 4, { { 0, 0, 1.0 }, { 0, 3, 2.0 }, { 2, 1, -1.0 } })
+		* LAR::SparseMatrix<double>::FromTriplets(4, wide, triplets);
+	REQUIRE(hashed.GetNonZeros() == 18);
+	REQUIRE(hashed(0, 3 * 7919 + 15013) == 4.0);
+	REQUIRE(hashed(2, 7919 + 5 * 15013) == -6.0);
+
+	// Columns that are all multiples of the hash table size: a hash keeping the low bits of the
+	// product sends every one of them to the same slot.
+	const size_t stride = size_t(1) << 15;
+	const size_t strided = 128;
+	std::vector<LAR::Triplet<double>> stridedTriplets;
+	std::vector<LAR::Triplet<double>> selector;
+	for (size_t k = 0; k < strided; ++k)
+	{
+		selector.push_back({ 0, k, 1.0 });
+		for (size_t j = 0; j < strided; ++j)
+		{
+			stridedTriplets.push_back({ k, (k * strided + j) * stride, double(k + j) });
+		}
+	}
+	const LAR::SparseMatrix<double> stridedProduct = LAR::SparseMatrix<double>::FromTriplets(1, strided, selector)
+		* LAR::SparseMatrix<double>::FromTriplets(strided, strided * strided * stride, stridedTriplets);
+	REQUIRE(stridedProduct.GetNonZeros() == strided * strided);
+	for (size_t q = 0; q < strided * strided; ++q)
+	{
+		REQUIRE(stridedProduct.InnerIndices()[q] == q * stride);
+		REQUIRE(stridedProduct.Values()[q] == double(q / strided + q % strided));
+	}
+
+	// Path graph 0 - 1 - 2 - 3 with weights 1, 2, 4 (both directions).
+	const std::vector<LAR::Triplet<double>> edges = { { 0, 1, 1.0 }, { 1, 0, 1.0 }, { 1, 2, 2.0 }, { 2, 1, 2.0 }, { 2, 3, 4.0 }, { 3, 2, 4.0 } };
+	const LAR::SparseMatrix<double> graph = LAR::SparseMatrix<double>::FromTriplets(4, 4, edges);
+	LAR::SparseMatrix<double> twoHop;
+	LAR::Multiply(graph, graph, twoHop, LAR::MinPlusSemiring<double>());
+	REQUIRE(twoHop.GetNonZeros() == 8);
+	REQUIRE(twoHop(0, 2) == 3.0);
+	REQUIRE(twoHop(1, 3) == 6.0);
+	REQUIRE(twoHop(1, 1) == 2.0);
+	REQUIRE(twoHop(2, 2) == 4.0);
+
+	LAR::SparseMatrix<double> reachable;
+	LAR::Multiply(graph, graph, reachable, LAR::OrAndSemiring<double>());
+	REQUIRE(reachable.InnerIndices() == twoHop.InnerIndices());
+	for (const double value : reachable.Values())
+	{
+		REQUIRE(value == 1.0);
+	}
+}
+
+TEST_CASE("SparseDirectTest", "[SparseMatrixTest]")
+{
+	const size_t grid = 30;
+	const size_t n = grid * grid;
+	const LAR::SparseMatrix<double> laplacian = Laplacian(grid);
+	LAR::Vector<double> b(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		b[i] = std::sin(double(i + 1));
+	}
+
+	size_t naturalFill = 0;
+	for (const LAR::SparseOrdering ordering : { LAR::SparseOrdering::Natural, LAR::SparseOrdering::MinimumDegree, LAR::SparseOrdering::NestedDissection })
+	{
+		const std::vector<size_t> permutation = LAR::FillReducingOrdering(laplacian, ordering);
+		std::vector<size_t> sorted = permutation;
+		std::sort(sorted.begin(), sorted.end());
+		for (size_t i = 0; i < n; ++i)
+		{
+			REQUIRE(sorted[i] == i);
+		}
+
+		LAR::SparseCholesky<double> cholesky(laplacian, ordering);
+		const LAR::Vector<double> x = cholesky.Solve(b);
+		const LAR::Vector<double> check = laplacian * x;
+		for (size_t i = 0; i < n; ++i)
+		{
+			REQUIRE(std::abs(check[i] - b[i]) < 1e-10);
+		}
+		if (ordering == LAR::SparseOrdering::Natural)
+		{
+			naturalFill = cholesky.GetFactorNonZeros();
+		}
+		else
+		{
+			REQUIRE(cholesky.GetFactorNonZeros() < naturalFill);
+		}
+	}
+
+	// Many components: isolated vertices, short paths and two copies of the grid. Dissection orders
+	// each component on its own, so this stays linear in the component count.
+	{
+		const size_t isolated = 60000;
+		std::vector<LAR::Triplet<double>> blocks;
+		for (size_t i = 0; i < isolated; ++i)
+		{
+			blocks.push_back({ i, i, 2.0 });
+		}
+		size_t offset = isolated;
+		for (size_t path = 0; path < 200; ++path, offset += 5)
+		{
+			for (size_t i = 0; i < 5; ++i)
+			{
+				blocks.push_back({ offset + i, offset + i, 4.0 });
+				if (i > 0)
+				{
+					blocks.push_back({ offset + i, offset + i - 1, -1.0 });
+					blocks.push_back({ offset + i - 1, offset + i, -1.0 });
+				}
+			}
+		}
+		for (size_t copy = 0; copy < 2; ++copy, offset += n)
+		{
+			laplacian.ForEach([&blocks, offset](const size_t row, const size_t col, const double value)
+			{
+				blocks.push_back({ offset + row, offset + col, value });
+			});
+		}
+		const LAR::SparseMatrix<double> disconnected = LAR::SparseMatrix<double>::FromTriplets(offset, offset, blocks);
+		std::vector<size_t> sorted = LAR::FillReducingOrdering(disconnected, LAR::SparseOrdering::NestedDissection);
+		std::sort(sorted.begin(), sorted.end());
+		REQUIRE(sorted.size() == offset);
+		for (size_t i = 0; i < offset; ++i)
+		{
+			REQUIRE(sorted[i] == i);
+		}
+		LAR::Vector<double> ones(offset);
+		for (size_t i = 0; i < offset; ++i)
+		{
+			ones[i] = 1.0;
+		}
+		const LAR::SparseCholesky<double> cholesky(disconnected, LAR::SparseOrdering::NestedDissection);
+		const LAR::Vector<double> check = disconnected * cholesky.Solve(ones);
+		for (size_t i = 0; i < offset; ++i)
+		{
+			REQUIRE(std::abs(check[i] - 1.0) < 1e-10);
+		}
+	}
+
+	// One stored triangle factors the same matrix as full storage, whichever way the ordering
+	// permutes it: the grid and an arrow matrix whose hub the orderings move last.
+	{
+		std::vector<LAR::Triplet<double>> arrow;
+		for (size_t i = 0; i < 6; ++i)
+		{
+			arrow.push_back({ i, i, 10.0 + double(i) });
+			if (i > 0)
+			{
+				arrow.push_back({ i, 0, 1.0 + 0.5 * double(i) });
+				arrow.push_back({ 0, i, 1.0 + 0.5 * double(i) });
+			}
+		}
+		for (const LAR::SparseMatrix<double>& full : { laplacian, LAR::SparseMatrix<double>::FromTriplets(6, 6, arrow) })
+		{
+			const size_t size = full.GetRows();
+			std::vector<LAR::Triplet<double>> lowerEntries;
+			std::vector<LAR::Triplet<double>> upperEntries;
+			full.ForEach([&lowerEntries, &upperEntries](const size_t row, const size_t col, const double value)
+			{
+				(row >= col ? lowerEntries : upperEntries).push_back({ row, col, value });
+				if (row == col)
+				{
+					upperEntries.push_back({ row, col, value });
+				}
+			});
+			const LAR::SparseMatrix<double> lowerOnly = LAR::SparseMatrix<double>::FromTriplets(size, size, lowerEntries);
+			const LAR::SparseMatrix<double> upperOnly = LAR::SparseMatrix<double>::FromTriplets(size, size, upperEntries);
+			LAR::Vector<double> rhs(size);
+			for (size_t i = 0; i < size; ++i)
+			{
+				rhs[i] = std::cos(double(i));
+			}
+			for (const LAR::SparseOrdering ordering : { LAR::SparseOrdering::Natural, LAR::SparseOrdering::MinimumDegree, LAR::SparseOrdering::NestedDissection })
+			{
+				const LAR::Vector<double> expected = LAR::SparseCholesky<double>(full, ordering).Solve(rhs);
+				const LAR::Vector<double> fromLower = LAR::SparseCholesky<double>(lowerOnly, ordering).Solve(rhs);
+				const LAR::Vector<double> fromUpper = LAR::SparseCholesky<double>(upperOnly, ordering).Solve(rhs);
+				for (size_t i = 0; i < size; ++i)
+				{
+					REQUIRE(std::abs(fromLower[i] - expected[i]) < 1e-12);
+					REQUIRE(std::abs(fromUpper[i] - expected[i]) < 1e-12);
+				}
+			}
+		}
+	}
+
+	// Refactoring with the same pattern reuses the analysis.
+	LAR::SparseCholesky<double> cholesky(laplacian);
+	LAR::SparseMatrix<double> shifted = laplacian;
+	for (size_t i = 0; i < n; ++i)
+	{
+		for (size_t p = shifted.OuterStart()[i]; p < shifted.OuterStart()[i + 1]; ++p)
+		{
+			shifted.Values()[p] *= shifted.InnerIndices()[p] == i ? 1.5 : 0.5;
+		}
+	}
+	cholesky.Factorize(shifted);
+	const LAR::Vector<double> shiftedCheck = shifted * cholesky.Solve(b);
+	for (size_t i = 0; i < n; ++i)
+	{
+		REQUIRE(std::abs(shiftedCheck[i] - b[i]) < 1e-10);
+	}
+	REQUIRE_THROWS_AS(cholesky.Factorize(Laplacian(grid - 1)), std::invalid_argument);
+	REQUIRE_THROWS_AS(LAR::SparseCholesky<double>(-laplacian), std::runtime_error);
+
+	// Unsymmetric values and pattern: convection-diffusion plus a few one-sided couplings.
+	std::vector<LAR::Triplet<double>> triplets;
+	laplacian.ForEach([&triplets](const size_t row, const size_t col, const double value)
+	{
+		triplets.push_back({ row, col, row == col ? value : value + (col > row ? 0.3 : -0.3) });
+	});
+	for (size_t i = 0; i + 7 < n; i += 11)
+	{
+		triplets.push_back({ i, i + 7, 0.25 });
+	}
+	const LAR::SparseMatrix<double, LAR::SparseFormat::CSC> general = LAR::SparseMatrix<double, LAR::SparseFormat::CSC>::FromTriplets(n, n, triplets);
+	for (const LAR::SparseOrdering ordering : { LAR::SparseOrdering::MinimumDegree, LAR::SparseOrdering::NestedDissection })
+	{
+		const LAR::SparseLU<double> lu(general, ordering);
+		const LAR::Vector<double> check = general * lu.Solve(b);
+		for (size_t i = 0; i < n; ++i)
+		{
+			REQUIRE(std::abs(check[i] - b[i]) < 1e-10);
+		}
+	}
+
+	// A diagonal block that needs a row interchange.
+	const LAR::SparseMatrix<double> swap = LAR::SparseMatrix<double>::FromTriplets(3, 3,
+		{ { 0, 1, 2.0 }, { 1, 0, 3.0 }, { 1, 1, 1.0 }, { 1, 2, 1.0 }, { 2, 1, 1.0 }, { 2, 2, 4.0 } });
+	const LAR::SparseLU<double> pivoted(swap, LAR::SparseOrdering::Natural);
+	LAR::Vector<double> rhs(3);
+	rhs[0] = 2.0;
+	rhs[1] = 6.0;
+	rhs[2] = 9.0;
+	const LAR::Vector<double> solution = pivoted.Solve(rhs);
+	REQUIRE(std::abs(solution[0] - 1.0) < 1e-12);
+	REQUIRE(std::abs(solution[1] - 1.0) < 1e-12);
+	REQUIRE(std::abs(solution[2] - 2.0) < 1e-12);
+
+	// A cyclic shift needs its pivots from outside each supernode. Within one supernode it factors;
+	// otherwise it throws, and a tiny diagonal fails the pivot threshold rather than the factors
+	// silently losing all accuracy.
+	const auto cyclic = [](const size_t size, const double diagonal)
+	{
+		std::vector<LAR::Triplet<double>> entries;
+		for (size_t i = 0; i < size; ++i)
+		{
+			entries.push_back({ i, (i + 1) % size, 1.0 });
+			entries.push_back({ i, i, diagonal });
+		}
+		return LAR::SparseMatrix<double>::FromTriplets(size, size, entries);
+	};
+	const LAR::Vector<double> shifted3 = cyclic(3, 0.0) * LAR::SparseLU<double>(cyclic(3, 0.0)).Solve(rhs);
+	for (size_t i = 0; i < 3; ++i)
+	{
+		REQUIRE(std::abs(shifted3[i] - rhs[i]) < 1e-12);
+	}
+	for (const LAR::SparseOrdering ordering : { LAR::SparseOrdering::Natural, LAR::SparseOrdering::MinimumDegree, LAR::SparseOrdering::NestedDissection })
+	{
+		REQUIRE_THROWS_WITH(LAR::SparseLU<double>(cyclic(50, 0.0), ordering), "Diagonal block is singular.");
+		REQUIRE_THROWS_WITH(LAR::SparseLU<double>(cyclic(50, 1e-3), ordering),
+			"Pivot too small for its supernode; the matrix needs pivoting across supernodes.");
+	}
+}
+
+TEST_CASE("SparseEliminationTest", "[SparseMatrixTest]")
+{
+	// Sparse integer rows plus combinations of earlier rows, so the rank is deficient and the
+	// sparsest pivots are not the leftmost ones.
+	const size_t rows = 40;
+	const size_t cols = 50;
+	std::vector<LAR::Triplet<LAR::Rational>> triplets;
+	unsigned seed = 12345;
+	const auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return (seed >> 16) & 0x7fff; };
+	for (size_t i = 0; i < 30; ++i)
+	{
+		for (size_t k = 0; k < 3; ++k)
+		{
+			triplets.push_back({ i, next() % cols, LAR::Rational(int(next() % 7) - 3, int(next() % 3) + 1) });
+		}
+	}
+	LAR::SparseMatrix<LAR::Rational> a = LAR::SparseMatrix<LAR::Rational>::FromTriplets(rows, cols, triplets);
+	for (size_t i = 30; i < rows; ++i)
+	{
+		const size_t first = next() % 30;
+		const size_t second = next() % 30;
+		a.ForEach([&](const size_t row, const size_t col, const LAR::Rational value)
+		{
+			if (row == first || row == second)
+			{
+				triplets.push_back({ i, col, row == first ? value : value * LAR::Rational(-2) });
+			}
+		});
+	}
+	a = LAR::SparseMatrix<LAR::Rational>::FromTriplets(rows, cols, triplets);
+
+	const LAR::Matrix<LAR::Rational> dense = a.ToDense();
+	const LAR::Matrix<LAR::Rational> echelon = dense.RowEchelonForm();
+	REQUIRE(LAR::RowEchelonForm(a).ToDense() == echelon);
+	REQUIRE(LAR::SparseRowEchelonForm(dense) == echelon);
+	size_t rank = 0;
+	for (size_t i = 0; i < rows; ++i)
+	{
+		bool nonZero = false;
+		for (size_t j = 0; j < cols; ++j)
+		{
+			nonZero = nonZero || echelon(i, j) != LAR::Rational(0);
+		}
+		rank += nonZero ? 1 : 0;
+	}
+	REQUIRE(rank == 30);
+	REQUIRE(LAR::Rank(a) == rank);
+
+	// The documented 2x3 example and an empty matrix.
+	std::vector<std::vector<LAR::Rational>> data = { {1, 2, 3}, {4, 5, 6} };
+	const LAR::Matrix<LAR::Rational> small = data;
+	REQUIRE(LAR::SparseRowEchelonForm(small) == small.RowEchelonForm());
+	REQUIRE(LAR::Rank(LAR::SparseMatrix<LAR::Rational>(3, 4)) == 0);
+	REQUIRE(LAR::RowEchelonForm(LAR::SparseMatrix<LAR::Rational>(3, 4)).GetNonZeros() == 0);
+}
+
+TEST_CASE("BsrMatrixTest", "[SparseMatrixTest]")
+{
+	// Element stiffness-like blocks on a chain of nodes: every element couples nodes e and e + 1.
+	for (const size_t b : { size_t(3), size_t(6), size_t(5) })
+	{
+		const size_t nodes = 40;
+		LAR::BsrAssembler<double> assembler(nodes, nodes, b);
+		LAR::Matrix<double> element(b, b);
+		for (size_t e = 0; e + 1 < nodes; ++e)
+		{
+			for (size_t r = 0; r < b; ++r)
+			{
+				for (size_t c = 0; c < b; ++c)
+				{
+					element(r, c) = std::cos(double(e * b * b + r * b + c));
+				}
+			}
+			assembler.AddBlock(e, e, element);
+			assembler.AddBlock(e + 1, e + 1, element);
+			assembler.AddBlock(e, e + 1, element);
+			assembler.AddBlock(e + 1, e, element);
+		}
+		const LAR::BsrMatrix<double> bsr = assembler.Assemble();
+		REQUIRE(bsr.GetBlocks() == 3 * nodes - 2);
+		REQUIRE(bsr.GetRows() == nodes * b);
+
+		const LAR::Matrix<double> dense = bsr.ToDense();
+		const LAR::SparseMatrix<double> csr = bsr.ToSparse();
+		REQUIRE(csr.ToDense() == dense);
+		REQUIRE(LAR::BsrMatrix<double>(csr, b).ToDense() == dense);
+		REQUIRE(LAR::BsrMatrix<double>(dense, b).GetBlocks() == bsr.GetBlocks());
+		REQUIRE(bsr(b, 2 * b + 1) == dense(b, 2 * b + 1));
+
+		LAR::Vector<double> x(nodes * b);
+		for (size_t i = 0; i < x.GetSize(); ++i)
+		{
+			x[i] = std::sin(double(i));
+		}
+		const LAR::Vector<double> y = bsr * x;
+		const LAR::Vector<double> expected = csr * x;
+		const LAR::Matrix<double> block = LAR::Matrix<double>::Random(nodes * b, 4, -1.0, 1.0);
+		const LAR::Matrix<double> product = bsr * block;
+		const LAR::Matrix<double> expectedProduct = csr * block;
+		for (size_t i = 0; i < nodes * b; ++i)
+		{
+			REQUIRE(std::abs(y[i] - expected[i]) < 1e-12);
+			for (size_t j = 0; j < 4; ++j)
+			{
+				REQUIRE(std::abs(product(i, j) - expectedProduct(i, j)) < 1e-12);
+			}
+		}
+
+		// Reassembly into the fixed pattern.
+		LAR::BsrMatrix<double> reassembled = bsr;
+		reassembled.SetZero();
+		reassembled.AddToBlock(1, 2, element.mData);
+		REQUIRE(reassembled(b, 2 * b) == element(0, 0));
+		REQUIRE_THROWS_AS(reassembled.AddToBlock(0, 5, element.mData), std::invalid_argument);
+	}
+	REQUIRE_THROWS_AS(LAR::BsrMatrix<double>(LAR::Matrix<double>(4, 4), 3), std::invalid_argument);
+}
+
+TEST_CASE("SparseVectorTest", "[SparseMatrixTest]")
+{
+	const size_t size = 1 << 20;
+	std::vector<std::pair<size_t, double>> entries;
+	for (size_t k = 0; k < 100; ++k)
+	{
+		entries.push_back({ (k * 7919 * 104729) % size, double(k % 5) - 2.0 });
+	}
+	entries.push_back({ entries.front().first, 1.5 });
+	const LAR::SparseVector<double> x = LAR::SparseVector<double>::FromEntries(size, entries);
+	REQUIRE(x.GetNonZeros() == 100);
+	REQUIRE(x[entries.front().first] == -0.5);
+	REQUIRE(std::is_sorted(x.Indices().begin(), x.Indices().end()));
+
+	const LAR::Vector<double> dense = x.ToDense();
+	LAR::Vector<double> y(size);
+	for (size_t i = 0; i < size; ++i)
+	{
+		y[i] = double(i % 11);
+	}
+	double expected = 0.0;
+	for (size_t p = 0; p < x.GetNonZeros(); ++p)
+	{
+		expected += x.Values()[p] * y[x.Indices()[p]];
+	}
+	REQUIRE(x.DotProduct(y) == expected);
+	REQUIRE(x.DotProduct(y, LAR::ReductionMode::Naive) == expected);
+	REQUIRE(x.DotProduct(y, LAR::ReductionMode::Pairwise) == Approx(expected));
+	REQUIRE(x.DotProduct(y, LAR::ReductionMode::Kahan) == Approx(expected));
+
+	// Sparse-sparse products by merging and by searching the longer operand.
+	const LAR::SparseVector<double> ySparse(y);
+	REQUIRE(x.DotProduct(ySparse) == Approx(expected));
+	REQUIRE(ySparse.DotProduct(x) == Approx(expected));
+	REQUIRE(x.DotProduct(x) == Approx(dense.DotProduct(dense)));
+	REQUIRE(x.DotProduct(LAR::SparseVector<double>(size)) == 0.0);
+	REQUIRE_THROWS_AS(x.DotProduct(LAR::SparseVector<double>(size - 1)), std::invalid_argument);
+
+	LAR::Vector<double> z = y;
+	LAR::Axpy(2.0, x, z);
+	for (size_t p = 0; p < x.GetNonZeros(); ++p)
+	{
+		const size_t i = x.Indices()[p];
+		REQUIRE(z[i] == y[i] + 2.0 * x.Values()[p]);
+	}
+	REQUIRE(z[1] == y[1] + 2.0 * x[1]);
+
+	// Outer product on a small case against the dense one.
+	const LAR::SparseVector<double> a(6, { 1, 4 }, { 2.0, -1.0 });
+	const LAR::SparseVector<double> b(5, { 0, 2, 3 }, { 1.0, 3.0, 0.5 });
+	const LAR::SparseMatrix<double> outer = a.OuterProduct(b);
+	REQUIRE(outer.GetNonZeros() == 6);
+	REQUIRE(outer.ToDense() == a.ToDense().OuterProduct(b.ToDense()));
+	REQUIRE_THROWS_AS(LAR::SparseVector<double>(5, { 3, 2 }, { 1.0, 1.0 }), std::invalid_argument);
+}
+
+TEST_CASE("SparseReorderingTest", "[SparseMatrixTest]")
+{
+	const size_t grid = 40;
+	const size_t n = grid * grid;
+	const auto bandwidth = [](const LAR::SparseMatrix<double>& a)
+	{
+		size_t result = 0;
+		a.ForEach([&result](const size_t row, const size_t col, const double)
+		{
+			result = std::max(result, row > col ? row - col : col - row);
+		});
+		return result;
+	};
+
+	// Scramble the Laplacian, then let reverse Cuthill-McKee recover a narrow band.
+	std::vector<size_t> scramble(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		scramble[i] = (i * 797) % n;
+	}
+	const LAR::SparseMatrix<double> laplacian = Laplacian(grid);
+	const LAR::SparseMatrix<double> scrambled = LAR::Permute(laplacian, scramble, scramble);
+	REQUIRE(bandwidth(scrambled) > n / 2);
+	const std::vector<size_t> rcm = LAR::FillReducingOrdering(scrambled, LAR::SparseOrdering::ReverseCuthillMcKee);
+	const LAR::SparseMatrix<double> banded = LAR::Permute(scrambled, rcm, rcm);
+	REQUIRE(bandwidth(banded) <= grid + 1);
+	REQUIRE(banded.GetNonZeros() == laplacian.GetNonZeros());
+
+	// Sparse and dense permutation agree, and match a sequence of swaps.
+	LAR::Matrix<double> dense = scrambled.ToDense();
+	dense.PermuteRows(rcm);
+	dense.PermuteCols(rcm);
+	REQUIRE(dense == banded.ToDense());
+	LAR::Matrix<double> swapped = LAR::Matrix<double>::Random(4, 3, -1.0, 1.0);
+	LAR::Matrix<double> permuted = swapped;
+	swapped.SwapRows(0, 2);
+	swapped.SwapRows(2, 3);
+	swapped.SwapCols(0, 1);
+	permuted.PermuteRows({ 2, 1, 3, 0 });
+	permuted.PermuteCols({ 1, 0, 2 });
+	REQUIRE(permuted == swapped);
+	LAR::Matrix<double> rowsOnly = swapped;
+	rowsOnly.PermuteRows({ 2, 1, 3, 0 });
+	REQUIRE(LAR::Permute(LAR::SparseMatrix<double>(swapped), { 2, 1, 3, 0 }, {}).ToDense() == rowsOnly);
+	REQUIRE_THROWS_AS(permuted.PermuteRows({ 0, 0, 1, 2 }), std::invalid_argument);
+
+	// Four parts of equal size with a cut within twice the optimal 2 * grid.
+	const size_t parts = 4;
+	const std::vector<size_t> partition = LAR::GraphPartition(scrambled, parts);
+	std::vector<size_t> sizes(parts, 0);
+	for (const size_t part : partition)
+	{
+		++sizes[part];
+	}
+	for (const size_t size : sizes)
+	{
+		REQUIRE(size >= n / parts * 95 / 100);
+		REQUIRE(size <= n / parts * 105 / 100);
+	}
+	size_t cut = 0;
+	scrambled.ForEach([&](const size_t row, const size_t col, const double)
+	{
+		cut += partition[row] != partition[col] ? 1 : 0;
+	});
+	REQUIRE(cut / 2 <= 4 * grid);
+
+	const std::vector<size_t> order = LAR::PartitionOrdering(partition, parts);
+	for (size_t k = 1; k < n; ++k)
+	{
+		REQUIRE(partition[order[k - 1]] <= partition[order[k]]);
+	}
+}